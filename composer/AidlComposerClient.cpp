@@ -38,6 +38,15 @@ BufferCacheEntry::BufferCacheEntry(BufferCacheEntry &&other) {
   other.mHandle = nullptr;
 }
 
+BufferCacheEntry &BufferCacheEntry::operator=(BufferCacheEntry &&other) {
+  if (this != &other) {
+    clear();
+    mHandle = other.mHandle;
+    other.mHandle = nullptr;
+  }
+  return *this;
+}
+
 BufferCacheEntry &BufferCacheEntry::operator=(buffer_handle_t handle) {
   clear();
   mHandle = handle;
@@ -77,12 +86,12 @@ AidlComposerClient::~AidlComposerClient() {
 
   // no need to grab the mutex as any in-flight hwbinder call would have
   // kept the client alive
-  for (const auto &dpy : mDisplayData) {
+  for (auto &dpy : mDisplayData) {
     ALOGW("%s: Destroying client resources for display %" PRIu64, __FUNCTION__, dpy.first);
 
-    for (const auto &ly : dpy.second.Layers) {
-      hwc_session_->DestroyLayer(dpy.first, ly.first);
-    }
+    dpy.second.Layers.ForEach([&](int64_t layer, LayerBuffers &) {
+      hwc_session_->DestroyLayer(dpy.first, layer);
+    });
 
     if (dpy.second.IsVirtual) {
       destroyVirtualDisplay(dpy.first);
@@ -149,8 +158,8 @@ ScopedAStatus AidlComposerClient::createLayer(int64_t in_display, int32_t in_buf
     auto dpy = mDisplayData.find(in_display);
     // The display entry may have already been removed by onHotplug.
     if (dpy != mDisplayData.end()) {
-      auto ly = dpy->second.Layers.emplace(layer, LayerBuffers()).first;
-      ly->second.Buffers.resize(in_buffer_slot_count);
+      auto ly = dpy->second.Layers.Insert(layer);
+      ly->Buffers.resize(in_buffer_slot_count);
     } else {
       error = Error::BadDisplay;
       // Note: We do not destroy the layer on this error as the hotplug
@@ -189,7 +198,7 @@ ScopedAStatus AidlComposerClient::destroyLayer(int64_t in_display, int64_t in_la
     auto dpy = mDisplayData.find(in_display);
     // The display entry may have already been removed by onHotplug.
     if (dpy != mDisplayData.end()) {
-      dpy->second.Layers.erase(in_layer);
+      dpy->second.Layers.Erase(in_layer);
     }
   }
   return TO_BINDER_STATUS(INT32(error));
@@ -198,9 +207,13 @@ ScopedAStatus AidlComposerClient::destroyLayer(int64_t in_display, int64_t in_la
 ScopedAStatus AidlComposerClient::destroyVirtualDisplay(int64_t in_display) {
   auto error = hwc_session_->DestroyVirtualDisplay(in_display);
   if (error == Error::None) {
-    std::lock_guard<std::mutex> lock(m_display_data_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(m_display_data_mutex_);
+      mDisplayData.erase(in_display);
+    }
 
-    mDisplayData.erase(in_display);
+    std::lock_guard<std::mutex> lock(m_command_mutex_);
+    mCommandEngine->releaseArena(in_display);
   }
 
   return TO_BINDER_STATUS(INT32(error));
@@ -705,6 +718,7 @@ void AidlComposerClient::OnHotplug(void *callbackData, int64_t in_display, bool
     std::lock_guard<std::mutex> lock(client->m_command_mutex_);
     std::lock_guard<std::mutex> lock_d(client->m_display_data_mutex_);
     client->mDisplayData.erase(in_display);
+    client->mCommandEngine->releaseArena(in_display);
   }
 }
 void AidlComposerClient::OnRefresh(void *callback_data, int64_t in_display) {
@@ -1223,8 +1237,11 @@ void AidlComposerClient::CommandEngine::executeSetLayerZOrder(int64_t display, i
 void AidlComposerClient::CommandEngine::executeSetLayerPerFrameMetadata(
     int64_t display, int64_t layer,
     const std::vector<std::optional<PerFrameMetadata>> &perFrameMetadata) {
-  std::vector<int32_t> keys;
-  std::vector<float> values;
+  CommandArena *arena = getArena(display);
+  auto &keys = arena->metadataKeys;
+  auto &values = arena->metadataValues;
+  keys.clear();
+  values.clear();
 
   for (const auto &m : perFrameMetadata) {
     keys.push_back(INT32(m->key));
@@ -1249,9 +1266,13 @@ void AidlComposerClient::CommandEngine::executeSetLayerColorTransform(
 void AidlComposerClient::CommandEngine::executeSetLayerPerFrameMetadataBlobs(
     int64_t display, int64_t layer,
     const std::vector<std::optional<PerFrameMetadataBlob>> &perFrameMetadataBlob) {
-  std::vector<int32_t> keys;
-  std::vector<uint32_t> sizes_of_metablob_;
-  std::vector<uint8_t> blob_of_data_;
+  CommandArena *arena = getArena(display);
+  auto &keys = arena->metadataKeys;
+  auto &sizes_of_metablob_ = arena->metadataBlobSizes;
+  auto &blob_of_data_ = arena->metadataBlobs;
+  keys.clear();
+  sizes_of_metablob_.clear();
+  blob_of_data_.clear();
 
   for (const auto &m : perFrameMetadataBlob) {
     keys.push_back(INT32(m->key));
@@ -1327,9 +1348,10 @@ Error AidlComposerClient::CommandEngine::postPresentDisplay(int64_t display,
     return Error::None;
   }
 
-  std::vector<sdm::LayerId> layers;
-  std::vector<shared_ptr<Fence>> releaseFences;
-  std::vector<::ndk::ScopedFileDescriptor> aidlReleaseFences;
+  CommandArena *arena = getArena(display);
+  auto &layers = arena->layers;
+  auto &releaseFences = arena->releaseFences;
+  auto &aidlReleaseFences = arena->aidlReleaseFences;
   layers.resize(count);
   releaseFences.resize(count);
   err = mClient.hwc_session_->GetReleaseFences(display, &count, layers.data(), &releaseFences);
@@ -1341,23 +1363,28 @@ Error AidlComposerClient::CommandEngine::postPresentDisplay(int64_t display,
   }
 
   // Convert from Fence to ScopedFileDescriptor
+  aidlReleaseFences.clear();
   for (auto const &fd : releaseFences) {
     aidlReleaseFences.emplace_back(::ndk::ScopedFileDescriptor(Fence::Dup(fd)));
   }
+  // The arena keeps its capacity but must not keep the fences alive until the next frame.
+  releaseFences.clear();
 
   mWriter->setPresentFence(display,
                            std::move(::ndk::ScopedFileDescriptor(Fence::Dup(*presentFence))));
-  mWriter->setReleaseFences(display, layers, std::move(aidlReleaseFences));
+  mWriter->setReleaseFences(display, layers, &aidlReleaseFences);
+  aidlReleaseFences.clear();
 
   return Error::None;
 }
 
 Error AidlComposerClient::CommandEngine::postValidateDisplay(int64_t display, uint32_t &types_count,
                                                              uint32_t &reqs_count) {
-  std::vector<sdm::LayerId> changedLayers;
-  std::vector<Composition> compositionTypes;
-  std::vector<sdm::LayerId> requestedLayers;
-  std::vector<int32_t> requestMasks;
+  CommandArena *arena = getArena(display);
+  auto &changedLayers = arena->changedLayers;
+  auto &compositionTypes = arena->compositionTypes;
+  auto &requestedLayers = arena->requestedLayers;
+  auto &requestMasks = arena->requestMasks;
   ClientTargetProperty clientTargetProperty;
   changedLayers.resize(types_count);
   compositionTypes.resize(types_count);
@@ -1404,10 +1431,8 @@ Error AidlComposerClient::CommandEngine::postValidateDisplay(int64_t display, ui
     return err;
   }
 
-  mWriter->setChangedCompositionTypes(display, static_cast<std::vector<int64_t>>(changedLayers),
-                                      compositionTypes);
-  mWriter->setDisplayRequests(display, display_reqs,
-                              static_cast<std::vector<int64_t>>(requestedLayers), requestMasks);
+  mWriter->setChangedCompositionTypes(display, changedLayers, compositionTypes);
+  mWriter->setDisplayRequests(display, display_reqs, requestedLayers, requestMasks);
   static constexpr float kBrightness = 1.f;
   DimmingStage dimmingStage = DimmingStage::NONE;
   mWriter->setClientTargetProperty(display, clientTargetProperty, kBrightness, dimmingStage);
@@ -1492,21 +1517,21 @@ Error AidlComposerClient::CommandEngine::lookupBufferCacheEntryLocked(
       }
       break;
     case BufferCache::LAYER_BUFFERS: {
-      auto ly = dpy->second.Layers.find(layer);
-      if (ly == dpy->second.Layers.end()) {
+      auto ly = dpy->second.Layers.Find(layer);
+      if (!ly) {
         return Error::BadLayer;
       }
-      if (slot < ly->second.Buffers.size()) {
-        entry = &ly->second.Buffers[slot];
+      if (slot < ly->Buffers.size()) {
+        entry = &ly->Buffers[slot];
       }
     } break;
     case BufferCache::LAYER_SIDEBAND_STREAMS: {
-      auto ly = dpy->second.Layers.find(layer);
-      if (ly == dpy->second.Layers.end()) {
+      auto ly = dpy->second.Layers.Find(layer);
+      if (!ly) {
         return Error::BadLayer;
       }
       if (slot == 0) {
-        entry = &ly->second.SidebandStream;
+        entry = &ly->SidebandStream;
       }
     } break;
     default:
@@ -28,6 +28,7 @@
 #include <aidl/vendor/qti/hardware/display/composer3/BnQtiComposer3Client.h>
 #include <aidl/android/hardware/graphics/composer3/BnComposerClient.h>
 #include <aidlcommonsupport/NativeHandle.h>
+#include <utils/slot_map.h>
 #include "hwc_session.h"
 #include "AidlComposerHandleImporter.h"
 #include "AidlComposerServiceWriter.h"
@@ -108,6 +109,7 @@ class BufferCacheEntry {
   BufferCacheEntry(const BufferCacheEntry &other) = delete;
   BufferCacheEntry &operator=(const BufferCacheEntry &other) = delete;
 
+  BufferCacheEntry &operator=(BufferCacheEntry &&other);
   BufferCacheEntry &operator=(buffer_handle_t handle);
   ~BufferCacheEntry();
 
@@ -236,14 +238,17 @@ class AidlComposerClient : public BnComposerClient {
   };
 
   struct DisplayData {
+    // Layers a display usually has, more grow the layer cache on createLayer.
+    static const size_t kLayerCacheSize = 64;
+
     bool IsVirtual;
 
     std::vector<BufferCacheEntry> ClientTargets;
     std::vector<BufferCacheEntry> OutputBuffers;
 
-    std::unordered_map<sdm::LayerId, LayerBuffers> Layers;
+    sdm::SlotMap<LayerBuffers> Layers;
 
-    explicit DisplayData(bool isVirtual) : IsVirtual(isVirtual) {}
+    explicit DisplayData(bool isVirtual) : IsVirtual(isVirtual), Layers(kLayerCacheSize) {}
   };
 
   class CommandEngine {
@@ -258,6 +263,7 @@ class AidlComposerClient : public BnComposerClient {
     Error presentDisplay(int64_t display, shared_ptr<Fence> *presentFence);
 
     void reset() { mWriter->reset(); }
+    void releaseArena(int64_t display) { mArenas.Erase(display); }
 
    private:
     template <typename field, typename... Args, typename... prototypeParams>
@@ -267,8 +273,8 @@ class AidlComposerClient : public BnComposerClient {
         (this->*func)(std::forward<Args>(args)...);
       }
     }
-    __attribute__((always_inline)) inline void writeError(std::string function, Error err) {
-      ALOGW("%s: error: %s", function.c_str(), sdm::to_string(err).c_str());
+    __attribute__((always_inline)) inline void writeError(const char *function, Error err) {
+      ALOGW("%s: error: %s", function, sdm::to_string(err).c_str());
       mWriter->setError(mCommandIndex, INT32(err));
     }
 
@@ -334,6 +340,26 @@ class AidlComposerClient : public BnComposerClient {
     std::unique_ptr<ComposerServiceWriter> mWriter;
     int32_t mCommandIndex;
 
+    // Lists a frame of one display goes through, kept across frames so that they are only
+    // allocated while a display grows its layer count.
+    struct CommandArena {
+      std::vector<sdm::LayerId> layers;
+      std::vector<shared_ptr<Fence>> releaseFences;
+      std::vector<::ndk::ScopedFileDescriptor> aidlReleaseFences;
+      std::vector<sdm::LayerId> changedLayers;
+      std::vector<Composition> compositionTypes;
+      std::vector<sdm::LayerId> requestedLayers;
+      std::vector<int32_t> requestMasks;
+      std::vector<int32_t> metadataKeys;
+      std::vector<float> metadataValues;
+      std::vector<uint32_t> metadataBlobSizes;
+      std::vector<uint8_t> metadataBlobs;
+    };
+
+    CommandArena *getArena(int64_t display) { return mArenas.Insert(display); }
+
+    sdm::SlotMap<CommandArena> mArenas;
+
     // Buffer cache impl
     enum class BufferCache {
       CLIENT_TARGETS,
@@ -17,7 +17,7 @@
 /*
  * Changes from Qualcomm Innovation Center are provided under the following license:
  *
- * Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+ * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
  * SPDX-License-Identifier: BSD-3-Clause-Clear
  */
 
@@ -112,18 +112,20 @@ class ComposerServiceWriter {
     }
   }
 
+  // Takes the fences out of releaseFences, the caller may reuse the vector.
   void setReleaseFences(int64_t display, const std::vector<int64_t> &layers,
-                        std::vector<::ndk::ScopedFileDescriptor> releaseFences) {
+                        std::vector<::ndk::ScopedFileDescriptor> *releaseFences) {
     ReleaseFences releaseFencesCommand;
     releaseFencesCommand.display = display;
+    releaseFencesCommand.layers.reserve(layers.size());
     for (int i = 0; i < layers.size(); i++) {
-      if (releaseFences[i].get() >= 0) {
+      if ((*releaseFences)[i].get() >= 0) {
         ReleaseFences::Layer layer;
         layer.layer = layers[i];
-        layer.fence = std::move(releaseFences[i]);
+        layer.fence = std::move((*releaseFences)[i]);
         releaseFencesCommand.layers.emplace_back(std::move(layer));
       } else {
-        ALOGV("%s: Invalid release fence %d", __FUNCTION__, releaseFences[i].get());
+        ALOGV("%s: Invalid release fence %d", __FUNCTION__, (*releaseFences)[i].get());
       }
     }
     mCommandsResults.emplace_back(std::move(releaseFencesCommand));
@@ -139,8 +141,14 @@ class ComposerServiceWriter {
     mCommandsResults.emplace_back(std::move(clientTargetPropertyWithBrightness));
   }
 
+  // The results go to the caller, the next set is reserved at the size of this one so that it
+  // does not reallocate while it fills.
   std::vector<CommandResultPayload> getPendingCommandResults() {
-    return std::move(mCommandsResults);
+    size_t count = mCommandsResults.size();
+    std::vector<CommandResultPayload> results = std::move(mCommandsResults);
+    mCommandsResults.clear();
+    mCommandsResults.reserve(count);
+    return results;
   }
 
  private:
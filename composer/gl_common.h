@@ -43,17 +43,11 @@
 #include <string>
 
 #include "glengine.h"
+#include "gl_rect.h"
 #include "EGLImageWrapper.h"
 
 namespace sdm {
 
-struct GLRect {
-  float left = 0.0f;
-  float top = 0.0f;
-  float right = 0.0f;
-  float bottom = 0.0f;
-};
-
 struct GLContext {
   EGLDisplay egl_display = EGL_NO_DISPLAY;
   EGLContext egl_context = EGL_NO_CONTEXT;
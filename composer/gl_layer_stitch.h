@@ -30,7 +30,7 @@
 /*
  * Changes from Qualcomm Innovation Center are provided under the following license:
  *
- * Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+ * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
  * SPDX-License-Identifier: BSD-3-Clause-Clear
  */
 
@@ -42,6 +42,7 @@
 
 namespace sdm {
 struct StitchParams {
+  uint64_t id = 0;  // Matches the job across frames, e.g. the layer id
   const native_handle_t *src_hnd = nullptr;
   const native_handle_t *dst_hnd = nullptr;
   GLRect src_rect;
@@ -49,13 +50,21 @@ struct StitchParams {
   GLRect scissor_rect;
   shared_ptr<Fence> src_acquire_fence = nullptr;
   shared_ptr<Fence> dst_acquire_fence = nullptr;
+  // Destination areas changed since the previous frame, used when full_update is false. No dirty
+  // rects means the source has not changed. Only valid when the job was stitched in the previous
+  // Blit, other jobs are redrawn in full.
+  bool full_update = true;
+  std::vector<GLRect> dirty_rects = {};
 };
 
 class GLLayerStitch {
  public:
   static GLLayerStitch *GetInstance(bool secure);
   static void Destroy(GLLayerStitch *intf);
+  // Returns a release fence per source in src_release_fences, null for sources that were not
+  // read, and the fence for the whole stitch in release_fence.
   virtual int Blit(const std::vector<StitchParams> &stitch_params,
+                   std::vector<shared_ptr<Fence>> *src_release_fences,
                    shared_ptr<Fence> *release_fence) = 0;
 
  protected:
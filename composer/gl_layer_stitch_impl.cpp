@@ -30,10 +30,11 @@
 /*
  * Changes from Qualcomm Innovation Center are provided under the following license:
  *
- * Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+ * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
  * SPDX-License-Identifier: BSD-3-Clause-Clear
  */
 
+#include <map>
 #include <vector>
 
 #include "gl_layer_stitch_impl.h"
@@ -75,10 +76,6 @@ const char *kConvertRenderRGBShader =
     "    color = texture(u_sTexture, uv);                                  \n"
     "}                                                                     \n";
 
-static bool IsValid(const GLRect &rect) {
-  return ((rect.right - rect.left) && (rect.bottom - rect.top));
-}
-
 int GLLayerStitchImpl::CreateContext(bool secure) {
   ctx_.egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
   EGL(eglBindAPI(EGL_OPENGL_ES_API));
@@ -142,51 +139,78 @@ int GLLayerStitchImpl::CreateContext(bool secure) {
 }
 
 int GLLayerStitchImpl::Blit(const std::vector<StitchParams> &stitch_params,
+                            std::vector<shared_ptr<Fence>> *src_release_fences,
                             shared_ptr<Fence> *release_fence) {
   DTRACE_SCOPED();
 
-  std::vector<shared_ptr<Fence>> acquire_fences;
   std::vector<shared_ptr<Fence>> release_fences;
-  bool can_batch = !NeedsGLScissor(stitch_params);
-  for (auto &info : stitch_params) {
+  std::map<uint64_t, StitchSlot> slots;
+  src_release_fences->assign(stitch_params.size(), nullptr);
+  for (size_t i = 0; i < stitch_params.size(); i++) {
+    const StitchParams &info = stitch_params.at(i);
+    auto it = slots_.find(info.id);
+    const StitchSlot *last = (it != slots_.end()) ? &it->second : nullptr;
+    const std::vector<GLRect> &tiles = GetDirtyTiles(info, last);
+    StitchSlot &slot = slots[info.id];
+    slot.src_hnd = info.src_hnd;
+    slot.dst_hnd = info.dst_hnd;
+    slot.dst_rect = info.dst_rect;
+    slot.scissor_rect = info.scissor_rect;
+    if (tiles.empty()) {
+      // Source is unchanged and was not read.
+      continue;
+    }
+
+    // Each source waits on its own acquire fence and gets its own release fence, so that it is
+    // released as soon as its tiles are drawn rather than with the whole stitch.
+    WaitOnInputFence({info.src_acquire_fence});
     SetSourceBuffer(info.src_hnd);
     SetDestinationBuffer(info.dst_hnd);
     SetViewport(info.dst_rect);
-    ClearWithTransparency(info.scissor_rect);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-
-    acquire_fences.push_back(info.src_acquire_fence);
-
-    if (!can_batch) {
-      // Trigger flush and cache release fence.
-      WaitOnInputFence(acquire_fences);
-      shared_ptr<Fence> temp_release_fence = nullptr;
-      CreateOutputFence(&temp_release_fence);
-      release_fences.push_back(temp_release_fence);
-      acquire_fences = {};
+    for (auto &tile : tiles) {
+      DrawTile(tile, IsValid(info.scissor_rect));
     }
-  }
 
-  if (can_batch) {
-    // Create output fence for client to wait on.
-    WaitOnInputFence(acquire_fences);
-    CreateOutputFence(release_fence);
-  } else {
-    // Merge all fd's and return one.
-    *release_fence = Fence::Merge(release_fences, false);
+    CreateOutputFence(&src_release_fences->at(i));
+    release_fences.push_back(src_release_fences->at(i));
   }
+  // Jobs missing from this frame lose their slot, they missed its damage.
+  slots_.swap(slots);
+
+  // Merge all fd's and return one.
+  *release_fence = Fence::Merge(release_fences, false);
 
   return 0;
 }
 
-int GLLayerStitchImpl::NeedsGLScissor(const std::vector<StitchParams> &stitch_params) {
-  for (auto &info : stitch_params) {
-    if (IsValid(info.scissor_rect)) {
-      return true;
-    }
+const std::vector<GLRect> &GLLayerStitchImpl::GetDirtyTiles(const StitchParams &info,
+                                                           const StitchSlot *slot) {
+  // A job owns its slice of the destination when it has one, the slice is cleared around the
+  // layer.
+  const GLRect &bounds = IsValid(info.scissor_rect) ? info.scissor_rect : info.dst_rect;
+
+  // The destination keeps the previous stitch, a job redrawn at the same place as in the last
+  // frame only needs its changed tiles. A new job, or a new source buffer without damage, is
+  // redrawn in full.
+  bool full_update = info.full_update || !slot;
+  if (!full_update) {
+    bool same_target = (slot->dst_hnd == info.dst_hnd) && IsEqual(slot->dst_rect, info.dst_rect) &&
+                       IsEqual(slot->scissor_rect, info.scissor_rect);
+    bool src_changed = (slot->src_hnd != info.src_hnd);
+    full_update = !same_target || (src_changed && info.dirty_rects.empty());
   }
 
-  return false;
+  return stitch_tiles_.Get(bounds, full_update, info.dirty_rects);
+}
+
+void GLLayerStitchImpl::DrawTile(const GLRect &tile, bool clear) {
+  GL(glEnable(GL_SCISSOR_TEST));
+  GL(glScissor(tile.left, tile.top, tile.right - tile.left, tile.bottom - tile.top));
+  if (clear) {
+    GL(glClearColor(0, 0, 0, 0));
+    GL(glClear(GL_COLOR_BUFFER_BIT));
+  }
+  GL(glDrawArrays(GL_TRIANGLES, 0, 3));
 }
 
 int GLLayerStitchImpl::Init() {
@@ -200,22 +224,6 @@ int GLLayerStitchImpl::Deinit() {
   return 0;
 }
 
-void GLLayerStitchImpl::ClearWithTransparency(const GLRect &scissor_rect) {
-  if (!IsValid(scissor_rect)) {
-    // Disable scissor.
-    GL(glDisable(GL_SCISSOR_TEST));
-    return;
-  }
-
-  DTRACE_SCOPED();
-  // Enable scissor test.
-  GL(glEnable(GL_SCISSOR_TEST));
-  GL(glScissor(scissor_rect.left, scissor_rect.top, scissor_rect.right - scissor_rect.left,
-               scissor_rect.bottom - scissor_rect.top));
-  GL(glClearColor(0, 0, 0, 0));
-  GL(glClear(GL_COLOR_BUFFER_BIT));
-}
-
 void GLLayerStitchImpl::InitContext() {
   // eglMakeCurrent attaches rendering context to rendering surface.
   MakeCurrent(&ctx_);
@@ -230,6 +238,6 @@ void GLLayerStitchImpl::InitContext() {
 
 GLLayerStitchImpl::~GLLayerStitchImpl() {}
 
-GLLayerStitchImpl::GLLayerStitchImpl(bool secure) : secure_(secure) {}
+GLLayerStitchImpl::GLLayerStitchImpl(bool secure) : secure_(secure), stitch_tiles_(kTileSize) {}
 
 }  // namespace sdm
@@ -30,7 +30,7 @@
 /*
  * Changes from Qualcomm Innovation Center are provided under the following license:
  *
- * Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+ * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
  * SPDX-License-Identifier: BSD-3-Clause-Clear
  */
 
@@ -39,10 +39,12 @@
 
 #include <sync/sync.h>
 
+#include <map>
 #include <vector>
 
 #include "gl_layer_stitch.h"
 #include "gl_common.h"
+#include "gl_stitch_tiles.h"
 
 namespace sdm {
 
@@ -51,18 +53,31 @@ class GLLayerStitchImpl : public GLLayerStitch, public GLCommon {
   explicit GLLayerStitchImpl(bool secure);
   virtual ~GLLayerStitchImpl();
   virtual int Blit(const std::vector<StitchParams> &stitch_params,
+                   std::vector<shared_ptr<Fence>> *src_release_fences,
                    shared_ptr<Fence> *release_fence);
   virtual int CreateContext(bool secure);
   virtual int Init();
   virtual int Deinit();
 
  private:
+  // Destination state of a stitch job in the previous frame, keyed by StitchParams::id.
+  struct StitchSlot {
+    const native_handle_t *src_hnd = nullptr;
+    const native_handle_t *dst_hnd = nullptr;
+    GLRect dst_rect;
+    GLRect scissor_rect;
+  };
+
+  static const int kTileSize = 128;
+
   bool secure_ = false;
   GLContext ctx_;
+  std::map<uint64_t, StitchSlot> slots_ = {};
+  StitchTiles stitch_tiles_;
 
   void InitContext();
-  void ClearWithTransparency(const GLRect &scissor_rect);
-  int NeedsGLScissor(const std::vector<StitchParams> &stitch_params);
+  const std::vector<GLRect> &GetDirtyTiles(const StitchParams &info, const StitchSlot *slot);
+  void DrawTile(const GLRect &tile, bool clear);
 };
 
 }  // namespace sdm
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __GL_RECT_H__
+#define __GL_RECT_H__
+
+namespace sdm {
+
+struct GLRect {
+  float left = 0.0f;
+  float top = 0.0f;
+  float right = 0.0f;
+  float bottom = 0.0f;
+};
+
+inline bool IsValid(const GLRect &rect) {
+  return ((rect.right - rect.left) && (rect.bottom - rect.top));
+}
+
+inline bool IsEqual(const GLRect &rect1, const GLRect &rect2) {
+  return ((rect1.left == rect2.left) && (rect1.top == rect2.top) &&
+          (rect1.right == rect2.right) && (rect1.bottom == rect2.bottom));
+}
+
+}  // namespace sdm
+
+#endif  // __GL_RECT_H__
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <math.h>
+#include <utils/constants.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gl_stitch_tiles.h"
+
+namespace sdm {
+
+const std::vector<GLRect> &StitchTiles::Get(const GLRect &bounds, bool full_update,
+                                            const std::vector<GLRect> &dirty_rects) {
+  tiles_.clear();
+  if (!IsValid(bounds)) {
+    return tiles_;
+  }
+
+  if (full_update) {
+    tiles_.push_back(bounds);
+    return tiles_;
+  }
+
+  int columns = (INT(ceilf(bounds.right - bounds.left)) + tile_size_ - 1) / tile_size_;
+  int rows = (INT(ceilf(bounds.bottom - bounds.top)) + tile_size_ - 1) / tile_size_;
+  dirty_tiles_.assign(columns * rows, 0);
+  for (auto &rect : dirty_rects) {
+    float left = std::max(rect.left, bounds.left) - bounds.left;
+    float top = std::max(rect.top, bounds.top) - bounds.top;
+    float right = std::min(rect.right, bounds.right) - bounds.left;
+    float bottom = std::min(rect.bottom, bounds.bottom) - bounds.top;
+    if ((left >= right) || (top >= bottom)) {
+      continue;
+    }
+
+    int column_end = std::min((INT(ceilf(right)) + tile_size_ - 1) / tile_size_, columns);
+    int row_end = std::min((INT(ceilf(bottom)) + tile_size_ - 1) / tile_size_, rows);
+    for (int row = INT(top) / tile_size_; row < row_end; row++) {
+      for (int column = INT(left) / tile_size_; column < column_end; column++) {
+        dirty_tiles_.at(row * columns + column) = 1;
+      }
+    }
+  }
+
+  for (int row = 0; row < rows; row++) {
+    int column = 0;
+    while (column < columns) {
+      if (!dirty_tiles_.at(row * columns + column)) {
+        column++;
+        continue;
+      }
+
+      GLRect tile;
+      tile.left = bounds.left + FLOAT(column * tile_size_);
+      tile.top = bounds.top + FLOAT(row * tile_size_);
+      while ((column < columns) && dirty_tiles_.at(row * columns + column)) {
+        column++;
+      }
+      tile.right = std::min(bounds.left + FLOAT(column * tile_size_), bounds.right);
+      tile.bottom = std::min(bounds.top + FLOAT((row + 1) * tile_size_), bounds.bottom);
+
+      bool merged = false;
+      for (auto &drawn : tiles_) {
+        if ((drawn.bottom == tile.top) && (drawn.left == tile.left) &&
+            (drawn.right == tile.right)) {
+          drawn.bottom = tile.bottom;
+          merged = true;
+          break;
+        }
+      }
+      if (!merged) {
+        tiles_.push_back(tile);
+      }
+    }
+  }
+
+  return tiles_;
+}
+
+}  // namespace sdm
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __GL_STITCH_TILES_H__
+#define __GL_STITCH_TILES_H__
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "gl_rect.h"
+
+namespace sdm {
+
+// Splits the area a stitch job owns into tiles and returns the ones covered by its damage. Has no
+// GL state, the stitch draws one scissored pass per returned rect.
+class StitchTiles {
+ public:
+  explicit StitchTiles(int tile_size) : tile_size_(tile_size) {}
+
+  // Rects of bounds to redraw for dirty_rects, which are clipped to bounds. Tiles are aligned to
+  // the top left of bounds and clipped at its bottom right edge. Dirty tiles next to each other
+  // in a row are returned as one rect, which extends the rect of the row above when both span the
+  // same columns. A full update returns bounds as is.
+  const std::vector<GLRect> &Get(const GLRect &bounds, bool full_update,
+                                 const std::vector<GLRect> &dirty_rects);
+
+ private:
+  int tile_size_ = 0;
+  std::vector<uint8_t> dirty_tiles_ = {};
+  std::vector<GLRect> tiles_ = {};
+};
+
+}  // namespace sdm
+
+#endif  // __GL_STITCH_TILES_H__
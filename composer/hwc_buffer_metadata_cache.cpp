@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <QtiGralloc.h>
+#include <gralloctypes/Gralloc4.h>
+#include <utils/debug.h>
+#include <gr_utils.h>
+
+#include "hwc_buffer_metadata_cache.h"
+#include "hwc_debugger.h"
+
+#define __CLASS__ "HWCBufferMetadataCache"
+
+using aidl::android::hardware::graphics::common::StandardMetadataType;
+
+namespace sdm {
+
+const BufferMetadataSnapshot *HWCBufferMetadataCache::Get(const native_handle_t *handle) {
+  if (!handle) {
+    return nullptr;
+  }
+
+  void *hnd = const_cast<native_handle_t *>(handle);
+  uint64_t handle_id = 0;
+  if (gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::BUFFER_ID, &handle_id) !=
+      gralloc::Error::NONE) {
+    DLOGW("Failed to retrieve buffer id");
+  }
+  // The fd belongs to the handle rather than the buffer, a handle imported again at the same
+  // address for the same buffer can carry a different one.
+  int32_t fd = -1;
+  gralloc::GetMetaDataValue(hnd, qtigralloc::MetadataType_FD.value, &fd);
+
+  use_count_++;
+  Entry *lru = &entries_[0];
+  for (auto &entry : entries_) {
+    if (entry.snapshot.handle == handle && entry.snapshot.handle_id == handle_id) {
+      entry.snapshot.fd = fd;
+      entry.last_use = use_count_;
+      hits_++;
+      return &entry.snapshot;
+    }
+    if (entry.last_use < lru->last_use) {
+      lru = &entry;
+    }
+  }
+
+  misses_++;
+  Fill(handle, handle_id, &lru->snapshot);
+  lru->snapshot.fd = fd;
+  lru->last_use = use_count_;
+  return &lru->snapshot;
+}
+
+void HWCBufferMetadataCache::Clear() {
+  entries_ = {};
+  use_count_ = 0;
+}
+
+void HWCBufferMetadataCache::Fill(const native_handle_t *handle, uint64_t handle_id,
+                                  BufferMetadataSnapshot *snapshot) {
+  void *hnd = const_cast<native_handle_t *>(handle);
+  *snapshot = {};
+  snapshot->handle = handle;
+  snapshot->handle_id = handle_id;
+
+  gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::PIXEL_FORMAT_REQUESTED,
+                            &snapshot->format);
+  gralloc::GetMetaDataValue(hnd, (int64_t)qtigralloc::MetadataType_PrivateFlags.value,
+                            &snapshot->private_flags);
+  gralloc::GetMetaDataValue(hnd, (int64_t)qtigralloc::MetadataType_BufferType.value,
+                            &snapshot->buffer_type);
+  gralloc::GetMetaDataValue(hnd, android::gralloc4::MetadataType_Name.value, &snapshot->name);
+
+  if (gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::WIDTH,
+                                &snapshot->unaligned_width) != gralloc::Error::NONE) {
+    DLOGE("Failed to retrieve unaligned width");
+  }
+  if (gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::HEIGHT,
+                                &snapshot->unaligned_height) != gralloc::Error::NONE) {
+    DLOGE("Failed to retrieve unaligned height");
+  }
+  if (gralloc::GetMetaDataValue(hnd, QTI_ALIGNED_WIDTH_IN_PIXELS, &snapshot->aligned_width) !=
+      gralloc::Error::NONE) {
+    DLOGW("Failed to retrieve aligned width");
+  }
+  if (gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::ALLOCATION_SIZE,
+                                &snapshot->allocation_size) != gralloc::Error::NONE) {
+    DLOGW("Failed to retrieve allocation size");
+  }
+  if (gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::USAGE, &snapshot->usage) !=
+      gralloc::Error::NONE) {
+    DLOGW("Failed to retrieve handle usage");
+  }
+}
+
+}  // namespace sdm
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __HWC_BUFFER_METADATA_CACHE_H__
+#define __HWC_BUFFER_METADATA_CACHE_H__
+
+#include <cutils/native_handle.h>
+
+#include <array>
+#include <string>
+
+namespace sdm {
+
+// Buffer attributes fixed by gralloc at allocation time. These never change for a given
+// buffer id, so they are read once and reused every frame the buffer is latched again.
+struct BufferMetadataSnapshot {
+  const native_handle_t *handle = nullptr;
+  uint64_t handle_id = 0;
+  int32_t fd = -1;  // Owned by the handle, read from the current one on every Get
+  int32_t format = 0;
+  int32_t private_flags = 0;
+  int32_t buffer_type = 0;
+  uint64_t unaligned_width = 0;
+  uint64_t unaligned_height = 0;
+  uint32_t aligned_width = 0;
+  uint32_t allocation_size = 0;
+  uint64_t usage = 0;
+  std::string name;
+};
+
+// Small per-layer LRU of snapshots, sized for a producer cycling through its swapchain.
+// Entries are keyed by handle and validated against the gralloc buffer id, so a handle
+// address reused for a new allocation is refilled instead of served stale.
+// Not thread safe; owned and accessed by a single HWCLayer.
+class HWCBufferMetadataCache {
+ public:
+  const BufferMetadataSnapshot *Get(const native_handle_t *handle);
+  void Clear();
+  uint64_t GetHits() const { return hits_; }
+  uint64_t GetMisses() const { return misses_; }
+
+ private:
+  static const uint32_t kMaxEntries = 8;
+
+  struct Entry {
+    BufferMetadataSnapshot snapshot;
+    uint64_t last_use = 0;
+  };
+
+  void Fill(const native_handle_t *handle, uint64_t handle_id, BufferMetadataSnapshot *snapshot);
+
+  std::array<Entry, kMaxEntries> entries_ = {};
+  uint64_t use_count_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+}  // namespace sdm
+
+#endif  // __HWC_BUFFER_METADATA_CACHE_H__
@@ -30,7 +30,7 @@
 /*
  * Changes from Qualcomm Innovation Center are provided under the following license:
  *
- * Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+ * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
  * SPDX-License-Identifier: BSD-3-Clause-Clear
  */
 
@@ -40,6 +40,8 @@
 #include <utils/debug.h>
 #include <utils/fence.h>
 
+#include <algorithm>
+
 #include "hwc_debugger.h"
 #include "hwc_buffer_sync_handler.h"
 
@@ -114,4 +116,26 @@ void HWCBufferSyncHandler::GetSyncInfo(int fd, std::ostringstream *os) {
   }
 }
 
+int HWCBufferSyncHandler::GetSignalTime(int fd, int64_t *timestamp_ns) {
+  struct sync_file_info *file_info = sync_file_info(fd);
+  if (!file_info) {
+    return -EINVAL;
+  }
+
+  int error = 0;
+  struct sync_fence_info *fence_info = sync_get_fence_info(file_info);
+  if (file_info->status != 1 || !fence_info) {
+    error = (file_info->status == 0) ? -EBUSY : -EINVAL;
+  } else {
+    // A merged fence signals with the last of its fences.
+    *timestamp_ns = 0;
+    for (size_t i = 0; i < file_info->num_fences; i++) {
+      *timestamp_ns = std::max(*timestamp_ns, static_cast<int64_t>(fence_info[i].timestamp_ns));
+    }
+  }
+  sync_file_info_free(file_info);
+
+  return error;
+}
+
 }  // namespace sdm
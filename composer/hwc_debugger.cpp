@@ -46,6 +46,18 @@ HWCDebugHandler HWCDebugHandler::debug_handler_;
 
 HWCDebugHandler::HWCDebugHandler() {
   DebugHandler::Set(HWCDebugHandler::Get());
+  // Verbose() prints nothing until a verbose level is set, skip the call altogether.
+  DebugHandler::SetLogLevel(display::kLogLevelDebug);
+}
+
+void HWCDebugHandler::UpdateLogState() {
+  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  DebugHandler::SetLogLevel(debug_handler_.verbose_level_ ? display::kLogLevelVerbose
+                                                          : display::kLogLevelDebug);
+}
+
+void HWCDebugHandler::RefreshTraceEnabled() {
+  DebugHandler::SetTraceEnabled(atrace_is_tag_enabled(ATRACE_TAG));
 }
 
 void HWCDebugHandler::DebugAll(bool enable, int verbose_level) {
@@ -61,7 +73,7 @@ void HWCDebugHandler::DebugAll(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugResources(bool enable, int verbose_level) {
@@ -73,7 +85,7 @@ void HWCDebugHandler::DebugResources(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugStrategy(bool enable, int verbose_level) {
@@ -85,7 +97,7 @@ void HWCDebugHandler::DebugStrategy(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugIWE(bool enable, int verbose_level) {
@@ -97,7 +109,7 @@ void HWCDebugHandler::DebugIWE(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugWbUsage(bool enable, int verbose_level) {
@@ -109,7 +121,7 @@ void HWCDebugHandler::DebugWbUsage(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugCompManager(bool enable, int verbose_level) {
@@ -121,7 +133,7 @@ void HWCDebugHandler::DebugCompManager(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugDriverConfig(bool enable, int verbose_level) {
@@ -133,7 +145,7 @@ void HWCDebugHandler::DebugDriverConfig(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugRotator(bool enable, int verbose_level) {
@@ -145,7 +157,7 @@ void HWCDebugHandler::DebugRotator(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugScalar(bool enable, int verbose_level) {
@@ -157,7 +169,7 @@ void HWCDebugHandler::DebugScalar(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugQdcm(bool enable, int verbose_level) {
@@ -169,7 +181,7 @@ void HWCDebugHandler::DebugQdcm(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugClient(bool enable, int verbose_level) {
@@ -181,7 +193,7 @@ void HWCDebugHandler::DebugClient(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugDisplay(bool enable, int verbose_level) {
@@ -193,7 +205,7 @@ void HWCDebugHandler::DebugDisplay(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::DebugQos(bool enable, int verbose_level) {
@@ -207,7 +219,7 @@ void HWCDebugHandler::DebugQos(bool enable, int verbose_level) {
     debug_handler_.verbose_level_ = 0;
   }
 
-  DebugHandler::SetLogMask(debug_handler_.log_mask_);
+  UpdateLogState();
 }
 
 void HWCDebugHandler::Error(const char *fmt, ...) {
@@ -69,6 +69,8 @@ class HWCDebugHandler : public DebugHandler {
   static int GetIdleTimeoutMs();
   static void DebugIWE(bool enable, int verbose_level);
   static void DebugWbUsage(bool enable, int verbose_level);
+  // Caches the trace tag state for DTRACE_SCOPED, called once per frame.
+  static void RefreshTraceEnabled();
 
   virtual void Error(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
   virtual void Warning(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
@@ -82,6 +84,8 @@ class HWCDebugHandler : public DebugHandler {
   virtual int GetProperty(const char *property_name, char *value);
 
  private:
+  static void UpdateLogState();
+
   static HWCDebugHandler debug_handler_;
   std::bitset<32> log_mask_;
   int32_t verbose_level_;
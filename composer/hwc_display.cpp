@@ -35,9 +35,12 @@
 #include <utils/utils.h>
 #include <utils/formats.h>
 #include <utils/rect.h>
+#include <utils/layer_stack_serializer.h>
+#include <utils/frame_dump_writer.h>
 #include <QtiGralloc.h>
 
 #include <algorithm>
+#include <fstream>
 #include <iomanip>
 #include <map>
 #include <sstream>
@@ -716,15 +719,21 @@ void HWCDisplay::BuildLayerStack() {
     void *hdl = reinterpret_cast<native_handle_t *>(layer->input_buffer.buffer_id);
     if (hdl) {
       int buffer_type;
-      gralloc::GetMetaDataValue(hdl, QTI_BUFFER_TYPE, &buffer_type);
+      int32_t handle_flags;
+      const BufferMetadataSnapshot *snapshot = hwc_layer->GetBufferMetadata();
+      if (snapshot && snapshot->handle == hdl) {
+        buffer_type = snapshot->buffer_type;
+        handle_flags = snapshot->private_flags;
+      } else {
+        gralloc::GetMetaDataValue(hdl, QTI_BUFFER_TYPE, &buffer_type);
+        gralloc::GetMetaDataValue(hdl, QTI_PRIVATE_FLAGS, &handle_flags);
+      }
       if (buffer_type == BUFFER_TYPE_VIDEO) {
         layer_stack_.flags.video_present = true;
         is_video = true;
       }
       // TZ Protected Buffer - L1
       // Gralloc Usage Protected Buffer - L3 - which needs to be treated as Secure & avoid fallback
-      int32_t handle_flags;
-      gralloc::GetMetaDataValue(hdl, QTI_PRIVATE_FLAGS, &handle_flags);
       if (handle_flags & qtigralloc::PRIV_FLAGS_SECURE_BUFFER) {
         layer_stack_.flags.secure_present = true;
         is_secure = true;
@@ -1362,11 +1371,27 @@ HWC3::Error HWCDisplay::SetFrameDumpConfig(uint32_t count, uint32_t bit_mask_lay
     dump_input_frame_index_ = 0;
   }
 
+  if (bit_mask_layer_type & (1 << LAYER_STACK_DUMP)) {
+    dump_layer_stack_count_ = count;
+    dump_layer_stack_index_ = 0;
+  }
+
   if (tone_mapper_) {
     tone_mapper_->SetFrameDumpConfig(count);
   }
 
-  DLOGI("num_frame_dump %d, input_layer_dump_enable %d", dump_frame_count_, dump_input_layers_);
+  if (dump_input_layers_ || (bit_mask_layer_type & (1 << OUTPUT_LAYER_DUMP))) {
+    int slots = 0, staging_mb = 0, compress = 0;
+    HWCDebugHandler::Get()->GetProperty(FRAME_DUMP_STAGING_SLOTS, &slots);
+    HWCDebugHandler::Get()->GetProperty(FRAME_DUMP_STAGING_MB, &staging_mb);
+    HWCDebugHandler::Get()->GetProperty(FRAME_DUMP_COMPRESS, &compress);
+    FrameDumpWriter::GetInstance()->Configure(UINT32(std::max(slots, 0)),
+                                              UINT64(std::max(staging_mb, 0)) * 1024 * 1024,
+                                              compress != 0);
+  }
+
+  DLOGI("num_frame_dump %d, input_layer_dump_enable %d, layer_stack_dump %d", dump_frame_count_,
+        dump_input_layers_, dump_layer_stack_count_);
 
   return HWC3::Error::None;
 }
@@ -1423,24 +1448,10 @@ HWC3::Error HWCDisplay::SetFrameDumpConfig(uint32_t count, uint32_t bit_mask_lay
   }
   DLOGI("Output Frame dumping buffer is allocated!");
 
-  void *buffer = mmap(NULL, output_buffer_info_.alloc_buffer_info.size, PROT_READ | PROT_WRITE,
-                      MAP_SHARED, output_buffer_info_.alloc_buffer_info.fd, 0);
-
-  if (buffer == MAP_FAILED) {
-    DLOGE("mmap failed with err %d", errno);
-    std::unique_lock<std::mutex> lock(frame_dump_config_lock_);
-    buffer_allocator_->FreeBuffer(&output_buffer_info_);
-    output_buffer_info_ = {};
-    dump_frame_count_ = 0;
-    DLOGI("Output Frame dumping buffer is freed!");
-    return HWC3::Error::NoResources;
-  }
-
   const native_handle_t *handle = static_cast<native_handle_t *>(output_buffer_info_.private_data);
   HWC3::Error err = SetReadbackBuffer(handle, nullptr, cwb_config, kCWBClientFrameDump);
   if (err != HWC3::Error::None) {
     std::unique_lock<std::mutex> lock(frame_dump_config_lock_);
-    munmap(buffer, output_buffer_info_.alloc_buffer_info.size);
     buffer_allocator_->FreeBuffer(&output_buffer_info_);
     output_buffer_info_ = {};
     dump_frame_count_ = 0;
@@ -1448,7 +1459,6 @@ HWC3::Error HWCDisplay::SetFrameDumpConfig(uint32_t count, uint32_t bit_mask_lay
     return err;
   }
   dump_output_to_file_ = dump_output_to_file;
-  output_buffer_base_ = buffer;
   output_buffer_cwb_config_ = cwb_config;
 
   return HWC3::Error::None;
@@ -1546,6 +1556,7 @@ HWC3::Error HWCDisplay::PrepareLayerStack(uint32_t *out_num_types, uint32_t *out
 
   UpdateRefreshRate();
   UpdateActiveConfig();
+  DumpLayerStack();
   DisplayError error = display_intf_->Prepare(&layer_stack_);
   auto status = HandlePrepareError(error);
   if (status != HWC3::Error::None) {
@@ -1809,6 +1820,7 @@ HWC3::Error HWCDisplay::CommitOrPrepare(bool validate_only, shared_ptr<Fence> *o
 
   layer_stack_.validate_only = validate_only;
 
+  DumpLayerStack();
   DisplayError error = display_intf_->CommitOrPrepare(&layer_stack_);
   // Mask error if needed.
   auto status = HandlePrepareError(error);
@@ -1986,6 +1998,32 @@ DisplayError HWCDisplay::SetMaxMixerStages(uint32_t max_mixer_stages) {
   return error;
 }
 
+void HWCDisplay::DumpLayerStack() {
+  if (!dump_layer_stack_count_) {
+    return;
+  }
+
+  // Capture what the client handed to SDM, before Prepare rewrites the composition types.
+  char dump_file_name[PATH_MAX];
+  snprintf(dump_file_name, sizeof(dump_file_name), "%s/layer_stack_disp_id_%02u_%s.txt",
+           HWCDebugHandler::DumpDir(), UINT32(id_), GetDisplayString());
+
+  std::ofstream ofs(dump_file_name, dump_layer_stack_index_ ? std::ios::app : std::ios::trunc);
+  if (!ofs) {
+    DLOGW("Failed to open %s errno = %d, desc = %s", dump_file_name, errno, strerror(errno));
+    dump_layer_stack_count_ = 0;
+    return;
+  }
+
+  WriteLayerStack(layer_stack_, dump_layer_stack_index_, &ofs);
+  dump_layer_stack_index_++;
+  dump_layer_stack_count_--;
+
+  if (!dump_layer_stack_count_) {
+    DLOGI("Layer stack dump %s: %u frames", dump_file_name, dump_layer_stack_index_);
+  }
+}
+
 void HWCDisplay::DumpInputBuffers() {
   char dir_path[PATH_MAX];
   int status;
@@ -2025,7 +2063,6 @@ void HWCDisplay::DumpInputBuffers() {
 
     const native_handle_t *handle =
         reinterpret_cast<const native_handle_t *>(layer->input_buffer.buffer_id);
-    Fence::Wait(layer->input_buffer.acquire_fence);
 
     if (!handle) {
       DLOGW(
@@ -2037,13 +2074,6 @@ void HWCDisplay::DumpInputBuffers() {
 
     DLOGI("Dump layer[%d] of %lu handle %p", i, layer_stack_.layers.size(), handle);
 
-    void *base_ptr = NULL;
-    int error = buffer_allocator_->MapBuffer(handle, nullptr, &base_ptr);
-    if (error != kErrorNone) {
-      DLOGE("Failed to map buffer, error = %d", error);
-      continue;
-    }
-
     char dump_file_name[PATH_MAX];
     size_t result = 0;
 
@@ -2057,23 +2087,17 @@ void HWCDisplay::DumpInputBuffers() {
              dir_path, i, width, height, GetFormatString(layer->input_buffer.format),
              dump_input_frame_index_);
 
-    if (base_ptr != nullptr) {
-      FILE *fp = fopen(dump_file_name, "w+");
-      if (fp) {
-        result = fwrite(base_ptr, alloc_size, 1, fp);
-        fclose(fp);
-      }
+    // Copied once the acquire fence signals and written by the frame dump writer, so neither
+    // the fence wait nor the file write stalls this frame.
+    FrameDumpRequest request = {};
+    request.path = dump_file_name;
+    request.fd = layer->input_buffer.planes[0].fd;
+    request.size = alloc_size;
+    request.fence = layer->input_buffer.acquire_fence;
+    if (FrameDumpWriter::GetInstance()->Queue(request) != kErrorNone) {
+      DLOGW("Frame Dump %s is dropped", dump_file_name);
     }
 
-    int release_fence = -1;
-    error = buffer_allocator_->UnmapBuffer(handle, &release_fence);
-    if (error != 0) {
-      DLOGE("Failed to unmap buffer, error = %d", error);
-      continue;
-    }
-
-    DLOGI("Frame Dump %s: is %s", dump_file_name, result ? "Successful" : "Failed");
-
     HWCDebugHandler::Get()->GetProperty(ENABLE_METADATA_DUMPING, &dump_metadata);
     if (dump_metadata) {
       // Dump only extended content metadata for now. Property named generically for future extension
@@ -2099,9 +2123,16 @@ void HWCDisplay::DumpInputBuffers() {
   }
   dump_input_frame_count_--;
   dump_input_frame_index_++;
+
+  if (!dump_input_frame_count_) {
+    FrameDumpStats stats = {};
+    FrameDumpWriter::GetInstance()->GetStats(&stats);
+    DLOGI("Frame dump writer: queued %" PRIu64 " written %" PRIu64 " dropped %" PRIu64
+          " failed %" PRIu64, stats.queued, stats.written, stats.dropped, stats.failed);
+  }
 }
 
-void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, void *base,
+void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, int fd,
                                   shared_ptr<Fence> &retire_fence) {
   char dir_path[PATH_MAX];
   int status;
@@ -2121,32 +2152,29 @@ void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, void *base,
     return;
   }
 
-  if (base) {
+  if (fd >= 0) {
     char dump_file_name[PATH_MAX];
-    size_t result = 0;
-
-    if (Fence::Wait(retire_fence) != kErrorNone) {
-      DLOGW("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
-      return;
-    }
 
     snprintf(dump_file_name, sizeof(dump_file_name), "%s/output_layer_%dx%d_%s_frame%d.raw",
              dir_path, buffer_info.alloc_buffer_info.aligned_width,
              buffer_info.alloc_buffer_info.aligned_height,
              GetFormatString(buffer_info.buffer_config.format), dump_frame_index_);
 
-    FILE *fp = fopen(dump_file_name, "w+");
-    if (fp) {
-      result = fwrite(base, buffer_info.alloc_buffer_info.size, 1, fp);
-      fclose(fp);
-    }
+    // The output buffer is handed back for the next frame right after this, so it is copied
+    // before returning; only the file write is deferred to the frame dump writer.
     // Need to clear buffer after dumping of current frame to provide empty buffer for next frame.
     // But avoid this in case of virtual display frame dump, else it would provide empty buffer
     // to virtual display client, because it uses client buffer for dumping output.
-    if (type_ != kVirtual) {
-      memset(base, 0, buffer_info.alloc_buffer_info.size);
+    FrameDumpRequest request = {};
+    request.path = dump_file_name;
+    request.fd = fd;
+    request.size = buffer_info.alloc_buffer_info.size;
+    request.fence = retire_fence;
+    request.clear = (type_ != kVirtual);
+    request.sync_copy = true;
+    if (FrameDumpWriter::GetInstance()->Queue(request) != kErrorNone) {
+      DLOGW("Frame Dump of %s is dropped", dump_file_name);
     }
-    DLOGI("Frame Dump of %s is %s", dump_file_name, result ? "Successful" : "Failed");
   }
 }
 
@@ -3224,15 +3252,10 @@ int HWCDisplay::GetCwbBufferResolution(CwbConfig *cwb_config, uint32_t *x_pixels
 
 void HWCDisplay::ReleaseFrameDumpResources() {
   std::unique_lock<std::mutex> lock(frame_dump_config_lock_);
-  if (output_buffer_info_.alloc_buffer_info.fd < 0 && !output_buffer_base_ && !dump_frame_count_) {
+  if (output_buffer_info_.alloc_buffer_info.fd < 0 && !dump_frame_count_) {
     return;
   }
 
-  if (output_buffer_base_ &&
-      munmap(output_buffer_base_, output_buffer_info_.alloc_buffer_info.size) != 0) {
-    DLOGW("unmap failed with err %d", errno);
-  }
-
   if (output_buffer_info_.alloc_buffer_info.fd > 0 && buffer_allocator_ &&
       buffer_allocator_->FreeBuffer(&output_buffer_info_) != 0) {
     DLOGW("FreeBuffer failed");
@@ -3240,7 +3263,6 @@ void HWCDisplay::ReleaseFrameDumpResources() {
 
   output_buffer_info_ = {};
   output_buffer_cwb_config_ = {};
-  output_buffer_base_ = nullptr;
   dump_frame_count_ = 0;
   dump_frame_index_ = 0;
   dump_output_to_file_ = false;
@@ -3636,7 +3658,8 @@ void HWCDisplay::HandleFrameDump() {
     // one second for signal, and which might got delayed due to some flushing and resource
     // releasing operations during certain power glitch event. So, we can assume that buffer
     // writing operation is over after timeout.
-    DumpOutputBuffer(output_buffer_info_, output_buffer_base_, layer_stack_.retire_fence);
+    DumpOutputBuffer(output_buffer_info_, output_buffer_info_.alloc_buffer_info.fd,
+                     layer_stack_.retire_fence);
     if (ret == kCWBReleaseFenceWaitTimedOut) {
       DLOGW("CWB frame-%d dump may be empty due to fence timeout on any unexpected event!",
             dump_frame_index_);
@@ -76,6 +76,7 @@ enum DisplayClass {
 enum {
   INPUT_LAYER_DUMP,
   OUTPUT_LAYER_DUMP,
+  LAYER_STACK_DUMP,
 };
 
 enum SecureSessionType {
@@ -454,7 +455,7 @@ class HWCDisplay : public DisplayEventHandler {
   virtual DisplayError HandleEvent(DisplayEvent event);
   virtual DisplayError HandleQsyncState(const QsyncEventData &qsync_data);
   virtual void NotifyCwbDone(int32_t status, const LayerBuffer &buffer);
-  virtual void DumpOutputBuffer(const BufferInfo &buffer_info, void *base,
+  virtual void DumpOutputBuffer(const BufferInfo &buffer_info, int fd,
                                 shared_ptr<Fence> &retire_fence);
   virtual HWC3::Error PrepareLayerStack(uint32_t *out_num_types, uint32_t *out_num_requests);
   virtual HWC3::Error CommitLayerStack(void);
@@ -495,6 +496,7 @@ class HWCDisplay : public DisplayEventHandler {
   void UpdateRefreshRate();
   void UpdateActiveConfig();
   void DumpInputBuffers(void);
+  void DumpLayerStack(void);
   void RetrieveFences(shared_ptr<Fence> *out_retire_fence);
   void SetDrawMethod();
 
@@ -579,8 +581,9 @@ class HWCDisplay : public DisplayEventHandler {
   uint32_t dump_input_frame_count_ = 0;  // tracks input frames count which to be dump
   uint32_t dump_input_frame_index_ = 0;  // tracks current input frame index which to be dump
   bool dump_input_layers_ = false;
+  uint32_t dump_layer_stack_count_ = 0;  // tracks layer stack frames count which to be dump
+  uint32_t dump_layer_stack_index_ = 0;  // tracks current layer stack frame index
   BufferInfo output_buffer_info_ = {};
-  void *output_buffer_base_ = nullptr;  // points to base address of output_buffer_info_
   CwbConfig output_buffer_cwb_config_ = {};
 
   // Members for 1 frame capture in a client provided buffer
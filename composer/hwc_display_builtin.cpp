@@ -35,9 +35,11 @@
  */
 
 #include <cutils/properties.h>
+#include <math.h>
 #include <sync/sync.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/rect.h>
 #include <utils/utils.h>
 #include <stdarg.h>
 #include <sys/mman.h>
@@ -63,6 +65,35 @@ static void SetRect(LayerRect &src_rect, GLRect *target) {
   target->bottom = src_rect.bottom;
 }
 
+// Maps the surface damage of a stitched layer from its buffer onto the stitch target, where the
+// whole buffer is drawn at dst_rect. Returns false when the layer needs a full redraw.
+static bool GetStitchDirtyRects(const Layer &layer, const GLRect &dst_rect,
+                                std::vector<GLRect> *dirty_rects) {
+  const LayerBuffer &input_buffer = layer.input_buffer;
+  if (layer.dirty_regions.empty() || !input_buffer.unaligned_width ||
+      !input_buffer.unaligned_height) {
+    return false;
+  }
+
+  float scale_x = (dst_rect.right - dst_rect.left) / FLOAT(input_buffer.unaligned_width);
+  float scale_y = (dst_rect.bottom - dst_rect.top) / FLOAT(input_buffer.unaligned_height);
+  for (auto &dirty : layer.dirty_regions) {
+    if (!IsValid(dirty)) {
+      continue;
+    }
+
+    // Grow by a pixel for the filtering of scaled layers.
+    GLRect rect;
+    rect.left = floorf(dst_rect.left + dirty.left * scale_x) - 1.0f;
+    rect.top = floorf(dst_rect.top + dirty.top * scale_y) - 1.0f;
+    rect.right = ceilf(dst_rect.left + dirty.right * scale_x) + 1.0f;
+    rect.bottom = ceilf(dst_rect.top + dirty.bottom * scale_y) + 1.0f;
+    dirty_rects->push_back(rect);
+  }
+
+  return true;
+}
+
 int HWCDisplayBuiltIn::Create(CoreInterface *core_intf, BufferAllocator *buffer_allocator,
                               HWCCallbacks *callbacks, HWCDisplayEventHandler *event_handler,
                               qService::QService *qservice, Display id, int32_t sdm_id,
@@ -324,6 +355,8 @@ HWC3::Error HWCDisplayBuiltIn::CommitStitchLayers() {
   }
 
   if (!display_intf_->IsValidated() || skip_commit_) {
+    // Damage of this frame is not stitched, the next stitch cannot build on the previous one.
+    stitch_full_update_ = true;
     return HWC3::Error::None;
   }
 
@@ -337,6 +370,7 @@ HWC3::Error HWCDisplayBuiltIn::CommitStitchLayers() {
     }
 
     StitchParams params = {};
+    params.id = layer->layer_id;
     // Stitch target doesn't have an input fence.
     // Render all layers at specified destination.
     LayerBuffer &input_buffer = layer->input_buffer;
@@ -345,18 +379,23 @@ HWC3::Error HWCDisplayBuiltIn::CommitStitchLayers() {
     SetRect(layer->stitch_info.dst_rect, &params.dst_rect);
     SetRect(layer->stitch_info.slice_rect, &params.scissor_rect);
     params.src_acquire_fence = input_buffer.acquire_fence;
+    params.full_update = stitch_full_update_ ||
+                         !GetStitchDirtyRects(*layer, params.dst_rect, &params.dirty_rects);
 
     ctx.stitch_params.push_back(params);
   }
 
   if (!ctx.stitch_params.size()) {
     // No layers marked for stitch.
+    stitch_full_update_ = true;
     return HWC3::Error::None;
   }
 
   layer_stitch_task_.PerformTask(LayerStitchTaskCode::kCodeStitch, &ctx);
+  stitch_full_update_ = false;
   // Set release fence.
   output_buffer.acquire_fence = ctx.release_fence;
+  stitch_release_fences_ = std::move(ctx.src_release_fences);
 
   return HWC3::Error::None;
 }
@@ -436,17 +475,19 @@ void HWCDisplayBuiltIn::PostCommitStitchLayers() {
     return;
   }
 
-  // Close Stitch buffer acquire fence.
-  Layer *stitch_layer = stitch_target_->GetSDMLayer();
-  LayerBuffer &output_buffer = stitch_layer->input_buffer;
+  // Each stitched layer is released once GL has read it, in the order the layers were stitched.
+  size_t index = 0;
   for (auto &layer : layer_stack_.layers) {
     LayerComposition &composition = layer->composition;
     if (composition != kCompositionStitch) {
       continue;
     }
     LayerBuffer &input_buffer = layer->input_buffer;
-    input_buffer.release_fence = output_buffer.acquire_fence;
+    input_buffer.release_fence =
+        (index < stitch_release_fences_.size()) ? stitch_release_fences_.at(index) : nullptr;
+    index++;
   }
+  stitch_release_fences_.clear();
 }
 
 HWC3::Error HWCDisplayBuiltIn::GetColorModes(uint32_t *out_num_modes, ColorMode *out_modes) {
@@ -1201,7 +1242,8 @@ void HWCDisplayBuiltIn::OnTask(const LayerStitchTaskCode &task_code,
     case LayerStitchTaskCode::kCodeStitch: {
       DTRACE_SCOPED();
       LayerStitchContext *ctx = reinterpret_cast<LayerStitchContext *>(task_context);
-      gl_layer_stitch_->Blit(ctx->stitch_params, &(ctx->release_fence));
+      gl_layer_stitch_->Blit(ctx->stitch_params, &(ctx->src_release_fences),
+                             &(ctx->release_fence));
     } break;
     case LayerStitchTaskCode::kCodeDestroyInstance: {
       if (gl_layer_stitch_) {
@@ -67,6 +67,7 @@ struct LayerStitchContext : public SyncTask<LayerStitchTaskCode>::TaskContext {
   shared_ptr<Fence> src_acquire_fence = nullptr;
   shared_ptr<Fence> dst_acquire_fence = nullptr;
   shared_ptr<Fence> release_fence = nullptr;
+  vector<shared_ptr<Fence>> src_release_fences;
 };
 
 class HWCDisplayBuiltIn : public HWCDisplay, public SyncTask<LayerStitchTaskCode>::TaskHandler {
@@ -207,6 +208,8 @@ class HWCDisplayBuiltIn : public HWCDisplay, public SyncTask<LayerStitchTaskCode
   HWCLayer *stitch_target_ = nullptr;
   SyncTask<LayerStitchTaskCode> layer_stitch_task_;
   GLLayerStitch *gl_layer_stitch_ = nullptr;
+  vector<shared_ptr<Fence>> stitch_release_fences_ = {};
+  bool stitch_full_update_ = true;  // The last frame did not stitch
   BufferInfo buffer_info_ = {};
   DisplayConfigVariableInfo fb_config_ = {};
 
@@ -30,15 +30,13 @@
 /*
  * Changes from Qualcomm Innovation Center are provided under the following license:
  *
- * Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+ * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
  * SPDX-License-Identifier: BSD-3-Clause-Clear
  */
 
 #ifndef __HWC_DISPLAY_PLUGGABLE_TEST_H__
 #define __HWC_DISPLAY_PLUGGABLE_TEST_H__
 
-#include <bitset>
-
 #include "hwc_display.h"
 #include "hwc_buffer_allocator.h"
 
@@ -73,18 +71,6 @@ class HWCDisplayPluggableTest : public HWCDisplay {
     kDisplayBpp30 = 30,
   };
 
-  enum ColorRamp {
-    kColorRedRamp = 0,
-    kColorGreenRamp = 1,
-    kColorBlueRamp = 2,
-    kColorWhiteRamp = 3,
-  };
-
-  enum Colors {
-    kColorBlack = 0,
-    kColorWhite = 1,
-  };
-
  private:
   HWCDisplayPluggableTest(CoreInterface *core_intf, HWCBufferAllocator *buffer_allocator,
                           HWCCallbacks *callbacks, HWCDisplayEventHandler *event_handler,
@@ -93,13 +79,8 @@ class HWCDisplayPluggableTest : public HWCDisplay {
   int Init();
   int Deinit();
   void DumpInputBuffer();
-  void CalcCRC(uint32_t color_value, std::bitset<16> *crc_data);
   int FillBuffer();
   int GetStride(LayerBufferFormat format, uint32_t width, uint32_t *stride);
-  void PixelCopy(uint32_t red, uint32_t green, uint32_t blue, uint32_t alpha, uint8_t **buffer);
-  void GenerateColorRamp(uint8_t *buffer);
-  void GenerateBWVertical(uint8_t *buffer);
-  void GenerateColorSquare(uint8_t *buffer);
   int InitLayer(Layer *layer);
   int DeinitLayer(Layer *layer);
   int CreateLayerStack();
@@ -360,9 +360,11 @@ HWC3::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, shared_ptr<Fence> a
   }
 
   const native_handle_t *handle = reinterpret_cast<const native_handle_t *>(buffer);
-  void *hnd = const_cast<native_handle_t *>(handle);
-  int fd;
-  gralloc::GetMetaDataValue(hnd, qtigralloc::MetadataType_FD.value, &fd);
+  // Allocation-time attributes come from the per-layer snapshot; only the first frame a buffer
+  // is latched pays for the individual gralloc lookups.
+  const BufferMetadataSnapshot *snapshot = metadata_cache_.Get(handle);
+  buffer_metadata_ = snapshot;
+  int fd = snapshot->fd;
 
   if (fd < 0) {
     return HWC3::Error::BadParameter;
@@ -372,10 +374,8 @@ HWC3::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, shared_ptr<Fence> a
   int aligned_width, aligned_height;
   buffer_allocator_->GetCustomWidthAndHeight(reinterpret_cast<const native_handle_t *>(buffer),
                                              &aligned_width, &aligned_height);
-  int fmt, flag;
-  gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::PIXEL_FORMAT_REQUESTED, &fmt);
-  gralloc::GetMetaDataValue(hnd, (int64_t)qtigralloc::MetadataType_PrivateFlags.value, &flag);
-  LayerBufferFormat format = GetSDMFormat(fmt, flag);
+  int flag = snapshot->private_flags;
+  LayerBufferFormat format = GetSDMFormat(snapshot->format, flag);
   if ((format != layer_buffer->format) || (UINT32(aligned_width) != layer_buffer->width) ||
       (UINT32(aligned_height) != layer_buffer->height)) {
     // Layer buffer geometry has changed.
@@ -385,21 +385,10 @@ HWC3::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, shared_ptr<Fence> a
   layer_buffer->format = format;
   layer_buffer->width = UINT32(aligned_width);
   layer_buffer->height = UINT32(aligned_height);
+  layer_buffer->unaligned_width = UINT32(snapshot->unaligned_width);
+  layer_buffer->unaligned_height = UINT32(snapshot->unaligned_height);
 
-  auto err_w = gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::WIDTH,
-                                         &layer_buffer->unaligned_width);
-  if (err_w != gralloc::Error::NONE) {
-    DLOGE("Failed to retrieve unaligned width");
-  }
-  auto err_h = gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::HEIGHT,
-                                         &layer_buffer->unaligned_height);
-  if (err_h != gralloc::Error::NONE) {
-    DLOGE("Failed to retrieve unaligned height");
-  }
-  int32_t buffer_type;
-  gralloc::GetMetaDataValue(hnd, (int64_t)qtigralloc::MetadataType_BufferType.value, &buffer_type);
-
-  layer_buffer->flags.video = (buffer_type == BUFFER_TYPE_VIDEO) ? true : false;
+  layer_buffer->flags.video = (snapshot->buffer_type == BUFFER_TYPE_VIDEO) ? true : false;
   if (SetMetaData(handle, layer_) != kErrorNone) {
     return HWC3::Error::BadLayer;
   }
@@ -428,30 +417,12 @@ HWC3::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, shared_ptr<Fence> a
 
   layer_buffer->planes[0].fd = buffer_fd_;
   layer_buffer->planes[0].offset = 0;
-  auto err =
-      gralloc::GetMetaDataValue(hnd, QTI_ALIGNED_WIDTH_IN_PIXELS, &layer_buffer->planes[0].stride);
-  if (err != gralloc::Error::NONE) {
-    DLOGW("Failed to retrieve aligned width");
-  }
-
-  err = gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::ALLOCATION_SIZE,
-                                  &layer_buffer->size);
-
-  if (err != gralloc::Error::NONE) {
-    DLOGW("Failed to retrieve allocation size");
-  }
+  layer_buffer->planes[0].stride = snapshot->aligned_width;
+  layer_buffer->size = snapshot->allocation_size;
   buffer_flipped_ = reinterpret_cast<uint64_t>(handle) != layer_buffer->buffer_id;
   layer_buffer->buffer_id = reinterpret_cast<uint64_t>(handle);
-  [[maybe_unused]] int64_t hd_id, hd_usage;
-  err = gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::BUFFER_ID,
-                                  &layer_buffer->handle_id);
-  if (err != gralloc::Error::NONE) {
-    DLOGW("Failed to retrieve buffer id");
-  }
-  err = gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::USAGE, &layer_buffer->usage);
-  if (err != gralloc::Error::NONE) {
-    DLOGW("Failed to retrieve handle usage");
-  }
+  layer_buffer->handle_id = snapshot->handle_id;
+  layer_buffer->usage = snapshot->usage;
   return HWC3::Error::None;
 }
 
@@ -1062,9 +1033,13 @@ DisplayError HWCLayer::SetMetaData(const native_handle_t *pvt_handle, Layer *lay
   LayerBuffer *layer_buffer = &layer->input_buffer;
   void *handle = const_cast<native_handle_t *>(pvt_handle);
 
-  std::string name = "";
-  gralloc::GetMetaDataValue(handle, android::gralloc4::MetadataType_Name.value, &name);
-  name_ = name;
+  if (buffer_metadata_ && buffer_metadata_->handle == pvt_handle) {
+    name_ = buffer_metadata_->name;
+  } else {
+    std::string name = "";
+    gralloc::GetMetaDataValue(handle, android::gralloc4::MetadataType_Name.value, &name);
+    name_ = name;
+  }
 
   float fps = 0;
   uint32_t frame_rate = layer->frame_rate;
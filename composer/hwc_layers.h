@@ -41,6 +41,7 @@
 
 #include "core/buffer_allocator.h"
 #include "hwc_buffer_allocator.h"
+#include "hwc_buffer_metadata_cache.h"
 #include "hwc_common.h"
 
 using aidl::android::hardware::graphics::composer3::PerFrameMetadataKey;
@@ -123,6 +124,7 @@ class HWCLayer {
   void SetReleaseFence(const shared_ptr<Fence> &release_fence);
   bool IsLayerCompatible() { return compatible_; }
   void IgnoreSdrHistogramMetadata(bool disable) { ignore_sdr_histogram_md_ = disable; }
+  const BufferMetadataSnapshot *GetBufferMetadata() { return buffer_metadata_; }
 
  private:
   Layer *layer_ = nullptr;
@@ -148,6 +150,8 @@ class HWCLayer {
   bool secure_ = false;
   bool compatible_ = false;
   bool ignore_sdr_histogram_md_ = false;
+  HWCBufferMetadataCache metadata_cache_;
+  const BufferMetadataSnapshot *buffer_metadata_ = nullptr;
 
   // Composition requested by client(SF) Original
   Composition client_requested_orig_ = Composition::DEVICE;
@@ -105,69 +105,18 @@ int32_t GetDataspaceFromColorMode(ColorMode mode) {
   }
 }
 
-const char *GetTokenValue(const char *uevent_data, int length, const char *token) {
-  const char *iterator_str = uevent_data;
-  const char *pstr = NULL;
-  while (((iterator_str - uevent_data) <= length) && (*iterator_str)) {
-    pstr = strstr(iterator_str, token);
-    if (pstr) {
-      break;
-    }
-    iterator_str += strlen(iterator_str) + 1;
-  }
-
-  if (pstr)
-    pstr = pstr + strlen(token);
-
-  return pstr;
-}
-
-int GetEventValue(const char *uevent_data, int length, const char *event_info) {
-  const char *iterator_str = uevent_data;
-  while (((iterator_str - uevent_data) <= length) && (*iterator_str)) {
-    const char *pstr = strstr(iterator_str, event_info);
-    if (pstr != NULL) {
-      return (atoi(iterator_str + strlen(event_info)));
-    }
-    iterator_str += strlen(iterator_str) + 1;
-  }
-
-  return -1;
-}
-
 void HWCSession::ParseUEvent(char *uevent_data, int length) {
-  static constexpr uint32_t uevent_max_count = 3;
-  const char *str_status = GetTokenValue(uevent_data, length, "status=");
-  const char *str_sstmst = GetTokenValue(uevent_data, length, "HOTPLUG=");
-  const char *str_mst = GetTokenValue(uevent_data, length, "MST_HOTPLUG=");
-
-  if (!str_status && !str_mst && !str_sstmst) {
+  HotplugUEvent event;
+  if (length <= 0 ||
+      !ParseHotplugUEvent(uevent_data, UINT32(length), HWC_UEVENT_DRM_EXT_HOTPLUG, &event)) {
     return;
   }
 
-  if (!strcasestr(uevent_data, HWC_UEVENT_DRM_EXT_HOTPLUG)) {
-    return;
-  }
-
-  hpd_bpp_ = GetEventValue(uevent_data, length, "bpp=");
-  hpd_pattern_ = GetEventValue(uevent_data, length, "pattern=");
-
-  DLOGI("UEvent = %s, status = %s, HOTPLUG = %s (SST/MST)%s%s, bpp = %d, pattern = %d", uevent_data,
-        str_status ? str_status : "NULL", str_sstmst ? str_sstmst : "NULL",
-        str_mst ? ", MST_HOTPLUG = " : "", str_mst ? str_mst : "", hpd_bpp_, hpd_pattern_);
+  DLOGI("UEvent = %s, connected = %d, HOTPLUG = %d (SST/MST), MST_HOTPLUG = %d, bpp = %d, "
+        "pattern = %d", uevent_data, event.connected, event.sst_mst_hotplug, event.mst_hotplug,
+        event.bpp, event.pattern);
 
-  if (str_status) {
-    hpd_connected_ = strncmp(str_status, "connected", strlen("connected")) == 0;
-    DLOGI("Connected = %d", hpd_connected_);
-  }
-
-  uevent_counter_++;
-  std::unique_lock<std::mutex> evt_lock(hpd_mutex_);
-  if (uevent_counter_.load() > uevent_max_count) {
-    uevent_counter_.store(uevent_max_count);
-  }
-
-  hpd_cv_.notify_one();
+  hpd_events_.Push(event);
 }
 
 void HWCSession::HpdThreadTop() {
@@ -183,11 +132,16 @@ void HWCSession::HpdThreadTop() {
     return;
   }
 
+  // Reused for every event, only the received length is parsed.
+  char uevent_data[PAGE_SIZE];
   while (1) {
-    char uevent_data[PAGE_SIZE] = {};
-
-    // keep last 2 zeros to ensure double 0 termination
+    // keep last 2 bytes to ensure double 0 termination
     int length = uevent_next_event(uevent_data, INT32(sizeof(uevent_data)) - 2);
+    if (length <= 0) {
+      continue;
+    }
+    uevent_data[length] = '\0';
+    uevent_data[length + 1] = '\0';
 
     ParseUEvent(uevent_data, length);
   }
@@ -201,21 +155,15 @@ void HWCSession::HpdThreadBottom() {
   prctl(PR_SET_NAME, uevent_thread_name, 0, 0, 0);
   setpriority(PRIO_PROCESS, 0, HAL_PRIORITY_URGENT_DISPLAY);
 
-  std::unique_lock<std::mutex> evt_lock(hpd_mutex_);
-  while (1) {
-    hpd_cv_.wait(evt_lock);
-
-    if (hpd_thread_should_terminate_) {
-      break;
-    }
-
-    while (uevent_counter_.load() > 0) {
-      evt_lock.unlock();
-      UEventHandler();
-      evt_lock.lock();
-
-      uevent_counter_--;
-    }
+  // Connect and disconnect storms are handled once, with the state after the last event. Events
+  // received while a burst is handled make up the next one.
+  HotplugState state;
+  while (hpd_events_.WaitBurst(kHpdSettleMs, kHpdMaxDelayMs, &state)) {
+    hpd_connected_ = state.connected;
+    hpd_bpp_ = state.bpp;
+    hpd_pattern_ = state.pattern;
+    hpd_burst_events_ = state.events;
+    UEventHandler();
   }
   DLOGI("Ending!");
 }
@@ -261,6 +209,10 @@ int HWCSession::Init() {
     HWCDebugHandler::DebugAll(value, value);
   }
 
+  value = 0;
+  HWCDebugHandler::Get()->GetProperty(ENABLE_DEFERRED_LOGGING, &value);
+  DebugHandler::SetDeferredLogging(value == 1);
+
   HWCDebugHandler::Get()->GetProperty(DISABLE_HOTPLUG_BWCHECK, &disable_hotplug_bwcheck_);
   DLOGI("disable_hotplug_bwcheck_: %d", disable_hotplug_bwcheck_);
   HWCDebugHandler::Get()->GetProperty(DISABLE_MASK_LAYER_HINT, &disable_mask_layer_hint_);
@@ -325,8 +277,7 @@ void HWCSession::HpdInit() {
 
 void HWCSession::HpdDeinit() {
   if (hpd_thread_.joinable()) {
-    hpd_thread_should_terminate_ = true;
-    hpd_cv_.notify_one();
+    hpd_events_.Terminate();
     hpd_thread_.join();
   }
 }
@@ -814,6 +765,7 @@ void HWCSession::PerformIdleStatusCallback(Display display) {
 
 HWC3::Error HWCSession::PresentDisplay(Display display, shared_ptr<Fence> *out_retire_fence) {
   auto status = HWC3::Error::BadDisplay;
+  HWCDebugHandler::RefreshTraceEnabled();
   DTRACE_SCOPED();
 
   if (display >= HWCCallbacks::kNumDisplays) {
@@ -2771,7 +2723,7 @@ void HWCSession::UEventHandler() {
     return;
   }
 
-  DLOGI("Handling event, counter: %d", uevent_counter_.load());
+  DLOGI("Handling %u events, connected = %d", hpd_burst_events_, hpd_connected_);
 
   // Handle hotplug.
   int32_t err = HandlePluggableDisplays(true);
@@ -4575,6 +4527,7 @@ HWC3::Error HWCSession::CommitOrPrepare(Display display, bool validate_only,
                                         shared_ptr<Fence> *out_retire_fence,
                                         uint32_t *out_num_types, uint32_t *out_num_requests,
                                         bool *needs_commit) {
+  HWCDebugHandler::RefreshTraceEnabled();
   if (display >= HWCCallbacks::kNumDisplays) {
     return HWC3::Error::BadDisplay;
   }
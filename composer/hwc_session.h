@@ -38,6 +38,7 @@
 #include <core/ipc_interface.h>
 #include <utils/locker.h>
 #include <utils/constants.h>
+#include <utils/hotplug_uevent.h>
 #include <display_config.h>
 #include <vector>
 #include <queue>
@@ -104,19 +105,22 @@ class HWCUEvent {
   virtual void HpdDeinit() = 0;
   virtual void ParseUEvent(char *uevent_data, int length) = 0;
 
-  std::mutex hpd_mutex_;
-  std::condition_variable hpd_cv_;
-
   // top thread needs to be detached as we can't control
   // to wake it up to terminate it.
   virtual void HpdThreadTop() = 0;
 
  protected:
+  // Hotplug uevents closer than the settle time are handled together, a connection that keeps
+  // flapping is handled at least every max delay.
+  static const uint32_t kHpdSettleMs = 50;
+  static const uint32_t kHpdMaxDelayMs = 250;
+
+  // Written by the bottom thread before each burst is handled.
   int hpd_connected_ = -1;
   int hpd_bpp_ = 0;
   int hpd_pattern_ = 0;
-  bool hpd_thread_should_terminate_ = false;
-  std::atomic<int> uevent_counter_ = 0;
+  uint32_t hpd_burst_events_ = 0;
+  HotplugCoalescer hpd_events_;
 };
 
 class HWCSession : public HWCUEvent,
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../gl_stitch_tiles.h"
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+const int kTileSize = 128;
+
+GLRect Rect(float left, float top, float right, float bottom) {
+  GLRect rect;
+  rect.left = left;
+  rect.top = top;
+  rect.right = right;
+  rect.bottom = bottom;
+  return rect;
+}
+
+void ExpectTiles(const std::vector<GLRect> &expected, const std::vector<GLRect> &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_TRUE(IsEqual(expected[i], actual[i]))
+        << "tile " << i << ": " << actual[i].left << "," << actual[i].top << " "
+        << actual[i].right << "," << actual[i].bottom;
+  }
+}
+
+class StitchTilesTest : public Test {
+ protected:
+  StitchTiles tiles_ = StitchTiles(kTileSize);
+  // A 1080 wide slice below a 100 line header, 9 x 19 tiles with clipped right and bottom ones.
+  GLRect bounds_ = Rect(0, 100, 1080, 2500);
+};
+
+}  // namespace
+
+TEST_F(StitchTilesTest, FullUpdateRedrawsBounds) {
+  ExpectTiles({bounds_}, tiles_.Get(bounds_, true, {Rect(0, 100, 10, 110)}));
+  ExpectTiles({}, tiles_.Get(Rect(0, 100, 1080, 100), true, {}));
+}
+
+TEST_F(StitchTilesTest, NoDamageNoTiles) {
+  ExpectTiles({}, tiles_.Get(bounds_, false, {}));
+  // Damage outside the bounds, or empty once clipped to them.
+  ExpectTiles({}, tiles_.Get(bounds_, false, {Rect(0, 0, 1080, 100), Rect(1080, 200, 1200, 300),
+                                              Rect(10, 200, 10, 300)}));
+}
+
+TEST_F(StitchTilesTest, DamageIsRoundedOutToTiles) {
+  // Clipped to 0,0 300,200 in bounds, tiles 0-2 of rows 0-1 which merge into one rect.
+  ExpectTiles({Rect(0, 100, 384, 356)}, tiles_.Get(bounds_, false, {Rect(10, 10, 300, 300)}));
+  // A single pixel marks its whole tile.
+  ExpectTiles({Rect(128, 228, 256, 356)},
+              tiles_.Get(bounds_, false, {Rect(200, 300, 201, 301)}));
+}
+
+TEST_F(StitchTilesTest, EdgeTilesAreClippedToBounds) {
+  ExpectTiles({Rect(1024, 2404, 1080, 2500)},
+              tiles_.Get(bounds_, false, {Rect(1070, 2450, 2000, 3000)}));
+}
+
+TEST_F(StitchTilesTest, TilesAreAlignedToBounds) {
+  GLRect slice = Rect(540, 50, 1080, 350);
+  ExpectTiles({Rect(540, 50, 668, 178)}, tiles_.Get(slice, false, {Rect(600, 60, 610, 70)}));
+}
+
+TEST_F(StitchTilesTest, RunsAndColumnMerges) {
+  std::vector<GLRect> dirty = {
+    // Row 0: tiles 0-1 and tile 4, two runs.
+    Rect(0, 100, 200, 150), Rect(520, 100, 530, 150),
+    // Row 1: tiles 0-1 again, extends the first run of row 0.
+    Rect(0, 240, 256, 250),
+    // Row 2: tiles 0-2, wider than the rect above, starts a new rect.
+    Rect(0, 360, 300, 370),
+  };
+  ExpectTiles({Rect(0, 100, 256, 356), Rect(512, 100, 640, 228), Rect(0, 356, 384, 484)},
+              tiles_.Get(bounds_, false, dirty));
+}
+
+TEST_F(StitchTilesTest, ResultsDoNotCarryOver) {
+  tiles_.Get(bounds_, false, {Rect(0, 100, 1080, 2500)});
+  ExpectTiles({Rect(0, 100, 128, 228)}, tiles_.Get(bounds_, false, {Rect(0, 100, 1, 101)}));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
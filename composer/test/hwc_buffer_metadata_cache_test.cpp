@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <QtiGralloc.h>
+#include <QtiGrallocPriv.h>
+#include <gralloctypes/Gralloc4.h>
+#include <gr_utils.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../hwc_buffer_metadata_cache.h"
+
+using aidl::android::hardware::graphics::common::StandardMetadataType;
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+// Metadata gralloc keeps outside of the handle, per buffer.
+std::map<const void *, std::string> g_names;
+// Lookups of each metadata type since they were last cleared.
+std::map<int64_t, uint32_t> g_lookups;
+
+uint32_t TotalLookups() {
+  uint32_t total = 0;
+  for (auto &lookup : g_lookups) {
+    total += lookup.second;
+  }
+  return total;
+}
+
+class FakeBuffer {
+ public:
+  FakeBuffer(int fd, uint64_t id, int width, int height, int buffer_type, const char *name)
+      : handle_(new private_handle_t(fd, -1, 0, (width + 63) & ~63, height, width, height,
+                                     HAL_PIXEL_FORMAT_RGBA_8888, buffer_type,
+                                     UINT32_C(4) * ((width + 63) & ~63) * height,
+                                     UINT64_C(0x900))) {
+    handle_->id = id;
+    g_names[handle_.get()] = name;
+  }
+
+  ~FakeBuffer() { g_names.erase(handle_.get()); }
+
+  // A new allocation that landed at the same handle address.
+  void Reallocate(uint64_t id, int width, const char *name) {
+    handle_->id = id;
+    handle_->unaligned_width = width;
+    g_names[handle_.get()] = name;
+  }
+
+  // The same buffer imported again at the same handle address, with a new fd.
+  void Reimport(int fd) { handle_->fd = fd; }
+
+  const native_handle_t *Get() const { return handle_.get(); }
+
+ private:
+  std::unique_ptr<private_handle_t> handle_;
+};
+
+// Each per frame gralloc read SetLayerBuffer and BuildLayerStack did before the snapshot.
+void ReadUncached(const native_handle_t *handle, BufferMetadataSnapshot *out) {
+  void *hnd = const_cast<native_handle_t *>(handle);
+  gralloc::GetMetaDataValue(hnd, qtigralloc::MetadataType_FD.value, &out->fd);
+  gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::PIXEL_FORMAT_REQUESTED,
+                            &out->format);
+  gralloc::GetMetaDataValue(hnd, (int64_t)qtigralloc::MetadataType_PrivateFlags.value,
+                            &out->private_flags);
+  gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::WIDTH, &out->unaligned_width);
+  gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::HEIGHT, &out->unaligned_height);
+  gralloc::GetMetaDataValue(hnd, (int64_t)qtigralloc::MetadataType_BufferType.value,
+                            &out->buffer_type);
+  gralloc::GetMetaDataValue(hnd, QTI_ALIGNED_WIDTH_IN_PIXELS, &out->aligned_width);
+  gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::ALLOCATION_SIZE,
+                            &out->allocation_size);
+  gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::BUFFER_ID, &out->handle_id);
+  gralloc::GetMetaDataValue(hnd, (int64_t)StandardMetadataType::USAGE, &out->usage);
+  gralloc::GetMetaDataValue(hnd, android::gralloc4::MetadataType_Name.value, &out->name);
+  gralloc::GetMetaDataValue(hnd, QTI_BUFFER_TYPE, &out->buffer_type);
+  gralloc::GetMetaDataValue(hnd, QTI_PRIVATE_FLAGS, &out->private_flags);
+}
+
+class HWCBufferMetadataCacheTest : public Test {
+ protected:
+  void SetUp() override { g_lookups.clear(); }
+};
+
+}  // namespace
+
+namespace gralloc {
+
+// Answers from the fake handle and name table the way libgrallocutils answers from the handle
+// and its metadata region.
+Error GetMetaDataValue(void *buffer, int64_t type, void *in) {
+  private_handle_t *hnd = static_cast<private_handle_t *>(buffer);
+  if (!hnd || !in) {
+    return Error::BAD_BUFFER;
+  }
+  g_lookups[type]++;
+
+  switch (type) {
+    case (int64_t)StandardMetadataType::BUFFER_ID:
+      *static_cast<uint64_t *>(in) = hnd->id;
+      break;
+    case (int64_t)StandardMetadataType::NAME:
+      *static_cast<std::string *>(in) = g_names[hnd];
+      break;
+    case (int64_t)StandardMetadataType::WIDTH:
+      *static_cast<uint64_t *>(in) = static_cast<uint64_t>(hnd->unaligned_width);
+      break;
+    case (int64_t)StandardMetadataType::HEIGHT:
+      *static_cast<uint64_t *>(in) = static_cast<uint64_t>(hnd->unaligned_height);
+      break;
+    case (int64_t)StandardMetadataType::PIXEL_FORMAT_REQUESTED:
+      *static_cast<int32_t *>(in) = hnd->format;
+      break;
+    case (int64_t)StandardMetadataType::USAGE:
+      *static_cast<uint64_t *>(in) = hnd->usage;
+      break;
+    case (int64_t)StandardMetadataType::ALLOCATION_SIZE:
+      *static_cast<uint32_t *>(in) = hnd->size;
+      break;
+    case QTI_FD:
+      *static_cast<int32_t *>(in) = hnd->fd;
+      break;
+    case QTI_PRIVATE_FLAGS:
+      *static_cast<int32_t *>(in) = hnd->flags;
+      break;
+    case QTI_ALIGNED_WIDTH_IN_PIXELS:
+      *static_cast<uint32_t *>(in) = static_cast<uint32_t>(hnd->width);
+      break;
+    case QTI_BUFFER_TYPE:
+      *static_cast<int32_t *>(in) = hnd->buffer_type;
+      break;
+    default:
+      return Error::UNSUPPORTED;
+  }
+
+  return Error::NONE;
+}
+
+}  // namespace gralloc
+
+TEST_F(HWCBufferMetadataCacheTest, MatchesUncachedReads) {
+  FakeBuffer video(11, 1001, 1920, 1080, BUFFER_TYPE_VIDEO, "video");
+  FakeBuffer ui(12, 1002, 1080, 2400, BUFFER_TYPE_UI, "ui");
+  HWCBufferMetadataCache cache;
+
+  for (const FakeBuffer *buffer : {&video, &ui}) {
+    BufferMetadataSnapshot expected;
+    ReadUncached(buffer->Get(), &expected);
+    const BufferMetadataSnapshot *snapshot = cache.Get(buffer->Get());
+    ASSERT_NE(nullptr, snapshot);
+    EXPECT_EQ(buffer->Get(), snapshot->handle);
+    EXPECT_EQ(expected.handle_id, snapshot->handle_id);
+    EXPECT_EQ(expected.fd, snapshot->fd);
+    EXPECT_EQ(expected.format, snapshot->format);
+    EXPECT_EQ(expected.private_flags, snapshot->private_flags);
+    EXPECT_EQ(expected.buffer_type, snapshot->buffer_type);
+    EXPECT_EQ(expected.unaligned_width, snapshot->unaligned_width);
+    EXPECT_EQ(expected.unaligned_height, snapshot->unaligned_height);
+    EXPECT_EQ(expected.aligned_width, snapshot->aligned_width);
+    EXPECT_EQ(expected.allocation_size, snapshot->allocation_size);
+    EXPECT_EQ(expected.usage, snapshot->usage);
+    EXPECT_EQ(expected.name, snapshot->name);
+  }
+  EXPECT_EQ(0u, cache.GetHits());
+  EXPECT_EQ(2u, cache.GetMisses());
+  EXPECT_EQ(nullptr, cache.Get(nullptr));
+}
+
+TEST_F(HWCBufferMetadataCacheTest, HitCostsBufferIdAndFdLookups) {
+  std::vector<std::unique_ptr<FakeBuffer>> swapchain;
+  for (int i = 0; i < 3; i++) {
+    swapchain.emplace_back(new FakeBuffer(20 + i, 2000 + i, 1080, 2400, BUFFER_TYPE_UI, "app"));
+  }
+  HWCBufferMetadataCache cache;
+  for (auto &buffer : swapchain) {
+    cache.Get(buffer->Get());
+  }
+
+  g_lookups.clear();
+  for (int frame = 0; frame < 30; frame++) {
+    const FakeBuffer &buffer = *swapchain[frame % 3];
+    EXPECT_EQ(buffer.Get(), cache.Get(buffer.Get())->handle);
+  }
+  EXPECT_EQ(30u, g_lookups[(int64_t)StandardMetadataType::BUFFER_ID]);
+  EXPECT_EQ(30u, g_lookups[QTI_FD]);
+  EXPECT_EQ(60u, TotalLookups());
+  EXPECT_EQ(30u, cache.GetHits());
+  EXPECT_EQ(3u, cache.GetMisses());
+}
+
+TEST_F(HWCBufferMetadataCacheTest, RefillsReallocatedHandle) {
+  FakeBuffer buffer(30, 3000, 1080, 2400, BUFFER_TYPE_UI, "before");
+  HWCBufferMetadataCache cache;
+  EXPECT_EQ(1080u, cache.Get(buffer.Get())->unaligned_width);
+
+  // Same handle address, new buffer id: served from gralloc again, never stale.
+  buffer.Reallocate(3001, 720, "after");
+  const BufferMetadataSnapshot *snapshot = cache.Get(buffer.Get());
+  EXPECT_EQ(3001u, snapshot->handle_id);
+  EXPECT_EQ(720u, snapshot->unaligned_width);
+  EXPECT_EQ("after", snapshot->name);
+  EXPECT_EQ(2u, cache.GetMisses());
+}
+
+TEST_F(HWCBufferMetadataCacheTest, ReimportedHandleGetsCurrentFd) {
+  FakeBuffer buffer(50, 5000, 1080, 2400, BUFFER_TYPE_UI, "app");
+  HWCBufferMetadataCache cache;
+  EXPECT_EQ(50, cache.Get(buffer.Get())->fd);
+
+  // Same handle address and buffer id: the attributes are still cached, the fd is not.
+  buffer.Reimport(51);
+  const BufferMetadataSnapshot *snapshot = cache.Get(buffer.Get());
+  EXPECT_EQ(51, snapshot->fd);
+  EXPECT_EQ(5000u, snapshot->handle_id);
+  EXPECT_EQ(1u, cache.GetHits());
+  EXPECT_EQ(1u, cache.GetMisses());
+}
+
+TEST_F(HWCBufferMetadataCacheTest, EvictsLeastRecentlyUsed) {
+  std::vector<std::unique_ptr<FakeBuffer>> buffers;
+  for (int i = 0; i < 9; i++) {
+    buffers.emplace_back(new FakeBuffer(40 + i, 4000 + i, 256, 256, BUFFER_TYPE_UI, "buf"));
+  }
+  HWCBufferMetadataCache cache;
+  for (int i = 0; i < 8; i++) {
+    cache.Get(buffers[i]->Get());
+  }
+  // Touch all but the first, then a ninth buffer takes the first one's entry.
+  for (int i = 1; i < 8; i++) {
+    cache.Get(buffers[i]->Get());
+  }
+  cache.Get(buffers[8]->Get());
+  EXPECT_EQ(7u, cache.GetHits());
+  EXPECT_EQ(9u, cache.GetMisses());
+
+  cache.Get(buffers[1]->Get());
+  EXPECT_EQ(8u, cache.GetHits());
+  cache.Get(buffers[0]->Get());
+  EXPECT_EQ(10u, cache.GetMisses());
+
+  cache.Clear();
+  cache.Get(buffers[8]->Get());
+  EXPECT_EQ(11u, cache.GetMisses());
+}
+
+TEST_F(HWCBufferMetadataCacheTest, Throughput) {
+  const int kLayers = 8;
+  const int kSwapchain = 3;
+  const int kFrames = 20000;
+  std::vector<std::unique_ptr<FakeBuffer>> buffers;
+  for (int i = 0; i < kLayers * kSwapchain; i++) {
+    buffers.emplace_back(new FakeBuffer(100 + i, 10000 + i, 1080, 2400, BUFFER_TYPE_UI, "layer"));
+  }
+  std::vector<HWCBufferMetadataCache> caches(kLayers);
+
+  uint64_t checksum = 0;
+  g_lookups.clear();
+  auto begin = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < kFrames; frame++) {
+    for (int layer = 0; layer < kLayers; layer++) {
+      BufferMetadataSnapshot snapshot;
+      ReadUncached(buffers[layer * kSwapchain + frame % kSwapchain]->Get(), &snapshot);
+      checksum += snapshot.allocation_size;
+    }
+  }
+  std::chrono::duration<double, std::nano> uncached = std::chrono::steady_clock::now() - begin;
+  uint32_t uncached_lookups = TotalLookups();
+
+  g_lookups.clear();
+  begin = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < kFrames; frame++) {
+    for (int layer = 0; layer < kLayers; layer++) {
+      auto snapshot = caches[layer].Get(buffers[layer * kSwapchain + frame % kSwapchain]->Get());
+      checksum -= snapshot->allocation_size;
+    }
+  }
+  std::chrono::duration<double, std::nano> cached = std::chrono::steady_clock::now() - begin;
+  uint32_t cached_lookups = TotalLookups();
+
+  EXPECT_EQ(0u, checksum);
+  EXPECT_LT(cached_lookups, uncached_lookups);
+  printf("%d layers: uncached %.0f ns/frame (%.1f lookups), snapshot %.0f ns/frame "
+         "(%.1f lookups)\n", kLayers, uncached.count() / kFrames,
+         double(uncached_lookups) / kFrames, cached.count() / kFrames,
+         double(cached_lookups) / kFrames);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -268,7 +268,6 @@ int BufferManager::GetCustomDimensions(private_handle_t *hnd, int *stride, int *
 }
 
 BufferManager::BufferManager() : next_id_(0) {
-  handles_map_.clear();
   allocator_ = new Allocator();
   enable_logs = property_get_bool(ENABLE_LOGS_PROP, 0);
 }
@@ -366,7 +365,7 @@ void BufferManager::RegisterHandleLocked(const private_handle_t *hnd, int ion_ha
 #endif
   }
 
-  handles_map_.emplace(std::make_pair(hnd, buffer));
+  GetShard(hnd).handles_map.emplace(std::make_pair(hnd, buffer));
 }
 
 Error BufferManager::ImportHandleLocked(private_handle_t *hnd) {
@@ -400,18 +399,30 @@ Error BufferManager::ImportHandleLocked(private_handle_t *hnd) {
   }
 
   RegisterHandleLocked(hnd, ion_handle, ion_handle_meta);
-  allocated_ += hnd->size;
+  return Error::NONE;
+}
+
+BufferManager::Shard &BufferManager::GetShard(const private_handle_t *hnd) {
+  // Handles are heap allocated, drop the allocator alignment bits before picking a shard
+  auto addr = reinterpret_cast<uintptr_t>(hnd);
+  return shards_[((addr >> 4) ^ (addr >> 12)) % kNumShards];
+}
+
+bool BufferManager::AddAllocatedSize(uint64_t size) {
+  std::lock_guard<std::mutex> lock(stats_lock_);
+  allocated_ += size;
   if (allocated_ >= kAllocThreshold) {
     kAllocThreshold += kMemoryOffset;
-    BuffersDump();
+    return true;
   }
-  return Error::NONE;
+  return false;
 }
 
 std::shared_ptr<BufferManager::Buffer> BufferManager::GetBufferFromHandleLocked(
     const private_handle_t *hnd) {
-  auto it = handles_map_.find(hnd);
-  if (it != handles_map_.end()) {
+  auto &handles_map = GetShard(hnd).handles_map;
+  auto it = handles_map.find(hnd);
+  if (it != handles_map.end()) {
     return it->second;
   } else {
     return nullptr;
@@ -437,7 +448,7 @@ Error BufferManager::MapBuffer(private_handle_t const *handle) {
 }
 
 Error BufferManager::IsBufferImported(const private_handle_t *hnd) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
+  std::shared_lock<std::shared_mutex> lock(GetShard(hnd).lock);
   auto buf = GetBufferFromHandleLocked(hnd);
   if (buf != nullptr) {
     return Error::NONE;
@@ -448,30 +459,45 @@ Error BufferManager::IsBufferImported(const private_handle_t *hnd) {
 Error BufferManager::RetainBuffer(private_handle_t const *hnd) {
   ALOGD_IF(enable_logs, "Retain buffer handle:%p id: %" PRIu64, hnd, hnd->id);
   auto err = Error::NONE;
-  std::lock_guard<std::mutex> lock(buffer_lock_);
-  auto buf = GetBufferFromHandleLocked(hnd);
-  if (buf != nullptr) {
-    buf->IncRef();
-  } else {
-    private_handle_t *handle = const_cast<private_handle_t *>(hnd);
-    err = ImportHandleLocked(handle);
+  bool dump_buffers = false;
+  {
+    std::lock_guard<std::shared_mutex> lock(GetShard(hnd).lock);
+    auto buf = GetBufferFromHandleLocked(hnd);
+    if (buf != nullptr) {
+      buf->IncRef();
+    } else {
+      private_handle_t *handle = const_cast<private_handle_t *>(hnd);
+      err = ImportHandleLocked(handle);
+      if (err == Error::NONE) {
+        dump_buffers = AddAllocatedSize(hnd->size);
+      }
+    }
+  }
+
+  // Dump walks every shard, so it must run without holding this handle's shard lock
+  if (dump_buffers) {
+    BuffersDump();
   }
   return err;
 }
 
 Error BufferManager::ReleaseBuffer(private_handle_t const *hnd) {
   ALOGD_IF(enable_logs, "Release buffer handle:%p", hnd);
-  std::lock_guard<std::mutex> lock(buffer_lock_);
+  auto &shard = GetShard(hnd);
+  std::lock_guard<std::shared_mutex> lock(shard.lock);
   auto buf = GetBufferFromHandleLocked(hnd);
   if (buf == nullptr) {
     ALOGE("Could not find handle: %p", hnd);
     return Error::BAD_BUFFER;
   } else {
     if (buf->DecRef()) {
-      handles_map_.erase(hnd);
+      shard.handles_map.erase(hnd);
       // Unmap, close ion handle and close fd
-      if (allocated_ >= hnd->size) {
-        allocated_ -= hnd->size;
+      {
+        std::lock_guard<std::mutex> stats_lock(stats_lock_);
+        if (allocated_ >= hnd->size) {
+          allocated_ -= hnd->size;
+        }
       }
       FreeBuffer(buf);
     }
@@ -480,7 +506,7 @@ Error BufferManager::ReleaseBuffer(private_handle_t const *hnd) {
 }
 
 Error BufferManager::LockBuffer(const private_handle_t *hnd, uint64_t usage) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
+  std::lock_guard<std::shared_mutex> lock(GetShard(hnd).lock);
   auto err = Error::NONE;
   ALOGD_IF(enable_logs, "LockBuffer buffer handle:%p id: %" PRIu64, hnd, hnd->id);
 
@@ -522,7 +548,7 @@ Error BufferManager::LockBuffer(const private_handle_t *hnd, uint64_t usage) {
 }
 
 Error BufferManager::FlushBuffer(const private_handle_t *handle) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
+  std::shared_lock<std::shared_mutex> lock(GetShard(handle).lock);
   auto status = Error::NONE;
 
   private_handle_t *hnd = const_cast<private_handle_t *>(handle);
@@ -540,7 +566,7 @@ Error BufferManager::FlushBuffer(const private_handle_t *handle) {
 }
 
 Error BufferManager::RereadBuffer(const private_handle_t *handle) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
+  std::shared_lock<std::shared_mutex> lock(GetShard(handle).lock);
   auto status = Error::NONE;
 
   private_handle_t *hnd = const_cast<private_handle_t *>(handle);
@@ -558,7 +584,7 @@ Error BufferManager::RereadBuffer(const private_handle_t *handle) {
 }
 
 Error BufferManager::UnlockBuffer(const private_handle_t *handle) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
+  std::lock_guard<std::shared_mutex> lock(GetShard(handle).lock);
   auto status = Error::NONE;
 
   private_handle_t *hnd = const_cast<private_handle_t *>(handle);
@@ -615,7 +641,7 @@ Error BufferManager::AllocateBuffer(const BufferDescriptor &descriptor, buffer_h
                                     unsigned int bufferSize, bool testAlloc) {
   if (!handle)
     return Error::BAD_BUFFER;
-  std::lock_guard<std::mutex> buffer_lock(buffer_lock_);
+  std::lock_guard<std::mutex> alloc_lock(alloc_lock_);
 
   uint64_t usage = descriptor.GetUsage();
   int format = GetImplDefinedFormat(usage, descriptor.GetFormat());
@@ -742,7 +768,10 @@ Error BufferManager::AllocateBuffer(const BufferDescriptor &descriptor, buffer_h
 
   *handle = hnd;
 
-  RegisterHandleLocked(hnd, data.ion_handle, e_data.ion_handle);
+  {
+    std::lock_guard<std::shared_mutex> lock(GetShard(hnd).lock);
+    RegisterHandleLocked(hnd, data.ion_handle, e_data.ion_handle);
+  }
   ALOGD_IF(enable_logs,
            "Allocated buffer info: handle id:%" PRIu64
            " wxh:%dx%d uwxuh:%dx%d size: %d fd:%d fd_meta:%d flags:0x%x "
@@ -769,6 +798,7 @@ void BufferManager::BuffersDump() {
   millis = tv.tv_usec / 1000;
   snprintf(timeStamp, sizeof(timeStamp), "Timestamp: %s.%03" PRIu64, hms, millis);
 
+  std::lock_guard<std::mutex> dump_lock(dump_lock_);
   std::fstream fs;
   fs.open(file_dump_.kDumpFile, std::ios::app);
   if (!fs) {
@@ -776,18 +806,25 @@ void BufferManager::BuffersDump() {
   }
   fs << "============================" << std::endl;
   fs << timeStamp << std::endl;
-  fs << "Total layers = " << handles_map_.size() << std::endl;
+  size_t total_layers = 0;
+  std::ostringstream layers;
   uint64_t totalAllocationSize = 0;
-  for (auto it : handles_map_) {
-    auto buf = it.second;
-    auto hnd = buf->handle;
-    auto metadata = reinterpret_cast<MetaData_t *>(hnd->base_metadata);
-    fs << std::setw(80) << "Client:" << (metadata ? metadata->name : "No name");
-    fs << std::setw(20) << "WxH:" << std::setw(4) << hnd->width << " x " << std::setw(4)
-       << hnd->height;
-    fs << std::setw(20) << "Size: " << std::setw(9) << hnd->size << std::endl;
-    totalAllocationSize += hnd->size;
+  for (auto &shard : shards_) {
+    std::shared_lock<std::shared_mutex> lock(shard.lock);
+    total_layers += shard.handles_map.size();
+    for (auto it : shard.handles_map) {
+      auto buf = it.second;
+      auto hnd = buf->handle;
+      auto metadata = reinterpret_cast<MetaData_t *>(hnd->base_metadata);
+      layers << std::setw(80) << "Client:" << (metadata ? metadata->name : "No name");
+      layers << std::setw(20) << "WxH:" << std::setw(4) << hnd->width << " x " << std::setw(4)
+             << hnd->height;
+      layers << std::setw(20) << "Size: " << std::setw(9) << hnd->size << std::endl;
+      totalAllocationSize += hnd->size;
+    }
   }
+  fs << "Total layers = " << total_layers << std::endl;
+  fs << layers.str();
   fs << "Total allocation  = " << totalAllocationSize / 1024 << "KiB" << std::endl;
   file_dump_.position = fs.tellp();
   if (file_dump_.position > (20 * 1024 * 1024)) {
@@ -797,48 +834,52 @@ void BufferManager::BuffersDump() {
 }
 
 Error BufferManager::Dump(std::ostringstream *os) {
-  std::lock_guard<std::mutex> buffer_lock(buffer_lock_);
-  for (auto it : handles_map_) {
-    auto buf = it.second;
-    auto hnd = buf->handle;
-    *os << "handle id: " << std::setw(4) << hnd->id;
-    *os << " fd: " << std::setw(3) << hnd->fd;
-    *os << " fd_meta: " << std::setw(3) << hnd->fd_metadata;
-    *os << " wxh: " << std::setw(4) << hnd->width << " x " << std::setw(4) << hnd->height;
-    *os << " uwxuh: " << std::setw(4) << hnd->unaligned_width << " x ";
-    *os << std::setw(4) << hnd->unaligned_height;
-    *os << " size: " << std::setw(9) << hnd->size;
-    *os << std::hex << std::setfill('0');
-    *os << " priv_flags: "
-        << "0x" << std::setw(8) << hnd->flags;
-    *os << " usage: "
-        << "0x" << std::setw(8) << hnd->usage;
-    // TODO(user): get format string from qdutils
-    *os << " format: "
-        << "0x" << std::setw(8) << hnd->format;
-    *os << std::dec << std::setfill(' ') << std::endl;
+  for (auto &shard : shards_) {
+    std::shared_lock<std::shared_mutex> lock(shard.lock);
+    for (auto it : shard.handles_map) {
+      auto buf = it.second;
+      auto hnd = buf->handle;
+      *os << "handle id: " << std::setw(4) << hnd->id;
+      *os << " fd: " << std::setw(3) << hnd->fd;
+      *os << " fd_meta: " << std::setw(3) << hnd->fd_metadata;
+      *os << " wxh: " << std::setw(4) << hnd->width << " x " << std::setw(4) << hnd->height;
+      *os << " uwxuh: " << std::setw(4) << hnd->unaligned_width << " x ";
+      *os << std::setw(4) << hnd->unaligned_height;
+      *os << " size: " << std::setw(9) << hnd->size;
+      *os << std::hex << std::setfill('0');
+      *os << " priv_flags: "
+          << "0x" << std::setw(8) << hnd->flags;
+      *os << " usage: "
+          << "0x" << std::setw(8) << hnd->usage;
+      // TODO(user): get format string from qdutils
+      *os << " format: "
+          << "0x" << std::setw(8) << hnd->format;
+      *os << std::dec << std::setfill(' ') << std::endl;
+    }
   }
   return Error::NONE;
 }
 
-// Get list of private handles in handles_map_
+// Get list of private handles in all registry shards
 Error BufferManager::GetAllHandles(std::vector<const private_handle_t *> *out_handle_list) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
-  if (handles_map_.empty()) {
-    return Error::NO_RESOURCES;
+  for (auto &shard : shards_) {
+    std::shared_lock<std::shared_mutex> lock(shard.lock);
+    out_handle_list->reserve(out_handle_list->size() + shard.handles_map.size());
+    for (auto handle : shard.handles_map) {
+      out_handle_list->push_back(handle.first);
+    }
   }
-  out_handle_list->reserve(handles_map_.size());
-  for (auto handle : handles_map_) {
-    out_handle_list->push_back(handle.first);
+  if (out_handle_list->empty()) {
+    return Error::NO_RESOURCES;
   }
   return Error::NONE;
 }
 
 Error BufferManager::GetReservedRegion(private_handle_t *handle, void **reserved_region,
                                        uint64_t *reserved_region_size) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
   if (!handle)
     return Error::BAD_BUFFER;
+  std::shared_lock<std::shared_mutex> lock(GetShard(handle).lock);
 
   auto buf = GetBufferFromHandleLocked(handle);
   if (buf == nullptr)
@@ -856,9 +897,9 @@ Error BufferManager::GetReservedRegion(private_handle_t *handle, void **reserved
 Error BufferManager::GetCustomContentMdRegion(private_handle_t *handle,
                                             void **custom_content_md_region,
                                             uint64_t *custom_content_md_region_size) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
   if (!handle)
     return Error::BAD_BUFFER;
+  std::shared_lock<std::shared_mutex> lock(GetShard(handle).lock);
 
   auto buf = GetBufferFromHandleLocked(handle);
   if (buf == nullptr)
@@ -875,9 +916,9 @@ Error BufferManager::GetCustomContentMdRegion(private_handle_t *handle,
 
 Error BufferManager::GetMetadataValue(private_handle_t *handle, int64_t metadatatype_value,
                                       void *param) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
   if (!handle)
     return Error::BAD_BUFFER;
+  std::shared_lock<std::shared_mutex> lock(GetShard(handle).lock);
   auto buf = GetBufferFromHandleLocked(handle);
   if (buf == nullptr)
     return Error::BAD_BUFFER;
@@ -924,9 +965,9 @@ static Error GetCustomMetadataHelper(void *custom_content_md_region_ptr,
 
 Error BufferManager::GetMetadata(private_handle_t *handle, int64_t metadatatype_value,
                                  hidl_vec<uint8_t> *out) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
   if (!handle)
     return Error::BAD_BUFFER;
+  std::shared_lock<std::shared_mutex> lock(GetShard(handle).lock);
   auto buf = GetBufferFromHandleLocked(handle);
   if (buf == nullptr)
     return Error::BAD_BUFFER;
@@ -1456,10 +1497,9 @@ Error BufferManager::GetMetadata(private_handle_t *handle, int64_t metadatatype_
 
 Error BufferManager::SetMetadata(private_handle_t *handle, int64_t metadatatype_value,
                                  hidl_vec<uint8_t> in) {
-  std::lock_guard<std::mutex> lock(buffer_lock_);
-
   if (!handle)
     return Error::BAD_BUFFER;
+  std::lock_guard<std::shared_mutex> lock(GetShard(handle).lock);
 
   auto buf = GetBufferFromHandleLocked(handle);
   if (buf == nullptr)
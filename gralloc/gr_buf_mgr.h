@@ -26,7 +26,9 @@
 
 #include <pthread.h>
 
+#include <atomic>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -74,6 +76,7 @@ class BufferManager {
   Error ImportHandleLocked(private_handle_t *hnd);
 
   // Creates a Buffer from the valid private handle and adds it to the map
+  // Caller must hold the handle's shard lock exclusively
   void RegisterHandleLocked(const private_handle_t *hnd, int ion_handle, int ion_handle_meta);
 
   // Wrapper structure over private handle
@@ -103,11 +106,31 @@ class BufferManager {
 
   Error FreeBuffer(std::shared_ptr<Buffer> buf);
 
+  // The handle registry is split into shards keyed by handle address, so that lookups on
+  // unrelated buffers from different clients do not serialize on one mutex.
+  // Metadata reads and other non-mutating lookups take the shard lock shared, anything that
+  // changes the Buffer entry or the private handle takes it exclusive.
+  static const uint32_t kNumShards = 16;
+  struct Shard {
+    std::shared_mutex lock;
+    std::unordered_map<const private_handle_t *, std::shared_ptr<Buffer>> handles_map = {};
+  };
+  Shard &GetShard(const private_handle_t *hnd);
+
+  // Updates the imported size accounting, returns true if a buffers dump is due
+  bool AddAllocatedSize(uint64_t size);
+
   // Get the wrapper Buffer object from the handle, returns nullptr if handle is not found
+  // Caller must hold the handle's shard lock
   std::shared_ptr<Buffer> GetBufferFromHandleLocked(const private_handle_t *hnd);
   Allocator *allocator_ = NULL;
-  std::mutex buffer_lock_;
-  std::unordered_map<const private_handle_t *, std::shared_ptr<Buffer>> handles_map_ = {};
+  Shard shards_[kNumShards];
+  // Serializes AllocateBuffer, lookups never take it
+  std::mutex alloc_lock_;
+  // Guards allocated_ and kAllocThreshold
+  std::mutex stats_lock_;
+  // Guards file_dump_, never held while acquiring it from under a shard lock
+  std::mutex dump_lock_;
   std::atomic<uint64_t> next_id_;
   uint64_t allocated_ = 0;
   uint64_t kAllocThreshold = (uint64_t)1*1024*1024*1024;
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <unordered_set>
+
+#include "../gr_allocator.h"
+#include "fake_allocator.h"
+
+namespace fake_alloc {
+
+namespace {
+
+struct State {
+  std::mutex lock;
+  std::unordered_set<int> live;
+  int next_handle = 1;
+  Stats stats = {};
+};
+
+State &GetState() {
+  static State state;
+  return state;
+}
+
+}  // namespace
+
+Stats GetStats() {
+  State &state = GetState();
+  std::lock_guard<std::mutex> lock(state.lock);
+  Stats stats = state.stats;
+  stats.live = static_cast<uint32_t>(state.live.size());
+  return stats;
+}
+
+void Reset() {
+  State &state = GetState();
+  std::lock_guard<std::mutex> lock(state.lock);
+  state.live.clear();
+  state.stats = {};
+}
+
+}  // namespace fake_alloc
+
+namespace gralloc {
+
+void Allocator::SetProperties(gralloc::GrallocProperties props) {}
+
+int Allocator::MapBuffer(void **base, unsigned int size, unsigned int offset, int fd) {
+  void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    return -errno;
+  }
+  *base = addr;
+  return 0;
+}
+
+int Allocator::ImportBuffer(int fd) {
+  if (fd < 0) {
+    return -EINVAL;
+  }
+  fake_alloc::State &state = fake_alloc::GetState();
+  std::lock_guard<std::mutex> lock(state.lock);
+  int handle = state.next_handle++;
+  state.live.insert(handle);
+  state.stats.imports++;
+  return handle;
+}
+
+int Allocator::FreeBuffer(void *base, unsigned int size, unsigned int offset, int fd,
+                          int handle) {
+  if (base) {
+    munmap(base, size);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+
+  fake_alloc::State &state = fake_alloc::GetState();
+  std::lock_guard<std::mutex> lock(state.lock);
+  state.stats.frees++;
+  if (!state.live.erase(handle)) {
+    state.stats.bad_frees++;
+  }
+  return 0;
+}
+
+int Allocator::CleanBuffer(void *base, unsigned int size, unsigned int offset, int handle, int op,
+                           int fd) {
+  return 0;
+}
+
+int Allocator::AllocateMem(AllocData *data, uint64_t usage, int format) {
+  return -ENOMEM;
+}
+
+bool Allocator::CheckForBufferSharing(
+    uint32_t num_descriptors, const std::vector<std::shared_ptr<BufferDescriptor>> &descriptors,
+    ssize_t *max_index) {
+  return false;
+}
+
+int Allocator::SetBufferPermission(int fd, BufferPermission *buffer_perm, int64_t *mem_hdl) {
+  return 0;
+}
+
+}  // namespace gralloc
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __FAKE_ALLOCATOR_H__
+#define __FAKE_ALLOCATOR_H__
+
+#include <stdint.h>
+
+// In-process stand-in for gralloc::Allocator, so BufferManager can be exercised without ion or
+// dma-buf heaps. Tests link it instead of gr_allocator.cpp. Imports hand out fresh handle ids,
+// frees unmap and close the fd like the heap backends do.
+namespace fake_alloc {
+
+struct Stats {
+  uint32_t imports;
+  uint32_t frees;
+  // Frees of a handle id that was never imported or was already freed
+  uint32_t bad_frees;
+  // Imported handle ids that have not been freed yet
+  uint32_t live;
+};
+
+Stats GetStats();
+void Reset();
+
+}  // namespace fake_alloc
+
+#endif  // __FAKE_ALLOCATOR_H__
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../gr_buf_mgr.h"
+#include "fake_allocator.h"
+
+using namespace gralloc;
+using namespace testing;
+
+namespace {
+
+const unsigned int kBufferSize = 4096;
+const int kThreads = 8;
+
+class BufferManagerTest : public Test {
+ protected:
+  void SetUp() override {
+    fake_alloc::Reset();
+    buf_mgr_ = BufferManager::GetInstance();
+  }
+
+  void TearDown() override {
+    fake_alloc::Stats stats = fake_alloc::GetStats();
+    EXPECT_EQ(0u, stats.live);
+    EXPECT_EQ(0u, stats.bad_frees);
+  }
+
+  // Returns a handle the way the mapper receives it before import. Like native_handle_clone()
+  // it is malloc'd, BufferManager frees it with the last release.
+  private_handle_t *CreateHandle() {
+    int fd = memfd_create("gr_buf_mgr_test", MFD_CLOEXEC);
+    int meta_fd = memfd_create("gr_buf_mgr_test_meta", MFD_CLOEXEC);
+    EXPECT_EQ(0, ftruncate(fd, kBufferSize));
+    EXPECT_EQ(0, ftruncate(meta_fd, static_cast<off_t>(GetMetaDataSize(0, 0))));
+
+    auto hnd = static_cast<private_handle_t *>(calloc(1, sizeof(private_handle_t)));
+    hnd->version = static_cast<int>(sizeof(native_handle));
+    hnd->numFds = private_handle_t::kNumFds;
+    hnd->numInts = private_handle_t::NumInts();
+    hnd->magic = private_handle_t::kMagic;
+    hnd->fd = fd;
+    hnd->fd_metadata = meta_fd;
+    hnd->width = 32;
+    hnd->height = 32;
+    hnd->unaligned_width = 32;
+    hnd->unaligned_height = 32;
+    hnd->format = HAL_PIXEL_FORMAT_RGBA_8888;
+    hnd->layer_count = 1;
+    hnd->id = ++next_id_;
+    return hnd;
+  }
+
+  std::vector<private_handle_t *> CreateHandles(size_t count) {
+    std::vector<private_handle_t *> handles(count);
+    for (auto &hnd : handles) {
+      hnd = CreateHandle();
+    }
+    return handles;
+  }
+
+  // Runs fn(thread index) on count threads at once.
+  void RunThreads(int count, std::function<void(int)> fn) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < count; i++) {
+      threads.emplace_back(fn, i);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  BufferManager *buf_mgr_ = nullptr;
+  uint64_t next_id_ = 0;
+};
+
+}  // namespace
+
+TEST_F(BufferManagerTest, RetainReleaseBalanced) {
+  private_handle_t *hnd = CreateHandle();
+  EXPECT_EQ(Error::BAD_BUFFER, buf_mgr_->IsBufferImported(hnd));
+
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(Error::NONE, buf_mgr_->RetainBuffer(hnd));
+  }
+  // Main and metadata fds are imported once, later retains only take a reference.
+  EXPECT_EQ(2u, fake_alloc::GetStats().imports);
+  EXPECT_EQ(kBufferSize, hnd->size);
+  EXPECT_NE(0u, hnd->base_metadata);
+
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(Error::NONE, buf_mgr_->ReleaseBuffer(hnd));
+    EXPECT_EQ(Error::NONE, buf_mgr_->IsBufferImported(hnd));
+  }
+  EXPECT_EQ(0u, fake_alloc::GetStats().frees);
+
+  ASSERT_EQ(Error::NONE, buf_mgr_->ReleaseBuffer(hnd));
+  EXPECT_EQ(2u, fake_alloc::GetStats().frees);
+}
+
+TEST_F(BufferManagerTest, ReleaseUnknownHandle) {
+  private_handle_t *hnd = CreateHandle();
+  EXPECT_EQ(Error::BAD_BUFFER, buf_mgr_->ReleaseBuffer(hnd));
+  EXPECT_EQ(0u, fake_alloc::GetStats().frees);
+  close(hnd->fd);
+  close(hnd->fd_metadata);
+  free(hnd);
+}
+
+// Every thread imports the same fresh handles at once, then every thread drops them at once.
+// Each handle has to be imported by exactly one thread and freed by exactly one thread.
+TEST_F(BufferManagerTest, ConcurrentImportAndFree) {
+  const size_t kHandles = 64;
+  const int kRounds = 20;
+
+  for (int round = 0; round < kRounds; round++) {
+    std::vector<private_handle_t *> handles = CreateHandles(kHandles);
+    std::atomic<int> errors(0);
+
+    RunThreads(kThreads, [&](int index) {
+      std::vector<private_handle_t *> order = handles;
+      std::shuffle(order.begin(), order.end(), std::mt19937(round * kThreads + index));
+      for (auto hnd : order) {
+        errors += buf_mgr_->RetainBuffer(hnd) != Error::NONE;
+      }
+    });
+    for (auto hnd : handles) {
+      EXPECT_EQ(Error::NONE, buf_mgr_->IsBufferImported(hnd));
+    }
+
+    RunThreads(kThreads, [&](int index) {
+      std::vector<private_handle_t *> order = handles;
+      std::shuffle(order.begin(), order.end(), std::mt19937(round * kThreads + index + 1));
+      for (auto hnd : order) {
+        errors += buf_mgr_->ReleaseBuffer(hnd) != Error::NONE;
+      }
+    });
+    ASSERT_EQ(0, errors.load()) << "round " << round;
+  }
+
+  fake_alloc::Stats stats = fake_alloc::GetStats();
+  EXPECT_EQ(2 * kHandles * kRounds, stats.imports);
+  EXPECT_EQ(2 * kHandles * kRounds, stats.frees);
+}
+
+// Threads retain and release handles that stay imported, while others look them up. No
+// reference may be lost or doubled, so the owner's final release frees each handle.
+TEST_F(BufferManagerTest, ConcurrentRetainRelease) {
+  const size_t kHandles = 64;
+  const int kIterations = 2000;
+  std::vector<private_handle_t *> handles = CreateHandles(kHandles);
+  for (auto hnd : handles) {
+    ASSERT_EQ(Error::NONE, buf_mgr_->RetainBuffer(hnd));
+  }
+
+  std::atomic<int> errors(0);
+  RunThreads(kThreads, [&](int index) {
+    std::mt19937 rng(index);
+    for (int i = 0; i < kIterations; i++) {
+      auto hnd = handles[rng() % kHandles];
+      if (index % 2) {
+        errors += buf_mgr_->IsBufferImported(hnd) != Error::NONE;
+        continue;
+      }
+      int depth = 1 + static_cast<int>(rng() % 3);
+      for (int j = 0; j < depth; j++) {
+        errors += buf_mgr_->RetainBuffer(hnd) != Error::NONE;
+      }
+      for (int j = 0; j < depth; j++) {
+        errors += buf_mgr_->ReleaseBuffer(hnd) != Error::NONE;
+      }
+    }
+  });
+  EXPECT_EQ(0, errors.load());
+  EXPECT_EQ(2 * kHandles, fake_alloc::GetStats().imports);
+  EXPECT_EQ(0u, fake_alloc::GetStats().frees);
+
+  for (auto hnd : handles) {
+    ASSERT_EQ(Error::NONE, buf_mgr_->ReleaseBuffer(hnd));
+  }
+  EXPECT_EQ(2 * kHandles, fake_alloc::GetStats().frees);
+}
+
+// Lookups and retain/release on imported handles, as the mapper sees them from composer,
+// camera and media threads. Throughput should grow with the thread count.
+TEST_F(BufferManagerTest, ScalingBenchmark) {
+  const size_t kHandles = 256;
+  const int kOps = 200000;
+  std::vector<private_handle_t *> handles = CreateHandles(kHandles);
+  for (auto hnd : handles) {
+    ASSERT_EQ(Error::NONE, buf_mgr_->RetainBuffer(hnd));
+  }
+
+  for (bool retain : {false, true}) {
+    for (int threads : {1, 2, 4, 8}) {
+      std::atomic<int> errors(0);
+      auto start = std::chrono::steady_clock::now();
+      RunThreads(threads, [&](int index) {
+        for (int i = 0; i < kOps; i++) {
+          auto hnd = handles[(static_cast<size_t>(i) * 7 + static_cast<size_t>(index)) % kHandles];
+          if (retain) {
+            errors += buf_mgr_->RetainBuffer(hnd) != Error::NONE;
+            errors += buf_mgr_->ReleaseBuffer(hnd) != Error::NONE;
+          } else {
+            errors += buf_mgr_->IsBufferImported(hnd) != Error::NONE;
+          }
+        }
+      });
+      auto end = std::chrono::steady_clock::now();
+
+      double seconds = std::chrono::duration<double>(end - start).count();
+      printf("%s, %d thread(s): %.2f Mops/s\n", retain ? "retain/release" : "lookup", threads,
+             threads * kOps / seconds / 1e6);
+      EXPECT_EQ(0, errors.load());
+    }
+  }
+
+  for (auto hnd : handles) {
+    ASSERT_EQ(Error::NONE, buf_mgr_->ReleaseBuffer(hnd));
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -95,6 +95,7 @@
 #define ENABLE_PIPE_PRIORITY_PROP            DISPLAY_PROP("enable_pipe_priority")
 #define DISABLE_EXCl_RECT_PARTIAL_FB         DISPLAY_PROP("disable_excl_rect_partial_fb")
 #define DISABLE_FBID_CACHE                   DISPLAY_PROP("disable_fbid_cache")
+#define FBID_CACHE_LIMIT                     DISPLAY_PROP("fbid_cache_limit")
 #define DISABLE_HOTPLUG_BWCHECK              DISPLAY_PROP("disable_hotplug_bwcheck")
 #define DISABLE_MASK_LAYER_HINT              DISPLAY_PROP("disable_mask_layer_hint")
 #define DISABLE_HDR_LUT_GEN                  DISPLAY_PROP("disable_hdr_lut_gen")
@@ -139,6 +140,10 @@
 // Allows color management(tonemapping) in native mode (native mode is considered BT709+sRGB)
 #define ALLOW_TONEMAP_NATIVE                 DISPLAY_PROP("allow_tonemap_native")
 #define ENABLE_METADATA_DUMPING              DISPLAY_PROP("enable_metadata_dump")
+// Frame dumps are staged and written off the composition path, see FrameDumpWriter
+#define FRAME_DUMP_STAGING_SLOTS             DISPLAY_PROP("frame_dump_staging_slots")
+#define FRAME_DUMP_STAGING_MB                DISPLAY_PROP("frame_dump_staging_mb")
+#define FRAME_DUMP_COMPRESS                  DISPLAY_PROP("frame_dump_compress")
 
 // RC
 #define ENABLE_ROUNDED_CORNER                DISPLAY_PROP("enable_rounded_corner")
@@ -194,6 +199,8 @@
 #define ENABLE_PRIMARY_RECONFIG_REQUEST      DISPLAY_PROP("enable_primary_reconfig_request")
 // SDM verbose logging
 #define ENABLE_VERBOSE_LOG                   DISPLAY_PROP("enable_verbose_log")
+// Format info and lower level logs on a drain thread instead of the logging thread
+#define ENABLE_DEFERRED_LOGGING              DISPLAY_PROP("enable_deferred_logging")
 // HDR10 GPU Target
 #define ENABLE_HDR10_GPU_TARGET              DISPLAY_PROP("enable_hdr10_gpu_target")
 #define MAX_SCALE_FACTOR_FOR_HDR_CLIENT      DISPLAY_PROP("max_scale_factor_for_hdr_client")
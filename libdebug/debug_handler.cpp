@@ -27,6 +27,8 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <mutex>
+
 #include "debug_handler.h"
 
 namespace display {
@@ -48,6 +50,19 @@ class DefaultDebugHandler : public DebugHandler {
 DefaultDebugHandler g_default_debug_handler;
 DebugHandler * DebugHandler::debug_handler_ = &g_default_debug_handler;
 std::bitset<32> DebugHandler::log_mask_ = 0x1;  // Always print logs tagged with value 0
+std::atomic<uint32_t> DebugHandler::log_state_(0x1F);  // All levels enabled, none deferred
+std::atomic<bool> DebugHandler::trace_enabled_(true);
+
+static std::mutex g_log_state_lock;
+static LogLevel g_log_level = kLogLevelVerbose;
+static bool g_deferred_logging = false;
+
+static uint32_t BuildLogState(LogLevel level, bool deferred) {
+  uint32_t enabled = (1U << (level + 1)) - 1;
+  // Deferred levels keep their enabled bit, the macro checks deferral first.
+  uint32_t deferred_levels = deferred ? (enabled & ~((1U << kLogLevelInfo) - 1)) : 0;
+  return enabled | (deferred_levels << DebugHandler::kDeferredShift);
+}
 
 void DebugHandler::Set(DebugHandler *debug_handler) {
   if (debug_handler) {
@@ -57,4 +72,19 @@ void DebugHandler::Set(DebugHandler *debug_handler) {
   }
 }
 
+void DebugHandler::SetLogLevel(LogLevel level) {
+  std::lock_guard<std::mutex> lock(g_log_state_lock);
+  g_log_level = level;
+  log_state_.store(BuildLogState(g_log_level, g_deferred_logging), std::memory_order_relaxed);
+}
+
+void DebugHandler::SetDeferredLogging(bool enable) {
+  std::lock_guard<std::mutex> lock(g_log_state_lock);
+  if (enable) {
+    LogDrain::Start();
+  }
+  g_deferred_logging = enable;
+  log_state_.store(BuildLogState(g_log_level, g_deferred_logging), std::memory_order_relaxed);
+}
+
 }  // namespace display
@@ -30,10 +30,32 @@
 #ifndef __DEBUG_HANDLER_H__
 #define __DEBUG_HANDLER_H__
 
+#include <atomic>
 #include <bitset>
 
-#define DLOG(method, format, ...) \
-  display::DebugHandler::Get()->method(__CLASS__ "::%s: " format, __FUNCTION__, ##__VA_ARGS__)
+#include "log_ring.h"
+
+// Log calls above this level are compiled out; their arguments are still type checked but never
+// evaluated. Defaults to keeping everything, e.g. -DDLOG_COMPILED_LEVEL=2 keeps up to Info.
+#ifndef DLOG_COMPILED_LEVEL
+#define DLOG_COMPILED_LEVEL 4
+#endif
+
+// Levels disabled at runtime, see DebugHandler::SetLogLevel(), return after a single load
+// without reaching the handler.
+#define DLOG(method, format, ...)                                                              \
+  do {                                                                                         \
+    if (display::kLogLevel##method <= DLOG_COMPILED_LEVEL) {                                   \
+      uint32_t dlog_state = display::DebugHandler::GetLogState();                              \
+      if (display::DebugHandler::IsDeferred(dlog_state, display::kLogLevel##method)) {         \
+        display::LogRing::Log(display::kLogLevel##method, __CLASS__ "::%s: " format,           \
+                              __FUNCTION__, ##__VA_ARGS__);                                    \
+      } else if (display::DebugHandler::IsEnabled(dlog_state, display::kLogLevel##method)) {   \
+        display::DebugHandler::Get()->method(__CLASS__ "::%s: " format, __FUNCTION__,          \
+                                             ##__VA_ARGS__);                                   \
+      }                                                                                        \
+    }                                                                                          \
+  } while (0)
 
 #define DLOG_IF(tag, method, format, ...) \
   if (display::DebugHandler::GetLogMask()[tag]) { \
@@ -79,22 +101,55 @@ class DebugHandler {
   static inline std::bitset<32> & GetLogMask() { return log_mask_; }
   static void SetLogMask(const std::bitset<32> &log_mask) { log_mask_ = log_mask; }
 
+  // Enabled and deferred state of every level, one bit each; read once per log call.
+  static const uint32_t kDeferredShift = 8;
+  static inline uint32_t GetLogState() { return log_state_.load(std::memory_order_relaxed); }
+  static inline bool IsEnabled(uint32_t state, LogLevel level) { return state & (1U << level); }
+  static inline bool IsDeferred(uint32_t state, LogLevel level) {
+    return state & (1U << (level + kDeferredShift));
+  }
+  // Levels above level are dropped without a call into the handler. All are enabled by default.
+  static void SetLogLevel(LogLevel level);
+  // Info and lower levels are recorded in per-thread rings and formatted by a drain thread,
+  // which keeps formatting and the handler's I/O off the logging thread. Errors and warnings
+  // stay synchronous.
+  static void SetDeferredLogging(bool enable);
+  static void FlushDeferredLogs() { LogDrain::Flush(); }
+
+  // Cached by the client, e.g. from the trace tag state, so that disabled scopes cost one load.
+  static inline bool IsTraceEnabled() { return trace_enabled_.load(std::memory_order_relaxed); }
+  static void SetTraceEnabled(bool enable) {
+    trace_enabled_.store(enable, std::memory_order_relaxed);
+  }
+
  protected:
   virtual ~DebugHandler() { }
 
  private:
   static DebugHandler *debug_handler_;
   static std::bitset<32> log_mask_;
+  static std::atomic<uint32_t> log_state_;
+  static std::atomic<bool> trace_enabled_;
 };
 
 template <class T>
 class ScopeTracer {
  public:
-  ScopeTracer(const char *class_name, const char *function_name) {
-    T::Get()->BeginTrace(class_name, function_name, "");
+  ScopeTracer(const char *class_name, const char *function_name)
+    : enabled_(T::IsTraceEnabled()) {
+    if (enabled_) {
+      T::Get()->BeginTrace(class_name, function_name, "");
+    }
   }
 
-  ~ScopeTracer() { T::Get()->EndTrace(); }
+  ~ScopeTracer() {
+    if (enabled_) {
+      T::Get()->EndTrace();
+    }
+  }
+
+ private:
+  bool enabled_;
 };
 
 }  // namespace display
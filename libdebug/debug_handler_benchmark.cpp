@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// Cost per log call and trace scope for each way a call can be handled. Built with
+// DLOG_COMPILED_LEVEL at Debug, so DLOGV sites are compiled out.
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+
+#include "debug_handler.h"
+
+#define __CLASS__ "Benchmark"
+
+namespace {
+
+// Formats like a real handler would, minus the log device write.
+class FormattingDebugHandler : public display::DebugHandler {
+ public:
+  void Error(const char *format, ...) override {
+    va_list list;
+    va_start(list, format);
+    Print(format, list);
+    va_end(list);
+  }
+  void Warning(const char *format, ...) override {
+    va_list list;
+    va_start(list, format);
+    Print(format, list);
+    va_end(list);
+  }
+  void Info(const char *format, ...) override {
+    va_list list;
+    va_start(list, format);
+    Print(format, list);
+    va_end(list);
+  }
+  void Debug(const char *format, ...) override {
+    va_list list;
+    va_start(list, format);
+    Print(format, list);
+    va_end(list);
+  }
+  void Verbose(const char *format, ...) override {
+    va_list list;
+    va_start(list, format);
+    Print(format, list);
+    va_end(list);
+  }
+  void BeginTrace(const char *, const char *, const char *) override { traces_++; }
+  void EndTrace() override { traces_++; }
+  int GetProperty(const char *, int *) override { return -1; }
+  int GetProperty(const char *, char *) override { return -1; }
+
+  size_t bytes_ = 0;
+  size_t traces_ = 0;
+
+ private:
+  void Print(const char *format, va_list list) {
+    char line[1024];
+    int length = vsnprintf(line, sizeof(line), format, list);
+    bytes_ += length > 0 ? static_cast<size_t>(length) : 0;
+  }
+};
+
+const int kIterations = 200000;
+// Deferred calls are timed in batches that fit a ring, the drain runs between batches.
+const int kBatch = 256;
+
+struct Layer {
+  const char *name;
+  int id;
+  uint32_t format;
+  float alpha;
+};
+
+template <typename Body>
+double MeasureNs(Body body, bool flush_between_batches) {
+  std::chrono::nanoseconds total(0);
+  for (int done = 0; done < kIterations; done += kBatch) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < kBatch; i++) {
+      body(done + i);
+    }
+    total += std::chrono::steady_clock::now() - begin;
+    if (flush_between_batches) {
+      display::DebugHandler::FlushDeferredLogs();
+    }
+  }
+  return static_cast<double>(total.count()) / kIterations;
+}
+
+void TracedFunction() {
+  DTRACE_SCOPED();
+}
+
+}  // namespace
+
+int main() {
+  FormattingDebugHandler handler;
+  display::DebugHandler::Set(&handler);
+  Layer layer = {"com.android.systemui.ImageWallpaper#0", 42, 0x1, 0.75f};
+
+  auto log_debug = [&](int i) {
+    DLOGD("layer %s id %d fmt 0x%x alpha %.2f frame %d", layer.name, layer.id, layer.format,
+          layer.alpha, i);
+  };
+  auto log_verbose = [&](int i) {
+    DLOGV("layer %s id %d fmt 0x%x alpha %.2f frame %d", layer.name, layer.id, layer.format,
+          layer.alpha, i);
+  };
+  auto trace = [&](int) { TracedFunction(); };
+
+  printf("%-34s %8s\n", "case", "ns/call");
+  printf("%-34s %8.1f\n", "log compiled out", MeasureNs(log_verbose, false));
+
+  display::DebugHandler::SetLogLevel(display::kLogLevelInfo);
+  printf("%-34s %8.1f\n", "log disabled at runtime", MeasureNs(log_debug, false));
+
+  display::DebugHandler::SetLogLevel(display::kLogLevelVerbose);
+  printf("%-34s %8.1f\n", "log enabled, formatted in place", MeasureNs(log_debug, false));
+
+  display::DebugHandler::SetDeferredLogging(true);
+  printf("%-34s %8.1f\n", "log enabled, deferred", MeasureNs(log_debug, true));
+  display::DebugHandler::SetDeferredLogging(false);
+
+  display::DebugHandler::SetTraceEnabled(false);
+  printf("%-34s %8.1f\n", "trace scope disabled", MeasureNs(trace, false));
+  display::DebugHandler::SetTraceEnabled(true);
+  printf("%-34s %8.1f\n", "trace scope enabled", MeasureNs(trace, false));
+
+  display::DebugHandler::Set(nullptr);
+  return (handler.bytes_ && handler.traces_) ? 0 : 1;
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "debug_handler.h"
+#include "log_ring.h"
+
+namespace display {
+
+// Drain period, bounds both the log latency and how much a ring has to absorb.
+static const std::chrono::milliseconds kDrainPeriod(10);
+
+thread_local LogRing *LogRing::thread_ring_ = nullptr;
+
+// Moves a head or tail count by at most the capacity.
+static uint32_t Advance(uint32_t index, uint32_t count) {
+  return (index + count) & (2 * LogRing::kCapacity - 1);
+}
+
+class LogRegistry {
+ public:
+  static LogRegistry *GetInstance() {
+    // Lives for the process lifetime, threads may log until exit.
+    static LogRegistry *registry = new LogRegistry();
+    return registry;
+  }
+
+  void Add(const std::shared_ptr<LogRing> &ring) {
+    std::lock_guard<std::mutex> lock(lock_);
+    rings_.push_back(ring);
+  }
+
+  void Start() {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!thread_.joinable()) {
+      thread_ = std::thread(&LogRegistry::Run, this);
+    }
+  }
+
+  void Drain() {
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      rings = rings_;
+    }
+
+    std::lock_guard<std::mutex> drain_lock(drain_lock_);
+    for (auto &ring : rings) {
+      uint32_t dropped = ring->TakeDropped();
+      if (dropped) {
+        DebugHandler::Get()->Warning("LogRing: dropped %u deferred messages", dropped);
+      }
+    }
+
+    // Merge by timestamp so lines from different threads keep their relative order.
+    std::string line;
+    while (true) {
+      LogRing *oldest_ring = nullptr;
+      const LogRing::Record *oldest = nullptr;
+      for (auto &ring : rings) {
+        const LogRing::Record *record = ring->Peek();
+        if (record && (!oldest || record->timestamp_ns < oldest->timestamp_ns)) {
+          oldest = record;
+          oldest_ring = ring.get();
+        }
+      }
+      if (!oldest) {
+        break;
+      }
+
+      char prefix[32];
+      snprintf(prefix, sizeof(prefix), "[%d] ", oldest->tid);
+      line = prefix;
+      LogRing::Format(oldest, &line);
+      Emit(static_cast<LogLevel>(oldest->level), line);
+      oldest_ring->Pop(oldest);
+    }
+
+    // Rings of exited threads go once they have been drained.
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto it = rings_.begin(); it != rings_.end();) {
+      it = ((*it)->IsExited() && !(*it)->Peek()) ? rings_.erase(it) : (it + 1);
+    }
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::this_thread::sleep_for(kDrainPeriod);
+      Drain();
+    }
+  }
+
+  static void Emit(LogLevel level, const std::string &line) {
+    DebugHandler *handler = DebugHandler::Get();
+    switch (level) {
+      case kLogLevelError:
+        handler->Error("%s", line.c_str());
+        break;
+      case kLogLevelWarning:
+        handler->Warning("%s", line.c_str());
+        break;
+      case kLogLevelInfo:
+        handler->Info("%s", line.c_str());
+        break;
+      case kLogLevelDebug:
+        handler->Debug("%s", line.c_str());
+        break;
+      default:
+        handler->Verbose("%s", line.c_str());
+        break;
+    }
+  }
+
+  std::mutex lock_;
+  std::mutex drain_lock_;
+  std::vector<std::shared_ptr<LogRing>> rings_;
+  std::thread thread_;
+};
+
+// Marks the ring exited when its thread goes away, the registry still owns the memory.
+struct ThreadRingOwner {
+  ~ThreadRingOwner() {
+    if (ring) {
+      ring->SetExited();
+    }
+  }
+
+  std::shared_ptr<LogRing> ring;
+};
+
+LogRing *LogRing::RegisterThread() {
+  static thread_local ThreadRingOwner owner;
+  if (!owner.ring) {
+    owner.ring = std::make_shared<LogRing>();
+    owner.ring->tid_ = gettid();
+    LogRegistry::GetInstance()->Add(owner.ring);
+  }
+
+  thread_ring_ = owner.ring.get();
+  return thread_ring_;
+}
+
+uint8_t *LogRing::Reserve(uint32_t size) {
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  uint32_t tail = tail_.load(std::memory_order_acquire);
+  uint32_t offset = head & (kCapacity - 1);
+  uint32_t to_end = kCapacity - offset;
+
+  // Records are contiguous; one that does not fit before the end starts over at offset 0.
+  skip_ = (size > to_end) ? to_end : 0;
+  uint32_t used = (head >= tail) ? head - tail : head + 2 * kCapacity - tail;
+  if (size > kCapacity / 4 || used + skip_ + size > kCapacity) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  if (skip_) {
+    uint32_t marker = 0;
+    memcpy(buffer_ + offset, &marker, sizeof(marker));
+    offset = 0;
+  }
+
+  return buffer_ + offset;
+}
+
+void LogRing::Commit(uint32_t size) {
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  head_.store(Advance(head, skip_ + size), std::memory_order_release);
+}
+
+const LogRing::Record *LogRing::Peek() {
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  uint32_t head = head_.load(std::memory_order_acquire);
+
+  while (tail != head) {
+    uint32_t offset = tail & (kCapacity - 1);
+    const Record *record = reinterpret_cast<const Record *>(buffer_ + offset);
+    if (record->size) {
+      return record;
+    }
+    tail = Advance(tail, kCapacity - offset);
+    tail_.store(tail, std::memory_order_release);
+  }
+
+  return nullptr;
+}
+
+void LogRing::Pop(const Record *record) {
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  tail_.store(Advance(tail, record->size), std::memory_order_release);
+}
+
+struct DecodedArg {
+  LogRing::ArgType type = LogRing::kArgInt32;
+  uint64_t bits = 0;
+  double real = 0;
+  const char *string = nullptr;
+};
+
+static const uint8_t *DecodeArg(const uint8_t *data, DecodedArg *arg) {
+  arg->type = static_cast<LogRing::ArgType>(*data++);
+  switch (arg->type) {
+    case LogRing::kArgInt32: {
+      int32_t value = 0;
+      memcpy(&value, data, sizeof(value));
+      arg->bits = static_cast<uint64_t>(static_cast<int64_t>(value));
+      return data + sizeof(value);
+    }
+    case LogRing::kArgUint32: {
+      uint32_t value = 0;
+      memcpy(&value, data, sizeof(value));
+      arg->bits = value;
+      return data + sizeof(value);
+    }
+    case LogRing::kArgInt64:
+    case LogRing::kArgUint64:
+      memcpy(&arg->bits, data, sizeof(arg->bits));
+      return data + sizeof(arg->bits);
+    case LogRing::kArgDouble:
+      memcpy(&arg->real, data, sizeof(arg->real));
+      return data + sizeof(arg->real);
+    case LogRing::kArgPointer: {
+      const void *value = nullptr;
+      memcpy(&value, data, sizeof(value));
+      arg->bits = reinterpret_cast<uintptr_t>(value);
+      return data + sizeof(value);
+    }
+    case LogRing::kArgString: {
+      uint16_t length = 0;
+      memcpy(&length, data, sizeof(length));
+      arg->string = reinterpret_cast<const char *>(data + sizeof(length));
+      return data + sizeof(length) + length + 1;
+    }
+  }
+
+  return data;
+}
+
+// Width in bits a length modifier gives an integer conversion.
+static uint32_t IntegerBits(const std::string &length) {
+  if (length == "hh") {
+    return 8;
+  } else if (length == "h") {
+    return 16;
+  } else if (length == "l") {
+    return sizeof(long) * 8;
+  } else if (length == "ll" || length == "j" || length == "q") {
+    return 64;
+  } else if (length == "z") {
+    return sizeof(size_t) * 8;
+  } else if (length == "t") {
+    return sizeof(ptrdiff_t) * 8;
+  }
+  return sizeof(int) * 8;
+}
+
+static void Append(std::string *out, const char *spec, ...) __attribute__((format(printf, 2, 3)));
+static void Append(std::string *out, const char *spec, ...) {
+  char buffer[512];
+  va_list list;
+  va_start(list, spec);
+  int length = vsnprintf(buffer, sizeof(buffer), spec, list);
+  va_end(list);
+  if (length > 0) {
+    out->append(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+  }
+}
+
+void LogRing::Format(const Record *record, std::string *out) {
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(record) + sizeof(Record);
+  uint32_t remaining_args = record->num_args;
+  const char *format = record->format;
+
+  auto next_arg = [&](DecodedArg *arg) {
+    if (!remaining_args) {
+      return false;
+    }
+    remaining_args--;
+    data = DecodeArg(data, arg);
+    return true;
+  };
+
+  while (*format) {
+    const char *percent = strchr(format, '%');
+    if (!percent) {
+      out->append(format);
+      break;
+    }
+    out->append(format, static_cast<size_t>(percent - format));
+    format = percent + 1;
+    if (*format == '%') {
+      out->push_back('%');
+      format++;
+      continue;
+    }
+
+    // Rebuild the conversion spec with '*' resolved and the length modifier taken out, each
+    // conversion is then formatted on its own with the stored argument.
+    std::string spec = "%";
+    while (*format && strchr("-+ #0'", *format)) {
+      spec.push_back(*format++);
+    }
+    for (int field = 0; field < 2; field++) {
+      if (field == 1) {
+        if (*format != '.') {
+          break;
+        }
+        spec.push_back(*format++);
+      }
+      if (*format == '*') {
+        DecodedArg arg;
+        if (!next_arg(&arg)) {
+          return;
+        }
+        spec += std::to_string(static_cast<int32_t>(arg.bits));
+        format++;
+      }
+      while (*format >= '0' && *format <= '9') {
+        spec.push_back(*format++);
+      }
+    }
+    std::string length;
+    while (*format && strchr("hlLqjzt", *format)) {
+      length.push_back(*format++);
+    }
+
+    char conversion = *format;
+    if (!conversion) {
+      break;
+    }
+    format++;
+    if (conversion == 'n') {
+      continue;
+    }
+
+    DecodedArg arg;
+    if (!next_arg(&arg)) {
+      out->append("<missing>");
+      continue;
+    }
+
+    switch (conversion) {
+      case 'd':
+      case 'i': {
+        uint32_t shift = 64 - IntegerBits(length);
+        int64_t value = static_cast<int64_t>(arg.bits << shift) >> shift;
+        Append(out, (spec + "lld").c_str(), static_cast<long long>(value));
+        break;
+      }
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X': {
+        uint32_t shift = 64 - IntegerBits(length);
+        uint64_t value = (arg.bits << shift) >> shift;
+        Append(out, (spec + "ll" + conversion).c_str(), static_cast<unsigned long long>(value));
+        break;
+      }
+      case 'c':
+        Append(out, (spec + "c").c_str(), static_cast<int>(arg.bits));
+        break;
+      case 's':
+        Append(out, (spec + "s").c_str(), arg.type == kArgString ? arg.string : "(null)");
+        break;
+      case 'p':
+        Append(out, (spec + "p").c_str(), reinterpret_cast<void *>(arg.bits));
+        break;
+      default:
+        Append(out, (spec + conversion).c_str(), arg.real);
+        break;
+    }
+  }
+}
+
+void LogDrain::Start() {
+  LogRegistry::GetInstance()->Start();
+}
+
+void LogDrain::Flush() {
+  LogRegistry::GetInstance()->Drain();
+}
+
+}  // namespace display
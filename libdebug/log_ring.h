@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __LOG_RING_H__
+#define __LOG_RING_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+namespace display {
+
+enum LogLevel {
+  kLogLevelError,
+  kLogLevelWarning,
+  kLogLevelInfo,
+  kLogLevelDebug,
+  kLogLevelVerbose,
+};
+
+// Per-thread binary log ring used for deferred logging. The logging thread only copies the
+// format string pointer and the raw arguments; formatting happens on the drain thread. Each ring
+// has a single producer (its thread) and a single consumer (the drain thread), so neither side
+// takes a lock. Messages are dropped and counted when the ring is full.
+class LogRing {
+ public:
+  enum ArgType : uint8_t {
+    kArgInt32,
+    kArgUint32,
+    kArgInt64,
+    kArgUint64,
+    kArgDouble,
+    kArgPointer,
+    kArgString,
+  };
+
+  struct Record {
+    uint32_t size;         // Whole record including arguments, 0 marks a skip to ring start
+    uint16_t num_args;
+    uint8_t level;
+    uint8_t reserved;
+    int32_t tid;
+    int64_t timestamp_ns;  // CLOCK_MONOTONIC, orders records across rings
+    const char *format;    // Must be a string literal, it is read on the drain thread
+  };
+
+  static const uint32_t kCapacity = 64 * 1024;
+  static const uint32_t kMaxStringLength = 255;
+
+  // Records a message on the calling thread's ring.
+  template <typename... Args>
+  static void Log(LogLevel level, const char *format, Args... args) {
+    LogRing *ring = thread_ring_ ? thread_ring_ : RegisterThread();
+    if (!ring) {
+      return;
+    }
+
+    uint32_t size = Align(static_cast<uint32_t>(sizeof(Record) + ArgsSize(args...)));
+    uint8_t *data = ring->Reserve(size);
+    if (!data) {
+      return;
+    }
+
+    struct timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    Record record = {};
+    record.size = size;
+    record.num_args = static_cast<uint16_t>(sizeof...(args));
+    record.level = static_cast<uint8_t>(level);
+    record.tid = ring->tid_;
+    record.timestamp_ns = now.tv_sec * 1000000000LL + now.tv_nsec;
+    record.format = format;
+    memcpy(data, &record, sizeof(record));
+    WriteArgs(data + sizeof(record), args...);
+    ring->Commit(size);
+  }
+
+  // Consumer side, only called from the drain thread.
+  const Record *Peek();
+  void Pop(const Record *record);
+  uint32_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+  bool IsExited() const { return exited_.load(std::memory_order_acquire); }
+  void SetExited() { exited_.store(true, std::memory_order_release); }
+
+  // Formats record the way printf would have, using the arguments stored after it.
+  static void Format(const Record *record, std::string *out);
+
+ private:
+  template <typename T, typename Enable = void>
+  struct Arg;
+
+  // Pointers to these are logged as strings.
+  template <typename T>
+  struct IsCharacter
+      : std::integral_constant<bool, std::is_integral<T>::value &&
+                                         sizeof(typename std::conditional<
+                                                std::is_integral<T>::value, T, int>::type) == 1> {};
+
+  static LogRing *RegisterThread();
+  static uint32_t Align(uint32_t size) { return (size + 7) & ~7U; }
+
+  uint8_t *Reserve(uint32_t size);
+  void Commit(uint32_t size);
+
+  static size_t ArgsSize() { return 0; }
+  template <typename T, typename... Rest>
+  static size_t ArgsSize(T value, Rest... rest) {
+    return Arg<T>::Size(value) + ArgsSize(rest...);
+  }
+
+  static void WriteArgs(uint8_t *) {}
+  template <typename T, typename... Rest>
+  static void WriteArgs(uint8_t *data, T value, Rest... rest) {
+    WriteArgs(Arg<T>::Write(data, value), rest...);
+  }
+
+  static uint8_t *WriteArg(uint8_t *data, ArgType type, const void *value, size_t size) {
+    *data = type;
+    memcpy(data + 1, value, size);
+    return data + 1 + size;
+  }
+
+  static thread_local LogRing *thread_ring_;
+
+  alignas(8) uint8_t buffer_[kCapacity];
+  // Byte counts modulo twice the capacity, so a full ring is told apart from an empty one and
+  // neither side's arithmetic wraps under the overflow sanitizer.
+  std::atomic<uint32_t> head_ = {0};  // Written by the producer
+  std::atomic<uint32_t> tail_ = {0};  // Written by the consumer
+  std::atomic<uint32_t> dropped_ = {0};
+  std::atomic<bool> exited_ = {false};
+  uint32_t skip_ = 0;
+  int32_t tid_ = 0;
+};
+
+// Integers and enums, stored after the usual varargs promotion so that the drain thread can
+// apply the conversion's length modifier exactly as printf would.
+template <typename T>
+struct LogRing::Arg<T, typename std::enable_if<std::is_integral<T>::value ||
+                                               std::is_enum<T>::value>::type> {
+  typedef typename std::conditional<std::is_enum<T>::value, std::underlying_type<T>,
+                                    std::common_type<T>>::type::type Integer;
+
+  static size_t Size(T) { return 1 + (sizeof(Integer) > 4 ? 8 : 4); }
+  static uint8_t *Write(uint8_t *data, T value) {
+    Integer integer = static_cast<Integer>(value);
+    if (sizeof(Integer) > 4) {
+      int64_t raw = static_cast<int64_t>(integer);
+      return WriteArg(data, std::is_signed<Integer>::value ? kArgInt64 : kArgUint64, &raw, 8);
+    }
+    int32_t raw = static_cast<int32_t>(integer);
+    bool is_signed = std::is_signed<Integer>::value || sizeof(Integer) < 4;
+    return WriteArg(data, is_signed ? kArgInt32 : kArgUint32, &raw, 4);
+  }
+};
+
+template <typename T>
+struct LogRing::Arg<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static size_t Size(T) { return 1 + sizeof(double); }
+  static uint8_t *Write(uint8_t *data, T value) {
+    double raw = static_cast<double>(value);
+    return WriteArg(data, kArgDouble, &raw, sizeof(raw));
+  }
+};
+
+// Strings are copied, the pointer may not outlive the call.
+template <typename T>
+struct LogRing::Arg<T *, typename std::enable_if<LogRing::IsCharacter<T>::value>::type> {
+  static size_t Length(T *value) {
+    return strnlen(reinterpret_cast<const char *>(value), kMaxStringLength);
+  }
+  static size_t Size(T *value) {
+    return value ? 1 + sizeof(uint16_t) + Length(value) + 1 : 1 + sizeof(const void *);
+  }
+  static uint8_t *Write(uint8_t *data, T *value) {
+    if (!value) {
+      const void *raw = nullptr;
+      return WriteArg(data, kArgPointer, &raw, sizeof(raw));
+    }
+    uint16_t length = static_cast<uint16_t>(Length(value));
+    data = WriteArg(data, kArgString, &length, sizeof(length));
+    memcpy(data, value, length);
+    data[length] = '\0';
+    return data + length + 1;
+  }
+};
+
+template <typename T>
+struct LogRing::Arg<T *, typename std::enable_if<!LogRing::IsCharacter<T>::value>::type> {
+  static size_t Size(T *) { return 1 + sizeof(const void *); }
+  static uint8_t *Write(uint8_t *data, T *value) {
+    const void *raw = value;
+    return WriteArg(data, kArgPointer, &raw, sizeof(raw));
+  }
+};
+
+template <>
+struct LogRing::Arg<std::nullptr_t> {
+  static size_t Size(std::nullptr_t) { return 1 + sizeof(const void *); }
+  static uint8_t *Write(uint8_t *data, std::nullptr_t) {
+    const void *raw = nullptr;
+    return WriteArg(data, kArgPointer, &raw, sizeof(raw));
+  }
+};
+
+// Drains every thread's ring in timestamp order and hands the formatted lines to the active
+// DebugHandler, tagged with the id of the thread that logged them.
+class LogDrain {
+ public:
+  // Starts the drain thread on first use.
+  static void Start();
+  // Synchronously drains everything logged so far.
+  static void Flush();
+};
+
+}  // namespace display
+
+#endif  // __LOG_RING_H__
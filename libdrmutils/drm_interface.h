@@ -626,6 +626,11 @@ enum struct DRMOps {
    *      uint32_t - Brightness Level
    */
   CONNECTOR_SET_BRIGHTNESS,
+  /*
+   * Op: reset connector property cache.
+   * Arg: uint32_t - Connector ID
+   */
+  CONNECTOR_RESET_CACHE,
 };
 
 enum struct DRMRotation {
@@ -1326,6 +1331,30 @@ typedef int (*GetDRMManager)(int fd, DRMManagerInterface **intf);
 /* Destroy DRMManager instance */
 typedef int (*DestroyDRMManager)();
 
+/* Optional, exported by backends that have no DRM node and manage framebuffers themselves.
+ * Populates a framebuffer id for the buffer fd with the given geometry and format */
+typedef int (*CreateDRMFbId)(int buffer_fd, uint32_t width, uint32_t height, uint32_t format,
+                             uint64_t modifier, uint32_t *fb_id);
+
+/* Optional, removes a framebuffer id populated by CreateDRMFbId */
+typedef int (*RemoveDRMFbId)(uint32_t fb_id);
+
+/* Optional, exported by backends that have no DRM node and raise vblank events themselves.
+ * Populates an fd that HWEventsDRM polls in place of a DRM node fd, it becomes readable when a
+ * vblank requested on it is due */
+typedef int (*OpenDRMEventFd)(int *fd);
+
+/* Optional, closes an fd populated by OpenDRMEventFd */
+typedef int (*CloseDRMEventFd)(int fd);
+
+/* Optional, counterpart of drmWaitVBlank with DRM_VBLANK_EVENT, requests an event for the next
+ * vblank on an fd populated by OpenDRMEventFd */
+typedef int (*RequestDRMVBlank)(int fd);
+
+/* Optional, counterpart of drmHandleEvent, consumes the vblank events that are due on fd and
+ * populates the CLOCK_MONOTONIC timestamp of the latest. Returns -EAGAIN if none is due */
+typedef int (*HandleDRMVBlank)(int fd, int64_t *timestamp_ns);
+
 
 /*
  * DRM Manager Interface - Any class which plans to implement helper function for vendor
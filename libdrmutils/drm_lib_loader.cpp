@@ -28,6 +28,7 @@
 */
 
 #include <dlfcn.h>
+#include <stdlib.h>
 
 #include "drm_lib_loader.h"
 
@@ -60,11 +61,29 @@ void DRMLibLoader::Destroy() {
 }
 
 DRMLibLoader::DRMLibLoader() {
-  if (Open("libsdedrm.so")) {
+  // SDE_DRM_LIB selects an alternate backend, e.g. libsdedrm_virtual.so for headless runs
+  const char *lib_name = getenv("SDE_DRM_LIB");
+  if (Open(lib_name ? lib_name : "libsdedrm.so")) {
     if (Sym("GetDRMManager", reinterpret_cast<void **>(&func_get_drm_manager_)) &&
         Sym("DestroyDRMManager", reinterpret_cast<void **>(&func_destroy_drm_manager_))) {
       is_loaded_ = true;
     }
+    // Optional, both or neither
+    if (!Sym("CreateDRMFbId", reinterpret_cast<void **>(&func_create_drm_fb_id_)) ||
+        !Sym("RemoveDRMFbId", reinterpret_cast<void **>(&func_remove_drm_fb_id_))) {
+      func_create_drm_fb_id_ = nullptr;
+      func_remove_drm_fb_id_ = nullptr;
+    }
+    // Optional, all or none
+    if (!Sym("OpenDRMEventFd", reinterpret_cast<void **>(&func_open_drm_event_fd_)) ||
+        !Sym("CloseDRMEventFd", reinterpret_cast<void **>(&func_close_drm_event_fd_)) ||
+        !Sym("RequestDRMVBlank", reinterpret_cast<void **>(&func_request_drm_vblank_)) ||
+        !Sym("HandleDRMVBlank", reinterpret_cast<void **>(&func_handle_drm_vblank_))) {
+      func_open_drm_event_fd_ = nullptr;
+      func_close_drm_event_fd_ = nullptr;
+      func_request_drm_vblank_ = nullptr;
+      func_handle_drm_vblank_ = nullptr;
+    }
   }
 }
 
@@ -41,6 +41,14 @@ class DRMLibLoader {
   bool IsLoaded() { return is_loaded_; }
   sde_drm::GetDRMManager FuncGetDRMManager() { return func_get_drm_manager_; }
   sde_drm::DestroyDRMManager FuncDestroyDRMManager() { return func_destroy_drm_manager_; }
+  // Framebuffer hooks of backends without a DRM node, nullptr otherwise
+  sde_drm::CreateDRMFbId FuncCreateDRMFbId() { return func_create_drm_fb_id_; }
+  sde_drm::RemoveDRMFbId FuncRemoveDRMFbId() { return func_remove_drm_fb_id_; }
+  // Vblank event hooks of backends without a DRM node, nullptr otherwise
+  sde_drm::OpenDRMEventFd FuncOpenDRMEventFd() { return func_open_drm_event_fd_; }
+  sde_drm::CloseDRMEventFd FuncCloseDRMEventFd() { return func_close_drm_event_fd_; }
+  sde_drm::RequestDRMVBlank FuncRequestDRMVBlank() { return func_request_drm_vblank_; }
+  sde_drm::HandleDRMVBlank FuncHandleDRMVBlank() { return func_handle_drm_vblank_; }
 
   static DRMLibLoader *GetInstance();
   static void Destroy();
@@ -53,6 +61,12 @@ class DRMLibLoader {
   void *lib_ = {};
   sde_drm::GetDRMManager func_get_drm_manager_ = {};
   sde_drm::DestroyDRMManager func_destroy_drm_manager_ = {};
+  sde_drm::CreateDRMFbId func_create_drm_fb_id_ = {};
+  sde_drm::RemoveDRMFbId func_remove_drm_fb_id_ = {};
+  sde_drm::OpenDRMEventFd func_open_drm_event_fd_ = {};
+  sde_drm::CloseDRMEventFd func_close_drm_event_fd_ = {};
+  sde_drm::RequestDRMVBlank func_request_drm_vblank_ = {};
+  sde_drm::HandleDRMVBlank func_handle_drm_vblank_ = {};
   bool is_loaded_ = false;
 
   static DRMLibLoader *s_instance;  // Singleton instance
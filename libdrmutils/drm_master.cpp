@@ -43,6 +43,7 @@
 #include <chrono>
 #include <thread>
 
+#include "drm_lib_loader.h"
 #include "drm_master.h"
 
 #define __CLASS__ "DRMMaster"
@@ -82,6 +83,15 @@ void DRMMaster::DestroyInstance() {
 }
 
 int DRMMaster::Init() {
+  // Backends that model the display in software, e.g. libsdedrm_virtual, have no node to open
+  DRMLibLoader *drm_lib_loader = DRMLibLoader::GetInstance();
+  if (drm_lib_loader->IsLoaded() && drm_lib_loader->FuncCreateDRMFbId()) {
+    func_create_fb_id_ = drm_lib_loader->FuncCreateDRMFbId();
+    func_remove_fb_id_ = drm_lib_loader->FuncRemoveDRMFbId();
+    DRM_LOGI("Framebuffers are managed by the DRM backend, no DRM node opened");
+    return 0;
+  }
+
   uint8_t retry = 0;
   do {
     dev_fd_ = drmOpen("msm_drm", nullptr);
@@ -98,12 +108,19 @@ int DRMMaster::Init() {
 }
 
 DRMMaster::~DRMMaster() {
-  drmClose(dev_fd_);
+  if (dev_fd_ >= 0) {
+    drmClose(dev_fd_);
+  }
   dev_fd_ = -1;
 }
 
 int DRMMaster::CreateFbId(const DRMBuffer &drm_buffer, uint32_t *fb_id) {
   lock_guard<mutex> obj(s_lock);
+  if (func_create_fb_id_) {
+    return func_create_fb_id_(drm_buffer.fd, drm_buffer.width, drm_buffer.height,
+                              drm_buffer.drm_format, drm_buffer.drm_format_modifier, fb_id);
+  }
+
   uint32_t gem_handle = 0;
   int ret = drmPrimeFDToHandle(dev_fd_, drm_buffer.fd, &gem_handle);
   if (ret) {
@@ -141,6 +158,10 @@ int DRMMaster::CreateFbId(const DRMBuffer &drm_buffer, uint32_t *fb_id) {
 
 int DRMMaster::RemoveFbId(uint32_t fb_id) {
   lock_guard<mutex> obj(s_lock);
+  if (func_remove_fb_id_) {
+    return func_remove_fb_id_(fb_id);
+  }
+
   int ret = 0;
 #ifdef DRM_IOCTL_MSM_RMFB2
   ret = drmIoctl(dev_fd_, DRM_IOCTL_MSM_RMFB2, &fb_id);
@@ -30,6 +30,7 @@
 #ifndef __DRM_MASTER_H__
 #define __DRM_MASTER_H__
 
+#include <drm_interface.h>
 #include <mutex>
 
 #include "drm_logger.h"
@@ -90,6 +91,9 @@ class DRMMaster {
   int Init();
 
   int dev_fd_ = -1;              // Master fd for DRM
+  // Framebuffer hooks of a backend without a DRM node, dev_fd_ stays -1 when they are set
+  sde_drm::CreateDRMFbId func_create_fb_id_ = {};
+  sde_drm::RemoveDRMFbId func_remove_fb_id_ = {};
   static DRMMaster *s_instance;  // Singleton instance
   static std::mutex s_lock;
 };
@@ -25,6 +25,7 @@
 #include <fcntl.h>
 #include <log/log.h>
 #include <pthread.h>
+#include <string.h>
 #include <sys/epoll.h>
 #include <sys/prctl.h>
 #include <sys/stat.h>
@@ -49,9 +50,27 @@
 
 constexpr static auto implementation_defined_max_frame_ringbuffer = 300;
 
+bool histogram::DrmBlobReader::read(int fd, BlobId id, drm_msm_hist &out) {
+  drmModePropertyBlobPtr blob = drmModeGetPropertyBlob(fd, id);
+  if (!blob || !blob->data || blob->length < sizeof(out)) {
+    if (blob)
+      drmModeFreePropertyBlob(blob);
+    return false;
+  }
+
+  memcpy(&out, blob->data, sizeof(out));
+  drmModeFreePropertyBlob(blob);
+  return true;
+}
+
 histogram::HistogramCollector::HistogramCollector()
-    : histogram(histogram::Ringbuffer::create(implementation_defined_max_frame_ringbuffer,
-                                              std::make_unique<histogram::DefaultTimeKeeper>())) {}
+    : HistogramCollector(std::make_unique<histogram::DrmBlobReader>()) {}
+
+histogram::HistogramCollector::HistogramCollector(std::unique_ptr<BlobReader> reader)
+    : blob_reader(std::move(reader)),
+      histogram(histogram::Ringbuffer::create(implementation_defined_max_frame_ringbuffer,
+                                              std::make_unique<histogram::DefaultTimeKeeper>(),
+                                              histogram::Ringbuffer::Storage::preallocated)) {}
 
 histogram::HistogramCollector::~HistogramCollector() {
   stop();
@@ -81,6 +100,9 @@ std::string histogram::HistogramCollector::Dump() const {
 
   std::stringstream ss;
   ss << "Color Sampling, dark (0.0) to light (1.0): sampled frames: " << num_frames << '\n';
+  ss << "\tevents: " << events.load(std::memory_order_relaxed)
+     << ", overruns: " << overruns.load(std::memory_order_relaxed)
+     << ", rejected: " << rejected.load(std::memory_order_relaxed) << '\n';
   if (num_frames == 0) {
     ss << "\tno color statistics collected\n";
     return ss.str();
@@ -108,21 +130,19 @@ HWC2::Error histogram::HistogramCollector::collect(
   out_samples_size[2] = numBuckets;
   out_samples_size[3] = 0;
 
-  uint64_t num_frames = 0;
-  std::array<uint64_t, HIST_V_SIZE> samples;
-
-  if (max_frames == 0 && timestamp == 0) {
-    std::tie(num_frames, samples) = histogram->collect_cumulative();
-  } else if (max_frames == 0) {
-    std::tie(num_frames, samples) = histogram->collect_after(timestamp);
-  } else if (timestamp == 0) {
-    std::tie(num_frames, samples) = histogram->collect_max(max_frames);
-  } else {
-    std::tie(num_frames, samples) = histogram->collect_max_after(timestamp, max_frames);
-  }
-
-  auto samples_rebucketed = rebucketTo8Buckets(samples);
-  *out_num_frames = num_frames;
+  // Rebucket straight from the returned sample rather than copying its bins out first.
+  auto const sample = [&] {
+    if (max_frames == 0 && timestamp == 0)
+      return histogram->collect_cumulative();
+    if (max_frames == 0)
+      return histogram->collect_after(timestamp);
+    if (timestamp == 0)
+      return histogram->collect_max(max_frames);
+    return histogram->collect_max_after(timestamp, max_frames);
+  }();
+
+  auto samples_rebucketed = rebucketTo8Buckets(std::get<1>(sample));
+  *out_num_frames = std::get<0>(sample);
   if (out_samples && out_samples[2])
     memcpy(out_samples[2], samples_rebucketed.data(), sizeof(uint64_t) * samples_rebucketed.size());
 
@@ -144,6 +164,11 @@ void histogram::HistogramCollector::start() {
   start(implementation_defined_max_frame_ringbuffer);
 }
 
+std::shared_ptr<histogram::HistogramSnapshot const> histogram::HistogramCollector::snapshot()
+    const {
+  return std::atomic_load(&published);
+}
+
 void histogram::HistogramCollector::start(uint64_t max_frames) {
   std::unique_lock<decltype(mutex)> lk(mutex);
   if (started) {
@@ -151,8 +176,17 @@ void histogram::HistogramCollector::start(uint64_t max_frames) {
   }
 
   started = true;
-  histogram =
-      histogram::Ringbuffer::create(max_frames, std::make_unique<histogram::DefaultTimeKeeper>());
+  if (max_frames > histogram::Ringbuffer::max_preallocated_size) {
+    ALOGW("Clamping requested %llu frames to %zu", static_cast<unsigned long long>(max_frames),
+          histogram::Ringbuffer::max_preallocated_size);
+  }
+  // blob_processing_thread is the only producer, so collect() never waits on it.
+  histogram = histogram::Ringbuffer::create(max_frames,
+                                            std::make_unique<histogram::DefaultTimeKeeper>(),
+                                            histogram::Ringbuffer::Storage::preallocated);
+  // Events left over from a previous session refer to blobs that are long gone.
+  queue_tail.store(queue_head.load(std::memory_order_acquire), std::memory_order_release);
+  accepting.store(true, std::memory_order_release);
   monitoring_thread = std::thread(&HistogramCollector::blob_processing_thread, this);
 }
 
@@ -163,6 +197,7 @@ void histogram::HistogramCollector::stop() {
   }
 
   started = false;
+  accepting.store(false, std::memory_order_release);
   cv.notify_all();
   lk.unlock();
 
@@ -172,21 +207,33 @@ void histogram::HistogramCollector::stop() {
 
 void histogram::HistogramCollector::notify_histogram_event(int blob_source_fd, BlobId id,
                                                            uint32_t width, uint32_t height) {
-  std::unique_lock<decltype(mutex)> lk(mutex);
-  if (!started) {
+  if (!accepting.load(std::memory_order_acquire)) {
     ALOGW("Discarding event blob-id: %X", id);
     return;
   }
-  if (work_available) {
-    ALOGI("notified of histogram event before consuming last one. prior event discarded");
+
+  events.fetch_add(1, std::memory_order_relaxed);
+  auto const head = queue_head.load(std::memory_order_relaxed);
+  if (head - queue_tail.load(std::memory_order_acquire) == blob_queue_size) {
+    // The head does not move while the queue stays full, so only the first overrun of a stall
+    // is logged. Dump() has the total.
+    overruns.fetch_add(1, std::memory_order_relaxed);
+    if (head != last_overrun_head) {
+      ALOGI("histogram event queue full, discarding blob-id: %X", id);
+      last_overrun_head = head;
+    }
+    return;
   }
 
-  panel_width_ = width;
-  panel_height_ = height;
+  blob_queue[head % blob_queue_size] = BlobWork{blob_source_fd, id, width, height};
+  queue_head.store(head + 1, std::memory_order_seq_cst);
 
-  work_available = true;
-  blobwork = HistogramCollector::BlobWork{blob_source_fd, id};
-  cv.notify_all();
+  // The consumer flags itself before its final emptiness check, under mutex. Taking the mutex
+  // here only when it is flagged cannot lose a wakeup and leaves a busy consumer alone.
+  if (consumer_waiting.load(std::memory_order_seq_cst)) {
+    std::lock_guard<decltype(mutex)> lk(mutex);
+    cv.notify_all();
+  }
 }
 
 void histogram::HistogramCollector::blob_processing_thread() {
@@ -195,37 +242,67 @@ void histogram::HistogramCollector::blob_processing_thread() {
   std::unique_lock<decltype(mutex)> lk(mutex);
 
   while (true) {
-    cv.wait(lk, [this] { return !started || work_available; });
+    consumer_waiting.store(true, std::memory_order_seq_cst);
+    cv.wait(lk, [this] {
+      return !started || queue_head.load(std::memory_order_seq_cst) !=
+                             queue_tail.load(std::memory_order_relaxed);
+    });
+    consumer_waiting.store(false, std::memory_order_relaxed);
     if (!started) {
       return;
     }
-
-    auto work = blobwork;
-    work_available = false;
     lk.unlock();
 
-    drmModePropertyBlobPtr blob = drmModeGetPropertyBlob(work.fd, work.id);
-    if (!blob || !blob->data) {
-      lk.lock();
-      continue;
-    }
+    auto tail = queue_tail.load(std::memory_order_relaxed);
+    while (tail != queue_head.load(std::memory_order_acquire)) {
+      auto const work = blob_queue[tail % blob_queue_size];
+      queue_tail.store(++tail, std::memory_order_release);
+
+      if (!blob_reader->read(work.fd, work.id, blob_frame) ||
+          !hist_data_validate(blob_frame, work.width, work.height)) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
 
-    bool pass = hist_data_validate(*static_cast<struct drm_msm_hist *>(blob->data));
-    if (pass) {
-      histogram->insert(*static_cast<struct drm_msm_hist *>(blob->data));
+      histogram->insert(blob_frame);
+      publish_snapshot(work.id, blob_frame);
     }
-    drmModeFreePropertyBlob(blob);
 
     lk.lock();
   }
 }
 
-bool histogram::HistogramCollector::hist_data_validate(struct drm_msm_hist const &hist) {
+void histogram::HistogramCollector::publish_snapshot(BlobId id, drm_msm_hist const &frame) {
+  std::shared_ptr<HistogramSnapshot> next;
+  if (spare && spare.use_count() == 1) {
+    // Pairs with the release in the last reader's reference drop, its reads are done.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    next = std::move(spare);
+  } else {
+    next = std::make_shared<HistogramSnapshot>();
+  }
+
+  next->sequence = ++inserted;
+  next->id = id;
+  next->timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
+  next->frame = frame;
+  next->events = events.load(std::memory_order_relaxed);
+  next->overruns = overruns.load(std::memory_order_relaxed);
+  next->rejected = rejected.load(std::memory_order_relaxed);
+
+  auto previous = std::atomic_exchange(&published, std::shared_ptr<HistogramSnapshot const>(next));
+  // No new reader can reach the previous snapshot once it is swapped out.
+  spare = std::const_pointer_cast<HistogramSnapshot>(previous);
+}
+
+bool histogram::HistogramCollector::hist_data_validate(struct drm_msm_hist const &hist,
+                                                       uint32_t panel_width,
+                                                       uint32_t panel_height) {
   uint32_t hist_checksum = 0;
-  uint32_t pixels_sum = panel_width_ * panel_height_;
+  uint32_t pixels_sum = panel_width * panel_height;
 
   if (pixels_sum == 0) {
-    ALOGI("Invalid panel_width %u, height  %u", panel_width_, panel_height_);
+    ALOGI("Invalid panel_width %u, height  %u", panel_width, panel_height);
     return false;
   }
 
@@ -241,8 +318,8 @@ bool histogram::HistogramCollector::hist_data_validate(struct drm_msm_hist const
 
   // Hist data is valid when the sum of all hist data equals the total number of pixels
   if (pixels_sum != hist_checksum) {
-    ALOGI("Invalid hsit data, panel_width %u, height %u, hist_checksum %u", panel_width_,
-          panel_height_, hist_checksum);
+    ALOGI("Invalid hsit data, panel_width %u, height %u, hist_checksum %u", panel_width,
+          panel_height, hist_checksum);
     return false;
   }
 
@@ -24,7 +24,12 @@
 #ifndef HISTOGRAM_HISTOGRAM_COLLECTOR_H_
 #define HISTOGRAM_HISTOGRAM_COLLECTOR_H_
 #include <android-base/thread_annotations.h>
+#include <display/drm/msm_drm_pp.h>
+#include <utils/Timers.h>
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -40,16 +45,42 @@
 namespace histogram {
 typedef uint32_t BlobId;
 
+// Reads the histogram blob an event refers to. The default implementation queries the DRM
+// property blob; tests substitute blobs read from a fake DRM fd.
+struct BlobReader {
+  virtual bool read(int fd, BlobId id, drm_msm_hist &out) = 0;
+  virtual ~BlobReader() = default;
+};
+
+struct DrmBlobReader final : BlobReader {
+  bool read(int fd, BlobId id, drm_msm_hist &out) final;
+};
+
+// The newest validated frame together with the queue counters at the time it was inserted.
+// Published by the processing thread; holders keep a consistent view without copying bins.
+struct HistogramSnapshot {
+  uint64_t sequence = 0;  // frames inserted so far, this one included
+  BlobId id = 0;
+  nsecs_t timestamp = 0;
+  drm_msm_hist frame = {};
+  uint64_t events = 0;    // histogram events notified
+  uint64_t overruns = 0;  // events dropped because the queue was full
+  uint64_t rejected = 0;  // blobs that could not be read or failed validation
+};
+
 class Ringbuffer;
 class HistogramCollector {
  public:
   HistogramCollector();
+  explicit HistogramCollector(std::unique_ptr<BlobReader> reader);
   ~HistogramCollector();
 
   void start();
   void start(uint64_t max_frames);
   void stop();
 
+  // Called from the display event thread, never blocks. Events are queued until the processing
+  // thread reads their blob; only a full queue loses events.
   void notify_histogram_event(int blob_source_fd, BlobId id, uint32_t width, uint32_t height);
 
   std::string Dump() const;
@@ -60,11 +91,15 @@ class HistogramCollector {
   HWC2::Error getAttributes(int32_t *format, int32_t *dataspace,
                             uint8_t *supported_components) const;
 
+  // Latest published snapshot, nullptr until the first frame is inserted.
+  std::shared_ptr<HistogramSnapshot const> snapshot() const;
+
  private:
   HistogramCollector(HistogramCollector const &) = delete;
   HistogramCollector &operator=(HistogramCollector const &) = delete;
   void blob_processing_thread();
-  bool hist_data_validate(struct drm_msm_hist const &hist);
+  bool hist_data_validate(struct drm_msm_hist const &hist, uint32_t width, uint32_t height);
+  void publish_snapshot(BlobId id, drm_msm_hist const &frame);
 
   std::condition_variable cv;
   std::mutex mutable mutex;
@@ -73,16 +108,36 @@ class HistogramCollector {
   struct BlobWork {
     int fd; /* non-owning! */
     BlobId id;
-  } blobwork /* GUARDED_BY(mutex) */;
-  // no optional in c++14.
-  bool work_available = false; /* GUARDED_BY(mutex) */
-  ;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  // Single producer (notify_histogram_event) / single consumer (blob_processing_thread) queue.
+  // Head and tail are free running; the producer drops new events while it is full.
+  static constexpr size_t blob_queue_size = 8;
+  static_assert((blob_queue_size & (blob_queue_size - 1)) == 0, "queue size must be a power of 2");
+  std::array<BlobWork, blob_queue_size> blob_queue;
+  std::atomic<uint64_t> queue_head{0};
+  std::atomic<uint64_t> queue_tail{0};
+  std::atomic<bool> accepting{false};
+  std::atomic<bool> consumer_waiting{false};
+
+  std::atomic<uint64_t> events{0};
+  std::atomic<uint64_t> overruns{0};
+  std::atomic<uint64_t> rejected{0};
+  uint64_t last_overrun_head = UINT64_MAX;  // producer only
+  uint64_t inserted = 0;                    // processing thread only
+  drm_msm_hist blob_frame = {};             // processing thread only
+
+  // Snapshots are replaced, never modified once published. The previous one is recycled when
+  // no reader holds it any more, so steady state publishing does not allocate.
+  std::shared_ptr<HistogramSnapshot const> published;
+  std::shared_ptr<HistogramSnapshot> spare;
 
   std::thread monitoring_thread;
 
+  std::unique_ptr<BlobReader> const blob_reader;
   std::unique_ptr<histogram::Ringbuffer> histogram;
-  uint32_t panel_width_ = 0;
-  uint32_t panel_height_ = 0;
 };
 
 }  // namespace histogram
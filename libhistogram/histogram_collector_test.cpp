@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "histogram_collector.h"
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr uint32_t panel_width = 16;
+constexpr uint32_t panel_height = 16;
+
+// Valid for the panel above, distinct per blob id.
+drm_msm_hist frame_for(histogram::BlobId id) {
+  drm_msm_hist frame{};
+  frame.data[id % HIST_V_SIZE] = panel_width * panel_height;
+  return frame;
+}
+
+// Stands in for the DRM device: blobs live in a memfd at id * sizeof(drm_msm_hist), histogram
+// events are blob ids written to a pipe, like the event records a DRM fd produces.
+struct FakeDrm {
+  FakeDrm() {
+    blob_fd = memfd_create("histogram_blobs", MFD_CLOEXEC);
+    EXPECT_THAT(pipe2(event_fds, O_CLOEXEC | O_NONBLOCK), Eq(0));
+  }
+  ~FakeDrm() {
+    close(blob_fd);
+    close(event_fds[0]);
+    close(event_fds[1]);
+  }
+
+  void add_blob(histogram::BlobId id, drm_msm_hist const &frame) {
+    EXPECT_THAT(pwrite(blob_fd, &frame, sizeof(frame), id * sizeof(frame)),
+                Eq(static_cast<ssize_t>(sizeof(frame))));
+  }
+
+  void send_event(histogram::BlobId id) {
+    EXPECT_THAT(write(event_fds[1], &id, sizeof(id)), Eq(static_cast<ssize_t>(sizeof(id))));
+  }
+
+  int blob_fd = -1;
+  int event_fds[2] = {-1, -1};
+};
+
+// Reads blobs from the fake DRM fd. While the gate is closed reads block, which holds the
+// processing thread inside the read like a slow ioctl would.
+struct GatedBlobReader final : histogram::BlobReader {
+  bool read(int fd, histogram::BlobId id, drm_msm_hist &out) final {
+    {
+      std::unique_lock<std::mutex> lk(mutex);
+      reading = true;
+      cv.notify_all();
+      cv.wait(lk, [this] { return open; });
+      reading = false;
+    }
+    return pread(fd, &out, sizeof(out), id * sizeof(out)) == static_cast<ssize_t>(sizeof(out));
+  }
+
+  void set_open(bool value) {
+    std::lock_guard<std::mutex> lk(mutex);
+    open = value;
+    cv.notify_all();
+  }
+
+  bool wait_reading() {
+    std::unique_lock<std::mutex> lk(mutex);
+    return cv.wait_for(lk, 1s, [this] { return reading; });
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool open = true;
+  bool reading = false;
+};
+
+// Epoll loop over the fake DRM event fd, forwarding each event the way the display event thread
+// forwards histogram events to HWCDisplayBuiltIn::HistogramEvent.
+class EventLoop {
+ public:
+  EventLoop(FakeDrm &drm, histogram::HistogramCollector &collector)
+      : drm(drm), collector(collector) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    exit_fd = eventfd(0, EFD_CLOEXEC);
+    add(drm.event_fds[0]);
+    add(exit_fd);
+    thread = std::thread(&EventLoop::run, this);
+  }
+
+  ~EventLoop() {
+    uint64_t one = 1;
+    EXPECT_THAT(write(exit_fd, &one, sizeof(one)), Eq(static_cast<ssize_t>(sizeof(one))));
+    thread.join();
+    close(exit_fd);
+    close(epoll_fd);
+  }
+
+  // Waits until every event sent so far has been handed to the collector.
+  bool wait_forwarded(uint64_t count) {
+    auto const deadline = std::chrono::steady_clock::now() + 1s;
+    while (forwarded.load() < count) {
+      if (std::chrono::steady_clock::now() > deadline)
+        return false;
+      std::this_thread::sleep_for(1ms);
+    }
+    return true;
+  }
+
+ private:
+  void add(int fd) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    EXPECT_THAT(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event), Eq(0));
+  }
+
+  void run() {
+    while (true) {
+      epoll_event events[2];
+      int count = epoll_wait(epoll_fd, events, 2, -1);
+      for (int i = 0; i < count; i++) {
+        if (events[i].data.fd == exit_fd)
+          return;
+        histogram::BlobId id;
+        while (read(drm.event_fds[0], &id, sizeof(id)) == static_cast<ssize_t>(sizeof(id))) {
+          collector.notify_histogram_event(drm.blob_fd, id, panel_width, panel_height);
+          forwarded++;
+        }
+      }
+    }
+  }
+
+  FakeDrm &drm;
+  histogram::HistogramCollector &collector;
+  int epoll_fd = -1;
+  int exit_fd = -1;
+  std::atomic<uint64_t> forwarded{0};
+  std::thread thread;
+};
+
+}  // namespace
+
+class HistogramCollectorTest : public Test {
+ protected:
+  void SetUp() override {
+    auto gated = std::make_unique<GatedBlobReader>();
+    reader = gated.get();
+    collector = std::make_unique<histogram::HistogramCollector>(std::move(gated));
+    collector->start();
+    loop = std::make_unique<EventLoop>(drm, *collector);
+  }
+
+  void TearDown() override {
+    reader->set_open(true);
+    loop.reset();
+    collector->stop();
+  }
+
+  void send(histogram::BlobId id) {
+    drm.add_blob(id, frame_for(id));
+    drm.send_event(id);
+    sent++;
+  }
+
+  std::shared_ptr<histogram::HistogramSnapshot const> wait_sequence(uint64_t sequence) {
+    auto const deadline = std::chrono::steady_clock::now() + 1s;
+    while (std::chrono::steady_clock::now() < deadline) {
+      auto snapshot = collector->snapshot();
+      if (snapshot && snapshot->sequence >= sequence)
+        return snapshot;
+      std::this_thread::sleep_for(1ms);
+    }
+    return nullptr;
+  }
+
+  FakeDrm drm;
+  GatedBlobReader *reader = nullptr;
+  std::unique_ptr<histogram::HistogramCollector> collector;
+  std::unique_ptr<EventLoop> loop;
+  uint64_t sent = 0;
+};
+
+TEST_F(HistogramCollectorTest, EventBurstWhileProcessingIsNotLost) {
+  reader->set_open(false);
+  send(1);
+  ASSERT_TRUE(reader->wait_reading());
+
+  // A 144Hz panel delivering several events while the previous blob is still being read.
+  for (histogram::BlobId id = 2; id <= 8; id++)
+    send(id);
+  ASSERT_TRUE(loop->wait_forwarded(sent));
+  reader->set_open(true);
+
+  auto snapshot = wait_sequence(8);
+  ASSERT_THAT(snapshot, NotNull());
+  EXPECT_THAT(snapshot->id, Eq(8u));
+  EXPECT_THAT(snapshot->events, Eq(8u));
+  EXPECT_THAT(snapshot->overruns, Eq(0u));
+  EXPECT_THAT(snapshot->rejected, Eq(0u));
+
+  int32_t samples_size[NUM_HISTOGRAM_COLOR_COMPONENTS];
+  uint64_t num_frames = 0;
+  EXPECT_THAT(collector->collect(0, 0, samples_size, nullptr, &num_frames),
+              Eq(HWC2::Error::None));
+  EXPECT_THAT(num_frames, Eq(8u));
+}
+
+TEST_F(HistogramCollectorTest, FullQueueCountsOverruns) {
+  reader->set_open(false);
+  send(1);
+  ASSERT_TRUE(reader->wait_reading());
+
+  // Eight queue slots behind the blob being read, three more events do not fit.
+  for (histogram::BlobId id = 2; id <= 12; id++)
+    send(id);
+  ASSERT_TRUE(loop->wait_forwarded(sent));
+  reader->set_open(true);
+
+  auto snapshot = wait_sequence(9);
+  ASSERT_THAT(snapshot, NotNull());
+  EXPECT_THAT(snapshot->id, Eq(9u));
+  EXPECT_THAT(snapshot->events, Eq(12u));
+  EXPECT_THAT(snapshot->overruns, Eq(3u));
+  EXPECT_THAT(collector->Dump(), HasSubstr("events: 12, overruns: 3, rejected: 0"));
+}
+
+TEST_F(HistogramCollectorTest, InvalidBlobsAreRejected) {
+  drm_msm_hist invalid{};
+  invalid.data[0] = panel_width * panel_height - 1;
+  drm.add_blob(1, invalid);
+  drm.send_event(1);
+  send(2);
+
+  auto snapshot = wait_sequence(1);
+  ASSERT_THAT(snapshot, NotNull());
+  EXPECT_THAT(snapshot->id, Eq(2u));
+  EXPECT_THAT(snapshot->events, Eq(2u));
+  EXPECT_THAT(snapshot->rejected, Eq(1u));
+}
+
+TEST_F(HistogramCollectorTest, SnapshotStaysValidWhileHeld) {
+  send(1);
+  auto first = wait_sequence(1);
+  ASSERT_THAT(first, NotNull());
+  EXPECT_THAT(collector->snapshot().get(), Eq(first.get()));
+
+  for (histogram::BlobId id = 2; id <= 20; id++) {
+    send(id);
+    ASSERT_THAT(wait_sequence(id), NotNull());
+  }
+
+  // Held snapshots are never recycled underneath their holder.
+  EXPECT_THAT(first->sequence, Eq(1u));
+  EXPECT_THAT(first->id, Eq(1u));
+  EXPECT_THAT(first->frame.data[1], Eq(panel_width * panel_height));
+  auto latest = collector->snapshot();
+  EXPECT_THAT(latest->id, Eq(20u));
+  EXPECT_THAT(latest->frame.data[20], Eq(panel_width * panel_height));
+}
+
+TEST_F(HistogramCollectorTest, EventsAfterStopAreDiscarded) {
+  collector->stop();
+  send(1);
+  ASSERT_TRUE(loop->wait_forwarded(sent));
+  collector->start();
+  send(2);
+
+  auto snapshot = wait_sequence(1);
+  ASSERT_THAT(snapshot, NotNull());
+  EXPECT_THAT(snapshot->id, Eq(2u));
+  EXPECT_THAT(snapshot->events, Eq(1u));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
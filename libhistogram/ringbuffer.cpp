@@ -26,25 +26,48 @@
 #include <unistd.h>
 #include <algorithm>
 #include <iostream>
+#include <thread>
 
 #include "ringbuffer.h"
 
+constexpr size_t histogram::Ringbuffer::max_preallocated_size;
+
 nsecs_t histogram::DefaultTimeKeeper::current_time() const {
   return systemTime(SYSTEM_TIME_MONOTONIC);
 }
 
-histogram::Ringbuffer::Ringbuffer(size_t ringbuffer_size, std::unique_ptr<histogram::TimeKeeper> tk)
-    : rb_max_size(ringbuffer_size), timekeeper(std::move(tk)), cumulative_frame_count(0) {
+histogram::Ringbuffer::Ringbuffer(size_t ringbuffer_size, std::unique_ptr<histogram::TimeKeeper> tk,
+                                  Storage storage)
+    : rb_max_size(ringbuffer_size),
+      timekeeper(std::move(tk)),
+      cumulative_frame_count(0),
+      storage(storage),
+      capacity(storage == Storage::preallocated ? ringbuffer_size : 0),
+      slots(capacity ? new Slot[capacity] : nullptr),
+      seq(0),
+      rb_head(0),
+      rb_count(0),
+      newest_frame{} {
   cumulative_bins.fill(0);
+  running_prefix.fill(0);
 }
 
 std::unique_ptr<histogram::Ringbuffer> histogram::Ringbuffer::create(
-    size_t ringbuffer_size, std::unique_ptr<histogram::TimeKeeper> tk) {
+    size_t ringbuffer_size, std::unique_ptr<histogram::TimeKeeper> tk, Storage storage) {
   if ((ringbuffer_size == 0) || !tk)
     return nullptr;
+  if (storage == Storage::preallocated)
+    ringbuffer_size = std::min(ringbuffer_size, max_preallocated_size);
   return std::unique_ptr<histogram::Ringbuffer>(
-      new histogram::Ringbuffer(ringbuffer_size, std::move(tk)));
+      new histogram::Ringbuffer(ringbuffer_size, std::move(tk), storage));
+}
+
+namespace {
+int64_t displayed_ms(nsecs_t start, nsecs_t end) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::nanoseconds(end - start)).count();
 }
+}  // namespace
 
 void histogram::Ringbuffer::update_cumulative(nsecs_t now, uint64_t &count,
                                               std::array<uint64_t, HIST_V_SIZE> &bins) const {
@@ -72,6 +95,9 @@ void histogram::Ringbuffer::update_cumulative(nsecs_t now, uint64_t &count,
 }
 
 void histogram::Ringbuffer::insert(drm_msm_hist const &frame) {
+  if (storage == Storage::preallocated)
+    return insert_preallocated(frame);
+
   std::cout << "Enter insert ringbuffer" << std::endl;
 
   std::unique_lock<decltype(mutex)> lk(mutex);
@@ -90,6 +116,9 @@ void histogram::Ringbuffer::insert(drm_msm_hist const &frame) {
 }
 
 bool histogram::Ringbuffer::resize(size_t ringbuffer_size) {
+  if (storage == Storage::preallocated)
+    return resize_preallocated(ringbuffer_size);
+
   std::unique_lock<decltype(mutex)> lk(mutex);
   if (ringbuffer_size == 0)
     return false;
@@ -100,6 +129,37 @@ bool histogram::Ringbuffer::resize(size_t ringbuffer_size) {
 }
 
 histogram::Ringbuffer::Sample histogram::Ringbuffer::collect_cumulative() const {
+  if (storage == Storage::preallocated) {
+    histogram::Ringbuffer::Sample sample;
+    bool have_frame = false;
+    nsecs_t newest_start = 0;
+    drm_msm_hist newest;
+    read_consistent([&] {
+      sample = Sample{cumulative_frame_count, cumulative_bins};
+      have_frame = rb_count != 0;
+      if (have_frame) {
+        newest_start = slots[(rb_head - 1) % capacity].start_timestamp;
+        newest = newest_frame;
+      }
+    });
+    if (!have_frame)
+      return sample;
+
+    auto &bins = std::get<1>(sample);
+    auto const delta = displayed_ms(newest_start, timekeeper->current_time());
+    std::get<0>(sample)++;
+    for (auto i = 0u; i < bins.size(); i++) {
+      auto const increment = newest.data[i] * delta;
+      if (CC_UNLIKELY(increment && ((bins[i] + increment < bins[i]) ||
+                                    (increment < newest.data[i])))) {
+        bins[i] = std::numeric_limits<uint64_t>::max();
+      } else {
+        bins[i] += increment;
+      }
+    }
+    return sample;
+  }
+
   std::unique_lock<decltype(mutex)> lk(mutex);
   histogram::Ringbuffer::Sample sample{cumulative_frame_count, cumulative_bins};
   update_cumulative(timekeeper->current_time(), std::get<0>(sample), std::get<1>(sample));
@@ -107,22 +167,34 @@ histogram::Ringbuffer::Sample histogram::Ringbuffer::collect_cumulative() const
 }
 
 histogram::Ringbuffer::Sample histogram::Ringbuffer::collect_ringbuffer_all() const {
+  if (storage == Storage::preallocated)
+    return collect_newest(capacity, false, 0);
+
   std::unique_lock<decltype(mutex)> lk(mutex);
   return collect_max(ringbuffer.size(), lk);
 }
 
 histogram::Ringbuffer::Sample histogram::Ringbuffer::collect_after(nsecs_t timestamp) const {
+  if (storage == Storage::preallocated)
+    return collect_newest(capacity, true, timestamp);
+
   std::unique_lock<decltype(mutex)> lk(mutex);
   return collect_max_after(timestamp, ringbuffer.size(), lk);
 }
 
 histogram::Ringbuffer::Sample histogram::Ringbuffer::collect_max(uint32_t max_frames) const {
+  if (storage == Storage::preallocated)
+    return collect_newest(max_frames, false, 0);
+
   std::unique_lock<decltype(mutex)> lk(mutex);
   return collect_max(max_frames, lk);
 }
 
 histogram::Ringbuffer::Sample histogram::Ringbuffer::collect_max_after(nsecs_t timestamp,
                                                                        uint32_t max_frames) const {
+  if (storage == Storage::preallocated)
+    return collect_newest(max_frames, true, timestamp);
+
   std::unique_lock<decltype(mutex)> lk(mutex);
   return collect_max_after(timestamp, max_frames, lk);
 }
@@ -159,3 +231,124 @@ histogram::Ringbuffer::Sample histogram::Ringbuffer::collect_max_after(
                                static_cast<std::ptrdiff_t>(max_frames));
   return collect_max(collect_last, lk);
 }
+
+void histogram::Ringbuffer::insert_preallocated(drm_msm_hist const &frame) {
+  std::lock_guard<decltype(producer_mutex)> lk(producer_mutex);
+  auto now = timekeeper->current_time();
+
+  auto const sequence = seq.load(std::memory_order_relaxed);
+  seq.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // Retire the frame on screen until now: its weight becomes final, so fold it into both the
+  // cumulative counts and the running prefix the next slot starts from.
+  if (rb_count != 0) {
+    auto const delta = displayed_ms(slots[(rb_head - 1) % capacity].start_timestamp, now);
+    cumulative_frame_count++;
+    for (auto i = 0u; i < HIST_V_SIZE; i++) {
+      auto const increment = newest_frame.data[i] * delta;
+      if (CC_UNLIKELY(increment && ((cumulative_bins[i] + increment < cumulative_bins[i]) ||
+                                    (increment < newest_frame.data[i])))) {
+        cumulative_bins[i] = std::numeric_limits<uint64_t>::max();
+      } else {
+        cumulative_bins[i] += increment;
+      }
+      running_prefix[i] += static_cast<uint64_t>(increment);
+    }
+  }
+
+  auto &slot = slots[rb_head % capacity];
+  slot.start_timestamp = now;
+  slot.prefix = running_prefix;
+  newest_frame = frame;
+  rb_head++;
+  if (rb_count < rb_max_size)
+    rb_count++;
+
+  seq.store(sequence + 2, std::memory_order_release);
+}
+
+bool histogram::Ringbuffer::resize_preallocated(size_t ringbuffer_size) {
+  std::lock_guard<decltype(producer_mutex)> lk(producer_mutex);
+  if ((ringbuffer_size == 0) || (ringbuffer_size > capacity))
+    return false;
+
+  auto const sequence = seq.load(std::memory_order_relaxed);
+  seq.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  rb_max_size = ringbuffer_size;
+  rb_count = std::min(rb_count, rb_max_size);
+  seq.store(sequence + 2, std::memory_order_release);
+  return true;
+}
+
+template <typename Reader>
+void histogram::Ringbuffer::read_consistent(Reader &&reader) const {
+  static constexpr auto max_attempts = 4;
+  for (auto attempt = 0; attempt < max_attempts; attempt++) {
+    auto const sequence = seq.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    reader();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq.load(std::memory_order_relaxed) == sequence)
+      return;
+  }
+
+  // A producer inserting back to back can keep every optimistic read torn; holding it off for
+  // one copy bounds the wait.
+  std::lock_guard<decltype(producer_mutex)> lk(producer_mutex);
+  reader();
+}
+
+// Number of newest frames whose start_timestamp is at or after timestamp. Called from within
+// read_consistent(), so indices are wrapped defensively against a torn head/count.
+size_t histogram::Ringbuffer::count_after(nsecs_t timestamp, uint64_t head, size_t count) const {
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    auto const mid = lo + (hi - lo) / 2;
+    if (slots[(head - 1 - mid) % capacity].start_timestamp >= timestamp)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+histogram::Ringbuffer::Sample histogram::Ringbuffer::collect_newest(size_t max_frames,
+                                                                    bool filter_timestamp,
+                                                                    nsecs_t timestamp) const {
+  size_t frames = 0;
+  nsecs_t newest_start = 0;
+  drm_msm_hist newest;
+  std::array<uint64_t, HIST_V_SIZE> bins;
+
+  read_consistent([&] {
+    auto const head = rb_head;
+    auto const count = std::min(rb_count, capacity);
+    frames = std::min(max_frames, count);
+    if (filter_timestamp)
+      frames = std::min(frames, count_after(timestamp, head, count));
+    if (frames == 0)
+      return;
+
+    // All but the newest frame are complete: their weighted sum is a prefix difference.
+    auto const &newest_slot = slots[(head - 1) % capacity];
+    auto const &oldest_slot = slots[(head - frames) % capacity];
+    for (auto i = 0u; i < HIST_V_SIZE; i++)
+      bins[i] = newest_slot.prefix[i] - oldest_slot.prefix[i];
+    newest_start = newest_slot.start_timestamp;
+    newest = newest_frame;
+  });
+
+  if (frames == 0)
+    return {0, {}};
+
+  auto const delta = displayed_ms(newest_start, timekeeper->current_time());
+  for (auto i = 0u; i < HIST_V_SIZE; i++)
+    bins[i] += newest.data[i] * delta;
+  return {frames, bins};
+}
@@ -23,6 +23,7 @@
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 #include <array>
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <mutex>
@@ -46,7 +47,16 @@ struct DefaultTimeKeeper final : TimeKeeper {
 
 class Ringbuffer {
  public:
-  static std::unique_ptr<Ringbuffer> create(size_t ringbuffer_size, std::unique_ptr<TimeKeeper> tk);
+  // dynamic: frames live in a mutex-guarded deque, resize() is unbounded.
+  // preallocated: ringbuffer_size is a fixed capacity allocated up front, clamped to
+  // max_preallocated_size. insert() and resize() must come from a single producer; collect_*()
+  // readers do not block it (seqlock) and are answered in O(bins) from running per-bin prefix
+  // sums. A reader that keeps losing the race falls back to reading under the producer lock.
+  enum class Storage { dynamic, preallocated };
+  static constexpr size_t max_preallocated_size = 1024;
+
+  static std::unique_ptr<Ringbuffer> create(size_t ringbuffer_size, std::unique_ptr<TimeKeeper> tk,
+                                            Storage storage = Storage::dynamic);
   void insert(drm_msm_hist const &frame);
   bool resize(size_t ringbuffer_size);
 
@@ -59,7 +69,7 @@ class Ringbuffer {
   ~Ringbuffer() = default;
 
  private:
-  Ringbuffer(size_t ringbuffer_size, std::unique_ptr<TimeKeeper> tk);
+  Ringbuffer(size_t ringbuffer_size, std::unique_ptr<TimeKeeper> tk, Storage storage);
   Ringbuffer(Ringbuffer const &) = delete;
   Ringbuffer &operator=(Ringbuffer const &) = delete;
 
@@ -81,6 +91,31 @@ class Ringbuffer {
 
   uint64_t cumulative_frame_count;
   std::array<uint64_t, HIST_V_SIZE> cumulative_bins;
+
+  // Storage::preallocated state. Every field below is written only by the producer between two
+  // increments of seq; readers copy what they need and retry if seq moved underneath them.
+  struct Slot {
+    nsecs_t start_timestamp;
+    // weighted bins of every completed frame inserted before this one. Unsigned wraparound is
+    // harmless since only differences between two slots are ever consumed.
+    std::array<uint64_t, HIST_V_SIZE> prefix;
+  };
+  void insert_preallocated(drm_msm_hist const &frame);
+  bool resize_preallocated(size_t ringbuffer_size);
+  template <typename Reader>
+  void read_consistent(Reader &&reader) const;
+  size_t count_after(nsecs_t timestamp, uint64_t head, size_t count) const;
+  Sample collect_newest(size_t max_frames, bool filter_timestamp, nsecs_t timestamp) const;
+
+  Storage const storage;
+  size_t const capacity;
+  std::unique_ptr<Slot[]> slots;
+  std::mutex mutable producer_mutex;
+  std::atomic<uint32_t> seq;
+  uint64_t rb_head;  // monotonic index of the next frame to insert
+  size_t rb_count;   // valid frames, newest one at rb_head - 1
+  drm_msm_hist newest_frame;
+  std::array<uint64_t, HIST_V_SIZE> running_prefix;
 };
 
 }  // namespace histogram
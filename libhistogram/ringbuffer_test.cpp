@@ -14,8 +14,13 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <iostream>
 #include <numeric>
+#include <thread>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -56,7 +61,7 @@ void insertFrameIncrementTimeline(histogram::Ringbuffer &rb, TickingTimeKeeper &
   tk.tick();
 }
 
-class RingbufferTestCases : public ::testing::Test {
+class RingbufferTestCases : public ::testing::TestWithParam<histogram::Ringbuffer::Storage> {
   void SetUp() {
     for (auto i = 0u; i < HIST_V_SIZE; i++) {
       frame0.data[i] = fill_frame0;
@@ -69,9 +74,14 @@ class RingbufferTestCases : public ::testing::Test {
   }
 
  protected:
+  std::unique_ptr<histogram::Ringbuffer> create(size_t size,
+                                                std::unique_ptr<histogram::TimeKeeper> tk) {
+    return histogram::Ringbuffer::create(size, std::move(tk), GetParam());
+  }
+
   std::unique_ptr<histogram::Ringbuffer> createFilledRingbuffer(
       std::shared_ptr<TickingTimeKeeper> const &tk) {
-    auto rb = histogram::Ringbuffer::create(4, std::make_unique<TimeKeeperWrapper>(tk));
+    auto rb = create(4, std::make_unique<TimeKeeperWrapper>(tk));
     insertFrameIncrementTimeline(*rb, *tk, frame0);
     insertFrameIncrementTimeline(*rb, *tk, frame1);
     insertFrameIncrementTimeline(*rb, *tk, frame2);
@@ -95,26 +105,26 @@ class RingbufferTestCases : public ::testing::Test {
   std::array<uint64_t, HIST_V_SIZE> bins;
 };
 
-TEST_F(RingbufferTestCases, ZeroSizedRingbufferReturnsNull) {
-  EXPECT_THAT(histogram::Ringbuffer::create(0, std::make_unique<TickingTimeKeeper>()), Eq(nullptr));
+TEST_P(RingbufferTestCases, ZeroSizedRingbufferReturnsNull) {
+  EXPECT_THAT(create(0, std::make_unique<TickingTimeKeeper>()), Eq(nullptr));
 }
 
-TEST_F(RingbufferTestCases, NullTimekeeperReturnsNull) {
-  EXPECT_THAT(histogram::Ringbuffer::create(10, nullptr), Eq(nullptr));
+TEST_P(RingbufferTestCases, NullTimekeeperReturnsNull) {
+  EXPECT_THAT(create(10, nullptr), Eq(nullptr));
 }
 
-TEST_F(RingbufferTestCases, CollectionWithNoFrames) {
-  auto rb = histogram::Ringbuffer::create(1, std::make_unique<TickingTimeKeeper>());
+TEST_P(RingbufferTestCases, CollectionWithNoFrames) {
+  auto rb = create(1, std::make_unique<TickingTimeKeeper>());
 
   std::tie(numFrames, bins) = rb->collect_ringbuffer_all();
   EXPECT_THAT(numFrames, Eq(0));
   EXPECT_THAT(bins, Each(0));
 }
 
-TEST_F(RingbufferTestCases, SimpleTest) {
+TEST_P(RingbufferTestCases, SimpleTest) {
   static constexpr int numInsertions = 3u;
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(numInsertions, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(numInsertions, std::make_unique<TimeKeeperWrapper>(tk));
 
   drm_msm_hist frame {};
   for (auto i = 0u; i < HIST_V_SIZE; i++) {
@@ -133,7 +143,7 @@ TEST_F(RingbufferTestCases, SimpleTest) {
   }
 }
 
-TEST_F(RingbufferTestCases, TestEvictionSingle) {
+TEST_P(RingbufferTestCases, TestEvictionSingle) {
   int fill_frame0 = 9;
   int fill_frame1 = 111;
   drm_msm_hist frame0 {};
@@ -144,7 +154,7 @@ TEST_F(RingbufferTestCases, TestEvictionSingle) {
   }
 
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(1, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(1, std::make_unique<TimeKeeperWrapper>(tk));
 
   insertFrameIncrementTimeline(*rb, *tk, frame0);
 
@@ -158,9 +168,9 @@ TEST_F(RingbufferTestCases, TestEvictionSingle) {
   EXPECT_THAT(bins, Each(fill_frame1));
 }
 
-TEST_F(RingbufferTestCases, TestEvictionMultiple) {
+TEST_P(RingbufferTestCases, TestEvictionMultiple) {
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(3, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(3, std::make_unique<TimeKeeperWrapper>(tk));
 
   insertFrameIncrementTimeline(*rb, *tk, frame0);
   insertFrameIncrementTimeline(*rb, *tk, frame1);
@@ -181,12 +191,12 @@ TEST_F(RingbufferTestCases, TestEvictionMultiple) {
   EXPECT_THAT(bins, Each(fill_frame2 + fill_frame3 + fill_frame0));
 }
 
-TEST_F(RingbufferTestCases, TestResizeToZero) {
-  auto rb = histogram::Ringbuffer::create(4, std::make_unique<TickingTimeKeeper>());
+TEST_P(RingbufferTestCases, TestResizeToZero) {
+  auto rb = create(4, std::make_unique<TickingTimeKeeper>());
   EXPECT_FALSE(rb->resize(0));
 }
 
-TEST_F(RingbufferTestCases, TestResizeDown) {
+TEST_P(RingbufferTestCases, TestResizeDown) {
   auto tk = std::make_shared<TickingTimeKeeper>();
   auto rb = createFilledRingbuffer(tk);
 
@@ -206,9 +216,12 @@ TEST_F(RingbufferTestCases, TestResizeDown) {
   EXPECT_THAT(bins, Each(fill_frame0 + fill_frame3));
 }
 
-TEST_F(RingbufferTestCases, TestResizeUp) {
+TEST_P(RingbufferTestCases, TestResizeUp) {
+  if (GetParam() == histogram::Ringbuffer::Storage::preallocated)
+    GTEST_SKIP() << "preallocated storage cannot grow past its capacity";
+
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(2, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(2, std::make_unique<TimeKeeperWrapper>(tk));
 
   insertFrameIncrementTimeline(*rb, *tk, frame0);
   insertFrameIncrementTimeline(*rb, *tk, frame1);
@@ -234,7 +247,7 @@ TEST_F(RingbufferTestCases, TestResizeUp) {
   EXPECT_THAT(bins, Each(fill_frame1 + fill_frame2 + fill_frame3));
 }
 
-TEST_F(RingbufferTestCases, TestTimestampFiltering) {
+TEST_P(RingbufferTestCases, TestTimestampFiltering) {
   auto rb = createFilledRingbuffer(std::make_shared<TickingTimeKeeper>());
 
   std::tie(numFrames, bins) = rb->collect_after(toNsecs(1500us));
@@ -249,9 +262,9 @@ TEST_F(RingbufferTestCases, TestTimestampFiltering) {
   EXPECT_THAT(bins, Each(fill_frame0 + fill_frame1 + fill_frame2 + fill_frame3));
 }
 
-TEST_F(RingbufferTestCases, TestTimestampFilteringSameTimestamp) {
+TEST_P(RingbufferTestCases, TestTimestampFilteringSameTimestamp) {
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(4, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(4, std::make_unique<TimeKeeperWrapper>(tk));
   insertFrameIncrementTimeline(*rb, *tk, frame0);
   insertFrameIncrementTimeline(*rb, *tk, frame1);
   insertFrameIncrementTimeline(*rb, *tk, frame2);
@@ -264,7 +277,7 @@ TEST_F(RingbufferTestCases, TestTimestampFilteringSameTimestamp) {
   EXPECT_THAT(bins, Each(fill_frame4));
 }
 
-TEST_F(RingbufferTestCases, TestFrameFiltering) {
+TEST_P(RingbufferTestCases, TestFrameFiltering) {
   auto rb = createFilledRingbuffer(std::make_shared<TickingTimeKeeper>());
 
   std::tie(numFrames, bins) = rb->collect_max(2);
@@ -284,7 +297,7 @@ TEST_F(RingbufferTestCases, TestFrameFiltering) {
   EXPECT_THAT(bins, Each(fill_frame0 + fill_frame1 + fill_frame2 + fill_frame3));
 }
 
-TEST_F(RingbufferTestCases, TestTimestampAndFrameFiltering) {
+TEST_P(RingbufferTestCases, TestTimestampAndFrameFiltering) {
   auto rb = createFilledRingbuffer(std::make_shared<TickingTimeKeeper>());
 
   std::tie(numFrames, bins) = rb->collect_max_after(toNsecs(1500us), 1);
@@ -304,7 +317,7 @@ TEST_F(RingbufferTestCases, TestTimestampAndFrameFiltering) {
   EXPECT_THAT(bins, Each(fill_frame0 + fill_frame1 + fill_frame2 + fill_frame3));
 }
 
-TEST_F(RingbufferTestCases, TestTimestampAndFrameFilteringAndResize) {
+TEST_P(RingbufferTestCases, TestTimestampAndFrameFilteringAndResize) {
   auto rb = createFilledRingbuffer(std::make_shared<TickingTimeKeeper>());
 
   std::tie(numFrames, bins) = rb->collect_max_after(toNsecs(500us), 1);
@@ -321,9 +334,9 @@ TEST_F(RingbufferTestCases, TestTimestampAndFrameFilteringAndResize) {
   EXPECT_THAT(bins, Each(fill_frame2 + fill_frame3));
 }
 
-TEST_F(RingbufferTestCases, TestCumulativeCounts) {
+TEST_P(RingbufferTestCases, TestCumulativeCounts) {
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(1, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(1, std::make_unique<TimeKeeperWrapper>(tk));
   insertFrameIncrementTimeline(*rb, *tk, frame0);
 
   std::tie(numFrames, bins) = rb->collect_ringbuffer_all();
@@ -359,16 +372,16 @@ TEST_F(RingbufferTestCases, TestCumulativeCounts) {
             std::chrono::duration_cast<std::chrono::milliseconds>(weight0 + weight1).count())));
 }
 
-TEST_F(RingbufferTestCases, TestCumulativeCountsEmpty) {
+TEST_P(RingbufferTestCases, TestCumulativeCountsEmpty) {
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(1, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(1, std::make_unique<TimeKeeperWrapper>(tk));
   std::tie(numFrames, bins) = rb->collect_cumulative();
   EXPECT_THAT(numFrames, Eq(0));
 }
 
-TEST_F(RingbufferTestCases, TestCumulativeCountsSaturate) {
+TEST_P(RingbufferTestCases, TestCumulativeCountsSaturate) {
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(1, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(1, std::make_unique<TimeKeeperWrapper>(tk));
   insertFrameIncrementTimeline(*rb, *tk, frame_saturate);
   auto eon = std::chrono::nanoseconds(std::numeric_limits<uint64_t>::max());
   tk->increment_by(eon);
@@ -377,10 +390,10 @@ TEST_F(RingbufferTestCases, TestCumulativeCountsSaturate) {
   EXPECT_THAT(bins, Each(std::numeric_limits<uint64_t>::max()));
 }
 
-TEST_F(RingbufferTestCases, TimeWeightingTest) {
+TEST_P(RingbufferTestCases, TimeWeightingTest) {
   static constexpr int numInsertions = 4u;
   auto tk = std::make_shared<TickingTimeKeeper>();
-  auto rb = histogram::Ringbuffer::create(numInsertions, std::make_unique<TimeKeeperWrapper>(tk));
+  auto rb = create(numInsertions, std::make_unique<TimeKeeperWrapper>(tk));
 
   auto weight0 = std::chrono::duration_cast<std::chrono::nanoseconds>(1ms);
   auto weight1 = std::chrono::duration_cast<std::chrono::nanoseconds>(1h);
@@ -407,6 +420,119 @@ TEST_F(RingbufferTestCases, TimeWeightingTest) {
   }
 }
 
+TEST(PreallocatedRingbuffer, TestResizeWithinCapacity) {
+  drm_msm_hist frame {};
+  for (auto i = 0u; i < HIST_V_SIZE; i++) {
+    frame.data[i] = 7;
+  }
+  auto tk = std::make_shared<TickingTimeKeeper>();
+  auto rb = histogram::Ringbuffer::create(4, std::make_unique<TimeKeeperWrapper>(tk),
+                                          histogram::Ringbuffer::Storage::preallocated);
+  for (auto i = 0; i < 4; i++) {
+    insertFrameIncrementTimeline(*rb, *tk, frame);
+  }
+
+  EXPECT_TRUE(rb->resize(2));
+  EXPECT_FALSE(rb->resize(5));
+  EXPECT_TRUE(rb->resize(4));
+
+  uint64_t numFrames = 0;
+  std::array<uint64_t, HIST_V_SIZE> bins;
+  std::tie(numFrames, bins) = rb->collect_ringbuffer_all();
+  EXPECT_THAT(numFrames, Eq(2u));
+  EXPECT_THAT(bins, Each(2 * 7));
+
+  insertFrameIncrementTimeline(*rb, *tk, frame);
+  insertFrameIncrementTimeline(*rb, *tk, frame);
+  insertFrameIncrementTimeline(*rb, *tk, frame);
+  std::tie(numFrames, bins) = rb->collect_ringbuffer_all();
+  EXPECT_THAT(numFrames, Eq(4u));
+  EXPECT_THAT(bins, Each(4 * 7));
+}
+
+TEST(PreallocatedRingbuffer, ClampsCapacity) {
+  auto tk = std::make_shared<TickingTimeKeeper>();
+  auto rb = histogram::Ringbuffer::create(std::numeric_limits<size_t>::max() / 2,
+                                          std::make_unique<TimeKeeperWrapper>(tk),
+                                          histogram::Ringbuffer::Storage::preallocated);
+  ASSERT_THAT(rb, Ne(nullptr));
+  EXPECT_TRUE(rb->resize(histogram::Ringbuffer::max_preallocated_size));
+  EXPECT_FALSE(rb->resize(histogram::Ringbuffer::max_preallocated_size + 1));
+
+  drm_msm_hist frame {};
+  for (auto i = 0u; i < histogram::Ringbuffer::max_preallocated_size + 3; i++) {
+    insertFrameIncrementTimeline(*rb, *tk, frame);
+  }
+  EXPECT_THAT(std::get<0>(rb->collect_ringbuffer_all()),
+              Eq(histogram::Ringbuffer::max_preallocated_size));
+}
+
+INSTANTIATE_TEST_SUITE_P(Storage, RingbufferTestCases,
+                         Values(histogram::Ringbuffer::Storage::dynamic,
+                                histogram::Ringbuffer::Storage::preallocated));
+
+// One producer inserting uniform frames against several collecting readers, comparable across
+// storage modes. Every frame has the same value in every bin, so any torn read shows up as
+// non-uniform bins.
+class RingbufferStress : public ::testing::TestWithParam<histogram::Ringbuffer::Storage> {};
+
+TEST_P(RingbufferStress, ThroughputUnderConcurrentReaders) {
+  static constexpr size_t rbSize = 300;
+  static constexpr int numInsertions = 20000;
+  static constexpr int numReaders = 3;
+
+  auto rb = histogram::Ringbuffer::create(rbSize, std::make_unique<histogram::DefaultTimeKeeper>(),
+                                          GetParam());
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> collections{0};
+  std::atomic<uint64_t> torn{0};
+
+  std::vector<std::thread> readers;
+  for (auto r = 0; r < numReaders; r++) {
+    readers.emplace_back([&, r] {
+      while (!done.load(std::memory_order_relaxed)) {
+        uint64_t frames = 0;
+        std::array<uint64_t, HIST_V_SIZE> sample;
+        if (r == 0)
+          std::tie(frames, sample) = rb->collect_cumulative();
+        else if (r == 1)
+          std::tie(frames, sample) = rb->collect_max(rbSize / 2);
+        else
+          std::tie(frames, sample) = rb->collect_ringbuffer_all();
+        if (!std::all_of(sample.begin(), sample.end(),
+                         [&](uint64_t v) { return v == sample[0]; }))
+          torn++;
+        collections++;
+      }
+    });
+  }
+
+  drm_msm_hist frame {};
+  auto const begin = std::chrono::steady_clock::now();
+  for (auto n = 0; n < numInsertions; n++) {
+    std::fill(std::begin(frame.data), std::end(frame.data), n % 1024);
+    rb->insert(frame);
+  }
+  auto const elapsed = std::chrono::steady_clock::now() - begin;
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_THAT(torn.load(), Eq(0u));
+  auto const elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  std::cout << (GetParam() == histogram::Ringbuffer::Storage::preallocated ? "preallocated"
+                                                                            : "dynamic")
+            << ": " << numInsertions << " inserts in " << elapsed_us << "us ("
+            << (elapsed_us ? numInsertions * 1000000ll / elapsed_us : 0) << "/s), "
+            << collections.load() << " concurrent collections ("
+            << (elapsed_us ? collections.load() * 1000000ll / elapsed_us : 0) << "/s)" << std::endl;
+}
+
+INSTANTIATE_TEST_SUITE_P(Storage, RingbufferStress,
+                         Values(histogram::Ringbuffer::Storage::dynamic,
+                                histogram::Ringbuffer::Storage::preallocated));
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -38,8 +38,11 @@
 #include <log/log.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <cinttypes>
+#include <list>
+#include <mutex>
 
 static int colorMetaDataToColorSpace(ColorMetaData in, ColorSpace_t *out) {
   if (in.colorPrimaries == ColorPrimaries_BT601_6_525 ||
@@ -275,6 +278,102 @@ static int validateAndMap(private_handle_t* handle) {
     return 0;
 }
 
+// Process-wide cache of metadata mappings used by the *AndUnmap helpers, which would otherwise
+// mmap and munmap the metadata buffer on every call. Entries are keyed by the metadata
+// buffer's inode, so dup'd or re-imported fds of the same buffer share one mapping.
+// A mapping keeps its metadata buffer alive, hence the cache is bounded and only entries
+// not in use are evicted, least recently used first.
+class MetaDataMapCache {
+ public:
+  static MetaDataMapCache *getInstance() {
+    static MetaDataMapCache *instance = new MetaDataMapCache();
+    return instance;
+  }
+
+  void *acquire(int fd) {
+    struct stat st = {};
+    if (fstat(fd, &st)) {
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto it = mEntries.begin(); it != mEntries.end(); it++) {
+      if (it->dev == st.st_dev && it->ino == st.st_ino) {
+        it->refs++;
+        mEntries.splice(mEntries.begin(), mEntries, it);
+        return it->base;
+      }
+    }
+
+    size_t size = 0;
+    void *base = map(fd, &size);
+    if (!base) {
+      return nullptr;
+    }
+    mEntries.push_front({st.st_dev, st.st_ino, base, size, 1});
+    trimLocked();
+    return base;
+  }
+
+  void release(void *base) {
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto &entry : mEntries) {
+      if (entry.base == base) {
+        entry.refs--;
+        break;
+      }
+    }
+    trimLocked();
+  }
+
+ private:
+  static const size_t kMaxEntries = 32;
+
+  struct Entry {
+    dev_t dev;
+    ino_t ino;
+    void *base;
+    size_t size;
+    uint32_t refs;
+  };
+
+  static void *map(int fd, size_t *out_size) {
+    auto size = getMetaDataSize();
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == reinterpret_cast<void *>(MAP_FAILED)) {
+      ALOGE("%s: metadata mmap failed - fd: %d err: %s", __func__, fd, strerror(errno));
+      return nullptr;
+    }
+    auto reserved_size = reinterpret_cast<MetaData_t *>(base)->reservedSize;
+    if (reserved_size) {
+      munmap(base, size);
+      size = getMetaDataSizeWithReservedRegion(reserved_size);
+      base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (base == reinterpret_cast<void *>(MAP_FAILED)) {
+        ALOGE("%s: metadata mmap failed - fd: %d err: %s", __func__, fd, strerror(errno));
+        return nullptr;
+      }
+    }
+    *out_size = size;
+    return base;
+  }
+
+  void trimLocked() {
+    auto it = mEntries.end();
+    while (mEntries.size() > kMaxEntries && it != mEntries.begin()) {
+      it--;
+      if (it->refs == 0) {
+        munmap(it->base, it->size);
+        it = mEntries.erase(it);
+      }
+    }
+  }
+
+  std::mutex mLock;
+  // Most recently used first
+  std::list<Entry> mEntries;
+};
+
 static void unmapAndReset(private_handle_t *handle) {
     if (private_handle_t::validate(handle) == 0 && handle->base_metadata) {
       // If reservedSize is 0, the return value will be the same as getMetaDataSize
@@ -626,17 +725,44 @@ int copyMetaDataVaToVa(MetaData_t *src_data, MetaData_t *dst_data) {
     return 0;
 }
 
+// Maps the handle's metadata through the shared mapping cache, if the caller has not mapped
+// it already. Returns the cached base to hand back to releaseCachedMapping, or nullptr.
+static void *acquireCachedMapping(private_handle_t *handle) {
+    if (private_handle_t::validate(handle) || handle->fd_metadata < 0 ||
+        handle->base_metadata) {
+      return nullptr;
+    }
+    void *base = MetaDataMapCache::getInstance()->acquire(handle->fd_metadata);
+    handle->base_metadata = reinterpret_cast<uintptr_t>(base);
+    return base;
+}
+
+static void releaseCachedMapping(private_handle_t *handle, void *base) {
+    handle->base_metadata = 0;
+    MetaDataMapCache::getInstance()->release(base);
+}
+
 int setMetaDataAndUnmap(struct private_handle_t *handle, enum DispParamType paramType,
                         void *param) {
+    void *cached_base = acquireCachedMapping(handle);
     auto ret = setMetaData(handle, paramType, param);
-    unmapAndReset(handle);
+    if (cached_base) {
+      releaseCachedMapping(handle, cached_base);
+    } else {
+      unmapAndReset(handle);
+    }
     return ret;
 }
 
 int getMetaDataAndUnmap(struct private_handle_t *handle,
                         enum DispFetchParamType paramType,
                         void *param) {
+    void *cached_base = acquireCachedMapping(handle);
     auto ret = getMetaData(handle, paramType, param);
-    unmapAndReset(handle);
+    if (cached_base) {
+      releaseCachedMapping(handle, cached_base);
+    } else {
+      unmapAndReset(handle);
+    }
     return ret;
 }
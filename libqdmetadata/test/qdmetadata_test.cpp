@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <QtiGrallocPriv.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "qdMetaData.h"
+
+using namespace testing;
+
+namespace {
+
+class QdMetaDataTest : public Test {
+ protected:
+  void SetUp() override {
+    name_ = std::string("qdmetadata_test_") + UnitTest::GetInstance()->current_test_info()->name();
+  }
+
+  void TearDown() override {
+    for (auto hnd : handles_) {
+      close(hnd->fd_metadata);
+      free(hnd);
+    }
+  }
+
+  // Returns a handle with a zeroed metadata buffer, as clients see it before it is mapped.
+  private_handle_t *CreateHandle() {
+    int fd = memfd_create(name_.c_str(), MFD_CLOEXEC);
+    EXPECT_EQ(0, ftruncate(fd, static_cast<off_t>(getMetaDataSize())));
+    auto hnd = static_cast<private_handle_t *>(calloc(1, sizeof(private_handle_t)));
+    hnd->version = static_cast<int>(sizeof(native_handle));
+    hnd->numFds = private_handle_t::kNumFds;
+    hnd->numInts = private_handle_t::NumInts();
+    hnd->magic = private_handle_t::kMagic;
+    hnd->fd = -1;
+    hnd->fd_metadata = fd;
+    handles_.push_back(hnd);
+    return hnd;
+  }
+
+  // Returns the live mappings of this test's metadata buffers, one /proc/self/maps line each.
+  std::vector<std::string> GetMappings() {
+    std::vector<std::string> mappings;
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+      if (line.find("/memfd:" + name_ + " ") != std::string::npos) {
+        mappings.push_back(line);
+      }
+    }
+    return mappings;
+  }
+
+  MetaData_t ReadMetaData(private_handle_t *hnd) {
+    MetaData_t data = {};
+    EXPECT_EQ(ssize_t(sizeof(data)), pread(hnd->fd_metadata, &data, sizeof(data), 0));
+    return data;
+  }
+
+  void WriteMetaData(private_handle_t *hnd, const MetaData_t &data) {
+    EXPECT_EQ(ssize_t(sizeof(data)), pwrite(hnd->fd_metadata, &data, sizeof(data), 0));
+  }
+
+  std::string name_;
+  std::vector<private_handle_t *> handles_;
+};
+
+}  // namespace
+
+TEST_F(QdMetaDataTest, RepeatedCallsMapOnce) {
+  private_handle_t *hnd = CreateHandle();
+  float rate = 60.0f;
+  ASSERT_EQ(0, setMetaDataAndUnmap(hnd, UPDATE_REFRESH_RATE, &rate));
+  EXPECT_EQ(0u, hnd->base_metadata);
+  std::vector<std::string> mappings = GetMappings();
+  ASSERT_EQ(1u, mappings.size());
+
+  for (int i = 0; i < 100; i++) {
+    rate = static_cast<float>(i);
+    ASSERT_EQ(0, setMetaDataAndUnmap(hnd, UPDATE_REFRESH_RATE, &rate));
+    float out = -1.0f;
+    ASSERT_EQ(0, getMetaDataAndUnmap(hnd, GET_REFRESH_RATE, &out));
+    EXPECT_EQ(rate, out);
+    EXPECT_EQ(0u, hnd->base_metadata);
+  }
+  // Same address range, the buffer was never remapped.
+  EXPECT_EQ(mappings, GetMappings());
+}
+
+TEST_F(QdMetaDataTest, DupSharesMapping) {
+  private_handle_t *hnd = CreateHandle();
+  private_handle_t *imported = CreateHandle();
+  close(imported->fd_metadata);
+  imported->fd_metadata = dup(hnd->fd_metadata);
+
+  float rate = 90.0f;
+  ASSERT_EQ(0, setMetaDataAndUnmap(hnd, UPDATE_REFRESH_RATE, &rate));
+  float out = -1.0f;
+  ASSERT_EQ(0, getMetaDataAndUnmap(imported, GET_REFRESH_RATE, &out));
+  EXPECT_EQ(rate, out);
+  EXPECT_EQ(1u, GetMappings().size());
+}
+
+TEST_F(QdMetaDataTest, CoherentWithOtherWriters) {
+  private_handle_t *hnd = CreateHandle();
+  float rate = 120.0f;
+  ASSERT_EQ(0, setMetaDataAndUnmap(hnd, UPDATE_REFRESH_RATE, &rate));
+  // Writes through the cached mapping reach the buffer right away.
+  MetaData_t data = ReadMetaData(hnd);
+  EXPECT_EQ(rate, data.refreshrate);
+
+  // Another process updating the buffer is seen by the next query.
+  data.refreshrate = 30.0f;
+  WriteMetaData(hnd, data);
+  float out = -1.0f;
+  ASSERT_EQ(0, getMetaDataAndUnmap(hnd, GET_REFRESH_RATE, &out));
+  EXPECT_EQ(30.0f, out);
+  EXPECT_EQ(1u, GetMappings().size());
+}
+
+TEST_F(QdMetaDataTest, IdleMappingsAreBounded) {
+  const int kBuffers = 40;
+  const size_t kMaxMappings = 32;
+  for (int i = 0; i < kBuffers; i++) {
+    float rate = static_cast<float>(i);
+    ASSERT_EQ(0, setMetaDataAndUnmap(CreateHandle(), UPDATE_REFRESH_RATE, &rate));
+  }
+  EXPECT_EQ(kMaxMappings, GetMappings().size());
+
+  // The most recent buffer is still cached, the oldest one is mapped again and evicts another.
+  std::vector<std::string> mappings = GetMappings();
+  float out = -1.0f;
+  ASSERT_EQ(0, getMetaDataAndUnmap(handles_.back(), GET_REFRESH_RATE, &out));
+  EXPECT_EQ(mappings, GetMappings());
+  ASSERT_EQ(0, getMetaDataAndUnmap(handles_.front(), GET_REFRESH_RATE, &out));
+  EXPECT_EQ(0.0f, out);
+  EXPECT_EQ(kMaxMappings, GetMappings().size());
+  EXPECT_NE(mappings, GetMappings());
+}
+
+TEST_F(QdMetaDataTest, CallerMappingIsNotCached) {
+  private_handle_t *hnd = CreateHandle();
+  void *base = mmap(nullptr, getMetaDataSize(), PROT_READ | PROT_WRITE, MAP_SHARED,
+                    hnd->fd_metadata, 0);
+  ASSERT_NE(MAP_FAILED, base);
+  hnd->base_metadata = reinterpret_cast<uintptr_t>(base);
+
+  float rate = 48.0f;
+  ASSERT_EQ(0, setMetaDataAndUnmap(hnd, UPDATE_REFRESH_RATE, &rate));
+  // The helper keeps its old contract for mapped handles and drops the caller's mapping.
+  EXPECT_EQ(0u, hnd->base_metadata);
+  EXPECT_TRUE(GetMappings().empty());
+  EXPECT_EQ(rate, ReadMetaData(hnd).refreshrate);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -17,6 +17,13 @@
  * limitations under the License.
  */
 
+/*
+ * Changes from Qualcomm Innovation Center are provided under the following license:
+ *
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
 #ifndef __QTIQMAACOMPOSERCOMMANDBUFFER_H__
 #define __QTIQMAACOMPOSERCOMMANDBUFFER_H__
 
@@ -27,6 +34,7 @@
 
 #include <limits>
 #include <algorithm>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -55,39 +63,54 @@ using std::shared_ptr;
 using std::string;
 
 // This class helps build a command queue.  Note that all sizes/lengths are in units of uint32_t's.
+//
+// Commands are written into chunks that are kept across frames. A command never spans two
+// chunks: when it does not fit, the next chunk is taken, or added at the size of all chunks so
+// far, so nothing written is moved when the writer grows. A frame that spilled past the first
+// chunk makes the next reset replace the chunks with one of their total size, the high-water
+// mark so far, and steady frames then serialize into a single chunk. writeQueue copies the
+// chunks straight into the message queue.
 class CommandWriter {
  public:
-  explicit CommandWriter(uint32_t initialMaxSize) : mDataMaxSize(initialMaxSize) {
-    mData = std::make_unique<uint32_t[]>(mDataMaxSize);
+  explicit CommandWriter(uint32_t initialMaxSize) : mDataMaxSize(0) {
+    addChunk(0, initialMaxSize);
     reset();
   }
 
-  ~CommandWriter() { reset(); }
+  ~CommandWriter() { releaseHandles(); }
 
   void reset() {
-    mDataWritten = 0;
+    if (mCurrentChunk > 0) {
+      mChunks.clear();
+      uint32_t highWater = mDataMaxSize;
+      mDataMaxSize = 0;
+      addChunk(0, highWater);
+    }
+    selectChunk(0);
+    mChunkBase = 0;
     mCommandEnd = 0;
 
-    // handles in mDataHandles are owned by the caller
-    mDataHandles.clear();
-
-    // handles in mTemporaryHandles are owned by the writer
-    for (auto handle : mTemporaryHandles) {
-      native_handle_close(handle);
-      native_handle_delete(handle);
-    }
-    mTemporaryHandles.clear();
+    releaseHandles();
   }
 
   IComposerClient::Command getCommand(uint32_t offset) {
-    uint32_t val = (offset < mDataWritten) ? mData[offset] : 0;
+    uint32_t val = 0;
+    for (size_t i = 0; i <= mCurrentChunk; i++) {
+      uint32_t written = getChunkWritten(i);
+      if (offset < written) {
+        val = mChunks[i].data[offset];
+        break;
+      }
+      offset -= written;
+    }
     return static_cast<IComposerClient::Command>(
         val & static_cast<uint32_t>(IComposerClient::Command::OPCODE_MASK));
   }
 
   bool writeQueue(bool &queueChanged, uint32_t &commandLength,
                   hidl_vec<hidl_handle> &commandHandles) {
-    if (mDataWritten == 0) {
+    uint32_t dataWritten = mChunkBase + mDataWritten;
+    if (dataWritten == 0) {
       queueChanged = false;
       commandLength = 0;
       commandHandles.setToExternal(nullptr, 0);
@@ -112,7 +135,7 @@ class CommandWriter {
     }
     // write data to queue, optionally resizing it
     if (mQueue && (mDataMaxSize <= mQueue->getQuantumCount())) {
-      if (!mQueue->write(mData.get(), mDataWritten)) {
+      if (!writeChunks(mQueue.get(), dataWritten)) {
         ALOGE("failed to write commands to message queue");
         return false;
       }
@@ -120,7 +143,7 @@ class CommandWriter {
       queueChanged = false;
     } else {
       auto newQueue = std::make_unique<CommandQueueType>(mDataMaxSize);
-      if (!newQueue->isValid() || !newQueue->write(mData.get(), mDataWritten)) {
+      if (!newQueue->isValid() || !writeChunks(newQueue.get(), dataWritten)) {
         ALOGE("failed to prepare a new message queue ");
         return false;
       }
@@ -129,7 +152,7 @@ class CommandWriter {
       queueChanged = true;
     }
 
-    commandLength = mDataWritten;
+    commandLength = dataWritten;
     commandHandles.setToExternal(const_cast<hidl_handle *>(mDataHandles.data()),
                                  mDataHandles.size());
 
@@ -580,27 +603,83 @@ class CommandWriter {
   }
 
  private:
-  void growData(uint32_t grow) {
-    uint32_t newWritten = mDataWritten + grow;
+  struct Chunk {
+    std::unique_ptr<uint32_t[]> data;
+    uint32_t size;
+    uint32_t written;
+  };
 
-    if (newWritten <= mDataMaxSize) {
+  void growData(uint32_t grow) {
+    if (mDataWritten + grow <= mChunks[mCurrentChunk].size) {
       return;
     }
 
-    uint32_t newMaxSize = mDataMaxSize << 1;
-    if (newMaxSize < newWritten) {
-      newMaxSize = newWritten;
+    // The command goes to the next chunk, or to a new one when that is too small for it.
+    mChunks[mCurrentChunk].written = mDataWritten;
+    mChunkBase += mDataWritten;
+    size_t next = mCurrentChunk + 1;
+    if (next == mChunks.size() || mChunks[next].size < grow) {
+      addChunk(next, std::max(grow, mDataMaxSize));
+    }
+    selectChunk(next);
+  }
+
+  void addChunk(size_t index, uint32_t size) {
+    Chunk chunk = {std::make_unique<uint32_t[]>(size), size, 0};
+    mChunks.insert(mChunks.begin() + index, std::move(chunk));
+    mDataMaxSize += size;
+  }
+
+  void selectChunk(size_t index) {
+    mCurrentChunk = index;
+    mData = mChunks[index].data.get();
+    mDataWritten = 0;
+  }
+
+  uint32_t getChunkWritten(size_t index) const {
+    return (index == mCurrentChunk) ? mDataWritten : mChunks[index].written;
+  }
+
+  // Gathers the chunks into one queue write.
+  bool writeChunks(CommandQueueType *queue, uint32_t length) {
+    CommandQueueType::MemTransaction tx;
+    if (!queue->beginWrite(length, &tx)) {
+      return false;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i <= mCurrentChunk; i++) {
+      uint32_t written = getChunkWritten(i);
+      if (written && !tx.copyTo(mChunks[i].data.get(), offset, written)) {
+        return false;
+      }
+      offset += written;
     }
 
-    auto newData = std::make_unique<uint32_t[]>(newMaxSize);
-    std::copy_n(mData.get(), mDataWritten, newData.get());
-    mDataMaxSize = newMaxSize;
-    mData = std::move(newData);
+    return queue->commitWrite(length);
   }
 
+  void releaseHandles() {
+    // handles in mDataHandles are owned by the caller
+    mDataHandles.clear();
+
+    // handles in mTemporaryHandles are owned by the writer
+    for (auto handle : mTemporaryHandles) {
+      native_handle_close(handle);
+      native_handle_delete(handle);
+    }
+    mTemporaryHandles.clear();
+  }
+
+  // total size of all chunks
   uint32_t mDataMaxSize;
-  std::unique_ptr<uint32_t[]> mData;
+  std::vector<Chunk> mChunks;
+  size_t mCurrentChunk = 0;
+  // words written to the chunks before the current one
+  uint32_t mChunkBase;
 
+  // current chunk, offsets below are within it
+  uint32_t *mData;
   uint32_t mDataWritten;
   // end offset of the current command
   uint32_t mCommandEnd;
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <android/hardware/graphics/composer/2.4/IComposerClient.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../QtiQmaaComposerCommandBuffer.h"
+
+using namespace vendor::qti::hardware::display::composer::V3_0;
+using namespace testing;
+
+namespace {
+
+using Command = IComposerClient::Command;
+
+const uint32_t kWriterInitialSize = 64 * 1024 / sizeof(uint32_t) - 16;
+
+// Results of one frame on two displays, the way the service writes them back.
+void WriteFrame(CommandWriter *writer, uint32_t layers, uint32_t blobSize) {
+  for (Display display = 0; display < 2; display++) {
+    writer->selectDisplay(display);
+    std::vector<Layer> changed;
+    std::vector<IComposerClient::Composition> types;
+    std::vector<uint32_t> masks;
+    for (uint32_t i = 0; i < layers; i++) {
+      changed.push_back((display << 32) | (i + 100));
+      types.push_back(IComposerClient::Composition::CLIENT);
+      masks.push_back(i);
+    }
+    writer->setChangedCompositionTypes(changed, types);
+    writer->setDisplayRequests(1, changed, masks);
+    writer->setPresentOrValidateResult(1);
+
+    for (uint32_t i = 0; i < layers; i++) {
+      writer->selectLayer(changed[i]);
+      writer->setLayerBuffer(i % 3, nullptr, nullptr);
+      std::vector<IComposerClient::Rect> damage(i % 4 + 1, IComposerClient::Rect{0, 0, 64, 64});
+      writer->setLayerSurfaceDamage(damage);
+    }
+
+    hidl_vec<IComposerClient::PerFrameMetadataBlob> blobs(1);
+    blobs[0].key = IComposerClient::PerFrameMetadataKey::HDR10_PLUS_SEI;
+    std::vector<uint8_t> blob(blobSize);
+    for (uint32_t i = 0; i < blobSize; i++) {
+      blob[i] = static_cast<uint8_t>(i * 7 + display);
+    }
+    blobs[0].blob = blob;
+    writer->setLayerPerFrameMetadataBlobs(blobs);
+    writer->setError(display, Error::BAD_LAYER);
+  }
+}
+
+class TestReader : public CommandReaderBase {
+ public:
+  // Reads back what the writer queued, as raw words with the commands they form.
+  bool Read(CommandWriter *writer, std::vector<uint32_t> *words, std::vector<Command> *commands) {
+    bool queueChanged = false;
+    uint32_t length = 0;
+    hidl_vec<hidl_handle> handles;
+    if (!writer->writeQueue(queueChanged, length, handles)) {
+      return false;
+    }
+    if (queueChanged && !setMQDescriptor(*writer->getMQDescriptor())) {
+      return false;
+    }
+    queue_changes_ += queueChanged ? 1 : 0;
+    if (!readQueue(length, handles)) {
+      return false;
+    }
+
+    words->clear();
+    commands->clear();
+    while (!isEmpty()) {
+      Command command;
+      uint16_t commandLength = 0;
+      if (!beginCommand(command, commandLength)) {
+        return false;
+      }
+      words->push_back(static_cast<uint32_t>(command) | commandLength);
+      for (uint16_t i = 0; i < commandLength; i++) {
+        words->push_back(read());
+      }
+      endCommand();
+      commands->push_back(command);
+    }
+    reset();
+
+    return words->size() == length;
+  }
+
+  int GetQueueChanges() const { return queue_changes_; }
+
+ private:
+  int queue_changes_ = 0;
+};
+
+void ExpectSameFrame(CommandWriter *expected, CommandWriter *actual) {
+  TestReader expected_reader;
+  TestReader actual_reader;
+  std::vector<uint32_t> expected_words, actual_words;
+  std::vector<Command> expected_commands, actual_commands;
+  ASSERT_TRUE(expected_reader.Read(expected, &expected_words, &expected_commands));
+  ASSERT_TRUE(actual_reader.Read(actual, &actual_words, &actual_commands));
+  EXPECT_EQ(expected_words, actual_words);
+  EXPECT_EQ(expected_commands, actual_commands);
+
+  uint32_t offset = 0;
+  for (Command command : expected_commands) {
+    EXPECT_EQ(command, actual->getCommand(offset));
+    offset += 1 + (expected_words[offset] & static_cast<uint32_t>(Command::LENGTH_MASK));
+  }
+}
+
+}  // namespace
+
+TEST(CommandBufferTest, RoundTripsThroughReader) {
+  CommandWriter writer(kWriterInitialSize);
+  WriteFrame(&writer, 4, 33);
+
+  TestReader reader;
+  std::vector<uint32_t> words;
+  std::vector<Command> commands;
+  ASSERT_TRUE(reader.Read(&writer, &words, &commands));
+  ASSERT_FALSE(commands.empty());
+  EXPECT_EQ(Command::SELECT_DISPLAY, commands.front());
+  EXPECT_EQ(Command::SET_ERROR, commands.back());
+  EXPECT_EQ(1, reader.GetQueueChanges());
+
+  // The blob keeps its bytes and pads to whole words.
+  size_t blob = 0;
+  for (size_t i = 0, command = 0; command < commands.size(); command++) {
+    if (commands[command] == Command::SET_LAYER_PER_FRAME_METADATA_BLOBS) {
+      blob = i;
+      break;
+    }
+    i += 1 + (words[i] & static_cast<uint32_t>(Command::LENGTH_MASK));
+  }
+  ASSERT_NE(0u, blob);
+  EXPECT_EQ(33u, words[blob + 3]);
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&words[blob + 4]);
+  for (uint32_t i = 0; i < 33; i++) {
+    EXPECT_EQ(static_cast<uint8_t>(i * 7), bytes[i]);
+  }
+
+  writer.reset();
+  EXPECT_EQ(0u, static_cast<uint32_t>(writer.getCommand(0)));
+}
+
+TEST(CommandBufferTest, SpillsAcrossChunks) {
+  // A writer that starts far too small writes the same stream as one that fits it.
+  CommandWriter reference(kWriterInitialSize);
+  CommandWriter writer(16);
+  WriteFrame(&reference, 24, 300);
+  WriteFrame(&writer, 24, 300);
+  ExpectSameFrame(&reference, &writer);
+
+  // A command larger than every chunk so far.
+  reference.reset();
+  writer.reset();
+  WriteFrame(&reference, 2, 40000);
+  WriteFrame(&writer, 2, 40000);
+  ExpectSameFrame(&reference, &writer);
+}
+
+TEST(CommandBufferTest, ReusesChunksAcrossFrames) {
+  CommandWriter writer(16);
+  TestReader reader;
+  std::vector<uint32_t> first_words, words;
+  std::vector<Command> commands;
+
+  WriteFrame(&writer, 32, 100);
+  ASSERT_TRUE(reader.Read(&writer, &first_words, &commands));
+  EXPECT_EQ(1, reader.GetQueueChanges());
+  const MQDescriptorSync<uint32_t> *descriptor = writer.getMQDescriptor();
+
+  // Once the writer held a frame, frames up to that size neither grow it nor the queue.
+  for (uint32_t frame = 0; frame < 8; frame++) {
+    writer.reset();
+    WriteFrame(&writer, 32 - frame % 3, 100);
+    ASSERT_TRUE(reader.Read(&writer, &words, &commands));
+  }
+  EXPECT_EQ(1, reader.GetQueueChanges());
+  EXPECT_EQ(descriptor, writer.getMQDescriptor());
+
+  writer.reset();
+  WriteFrame(&writer, 32, 100);
+  ASSERT_TRUE(reader.Read(&writer, &words, &commands));
+  EXPECT_EQ(first_words, words);
+
+  // Nothing written, nothing queued.
+  writer.reset();
+  bool queueChanged = true;
+  uint32_t length = 1;
+  hidl_vec<hidl_handle> handles;
+  ASSERT_TRUE(writer.writeQueue(queueChanged, length, handles));
+  EXPECT_FALSE(queueChanged);
+  EXPECT_EQ(0u, length);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
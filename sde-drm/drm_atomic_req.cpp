@@ -64,6 +64,7 @@
 */
 
 #include <drm_logger.h>
+#include <algorithm>
 
 #include "drm_atomic_req.h"
 #include "drm_connector.h"
@@ -186,7 +187,12 @@ int DRMAtomicReq::Perform(DRMOps opcode, uint32_t obj_id, ...) {
     case DRMOps::CONNECTOR_WB_USAGE_TYPE:
     case DRMOps::CONNECTOR_SET_CACHE_STATE:
     case DRMOps::CONNECTOR_SET_EPT:
-    case DRMOps::CONNECTOR_SET_BPP_MODE: {
+    case DRMOps::CONNECTOR_SET_BPP_MODE:
+    case DRMOps::CONNECTOR_RESET_CACHE: {
+      if (obj_id != token_.conn_id && std::find(other_conn_ids_.begin(), other_conn_ids_.end(),
+                                                obj_id) == other_conn_ids_.end()) {
+        other_conn_ids_.push_back(obj_id);
+      }
       drm_mgr_->GetConnectorMgr()->Perform(opcode, obj_id, drm_atomic_req_, args);
     } break;
     case DRMOps::DPPS_CACHE_FEATURE: {
@@ -223,6 +229,8 @@ int DRMAtomicReq::Validate() {
   // because we just want to validate, not actually mark planes as removed
   drm_mgr_->GetPlaneMgr()->UnsetUnusedResources(token_.crtc_id, false/*is_commit*/,
                                                 drm_atomic_req_);
+  DRM_LOGD("crtc %u: validating %d properties", token_.crtc_id,
+           drmModeAtomicGetCursor(drm_atomic_req_));
   int ret = drmModeAtomicCommit(fd_, drm_atomic_req_,
                                 DRM_MODE_ATOMIC_ALLOW_MODESET | DRM_MODE_ATOMIC_TEST_ONLY, nullptr);
   if (ret) {
@@ -231,6 +239,11 @@ int DRMAtomicReq::Validate() {
 
   drm_mgr_->GetPlaneMgr()->PostValidate(token_.crtc_id, !ret);
   drm_mgr_->GetCrtcMgr()->PostValidate(token_.crtc_id, !ret);
+  drm_mgr_->GetConnectorMgr()->PostValidate(token_.conn_id, !ret);
+  for (auto conn_id : other_conn_ids_) {
+    drm_mgr_->GetConnectorMgr()->PostValidate(conn_id, !ret);
+  }
+  other_conn_ids_.clear();
   drmModeAtomicSetCursor(drm_atomic_req_, 0);
 
   return ret;
@@ -252,6 +265,8 @@ int DRMAtomicReq::Commit(bool synchronous, bool retain_planes) {
     flags |= DRM_MODE_ATOMIC_NONBLOCK;
   }
 
+  DRM_LOGD("crtc %u: committing %d properties", token_.crtc_id,
+           drmModeAtomicGetCursor(drm_atomic_req_));
   int ret = drmModeAtomicCommit(fd_, drm_atomic_req_, flags, nullptr);
   if (ret) {
     DRM_LOGE("drmModeAtomicCommit failed with error %d (%s). crtc=%u", errno, strerror(errno), token_.crtc_id);
@@ -259,6 +274,11 @@ int DRMAtomicReq::Commit(bool synchronous, bool retain_planes) {
 
   drm_mgr_->GetPlaneMgr()->PostCommit(token_.crtc_id, !ret);
   drm_mgr_->GetCrtcMgr()->PostCommit(token_.crtc_id, !ret);
+  drm_mgr_->GetConnectorMgr()->PostCommit(token_.conn_id, !ret);
+  for (auto conn_id : other_conn_ids_) {
+    drm_mgr_->GetConnectorMgr()->PostCommit(conn_id, !ret);
+  }
+  other_conn_ids_.clear();
   drmModeAtomicSetCursor(drm_atomic_req_, 0);
 
   return ret;
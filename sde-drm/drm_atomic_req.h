@@ -54,6 +54,9 @@ class DRMAtomicReq : public DRMAtomicReqInterface {
   DRMManager *drm_mgr_ = {};
   int fd_ = -1;
   DRMDisplayToken token_ = {};
+  // Connectors other than token_.conn_id this request set properties on, such as the CWB
+  // connector. Their property caches are rolled back or promoted along with the display's.
+  std::vector<uint32_t> other_conn_ids_ = {};
 };
 
 }  // namespace sde_drm
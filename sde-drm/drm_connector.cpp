@@ -513,6 +513,22 @@ void DRMConnectorManager::Free(DRMDisplayToken *token) {
   token->conn_id = 0;
 }
 
+void DRMConnectorManager::PostValidate(uint32_t conn_id, bool success) {
+  lock_guard<mutex> lock(lock_);
+  auto iter = connector_pool_.find(conn_id);
+  if (iter != connector_pool_.end()) {
+    iter->second->PostValidate(success);
+  }
+}
+
+void DRMConnectorManager::PostCommit(uint32_t conn_id, bool success) {
+  lock_guard<mutex> lock(lock_);
+  auto iter = connector_pool_.find(conn_id);
+  if (iter != connector_pool_.end()) {
+    iter->second->PostCommit(success);
+  }
+}
+
 // DSI only
 int DRMConnectorManager::GetPreferredModeLMCounts(std::map<uint32_t, uint8_t> *lm_counts) {
   lock_guard<mutex> lock(lock_);
@@ -1102,6 +1118,25 @@ int DRMConnector::GetInfo(DRMConnectorInfo *info) {
   return 0;
 }
 
+void DRMConnector::Unlock() {
+  status_ = DRMStatus::FREE;
+  // Next owner may have committed from a different state, start from an empty cache
+  tmp_prop_val_map_.clear();
+  committed_prop_val_map_.clear();
+}
+
+void DRMConnector::PostValidate(bool success) {
+  tmp_prop_val_map_ = committed_prop_val_map_;
+}
+
+void DRMConnector::PostCommit(bool success) {
+  if (success) {
+    committed_prop_val_map_ = tmp_prop_val_map_;
+  } else {
+    tmp_prop_val_map_ = committed_prop_val_map_;
+  }
+}
+
 void DRMConnector::InitAndParse(drmModeConnector *conn) {
   drm_connector_ = conn;
   ParseProperties();
@@ -1115,7 +1150,8 @@ void DRMConnector::Perform(DRMOps code, drmModeAtomicReq *req, va_list args) {
   switch (code) {
     case DRMOps::CONNECTOR_SET_CRTC: {
       uint32_t crtc = va_arg(args, uint32_t);
-      drmModeAtomicAddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::CRTC_ID), crtc);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::CRTC_ID), crtc,
+                  true /* cache */, tmp_prop_val_map_);
       DRM_LOGD("Connector %d: Setting CRTC %d", obj_id, crtc);
     } break;
 
@@ -1132,19 +1168,19 @@ void DRMConnector::Perform(DRMOps code, drmModeAtomicReq *req, va_list args) {
       }
       uint32_t offset = va_arg(args, uint32_t);
       uint32_t prop_id = prop_mgr_.GetPropertyId(DRMProperty::RETIRE_FENCE_OFFSET);
-      drmModeAtomicAddProperty(req, obj_id, prop_id, offset);
+      AddProperty(req, obj_id, prop_id, offset, true /* cache */, tmp_prop_val_map_);
     } break;
 
     case DRMOps::CONNECTOR_SET_OUTPUT_RECT: {
       DRMRect rect = va_arg(args, DRMRect);
-      drmModeAtomicAddProperty(req, obj_id,
-                               prop_mgr_.GetPropertyId(DRMProperty::DST_X), rect.left);
-      drmModeAtomicAddProperty(req, obj_id,
-                               prop_mgr_.GetPropertyId(DRMProperty::DST_Y), rect.top);
-      drmModeAtomicAddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::DST_W),
-                               rect.right - rect.left);
-      drmModeAtomicAddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::DST_H),
-                               rect.bottom - rect.top);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::DST_X), rect.left,
+                  true /* cache */, tmp_prop_val_map_);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::DST_Y), rect.top,
+                  true /* cache */, tmp_prop_val_map_);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::DST_W),
+                  rect.right - rect.left, true /* cache */, tmp_prop_val_map_);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::DST_H),
+                  rect.bottom - rect.top, true /* cache */, tmp_prop_val_map_);
       DRM_LOGD("Connector %d: Setting dst [x,y,w,h][%d,%d,%d,%d]", obj_id, rect.left,
                   rect.top, (rect.right - rect.left), (rect.bottom - rect.top));
     } break;
@@ -1175,7 +1211,8 @@ void DRMConnector::Perform(DRMOps code, drmModeAtomicReq *req, va_list args) {
           DRM_LOGE("Invalid power mode %d to set on connector %d", drm_power_mode, obj_id);
           break;
       }
-      drmModeAtomicAddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::LP), power_mode);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::LP), power_mode,
+                  true /* cache */, tmp_prop_val_map_);
       DRM_LOGD("Connector %d: Setting power_mode %d", obj_id, power_mode);
     } break;
 
@@ -1193,17 +1230,16 @@ void DRMConnector::Perform(DRMOps code, drmModeAtomicReq *req, va_list args) {
 
     case DRMOps::CONNECTOR_SET_AUTOREFRESH: {
       uint32_t enable = va_arg(args, uint32_t);
-      drmModeAtomicAddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::AUTOREFRESH),
-                               enable);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::AUTOREFRESH), enable,
+                  true /* cache */, tmp_prop_val_map_);
       DRM_LOGD("Connector %d: Setting autorefresh %d", obj_id, enable);
     } break;
 
     case DRMOps::CONNECTOR_SET_FB_SECURE_MODE: {
       int secure_mode = va_arg(args, int);
       uint32_t fb_secure_mode = (secure_mode == (int)DRMSecureMode::SECURE) ? SECURE : NON_SECURE;
-      drmModeAtomicAddProperty(req, obj_id,
-                               prop_mgr_.GetPropertyId(DRMProperty::FB_TRANSLATION_MODE),
-                               fb_secure_mode);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::FB_TRANSLATION_MODE),
+                  fb_secure_mode, true /* cache */, tmp_prop_val_map_);
       DRM_LOGD("Connector %d: Setting FB secure mode %d", obj_id, fb_secure_mode);
     } break;
 
@@ -1225,8 +1261,8 @@ void DRMConnector::Perform(DRMOps code, drmModeAtomicReq *req, va_list args) {
       }
       int drm_qsync_mode = va_arg(args, int);
       uint32_t qsync_mode = static_cast<uint32_t>(drm_qsync_mode);
-      drmModeAtomicAddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::QSYNC_MODE),
-                               qsync_mode);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::QSYNC_MODE), qsync_mode,
+                  true /* cache */, tmp_prop_val_map_);
       DRM_LOGD("Connector %d: Setting Qsync mode %d", obj_id, qsync_mode);
     } break;
 
@@ -1466,8 +1502,8 @@ void DRMConnector::Perform(DRMOps code, drmModeAtomicReq *req, va_list args) {
       if (cache_state == (int)DRMCacheWBState::ENABLED) {
         connector_cache_state = CACHE_STATE_ENABLED;
       }
-      drmModeAtomicAddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::CACHE_STATE),
-                  connector_cache_state);
+      AddProperty(req, obj_id, prop_mgr_.GetPropertyId(DRMProperty::CACHE_STATE),
+                  connector_cache_state, true /* cache */, tmp_prop_val_map_);
     } break;
 
     case DRMOps::CONNECTOR_SET_EPT: {
@@ -1481,6 +1517,11 @@ void DRMConnector::Perform(DRMOps code, drmModeAtomicReq *req, va_list args) {
       DRM_LOGD("Connector %d: Setting ePT = %" PRId64, obj_id, expected_present_time);
     } break;
 
+    case DRMOps::CONNECTOR_RESET_CACHE: {
+      tmp_prop_val_map_.clear();
+      committed_prop_val_map_.clear();
+    } break;
+
     default:
       DRM_LOGE("Invalid opcode %d to set on connector %d", code, obj_id);
       break;
@@ -89,7 +89,7 @@ class DRMConnector {
   ~DRMConnector();
   void InitAndParse(drmModeConnector *conn);
   void Lock() { status_ = DRMStatus::BUSY; }
-  void Unlock() { status_ = DRMStatus::FREE; }
+  void Unlock();
   DRMStatus GetStatus() { return status_; }
   int GetInfo(DRMConnectorInfo *info);
   void GetType(uint32_t *conn_type) { *conn_type = drm_connector_->connector_type; }
@@ -99,6 +99,8 @@ class DRMConnector {
   int GetPossibleEncoders(std::set<uint32_t> *possible_encoders);
   void SetSkipConnectorReload(bool skip_reload) { skip_connector_reload_ = skip_reload; };
   void Dump();
+  void PostValidate(bool success);
+  void PostCommit(bool success);
 
  private:
   void ParseProperties();
@@ -118,6 +120,8 @@ class DRMConnector {
   DRMStatus status_ = DRMStatus::FREE;
   std::unique_ptr<DRMPPManager> pp_mgr_{};
   DRMJitterConfig jitter_cfg_ = {};
+  std::unordered_map<uint32_t, uint64_t> tmp_prop_val_map_ {};
+  std::unordered_map<uint32_t, uint64_t> committed_prop_val_map_ {};
 #ifdef SDE_MAX_ROI_V1
   sde_drm_roi_v1 roi_v1_ {};
 #endif
@@ -134,6 +138,8 @@ class DRMConnectorManager {
   int Reserve(DRMDisplayType disp_type, DRMDisplayToken *token);
   int Reserve(uint32_t conn_id, DRMDisplayToken *token);
   void Free(DRMDisplayToken *token);
+  void PostValidate(uint32_t conn_id, bool success);
+  void PostCommit(uint32_t conn_id, bool success);
   void Perform(DRMOps code, uint32_t obj_id, drmModeAtomicReq *req, va_list args);
   int GetConnectorInfo(uint32_t conn_id, DRMConnectorInfo *info);
   void GetConnectorList(std::vector<uint32_t> *conn_ids);
@@ -69,6 +69,7 @@
 #include <display/drm/msm_drm_pp.h>
 #endif
 #include <errno.h>
+#include <inttypes.h>
 #include <drm_logger.h>
 #include <cstring>
 #include <algorithm>
@@ -87,19 +88,15 @@ DRMPPManager::DRMPPManager(int fd) : fd_(fd) {
 
 DRMPPManager::~DRMPPManager() {
 #ifdef PP_DRM_ENABLE
-  DRMPPPropInfo prop_info = {};
-
-  /* free previously created blob to avoid memory leak */
-  for (int i = 0; i < kPPFeaturesMax; i++) {
-    prop_info = pp_prop_map_[i];
-    for (int j = 0; j < NUM_CACHED_BLOB_ID; j++) {
-      if (prop_info.blob_id[j] > 0) {
-        drmModeDestroyPropertyBlob(fd_, prop_info.blob_id[j]);
-        prop_info.blob_id[j] = 0;
-      }
-    }
+  /* free previously created blobs to avoid memory leak, every cached feature blob is tracked
+   * in blobs_ whether it is still referenced or idle */
+  for (auto &blob : blobs_) {
+    drmModeDestroyPropertyBlob(fd_, blob.blob_id);
   }
 #endif
+  blobs_.clear();
+  DRM_LOGD("blob hits %" PRIu64 " creates %" PRIu64 " destroys %" PRIu64, blob_hits_,
+           blob_creates_, blob_destroys_);
   fd_ = -1;
 }
 
@@ -338,21 +335,16 @@ int DRMPPManager::SetPPBlobProperty(drmModeAtomicReq *req, uint32_t obj_id,
     return 0;
   }
 
-  /* free previously created blob for this feature if exist */
-  if (prop_info->blob_id[prop_info->blob_id_index] > 0) {
-    ret = drmModeDestroyPropertyBlob(fd_, prop_info->blob_id[prop_info->blob_id_index]);
-    if (ret) {
-      DRM_LOGE("failed to destroy property blob for feature %d, ret = %d", feature.id, ret);
-      return ret;
-    } else {
-      prop_info->blob_id[prop_info->blob_id_index] = 0;
-    }
+  /* acquire before releasing the slot, so re-setting the same table keeps its blob alive */
+  blob_id = AcquireBlob(feature.payload, feature.payload_size);
+  if (blob_id == 0) {
+    return DRM_ERR_INVALID;
   }
+  ret = 0;
 
-  ret = drmModeCreatePropertyBlob(fd_, feature.payload, feature.payload_size, &blob_id);
-  if (ret || blob_id == 0) {
-    DRM_LOGE("failed to create property blob ret %d, blob_id = %d", ret, blob_id);
-    return DRM_ERR_INVALID;
+  /* drop this slot's reference to the blob set NUM_CACHED_BLOB_ID calls ago */
+  if (prop_info->blob_id[prop_info->blob_id_index] > 0) {
+    ReleaseBlob(prop_info->blob_id[prop_info->blob_id_index]);
   }
 
   prop_info->blob_id[prop_info->blob_id_index] = blob_id;
@@ -363,6 +355,98 @@ int DRMPPManager::SetPPBlobProperty(drmModeAtomicReq *req, uint32_t obj_id,
   return ret;
 }
 
+uint32_t DRMPPManager::AcquireBlob(const void *payload, uint32_t size) {
+  uint32_t blob_id = 0;
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(payload);
+  /* FNV-1a over 32 bit words, LUT payloads are tens of KB and this runs on every set. The
+   * module is built with the unsigned overflow sanitizer, so the product is taken in 64 bits,
+   * where a 32 bit hash times the 25 bit prime cannot wrap, and masked back to 32 bits. */
+  uint64_t hash = 0x811c9dc5ULL;
+  uint32_t i = 0;
+  for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+    uint32_t word = 0;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash = ((hash ^ word) * 0x01000193ULL) & 0xffffffffULL;
+  }
+  for (; i < size; i++) {
+    hash = ((hash ^ bytes[i]) * 0x01000193ULL) & 0xffffffffULL;
+  }
+
+  blob_use_count_++;
+  for (auto &blob : blobs_) {
+    if (blob.hash == hash && blob.payload.size() == size &&
+        !memcmp(blob.payload.data(), bytes, size)) {
+      blob.ref_count++;
+      blob.last_use = blob_use_count_;
+      blob_hits_++;
+      return blob.blob_id;
+    }
+  }
+
+#ifdef PP_DRM_ENABLE
+  int ret = drmModeCreatePropertyBlob(fd_, payload, size, &blob_id);
+  if (ret || blob_id == 0) {
+    DRM_LOGE("failed to create property blob ret %d, blob_id = %d", ret, blob_id);
+    return 0;
+  }
+#else
+  return 0;
+#endif
+
+  DRMPPBlob blob = {};
+  blob.blob_id = blob_id;
+  blob.ref_count = 1;
+  blob.hash = hash;
+  blob.last_use = blob_use_count_;
+  blob.payload.assign(bytes, bytes + size);
+  blobs_.push_back(std::move(blob));
+  blob_creates_++;
+
+  return blob_id;
+}
+
+void DRMPPManager::ReleaseBlob(uint32_t blob_id) {
+  for (auto &blob : blobs_) {
+    if (blob.blob_id == blob_id) {
+      if (blob.ref_count) {
+        blob.ref_count--;
+      }
+      break;
+    }
+  }
+
+  TrimIdleBlobs();
+}
+
+void DRMPPManager::TrimIdleBlobs() {
+  while (true) {
+    uint32_t idle_count = 0;
+    auto lru = blobs_.end();
+    for (auto it = blobs_.begin(); it != blobs_.end(); it++) {
+      if (it->ref_count) {
+        continue;
+      }
+      idle_count++;
+      if (lru == blobs_.end() || it->last_use < lru->last_use) {
+        lru = it;
+      }
+    }
+
+    if (idle_count <= NUM_IDLE_BLOB_ID) {
+      return;
+    }
+
+#ifdef PP_DRM_ENABLE
+    int ret = drmModeDestroyPropertyBlob(fd_, lru->blob_id);
+    if (ret) {
+      DRM_LOGE("failed to destroy property blob %d, ret = %d", lru->blob_id, ret);
+    }
+#endif
+    blob_destroys_++;
+    blobs_.erase(lru);
+  }
+}
+
 void DRMPPManager::SetPPEvent(uint32_t obj_id, DRMPPFeatureInfo &feature) {
 #ifdef PP_DRM_ENABLE
   int ret  = 0;
@@ -31,11 +31,13 @@
 #define __DRM_PP_MANAGER_H__
 
 #include <limits>
+#include <vector>
 #include "drm_utils.h"
 #include "drm_interface.h"
 #include "drm_property.h"
 
 #define NUM_CACHED_BLOB_ID 2
+#define NUM_IDLE_BLOB_ID 8
 
 namespace sde_drm {
 
@@ -47,6 +49,16 @@ struct DRMPPPropInfo {
   uint32_t blob_id_index;
 };
 
+// Property blob shared by every feature slot that set identical payload content. Blobs whose
+// ref_count drops to zero are kept idle for reuse until the idle limit evicts them.
+struct DRMPPBlob {
+  uint32_t blob_id = 0;
+  uint32_t ref_count = 0;
+  uint64_t hash = 0;
+  uint64_t last_use = 0;
+  std::vector<uint8_t> payload;
+};
+
 class DRMPPManager {
  public:
   explicit DRMPPManager(int fd);
@@ -62,10 +74,18 @@ class DRMPPManager {
   int SetPPRangeProperty(drmModeAtomicReq *req, uint32_t obj_id, struct DRMPPPropInfo *prop_info,
                         DRMPPFeatureInfo &feature);
   void SetPPEvent(uint32_t obj_id, DRMPPFeatureInfo &feature);
+  uint32_t AcquireBlob(const void *payload, uint32_t size);
+  void ReleaseBlob(uint32_t blob_id);
+  void TrimIdleBlobs();
 
   int fd_ = -1;
   uint32_t object_type_ = std::numeric_limits<uint32_t>::max();
   DRMPPPropInfo pp_prop_map_[kPPFeaturesMax] = {};
+  std::vector<DRMPPBlob> blobs_ = {};
+  uint64_t blob_use_count_ = 0;
+  uint64_t blob_hits_ = 0;
+  uint64_t blob_creates_ = 0;
+  uint64_t blob_destroys_ = 0;
 };
 
 }  // namespace sde_drm
@@ -0,0 +1,892 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <drm/drm_fourcc.h>
+#include <display/drm/sde_drm.h>
+#include <drm_logger.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+
+#include "drm_virtual_manager.h"
+
+#define __CLASS__ "DRMVirtualManager"
+
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::vector;
+
+extern "C" {
+
+int GetDRMManager(int fd, sde_drm::DRMManagerInterface **intf) {
+  sde_drm::DRMVirtualManager *drm_mgr = sde_drm::DRMVirtualManager::GetInstance();
+  if (!drm_mgr) {
+    return -ENODEV;
+  }
+
+  *intf = drm_mgr;
+  return 0;
+}
+
+int DestroyDRMManager() {
+  sde_drm::DRMVirtualManager::Destroy();
+  return 0;
+}
+
+int CreateDRMFbId(int buffer_fd, uint32_t width, uint32_t height, uint32_t format,
+                  uint64_t modifier, uint32_t *fb_id) {
+  return sde_drm::DRMVirtualManager::GetInstance()->CreateFbId(buffer_fd, width, height, format,
+                                                               modifier, fb_id);
+}
+
+int RemoveDRMFbId(uint32_t fb_id) {
+  return sde_drm::DRMVirtualManager::GetInstance()->RemoveFbId(fb_id);
+}
+
+int OpenDRMEventFd(int *fd) {
+  return sde_drm::DRMVirtualManager::GetInstance()->OpenEventFd(fd);
+}
+
+int CloseDRMEventFd(int fd) {
+  return sde_drm::DRMVirtualManager::GetInstance()->CloseEventFd(fd);
+}
+
+int RequestDRMVBlank(int fd) {
+  return sde_drm::DRMVirtualManager::GetInstance()->RequestVBlank(fd);
+}
+
+int HandleDRMVBlank(int fd, int64_t *timestamp_ns) {
+  return sde_drm::DRMVirtualManager::GetInstance()->HandleVBlank(fd, timestamp_ns);
+}
+
+}  // extern "C"
+
+namespace sde_drm {
+
+// Reader for the flat panel description: one object whose values are strings, numbers,
+// booleans or arrays of those. Nested objects are rejected.
+class PanelJsonReader {
+ public:
+  explicit PanelJsonReader(const string &text) : text_(text) {}
+
+  int Parse(std::map<string, vector<string>> *values) {
+    if (!Expect('{')) {
+      return -EINVAL;
+    }
+    if (Peek() == '}') {
+      return 0;
+    }
+    do {
+      string key;
+      if (!ReadString(&key) || !Expect(':')) {
+        return -EINVAL;
+      }
+      vector<string> &value = (*values)[key];
+      if (Peek() == '[') {
+        Expect('[');
+        if (Peek() != ']') {
+          do {
+            value.emplace_back();
+            if (!ReadScalar(&value.back())) {
+              return -EINVAL;
+            }
+          } while (Accept(','));
+        }
+        if (!Expect(']')) {
+          return -EINVAL;
+        }
+      } else {
+        value.emplace_back();
+        if (!ReadScalar(&value.back())) {
+          return -EINVAL;
+        }
+      }
+    } while (Accept(','));
+
+    return Expect('}') ? 0 : -EINVAL;
+  }
+
+ private:
+  char Peek() {
+    while (pos_ < text_.size() && isspace(static_cast<unsigned char>(text_[pos_]))) {
+      pos_++;
+    }
+    return (pos_ < text_.size()) ? text_[pos_] : '\0';
+  }
+
+  bool Accept(char c) {
+    if (Peek() == c) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool Expect(char c) {
+    if (!Accept(c)) {
+      DRM_LOGE("Panel description: expected '%c' at offset %zu", c, pos_);
+      return false;
+    }
+    return true;
+  }
+
+  bool ReadString(string *out) {
+    if (!Expect('"')) {
+      return false;
+    }
+    while (pos_ < text_.size() && text_[pos_] != '"') {
+      if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) {
+        pos_++;
+      }
+      out->push_back(text_[pos_++]);
+    }
+    return Expect('"');
+  }
+
+  bool ReadScalar(string *out) {
+    char c = Peek();
+    if (c == '"') {
+      return ReadString(out);
+    }
+    if (c == '{' || c == '[') {
+      DRM_LOGE("Panel description: nested values are not supported, offset %zu", pos_);
+      return false;
+    }
+    while (pos_ < text_.size() && (isalnum(static_cast<unsigned char>(text_[pos_])) ||
+                                   text_[pos_] == '.' || text_[pos_] == '-' ||
+                                   text_[pos_] == '+')) {
+      out->push_back(text_[pos_++]);
+    }
+    return !out->empty();
+  }
+
+  const string &text_;
+  size_t pos_ = 0;
+};
+
+static void ReadUint(const std::map<string, vector<string>> &values, const char *key,
+                     uint32_t *out) {
+  auto it = values.find(key);
+  if (it != values.end() && !it->second.empty()) {
+    *out = static_cast<uint32_t>(strtoul(it->second[0].c_str(), nullptr, 0));
+  }
+}
+
+int DRMVirtualPanel::Load(const string &path) {
+  std::ifstream fs(path);
+  if (!fs) {
+    DRM_LOGE("Failed to open panel description %s", path.c_str());
+    return -ENOENT;
+  }
+  std::stringstream ss;
+  ss << fs.rdbuf();
+  string text = ss.str();
+
+  std::map<string, vector<string>> values;
+  int ret = PanelJsonReader(text).Parse(&values);
+  if (ret) {
+    DRM_LOGE("Failed to parse panel description %s", path.c_str());
+    return ret;
+  }
+
+  auto it = values.find("name");
+  if (it != values.end() && !it->second.empty()) {
+    name = it->second[0];
+  }
+  it = values.find("mode");
+  if (it != values.end() && !it->second.empty()) {
+    cmd_mode = (it->second[0] == "command");
+  }
+  it = values.find("refresh_rates");
+  if (it != values.end() && !it->second.empty()) {
+    refresh_rates.clear();
+    for (auto &rate : it->second) {
+      uint32_t fps = static_cast<uint32_t>(strtoul(rate.c_str(), nullptr, 0));
+      if (fps) {
+        refresh_rates.push_back(fps);
+      }
+    }
+  }
+  ReadUint(values, "width", &width);
+  ReadUint(values, "height", &height);
+  ReadUint(values, "mm_width", &mm_width);
+  ReadUint(values, "mm_height", &mm_height);
+  ReadUint(values, "vig_planes", &vig_planes);
+  ReadUint(values, "dma_planes", &dma_planes);
+  ReadUint(values, "max_blend_stages", &max_blend_stages);
+  ReadUint(values, "max_linewidth", &max_linewidth);
+
+  if (!width || !height || refresh_rates.empty()) {
+    DRM_LOGE("Invalid panel description %s", path.c_str());
+    return -EINVAL;
+  }
+
+  return 0;
+}
+
+DRMVirtualTimeline::DRMVirtualTimeline() {
+  epoch_ = steady_clock::now();
+  thread_ = std::thread(&DRMVirtualTimeline::Run, this);
+}
+
+DRMVirtualTimeline::~DRMVirtualTimeline() {
+  {
+    lock_guard<mutex> lock(lock_);
+    exit_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+
+  // Signal whatever is left so that no client waits on a fence that can never fire.
+  for (auto &signal : pending_) {
+    if (signal.second.is_fence) {
+      uint64_t value = 1;
+      write(signal.second.fd, &value, sizeof(value));
+      close(signal.second.fd);
+    }
+  }
+}
+
+void DRMVirtualTimeline::SetPeriod(nanoseconds period) {
+  lock_guard<mutex> lock(lock_);
+  period_ = period;
+  epoch_ = steady_clock::now();
+}
+
+steady_clock::time_point DRMVirtualTimeline::NextVBlank(uint32_t n) {
+  lock_guard<mutex> lock(lock_);
+  auto elapsed = steady_clock::now() - epoch_;
+  auto count = elapsed / period_ + n;
+  return epoch_ + period_ * count;
+}
+
+int DRMVirtualTimeline::CreateFence(steady_clock::time_point deadline) {
+  int fd = eventfd(0, EFD_CLOEXEC);
+  if (fd < 0) {
+    DRM_LOGE("eventfd failed errno = %d", errno);
+    return -1;
+  }
+  int client_fd = dup(fd);
+  if (client_fd < 0) {
+    close(fd);
+    return -1;
+  }
+
+  {
+    lock_guard<mutex> lock(lock_);
+    pending_.emplace(deadline, Signal{fd, true});
+  }
+  cv_.notify_all();
+
+  return client_fd;
+}
+
+void DRMVirtualTimeline::SignalEvent(int fd, steady_clock::time_point deadline) {
+  {
+    lock_guard<mutex> lock(lock_);
+    pending_.emplace(deadline, Signal{fd, false});
+  }
+  cv_.notify_all();
+}
+
+steady_clock::time_point DRMVirtualTimeline::GetEventTime(int fd) {
+  lock_guard<mutex> lock(lock_);
+  auto it = event_times_.find(fd);
+  return (it != event_times_.end()) ? it->second : steady_clock::time_point();
+}
+
+void DRMVirtualTimeline::CancelEvents(int fd) {
+  lock_guard<mutex> lock(lock_);
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    it = (!it->second.is_fence && it->second.fd == fd) ? pending_.erase(it) : std::next(it);
+  }
+  event_times_.erase(fd);
+}
+
+void DRMVirtualTimeline::Run() {
+  std::unique_lock<mutex> lock(lock_);
+  while (!exit_) {
+    if (pending_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+
+    auto deadline = pending_.begin()->first;
+    if (steady_clock::now() < deadline) {
+      cv_.wait_until(lock, deadline);
+      continue;
+    }
+
+    while (!pending_.empty() && pending_.begin()->first <= deadline) {
+      const Signal &signal = pending_.begin()->second;
+      uint64_t value = 1;
+      write(signal.fd, &value, sizeof(value));
+      if (signal.is_fence) {
+        close(signal.fd);
+      } else {
+        event_times_[signal.fd] = pending_.begin()->first;
+      }
+      pending_.erase(pending_.begin());
+    }
+  }
+}
+
+int DRMVirtualAtomicReq::Perform(DRMOps opcode, uint32_t obj_id, ...) {
+  va_list args;
+  va_start(args, obj_id);
+  num_ops_++;
+
+  switch (opcode) {
+    case DRMOps::PLANE_SET_CRTC: {
+      planes_[obj_id].crtc_id = va_arg(args, uint32_t);
+    } break;
+    case DRMOps::PLANE_SET_FB_ID: {
+      planes_[obj_id].fb_id = va_arg(args, uint32_t);
+    } break;
+    case DRMOps::PLANE_SET_ZORDER: {
+      planes_[obj_id].zorder = va_arg(args, uint32_t);
+    } break;
+    case DRMOps::PLANE_SET_ROTATION: {
+      planes_[obj_id].rotation = va_arg(args, uint32_t);
+    } break;
+    case DRMOps::PLANE_SET_SRC_RECT: {
+      planes_[obj_id].src = va_arg(args, DRMRect);
+    } break;
+    case DRMOps::PLANE_SET_DST_RECT: {
+      planes_[obj_id].dst = va_arg(args, DRMRect);
+    } break;
+    case DRMOps::CRTC_SET_MODE: {
+      drmModeModeInfo *mode = va_arg(args, drmModeModeInfo *);
+      if (mode) {
+        mgr_->SetMode(*mode);
+      }
+    } break;
+    case DRMOps::CRTC_GET_RELEASE_FENCE: {
+      int64_t *fence = va_arg(args, int64_t *);
+      *fence = -1;
+      release_fences_.push_back(fence);
+    } break;
+    case DRMOps::CONNECTOR_GET_RETIRE_FENCE: {
+      int64_t *fence = va_arg(args, int64_t *);
+      *fence = -1;
+      retire_fences_.push_back(fence);
+    } break;
+    case DRMOps::CONNECTOR_GET_TRANSFER_TIME: {
+      uint32_t *transfer_time = va_arg(args, uint32_t *);
+      *transfer_time = 0;
+    } break;
+    default:
+      // Everything else is staged state that the virtual pipeline accepts as is.
+      break;
+  }
+
+  va_end(args);
+  return 0;
+}
+
+int DRMVirtualAtomicReq::Validate() {
+  int ret = mgr_->Validate(token_, planes_);
+  Reset();
+  return ret;
+}
+
+int DRMVirtualAtomicReq::Commit(bool synchronous, bool retain_planes) {
+  // Like the driver, a request that does not validate is not committed and gets no fences
+  int ret = mgr_->Validate(token_, planes_);
+  if (!ret) {
+    ret = mgr_->Commit(token_, synchronous, num_ops_, &release_fences_, &retire_fences_);
+  }
+  Reset();
+  return ret;
+}
+
+void DRMVirtualAtomicReq::Reset() {
+  release_fences_.clear();
+  retire_fences_.clear();
+  planes_.clear();
+  num_ops_ = 0;
+}
+
+const uint32_t DRMVirtualManager::kCrtcId;
+const uint32_t DRMVirtualManager::kConnectorId;
+const uint32_t DRMVirtualManager::kEncoderId;
+const uint32_t DRMVirtualManager::kPlaneIdBase;
+DRMVirtualManager *DRMVirtualManager::s_instance = nullptr;
+mutex DRMVirtualManager::s_lock;
+
+DRMVirtualManager *DRMVirtualManager::GetInstance() {
+  lock_guard<mutex> lock(s_lock);
+  if (!s_instance) {
+    s_instance = new DRMVirtualManager();
+  }
+  return s_instance;
+}
+
+void DRMVirtualManager::Destroy() {
+  lock_guard<mutex> lock(s_lock);
+  if (s_instance) {
+    delete s_instance;
+    s_instance = nullptr;
+  }
+}
+
+DRMVirtualManager::DRMVirtualManager() {
+  const char *path = getenv("SDE_DRM_VIRTUAL_PANEL");
+  if (path && panel_.Load(path)) {
+    DRM_LOGW("Falling back to the default virtual panel");
+    panel_ = {};
+  }
+  BuildModes();
+  BuildPlanes();
+  SetMode(modes_[0].mode);
+  DRM_LOGI("Virtual panel %s %ux%u, %zu modes, %u vig + %u dma planes", panel_.name.c_str(),
+           panel_.width, panel_.height, modes_.size(), panel_.vig_planes, panel_.dma_planes);
+}
+
+DRMVirtualManager::~DRMVirtualManager() {
+  DRM_LOGI("frames %" PRIu64 ", ops %" PRIu64 ", ops/frame %" PRIu64, frame_count_, op_count_,
+           frame_count_ ? op_count_ / frame_count_ : 0);
+  for (int fd : event_fds_) {
+    timeline_.CancelEvents(fd);
+    close(fd);
+  }
+}
+
+void DRMVirtualManager::BuildModes() {
+  uint32_t flags = panel_.cmd_mode ? DRM_MODE_FLAG_CMD_MODE_PANEL : DRM_MODE_FLAG_VID_MODE_PANEL;
+  bool dual_lm = panel_.width > panel_.max_linewidth;
+
+  modes_.clear();
+  for (auto fps : panel_.refresh_rates) {
+    DRMModeInfo info = {};
+    drmModeModeInfo &mode = info.mode;
+    mode.hdisplay = static_cast<uint16_t>(panel_.width);
+    mode.hsync_start = static_cast<uint16_t>(panel_.width + 40);
+    mode.hsync_end = static_cast<uint16_t>(panel_.width + 60);
+    mode.htotal = static_cast<uint16_t>(panel_.width + 120);
+    mode.vdisplay = static_cast<uint16_t>(panel_.height);
+    mode.vsync_start = static_cast<uint16_t>(panel_.height + 10);
+    mode.vsync_end = static_cast<uint16_t>(panel_.height + 12);
+    mode.vtotal = static_cast<uint16_t>(panel_.height + 40);
+    mode.vrefresh = fps;
+    mode.clock = static_cast<uint32_t>(uint64_t(mode.htotal) * mode.vtotal * fps / 1000);
+    mode.flags = flags;
+    mode.type = modes_.empty() ? DRM_MODE_TYPE_PREFERRED : 0;
+    snprintf(mode.name, sizeof(mode.name), "%ux%u@%u", panel_.width, panel_.height, fps);
+
+    info.num_roi = panel_.cmd_mode ? 1 : 0;
+    info.walign = 1;
+    info.halign = 1;
+    info.wmin = 1;
+    info.hmin = 1;
+    info.transfer_time_us = 1000000 / fps;
+    info.transfer_time_us_min = info.transfer_time_us;
+    info.transfer_time_us_max = info.transfer_time_us;
+    info.cur_panel_mode = flags;
+
+    DRMSubModeInfo sub_mode = {};
+    sub_mode.panel_mode_caps = flags;
+    sub_mode.topology = dual_lm ? DRMTopology::DUAL_LM : DRMTopology::SINGLE_LM;
+    info.sub_modes.push_back(sub_mode);
+
+    modes_.push_back(info);
+  }
+}
+
+void DRMVirtualManager::SetMode(const drmModeModeInfo &mode) {
+  if (mode.vrefresh) {
+    timeline_.SetPeriod(nanoseconds(1000000000LL / mode.vrefresh));
+  }
+}
+
+void DRMVirtualManager::BuildPlanes() {
+  std::vector<std::pair<uint32_t, uint64_t>> formats = {
+    {DRM_FORMAT_ARGB8888, 0}, {DRM_FORMAT_ABGR8888, 0}, {DRM_FORMAT_XRGB8888, 0},
+    {DRM_FORMAT_XBGR8888, 0}, {DRM_FORMAT_RGB565, 0}, {DRM_FORMAT_BGR565, 0},
+    {DRM_FORMAT_ABGR8888, DRM_FORMAT_MOD_QCOM_COMPRESSED},
+    {DRM_FORMAT_XBGR8888, DRM_FORMAT_MOD_QCOM_COMPRESSED},
+  };
+  std::vector<std::pair<uint32_t, uint64_t>> vig_formats = formats;
+  vig_formats.push_back({DRM_FORMAT_NV12, 0});
+  vig_formats.push_back({DRM_FORMAT_NV12, DRM_FORMAT_MOD_QCOM_COMPRESSED});
+
+  uint32_t id = kPlaneIdBase;
+  uint32_t count = panel_.vig_planes + panel_.dma_planes;
+  for (uint32_t i = 0; i < count; i++, id++) {
+    DRMPlaneTypeInfo plane = {};
+    bool vig = (i < panel_.vig_planes);
+    plane.type = vig ? DRMPlaneType::VIG : DRMPlaneType::DMA;
+    plane.formats_supported = vig ? vig_formats : formats;
+    plane.max_linewidth = panel_.max_linewidth;
+    plane.max_scaler_linewidth = panel_.max_linewidth;
+    plane.max_upscale = vig ? 20 : 1;
+    plane.max_downscale = vig ? 4 : 1;
+    plane.max_pipe_bandwidth = 4500000;
+    plane.max_pipe_bandwidth_high = 4500000;
+    plane.qseed3_version = QSEEDStepVersion::V3LITE_V9;
+    plane.inrot_version = InlineRotationVersion::kInlineRotationNone;
+    plane.pipe_idx = static_cast<int32_t>(i);
+    planes_.push_back(std::make_pair(id, plane));
+  }
+}
+
+void DRMVirtualManager::GetPlanesInfo(DRMPlanesInfo *info) {
+  info->insert(info->end(), planes_.begin(), planes_.end());
+}
+
+int DRMVirtualManager::CreateFbId(int buffer_fd, uint32_t width, uint32_t height,
+                                  uint32_t format, uint64_t modifier, uint32_t *fb_id) {
+  if (fcntl(buffer_fd, F_GETFD) < 0) {
+    DRM_LOGE("Invalid buffer fd %d", buffer_fd);
+    return -EBADF;
+  }
+  if (!width || !height) {
+    DRM_LOGE("Invalid framebuffer size %ux%u", width, height);
+    return -EINVAL;
+  }
+
+  bool supported = false;
+  for (auto &plane : planes_) {
+    auto &formats = plane.second.formats_supported;
+    supported |= std::find(formats.begin(), formats.end(), std::make_pair(format, modifier)) !=
+                 formats.end();
+  }
+  if (!supported) {
+    DRM_LOGE("Format 0x%x modifier 0x%" PRIx64 " is not supported by any plane", format,
+             modifier);
+    return -EINVAL;
+  }
+
+  lock_guard<mutex> lock(lock_);
+  *fb_id = next_fb_id_++;
+  fbs_[*fb_id] = {width, height, format, modifier};
+  return 0;
+}
+
+int DRMVirtualManager::RemoveFbId(uint32_t fb_id) {
+  lock_guard<mutex> lock(lock_);
+  return fbs_.erase(fb_id) ? 0 : -ENOENT;
+}
+
+int DRMVirtualManager::OpenEventFd(int *fd) {
+  if (!fd) {
+    return -EINVAL;
+  }
+
+  // Non blocking so that HandleVBlank can tell a spurious wake-up from a due vblank
+  int event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (event_fd < 0) {
+    DRM_LOGE("eventfd failed errno = %d", errno);
+    return -errno;
+  }
+
+  lock_guard<mutex> lock(lock_);
+  event_fds_.insert(event_fd);
+  *fd = event_fd;
+  return 0;
+}
+
+int DRMVirtualManager::CloseEventFd(int fd) {
+  lock_guard<mutex> lock(lock_);
+  if (!event_fds_.erase(fd)) {
+    return -ENOENT;
+  }
+
+  timeline_.CancelEvents(fd);
+  close(fd);
+  return 0;
+}
+
+int DRMVirtualManager::RequestVBlank(int fd) {
+  lock_guard<mutex> lock(lock_);
+  if (!event_fds_.count(fd)) {
+    return -ENOENT;
+  }
+
+  timeline_.SignalEvent(fd, timeline_.NextVBlank(1));
+  return 0;
+}
+
+int DRMVirtualManager::HandleVBlank(int fd, int64_t *timestamp_ns) {
+  if (!timestamp_ns) {
+    return -EINVAL;
+  }
+
+  lock_guard<mutex> lock(lock_);
+  if (!event_fds_.count(fd)) {
+    return -ENOENT;
+  }
+
+  // One read consumes every vblank signaled since the last one
+  uint64_t count = 0;
+  if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+    return -EAGAIN;
+  }
+
+  auto vblank = timeline_.GetEventTime(fd).time_since_epoch();
+  *timestamp_ns = std::chrono::duration_cast<nanoseconds>(vblank).count();
+  return 0;
+}
+
+int DRMVirtualManager::Validate(const DRMDisplayToken &token,
+                                const std::map<uint32_t, DRMVirtualPlaneState> &planes) {
+  lock_guard<mutex> lock(lock_);
+  // Blend stage of each staged pipe, two pipes may share a stage as a source split pair
+  std::map<uint32_t, uint32_t> stages;
+  for (auto &plane : planes) {
+    const DRMVirtualPlaneState &state = plane.second;
+    if (!state.crtc_id) {
+      continue;
+    }
+    if (state.crtc_id != token.crtc_id) {
+      DRM_LOGE("plane %u: staged on crtc %u, request is for crtc %u", plane.first,
+               state.crtc_id, token.crtc_id);
+      return -EINVAL;
+    }
+    int ret = ValidatePlane(plane.first, state);
+    if (ret) {
+      return ret;
+    }
+    if (++stages[state.zorder] > 2) {
+      DRM_LOGE("crtc %u: more than two pipes on blend stage %u", token.crtc_id, state.zorder);
+      return -EINVAL;
+    }
+  }
+
+  if (stages.size() > panel_.max_blend_stages) {
+    DRM_LOGE("crtc %u: %zu blend stages staged, only %u available", token.crtc_id,
+             stages.size(), panel_.max_blend_stages);
+    return -EINVAL;
+  }
+
+  return 0;
+}
+
+int DRMVirtualManager::ValidatePlane(uint32_t plane_id, const DRMVirtualPlaneState &state) {
+  auto plane = std::find_if(planes_.begin(), planes_.end(),
+                            [plane_id](const std::pair<uint32_t, DRMPlaneTypeInfo> &entry) {
+                              return entry.first == plane_id;
+                            });
+  if (plane == planes_.end()) {
+    DRM_LOGE("plane %u does not exist", plane_id);
+    return -EINVAL;
+  }
+  const DRMPlaneTypeInfo &info = plane->second;
+
+  auto fb = fbs_.find(state.fb_id);
+  if (fb == fbs_.end()) {
+    DRM_LOGE("plane %u: invalid fb_id %u", plane_id, state.fb_id);
+    return -EINVAL;
+  }
+  auto &formats = info.formats_supported;
+  if (std::find(formats.begin(), formats.end(),
+                std::make_pair(fb->second.format, fb->second.modifier)) == formats.end()) {
+    DRM_LOGE("plane %u: format 0x%x modifier 0x%" PRIx64 " not supported by this pipe type",
+             plane_id, fb->second.format, fb->second.modifier);
+    return -EINVAL;
+  }
+
+  if ((state.rotation & static_cast<uint32_t>(DRMRotation::ROT_90)) &&
+      info.inrot_version == InlineRotationVersion::kInlineRotationNone) {
+    DRM_LOGE("plane %u: no inline rotation", plane_id);
+    return -EINVAL;
+  }
+
+  uint32_t src_w = state.src.right - state.src.left;
+  uint32_t src_h = state.src.bottom - state.src.top;
+  uint32_t dst_w = state.dst.right - state.dst.left;
+  uint32_t dst_h = state.dst.bottom - state.dst.top;
+  if (!src_w || !src_h || !dst_w || !dst_h || state.src.right > fb->second.width ||
+      state.src.bottom > fb->second.height) {
+    DRM_LOGE("plane %u: invalid src %ux%u or dst %ux%u", plane_id, src_w, src_h, dst_w, dst_h);
+    return -EINVAL;
+  }
+  if (src_w > info.max_linewidth) {
+    DRM_LOGE("plane %u: src width %u exceeds max linewidth %u", plane_id, src_w,
+             info.max_linewidth);
+    return -EINVAL;
+  }
+  if (dst_w > src_w * info.max_upscale || dst_h > src_h * info.max_upscale ||
+      src_w > dst_w * info.max_downscale || src_h > dst_h * info.max_downscale) {
+    DRM_LOGE("plane %u: scaling %ux%u -> %ux%u out of range, up %u down %u", plane_id, src_w,
+             src_h, dst_w, dst_h, info.max_upscale, info.max_downscale);
+    return -EINVAL;
+  }
+
+  return 0;
+}
+
+int DRMVirtualManager::GetCrtcInfo(uint32_t crtc_id, DRMCrtcInfo *info) {
+  if (crtc_id && crtc_id != kCrtcId) {
+    return -ENODEV;
+  }
+
+  // Representative resource limits, not tied to any particular chipset.
+  *info = {};
+  info->has_src_split = true;
+  info->max_blend_stages = panel_.max_blend_stages;
+  info->max_solidfill_stages = panel_.max_blend_stages;
+  info->qseed_version = QSEEDVersion::V3LITE;
+  info->smart_dma_rev = SmartDMARevision::V2p5;
+  info->ib_fudge_factor = 1.1f;
+  info->clk_fudge_factor = 1.05f;
+  info->dest_scale_prefill_lines = 3;
+  info->undersized_prefill_lines = 2;
+  info->macrotile_prefill_lines = 8;
+  info->nv12_prefill_lines = 8;
+  info->linear_prefill_lines = 1;
+  info->downscale_prefill_lines = 1;
+  info->extra_prefill_lines = 1;
+  info->amortized_threshold = 30;
+  info->max_bandwidth_low = 15500000;
+  info->max_bandwidth_high = 15500000;
+  info->max_sde_clk = 514000000;
+  info->min_prefill_lines = 24;
+  info->num_mnocports = 2;
+  info->mnoc_bus_width = 32;
+  info->ubwc_version = 4;
+  info->dspp_count = 1;
+  return 0;
+}
+
+int DRMVirtualManager::GetConnectorInfo(uint32_t conn_id, DRMConnectorInfo *info) {
+  if (conn_id != kConnectorId) {
+    return -ENODEV;
+  }
+
+  *info = {};
+  info->mmWidth = panel_.mm_width;
+  info->mmHeight = panel_.mm_height;
+  info->type = DRM_MODE_CONNECTOR_DSI;
+  info->type_id = 1;
+  info->modes = modes_;
+  info->panel_name = panel_.name;
+  info->panel_mode = panel_.cmd_mode ? DRMPanelMode::COMMAND : DRMPanelMode::VIDEO;
+  info->is_primary = true;
+  info->dynamic_fps = !panel_.cmd_mode;
+  info->max_linewidth = panel_.max_linewidth;
+  info->is_connected = true;
+  info->max_os_brightness = 255;
+  info->max_panel_backlight = 255;
+  info->backlight_type = "virtual";
+  return 0;
+}
+
+int DRMVirtualManager::GetConnectorsInfo(DRMConnectorsInfo *info) {
+  DRMConnectorInfo conn_info = {};
+  GetConnectorInfo(kConnectorId, &conn_info);
+  (*info)[kConnectorId] = conn_info;
+  return 0;
+}
+
+int DRMVirtualManager::GetEncoderInfo(uint32_t encoder_id, DRMEncoderInfo *info) {
+  if (encoder_id != kEncoderId) {
+    return -ENODEV;
+  }
+  info->type = DRM_MODE_ENCODER_DSI;
+  return 0;
+}
+
+int DRMVirtualManager::GetEncodersInfo(DRMEncodersInfo *info) {
+  (*info)[kEncoderId].type = DRM_MODE_ENCODER_DSI;
+  return 0;
+}
+
+void DRMVirtualManager::GetCrtcPPInfo(uint32_t crtc_id, DRMPPFeatureInfo *info) {
+  // No post processing blocks are modeled
+  info->version = std::numeric_limits<uint32_t>::max();
+}
+
+void DRMVirtualManager::GetDppsFeatureInfo(DRMDppsFeatureInfo *info) {
+  info->version = std::numeric_limits<uint32_t>::max();
+}
+
+int DRMVirtualManager::RegisterDisplay(DRMDisplayType disp_type, DRMDisplayToken *token) {
+  if (disp_type != DRMDisplayType::PERIPHERAL) {
+    return -ENODEV;
+  }
+  return RegisterDisplay(static_cast<int32_t>(kConnectorId), token);
+}
+
+int DRMVirtualManager::RegisterDisplay(int32_t display_id, DRMDisplayToken *token) {
+  lock_guard<mutex> lock(lock_);
+  if (display_id != static_cast<int32_t>(kConnectorId) || display_registered_) {
+    return -ENODEV;
+  }
+
+  display_registered_ = true;
+  token->conn_id = kConnectorId;
+  token->crtc_id = kCrtcId;
+  token->crtc_index = 0;
+  token->encoder_id = kEncoderId;
+  token->hw_port = 0;
+  return 0;
+}
+
+void DRMVirtualManager::UnregisterDisplay(DRMDisplayToken *token) {
+  lock_guard<mutex> lock(lock_);
+  if (token->conn_id == kConnectorId) {
+    display_registered_ = false;
+  }
+  *token = {};
+}
+
+int DRMVirtualManager::CreateAtomicReq(const DRMDisplayToken &token,
+                                       DRMAtomicReqInterface **intf) {
+  if (token.crtc_id != kCrtcId) {
+    return -ENODEV;
+  }
+  *intf = new DRMVirtualAtomicReq(this, token);
+  return 0;
+}
+
+int DRMVirtualManager::DestroyAtomicReq(DRMAtomicReqInterface *intf) {
+  delete intf;
+  return 0;
+}
+
+int DRMVirtualManager::Commit(const DRMDisplayToken &token, bool synchronous, uint32_t num_ops,
+                              vector<int64_t *> *release_fences,
+                              vector<int64_t *> *retire_fences) {
+  // The frame latches at the next vblank, which retires it and releases the previous frame's
+  // buffers, same as the fences a video mode panel gets from the driver.
+  auto vblank = timeline_.NextVBlank(1);
+  for (auto fence : *release_fences) {
+    *fence = timeline_.CreateFence(vblank);
+  }
+  for (auto fence : *retire_fences) {
+    *fence = timeline_.CreateFence(vblank);
+  }
+
+  {
+    lock_guard<mutex> lock(lock_);
+    frame_count_++;
+    op_count_ += num_ops;
+  }
+
+  if (synchronous) {
+    std::this_thread::sleep_until(vblank);
+  }
+
+  return 0;
+}
+
+}  // namespace sde_drm
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __DRM_VIRTUAL_MANAGER_H__
+#define __DRM_VIRTUAL_MANAGER_H__
+
+#include <drm_interface.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sde_drm {
+
+// Panel and pipeline description for the virtual backend. Loaded from the JSON file named by
+// SDE_DRM_VIRTUAL_PANEL, any key that is absent keeps the default below. Example:
+//   { "name": "virtual_dsi", "width": 1080, "height": 2400, "mm_width": 68, "mm_height": 151,
+//     "mode": "command", "refresh_rates": [60, 90, 120], "vig_planes": 4, "dma_planes": 4,
+//     "max_blend_stages": 11, "max_linewidth": 2560 }
+struct DRMVirtualPanel {
+  std::string name = "virtual_dsi";
+  uint32_t width = 1080;
+  uint32_t height = 2400;
+  uint32_t mm_width = 68;
+  uint32_t mm_height = 151;
+  bool cmd_mode = false;
+  std::vector<uint32_t> refresh_rates = {60};
+  uint32_t vig_planes = 4;
+  uint32_t dma_planes = 4;
+  uint32_t max_blend_stages = 11;
+  uint32_t max_linewidth = 2560;
+
+  int Load(const std::string &path);
+};
+
+// Software vblank clock. Signals eventfd backed fences and vblank events at the vblank they are
+// due.
+class DRMVirtualTimeline {
+ public:
+  DRMVirtualTimeline();
+  ~DRMVirtualTimeline();
+  void SetPeriod(std::chrono::nanoseconds period);
+  // Returns the n-th vblank after now, n >= 1
+  std::chrono::steady_clock::time_point NextVBlank(uint32_t n);
+  // Returns a new fence fd owned by the caller, signaled at deadline
+  int CreateFence(std::chrono::steady_clock::time_point deadline);
+  // Signals the eventfd at deadline and records deadline as its latest vblank, fd stays open
+  void SignalEvent(int fd, std::chrono::steady_clock::time_point deadline);
+  // Returns the latest vblank signaled on fd
+  std::chrono::steady_clock::time_point GetEventTime(int fd);
+  // Drops the events still due on fd and its vblank time, before fd is closed
+  void CancelEvents(int fd);
+
+ private:
+  struct Signal {
+    int fd;
+    bool is_fence;  // Closed once signaled
+  };
+
+  void Run();
+
+  std::mutex lock_;
+  std::condition_variable cv_;
+  bool exit_ = false;
+  std::chrono::steady_clock::time_point epoch_ = {};
+  std::chrono::nanoseconds period_ = std::chrono::nanoseconds(16666667);
+  std::multimap<std::chrono::steady_clock::time_point, Signal> pending_ = {};
+  std::map<int, std::chrono::steady_clock::time_point> event_times_ = {};
+  std::thread thread_;
+};
+
+class DRMVirtualManager;
+
+// Plane state staged in one atomic request
+struct DRMVirtualPlaneState {
+  uint32_t crtc_id = 0;
+  uint32_t fb_id = 0;
+  uint32_t zorder = 0;
+  uint32_t rotation = 0;
+  DRMRect src = {};
+  DRMRect dst = {};
+};
+
+class DRMVirtualAtomicReq : public DRMAtomicReqInterface {
+ public:
+  DRMVirtualAtomicReq(DRMVirtualManager *mgr, const DRMDisplayToken &token)
+      : mgr_(mgr), token_(token) {}
+  virtual int Perform(DRMOps opcode, uint32_t obj_id, ...);
+  virtual int Commit(bool synchronous, bool retain_planes);
+  virtual int Validate();
+
+ private:
+  void Reset();
+
+  DRMVirtualManager *mgr_ = nullptr;
+  DRMDisplayToken token_ = {};
+  std::vector<int64_t *> release_fences_ = {};
+  std::vector<int64_t *> retire_fences_ = {};
+  std::map<uint32_t, DRMVirtualPlaneState> planes_ = {};
+  uint32_t num_ops_ = 0;
+};
+
+// In-process DRMManagerInterface that models one DSI pipeline in software, so that the
+// HWInfoDRM and HWDeviceDRM atomic path can be driven and profiled on a host without display
+// hardware. Atomic requests are checked against the plane and CRTC limits and counted rather
+// than programmed, fences are eventfds signaled on a software vblank clock derived from the
+// active mode. Framebuffer ids are handed out here too, DRMMaster routes to CreateFbId and
+// RemoveFbId when this backend is loaded. HWEventsDRM polls the event fds opened here for
+// vsync in place of a DRM node. Driver events, e.g. idle power collapse or panel dead, are never
+// raised.
+class DRMVirtualManager : public DRMManagerInterface {
+ public:
+  static DRMVirtualManager *GetInstance();
+  static void Destroy();
+
+  int CreateFbId(int buffer_fd, uint32_t width, uint32_t height, uint32_t format,
+                 uint64_t modifier, uint32_t *fb_id);
+  int RemoveFbId(uint32_t fb_id);
+  int OpenEventFd(int *fd);
+  int CloseEventFd(int fd);
+  int RequestVBlank(int fd);
+  int HandleVBlank(int fd, int64_t *timestamp_ns);
+
+  virtual ~DRMVirtualManager();
+  virtual void GetPlanesInfo(DRMPlanesInfo *info);
+  virtual int GetCrtcInfo(uint32_t crtc_id, DRMCrtcInfo *info);
+  virtual int GetConnectorInfo(uint32_t conn_id, DRMConnectorInfo *info);
+  virtual int GetConnectorsInfo(DRMConnectorsInfo *info);
+  virtual int GetEncoderInfo(uint32_t encoder_id, DRMEncoderInfo *info);
+  virtual int GetEncodersInfo(DRMEncodersInfo *info);
+  virtual void GetCrtcPPInfo(uint32_t crtc_id, DRMPPFeatureInfo *info);
+  virtual int RegisterDisplay(DRMDisplayType disp_type, DRMDisplayToken *tok);
+  virtual int RegisterDisplay(int32_t display_id, DRMDisplayToken *token);
+  virtual void UnregisterDisplay(DRMDisplayToken *token);
+  virtual int CreateAtomicReq(const DRMDisplayToken &token, DRMAtomicReqInterface **intf);
+  virtual int DestroyAtomicReq(DRMAtomicReqInterface *intf);
+  virtual int SetScalerLUT(const DRMScalerLUTInfo &lut_info) { return 0; }
+  virtual int UnsetScalerLUT() { return 0; }
+  virtual void GetDppsFeatureInfo(DRMDppsFeatureInfo *info);
+  virtual void GetPanelFeature(DRMPanelFeatureInfo *info) {}
+  virtual void SetPanelFeature(const DRMPanelFeatureInfo &info) {}
+  virtual void MarkPanelFeatureForNullCommit(const DRMDisplayToken &token,
+                                             const DRMPanelFeatureID &id) {}
+  virtual void MapPlaneToConnector(std::map<uint32_t, uint32_t> *plane_to_connector) {}
+  virtual void GetRequiredDemuraFetchResourceCount(std::map<uint32_t, uint8_t>
+                                                   *required_demura_fetch_cnt) {}
+  virtual void GetInitialDemuraInfo(std::vector<uint32_t> *initial_demura_planes) {}
+  virtual uint32_t GetCrtcCount() { return 1; }
+
+ private:
+  friend class DRMVirtualAtomicReq;
+
+  static const uint32_t kCrtcId = 100;
+  static const uint32_t kConnectorId = 200;
+  static const uint32_t kEncoderId = 300;
+  static const uint32_t kPlaneIdBase = 400;
+
+  struct FbInfo {
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint64_t modifier;
+  };
+
+  DRMVirtualManager();
+  void BuildModes();
+  void BuildPlanes();
+  void SetMode(const drmModeModeInfo &mode);
+  int Validate(const DRMDisplayToken &token,
+               const std::map<uint32_t, DRMVirtualPlaneState> &planes);
+  int ValidatePlane(uint32_t plane_id, const DRMVirtualPlaneState &state);
+  int Commit(const DRMDisplayToken &token, bool synchronous, uint32_t num_ops,
+             std::vector<int64_t *> *release_fences, std::vector<int64_t *> *retire_fences);
+
+  std::mutex lock_;
+  DRMVirtualPanel panel_ = {};
+  std::vector<DRMModeInfo> modes_ = {};
+  DRMPlanesInfo planes_ = {};
+  std::map<uint32_t, FbInfo> fbs_ = {};
+  uint32_t next_fb_id_ = 1;
+  std::set<int> event_fds_ = {};
+  DRMVirtualTimeline timeline_;
+  bool display_registered_ = false;
+  uint64_t frame_count_ = 0;
+  uint64_t op_count_ = 0;
+
+  static DRMVirtualManager *s_instance;
+  static std::mutex s_lock;
+};
+
+}  // namespace sde_drm
+
+#endif  // __DRM_VIRTUAL_MANAGER_H__
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <gtest/gtest.h>
+#include <stdarg.h>
+
+#include <memory>
+#include <vector>
+
+#include "../drm_connector.h"
+#include "fake_libdrm.h"
+
+using namespace sde_drm;
+using namespace testing;
+
+namespace {
+
+const uint32_t kConnId = 31;
+
+class DRMConnectorTest : public Test {
+ protected:
+  void SetUp() override {
+    fake_drm::Reset();
+    fake_drm::AddConnector(kConnId, DRM_MODE_CONNECTOR_DSI);
+    crtc_prop_ = fake_drm::AddProperty(kConnId, "CRTC_ID");
+    lp_prop_ = fake_drm::AddProperty(kConnId, "LP", {"ON", "LP1", "LP2", "OFF"});
+    autorefresh_prop_ = fake_drm::AddProperty(kConnId, "autorefresh");
+    for (const char *name : {"DST_X", "DST_Y", "DST_W", "DST_H"}) {
+      fake_drm::AddProperty(kConnId, name);
+    }
+
+    uint32_t connectors[] = {kConnId};
+    drmModeRes res = {};
+    res.count_connectors = 1;
+    res.connectors = connectors;
+    mgr_.reset(new DRMConnectorManager(-1));
+    mgr_->Init(&res);
+  }
+
+  void TearDown() override {
+    mgr_.reset();
+    drmModeAtomicFree(req_);
+  }
+
+  void Perform(DRMOps code, ...) {
+    va_list args;
+    va_start(args, code);
+    mgr_->Perform(code, kConnId, req_, args);
+    va_end(args);
+  }
+
+  // Sets up one frame's connector state and returns the properties it added to a fresh request.
+  std::vector<fake_drm::AtomicProperty> Frame(uint32_t crtc, DRMPowerMode power,
+                                              uint32_t autorefresh) {
+    drmModeAtomicFree(req_);
+    req_ = drmModeAtomicAlloc();
+    DRMRect rect = {0, 0, 1080, 2400};
+    Perform(DRMOps::CONNECTOR_SET_CRTC, crtc);
+    Perform(DRMOps::CONNECTOR_SET_POWER_MODE, static_cast<int>(power));
+    Perform(DRMOps::CONNECTOR_SET_AUTOREFRESH, autorefresh);
+    Perform(DRMOps::CONNECTOR_SET_OUTPUT_RECT, rect);
+    return fake_drm::GetRequest(req_);
+  }
+
+  std::unique_ptr<DRMConnectorManager> mgr_;
+  drmModeAtomicReq *req_ = nullptr;
+  uint32_t crtc_prop_ = 0;
+  uint32_t lp_prop_ = 0;
+  uint32_t autorefresh_prop_ = 0;
+};
+
+}  // namespace
+
+TEST_F(DRMConnectorTest, CommittedValuesAreNotResent) {
+  EXPECT_EQ(7u, Frame(100, DRMPowerMode::ON, 0).size());
+  mgr_->PostCommit(kConnId, true);
+
+  EXPECT_TRUE(Frame(100, DRMPowerMode::ON, 0).empty());
+  mgr_->PostCommit(kConnId, true);
+
+  auto props = Frame(100, DRMPowerMode::ON, 1);
+  ASSERT_EQ(1u, props.size());
+  EXPECT_EQ(kConnId, props[0].obj_id);
+  EXPECT_EQ(autorefresh_prop_, props[0].prop_id);
+  EXPECT_EQ(1u, props[0].value);
+}
+
+TEST_F(DRMConnectorTest, FailedCommitRollsBack) {
+  Frame(100, DRMPowerMode::ON, 0);
+  mgr_->PostCommit(kConnId, true);
+
+  auto props = Frame(100, DRMPowerMode::OFF, 0);
+  ASSERT_EQ(1u, props.size());
+  EXPECT_EQ(lp_prop_, props[0].prop_id);
+  mgr_->PostCommit(kConnId, false);
+
+  // The kernel never saw OFF, so it has to be sent again.
+  props = Frame(100, DRMPowerMode::OFF, 0);
+  ASSERT_EQ(1u, props.size());
+  EXPECT_EQ(lp_prop_, props[0].prop_id);
+  EXPECT_EQ(3u, props[0].value);
+}
+
+TEST_F(DRMConnectorTest, ValidateDoesNotPromote) {
+  Frame(100, DRMPowerMode::ON, 0);
+  mgr_->PostCommit(kConnId, true);
+
+  EXPECT_EQ(1u, Frame(200, DRMPowerMode::ON, 0).size());
+  mgr_->PostValidate(kConnId, true);
+
+  auto props = Frame(200, DRMPowerMode::ON, 0);
+  ASSERT_EQ(1u, props.size());
+  EXPECT_EQ(crtc_prop_, props[0].prop_id);
+  EXPECT_EQ(200u, props[0].value);
+}
+
+TEST_F(DRMConnectorTest, ResetCacheResendsEverything) {
+  Frame(100, DRMPowerMode::ON, 0);
+  mgr_->PostCommit(kConnId, true);
+
+  drmModeAtomicFree(req_);
+  req_ = drmModeAtomicAlloc();
+  Perform(DRMOps::CONNECTOR_RESET_CACHE);
+  EXPECT_TRUE(fake_drm::GetRequest(req_).empty());
+
+  EXPECT_EQ(7u, Frame(100, DRMPowerMode::ON, 0).size());
+}
+
+TEST_F(DRMConnectorTest, FreedConnectorStartsClean) {
+  DRMDisplayToken token = {};
+  ASSERT_EQ(0, mgr_->Reserve(kConnId, &token));
+  Frame(100, DRMPowerMode::ON, 0);
+  mgr_->PostCommit(kConnId, true);
+  mgr_->Free(&token);
+
+  ASSERT_EQ(0, mgr_->Reserve(kConnId, &token));
+  EXPECT_EQ(7u, Frame(100, DRMPowerMode::ON, 0).size());
+  mgr_->Free(&token);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "../drm_pp_manager.h"
+#include "fake_libdrm.h"
+
+using namespace sde_drm;
+using namespace testing;
+
+namespace {
+
+const uint32_t kCrtcId = 140;
+
+// One colour mode's tables, sized like the DSPP payloads QDCM sends.
+struct ColorMode {
+  std::vector<uint8_t> gamut = std::vector<uint8_t>(17 * 17 * 17 * 3 * 4);
+  std::vector<uint8_t> igc = std::vector<uint8_t>(3 * 256 * 4);
+  std::vector<uint8_t> pgc = std::vector<uint8_t>(3 * 512 * 4);
+  std::vector<uint8_t> pcc = std::vector<uint8_t>(216);
+
+  explicit ColorMode(uint8_t seed) {
+    for (auto *table : {&gamut, &igc, &pgc, &pcc}) {
+      for (size_t i = 0; i < table->size(); i++) {
+        (*table)[i] = static_cast<uint8_t>(i * 7 + seed);
+      }
+    }
+  }
+};
+
+class DRMPPManagerTest : public Test {
+ protected:
+  void SetUp() override {
+    fake_drm::Reset();
+    DRMPropertyManager pm;
+    pm.SetPropertyId(DRMProperty::SDE_DSPP_GAMUT_V5, 1);
+    pm.SetPropertyId(DRMProperty::SDE_DSPP_IGC_V4, 2);
+    pm.SetPropertyId(DRMProperty::SDE_DSPP_GC_V2, 3);
+    pm.SetPropertyId(DRMProperty::SDE_DSPP_PCC_V5, 4);
+    pp_mgr_.reset(new DRMPPManager(-1));
+    pp_mgr_->Init(pm, DRM_MODE_OBJECT_CRTC);
+    req_ = drmModeAtomicAlloc();
+  }
+
+  void TearDown() override {
+    pp_mgr_.reset();
+    EXPECT_TRUE(fake_drm::GetBlobs().empty());
+    drmModeAtomicFree(req_);
+  }
+
+  // Returns the blob id the request was given for the feature.
+  uint32_t Set(DRMPPFeatureID id, std::vector<uint8_t> *payload) {
+    DRMPPFeatureInfo feature = {};
+    feature.id = id;
+    feature.type = kPropBlob;
+    feature.payload = payload ? payload->data() : nullptr;
+    feature.payload_size = payload ? static_cast<uint32_t>(payload->size()) : 0;
+    pp_mgr_->SetPPFeature(req_, kCrtcId, feature);
+    return static_cast<uint32_t>(fake_drm::GetRequest(req_).back().value);
+  }
+
+  void SetMode(ColorMode *mode) {
+    Set(kFeatureGamut, &mode->gamut);
+    Set(kFeatureIgc, &mode->igc);
+    Set(kFeaturePgc, &mode->pgc);
+    Set(kFeaturePcc, &mode->pcc);
+  }
+
+  std::unique_ptr<DRMPPManager> pp_mgr_;
+  drmModeAtomicReq *req_ = nullptr;
+};
+
+}  // namespace
+
+TEST_F(DRMPPManagerTest, IdenticalPayloadReusesBlob) {
+  ColorMode mode(1);
+  uint32_t blob_id = Set(kFeaturePcc, &mode.pcc);
+  EXPECT_NE(0u, blob_id);
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(blob_id, Set(kFeaturePcc, &mode.pcc));
+  }
+  EXPECT_EQ(1u, fake_drm::GetBlobCreates());
+  EXPECT_EQ(0u, fake_drm::GetBlobDestroys());
+  EXPECT_EQ(mode.pcc, fake_drm::GetBlobs().at(blob_id));
+}
+
+TEST_F(DRMPPManagerTest, SameSizeDifferentContent) {
+  ColorMode first(1), second(2);
+  EXPECT_NE(Set(kFeaturePcc, &first.pcc), Set(kFeaturePcc, &second.pcc));
+  EXPECT_EQ(2u, fake_drm::GetBlobCreates());
+}
+
+TEST_F(DRMPPManagerTest, ColorModeToggleKeepsBlobs) {
+  ColorMode srgb(1), p3(2);
+  for (int i = 0; i < 10; i++) {
+    SetMode(i % 2 ? &p3 : &srgb);
+  }
+  EXPECT_EQ(8u, fake_drm::GetBlobCreates());
+  EXPECT_EQ(0u, fake_drm::GetBlobDestroys());
+}
+
+TEST_F(DRMPPManagerTest, DisableAddsNullBlob) {
+  ColorMode mode(1);
+  Set(kFeaturePcc, &mode.pcc);
+  EXPECT_EQ(0u, Set(kFeaturePcc, nullptr));
+  EXPECT_EQ(1u, fake_drm::GetBlobCreates());
+}
+
+TEST_F(DRMPPManagerTest, IdleBlobsAreBounded) {
+  std::vector<uint32_t> blob_ids;
+  for (uint8_t seed = 0; seed < 30; seed++) {
+    ColorMode mode(seed);
+    blob_ids.push_back(Set(kFeaturePcc, &mode.pcc));
+  }
+
+  EXPECT_EQ(30u, fake_drm::GetBlobCreates());
+  EXPECT_EQ(size_t(NUM_CACHED_BLOB_ID + NUM_IDLE_BLOB_ID), fake_drm::GetBlobs().size());
+  EXPECT_EQ(fake_drm::GetBlobCreates() - fake_drm::GetBlobDestroys(),
+            fake_drm::GetBlobs().size());
+  // The ring slots still reference the last blobs set.
+  for (size_t i = blob_ids.size() - NUM_CACHED_BLOB_ID; i < blob_ids.size(); i++) {
+    EXPECT_EQ(1u, fake_drm::GetBlobs().count(blob_ids[i]));
+  }
+}
+
+TEST_F(DRMPPManagerTest, ColorModeToggleBenchmark) {
+  const int kToggles = 2000;
+  ColorMode srgb(1), p3(2);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kToggles; i++) {
+    SetMode(i % 2 ? &p3 : &srgb);
+    drmModeAtomicFree(req_);
+    req_ = drmModeAtomicAlloc();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double us = std::chrono::duration<double, std::micro>(end - start).count() / kToggles;
+  // Recreating the blob on every set costs one create and one destroy per feature per toggle.
+  printf("colour mode toggle x%d, 4 features: %u creates, %u destroys (recreate per set: %d, %d)"
+         ", %.2f us per toggle\n", kToggles, fake_drm::GetBlobCreates(),
+         fake_drm::GetBlobDestroys(), 4 * kToggles, 4 * kToggles - 8, us);
+  EXPECT_EQ(8u, fake_drm::GetBlobCreates());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <drm/drm_fourcc.h>
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../drm_virtual_manager.h"
+
+using namespace sde_drm;
+using namespace testing;
+
+// Exported for DRMMaster, see DRMLibLoader
+extern "C" {
+int CreateDRMFbId(int buffer_fd, uint32_t width, uint32_t height, uint32_t format,
+                  uint64_t modifier, uint32_t *fb_id);
+int RemoveDRMFbId(uint32_t fb_id);
+int OpenDRMEventFd(int *fd);
+int CloseDRMEventFd(int fd);
+int RequestDRMVBlank(int fd);
+int HandleDRMVBlank(int fd, int64_t *timestamp_ns);
+}
+
+namespace {
+
+const char *kPanel =
+    "{ \"name\": \"test_panel\", \"width\": 1080, \"height\": 2400, \"mode\": \"video\",\n"
+    "  \"refresh_rates\": [120, 60], \"vig_planes\": 2, \"dma_planes\": 2,\n"
+    "  \"max_blend_stages\": 3, \"max_linewidth\": 2048 }\n";
+
+class DRMVirtualManagerTest : public Test {
+ protected:
+  void SetUp() override {
+    char path[] = "/tmp/drm_virtual_panel_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ssize_t(strlen(kPanel)), write(fd, kPanel, strlen(kPanel)));
+    close(fd);
+    setenv("SDE_DRM_VIRTUAL_PANEL", path, 1);
+    mgr_ = DRMVirtualManager::GetInstance();
+    unlink(path);
+
+    DRMPlanesInfo planes;
+    mgr_->GetPlanesInfo(&planes);
+    for (auto &plane : planes) {
+      (plane.second.type == DRMPlaneType::VIG ? vig_ : dma_).push_back(plane.first);
+    }
+    ASSERT_EQ(0, mgr_->RegisterDisplay(DRMDisplayType::PERIPHERAL, &token_));
+    ASSERT_EQ(0, mgr_->CreateAtomicReq(token_, &req_));
+    buffer_fd_ = memfd_create("drm_virtual_manager_test", MFD_CLOEXEC);
+  }
+
+  void TearDown() override {
+    mgr_->DestroyAtomicReq(req_);
+    mgr_->UnregisterDisplay(&token_);
+    DRMVirtualManager::Destroy();
+    unsetenv("SDE_DRM_VIRTUAL_PANEL");
+    close(buffer_fd_);
+  }
+
+  uint32_t CreateFb(uint32_t width, uint32_t height, uint32_t format = DRM_FORMAT_ABGR8888) {
+    uint32_t fb_id = 0;
+    EXPECT_EQ(0, mgr_->CreateFbId(buffer_fd_, width, height, format, 0, &fb_id));
+    return fb_id;
+  }
+
+  void Stage(uint32_t plane_id, uint32_t fb_id, DRMRect src, DRMRect dst, uint32_t zorder,
+             uint32_t crtc_id = 0) {
+    req_->Perform(DRMOps::PLANE_SET_CRTC, plane_id, crtc_id ? crtc_id : token_.crtc_id);
+    req_->Perform(DRMOps::PLANE_SET_FB_ID, plane_id, fb_id);
+    req_->Perform(DRMOps::PLANE_SET_SRC_RECT, plane_id, src);
+    req_->Perform(DRMOps::PLANE_SET_DST_RECT, plane_id, dst);
+    req_->Perform(DRMOps::PLANE_SET_ZORDER, plane_id, zorder);
+  }
+
+  // Stages a single plane showing src of a full screen buffer at dst and validates it
+  int ValidateOne(uint32_t plane_id, DRMRect src, DRMRect dst,
+                  uint32_t format = DRM_FORMAT_ABGR8888) {
+    Stage(plane_id, CreateFb(1080, 2400, format), src, dst, 0);
+    return req_->Validate();
+  }
+
+  DRMVirtualManager *mgr_ = nullptr;
+  DRMDisplayToken token_ = {};
+  DRMAtomicReqInterface *req_ = nullptr;
+  std::vector<uint32_t> vig_;
+  std::vector<uint32_t> dma_;
+  int buffer_fd_ = -1;
+};
+
+const DRMRect kFull = {0, 0, 1080, 2400};
+
+}  // namespace
+
+TEST_F(DRMVirtualManagerTest, PanelDescription) {
+  DRMConnectorInfo conn_info = {};
+  ASSERT_EQ(0, mgr_->GetConnectorInfo(token_.conn_id, &conn_info));
+  EXPECT_EQ("test_panel", conn_info.panel_name);
+  ASSERT_EQ(2u, conn_info.modes.size());
+  EXPECT_EQ(120u, conn_info.modes[0].mode.vrefresh);
+  EXPECT_EQ(1080, conn_info.modes[1].mode.hdisplay);
+  EXPECT_EQ(DRMPanelMode::VIDEO, conn_info.panel_mode);
+
+  EXPECT_EQ(2u, vig_.size());
+  EXPECT_EQ(2u, dma_.size());
+  DRMCrtcInfo crtc_info = {};
+  ASSERT_EQ(0, mgr_->GetCrtcInfo(token_.crtc_id, &crtc_info));
+  EXPECT_EQ(3u, crtc_info.max_blend_stages);
+
+  DRMDisplayToken second = {};
+  EXPECT_EQ(-ENODEV, mgr_->RegisterDisplay(DRMDisplayType::PERIPHERAL, &second));
+}
+
+TEST_F(DRMVirtualManagerTest, FbIds) {
+  uint32_t fb_id = 0;
+  EXPECT_EQ(-EBADF, ::CreateDRMFbId(-1, 1080, 2400, DRM_FORMAT_ABGR8888, 0, &fb_id));
+  EXPECT_EQ(-EINVAL, ::CreateDRMFbId(buffer_fd_, 0, 2400, DRM_FORMAT_ABGR8888, 0, &fb_id));
+  EXPECT_EQ(-EINVAL, ::CreateDRMFbId(buffer_fd_, 1080, 2400, DRM_FORMAT_NV12,
+                                   DRM_FORMAT_MOD_QCOM_COMPRESSED + 1, &fb_id));
+
+  fb_id = CreateFb(1080, 2400);
+  EXPECT_NE(0u, fb_id);
+  EXPECT_NE(fb_id, CreateFb(1080, 2400));
+  EXPECT_EQ(0, ::RemoveDRMFbId(fb_id));
+  EXPECT_EQ(-ENOENT, ::RemoveDRMFbId(fb_id));
+
+  // A removed framebuffer cannot be scanned out
+  Stage(vig_[0], fb_id, kFull, kFull, 0);
+  EXPECT_EQ(-EINVAL, req_->Validate());
+}
+
+TEST_F(DRMVirtualManagerTest, ValidFrame) {
+  uint32_t fb_id = CreateFb(1080, 2400);
+  Stage(vig_[0], fb_id, kFull, kFull, 0);
+  Stage(dma_[0], CreateFb(1080, 100), {0, 0, 1080, 100}, {0, 0, 1080, 100}, 1);
+  EXPECT_EQ(0, req_->Validate());
+  // Nothing carries over from a validated request
+  EXPECT_EQ(0, req_->Validate());
+}
+
+TEST_F(DRMVirtualManagerTest, PipeTypeLimits) {
+  // YUV is only fetched by VIG pipes
+  EXPECT_EQ(0, ValidateOne(vig_[0], kFull, kFull, DRM_FORMAT_NV12));
+  EXPECT_EQ(-EINVAL, ValidateOne(dma_[0], kFull, kFull, DRM_FORMAT_NV12));
+
+  // DMA pipes have no scaler, VIG pipes downscale up to 4x and upscale up to 20x
+  DRMRect half = {0, 0, 540, 1200};
+  EXPECT_EQ(-EINVAL, ValidateOne(dma_[0], kFull, half));
+  EXPECT_EQ(0, ValidateOne(vig_[0], kFull, half));
+  EXPECT_EQ(-EINVAL, ValidateOne(vig_[0], kFull, {0, 0, 200, 400}));
+  EXPECT_EQ(0, ValidateOne(vig_[0], {0, 0, 100, 200}, kFull));
+  EXPECT_EQ(-EINVAL, ValidateOne(vig_[0], {0, 0, 50, 100}, kFull));
+
+  // Source wider than the pipe line buffer, and a source outside the buffer
+  DRMRect wide = {0, 0, 2100, 1000};
+  Stage(vig_[0], CreateFb(2400, 1000), wide, {0, 0, 1080, 1000}, 0);
+  EXPECT_EQ(-EINVAL, req_->Validate());
+  EXPECT_EQ(-EINVAL, ValidateOne(vig_[0], {0, 0, 1080, 2401}, kFull));
+
+  // No inline rotation
+  req_->Perform(DRMOps::PLANE_SET_ROTATION, vig_[0], static_cast<uint32_t>(DRMRotation::ROT_90));
+  EXPECT_EQ(-EINVAL, ValidateOne(vig_[0], kFull, kFull));
+}
+
+TEST_F(DRMVirtualManagerTest, CrtcLimits) {
+  uint32_t fb_id = CreateFb(1080, 2400);
+
+  // Planes must be staged on the request's own crtc, and must exist
+  Stage(vig_[0], fb_id, kFull, kFull, 0, token_.crtc_id + 1);
+  EXPECT_EQ(-EINVAL, req_->Validate());
+  Stage(dma_.back() + 1, fb_id, kFull, kFull, 0);
+  EXPECT_EQ(-EINVAL, req_->Validate());
+  // An unset plane is ignored
+  req_->Perform(DRMOps::PLANE_SET_CRTC, vig_[0], 0);
+  EXPECT_EQ(0, req_->Validate());
+
+  // Two pipes per blend stage as a source split pair, at most max_blend_stages stages
+  DRMRect left = {0, 0, 540, 2400}, right = {540, 0, 1080, 2400};
+  Stage(vig_[0], fb_id, left, left, 0);
+  Stage(vig_[1], fb_id, right, right, 0);
+  Stage(dma_[0], fb_id, kFull, kFull, 1);
+  EXPECT_EQ(0, req_->Validate());
+
+  Stage(vig_[0], fb_id, left, left, 0);
+  Stage(vig_[1], fb_id, right, right, 0);
+  Stage(dma_[0], fb_id, kFull, kFull, 0);
+  EXPECT_EQ(-EINVAL, req_->Validate());
+
+  for (size_t i = 0; i < 4; i++) {
+    Stage(i < 2 ? vig_[i] : dma_[i - 2], fb_id, kFull, kFull, static_cast<uint32_t>(i));
+  }
+  EXPECT_EQ(-EINVAL, req_->Validate());
+}
+
+TEST_F(DRMVirtualManagerTest, CommitSignalsAtVBlank) {
+  Stage(vig_[0], CreateFb(1080, 2400), kFull, kFull, 0);
+  int64_t release_fence = -1, retire_fence = -1;
+  req_->Perform(DRMOps::CRTC_GET_RELEASE_FENCE, token_.crtc_id, &release_fence);
+  req_->Perform(DRMOps::CONNECTOR_GET_RETIRE_FENCE, token_.conn_id, &retire_fence);
+
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(0, req_->Commit(false, false));
+  ASSERT_GE(release_fence, 0);
+  ASSERT_GE(retire_fence, 0);
+
+  for (int64_t fence : {release_fence, retire_fence}) {
+    struct pollfd pfd = {static_cast<int>(fence), POLLIN, 0};
+    EXPECT_EQ(1, poll(&pfd, 1, 1000));
+    close(static_cast<int>(fence));
+  }
+  // 120 Hz is the preferred mode, the frame latches at the next vblank
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(elapsed, std::chrono::milliseconds(50));
+
+  // A request that does not validate is rejected and gets no fences
+  Stage(dma_[0], CreateFb(1080, 2400, DRM_FORMAT_NV12), kFull, kFull, 0);
+  release_fence = -1;
+  req_->Perform(DRMOps::CRTC_GET_RELEASE_FENCE, token_.crtc_id, &release_fence);
+  EXPECT_EQ(-EINVAL, req_->Commit(false, false));
+  EXPECT_EQ(-1, release_fence);
+}
+
+TEST_F(DRMVirtualManagerTest, VBlankEvents) {
+  int fd = -1;
+  ASSERT_EQ(0, ::OpenDRMEventFd(&fd));
+  ASSERT_GE(fd, 0);
+  int64_t timestamp = 0;
+  EXPECT_EQ(-EAGAIN, ::HandleDRMVBlank(fd, &timestamp));
+
+  // One event per request, stamped with the vblank it fired at, as HWEventsDRM re-arms vsync
+  int64_t last = 0;
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(0, ::RequestDRMVBlank(fd));
+    struct pollfd pfd = {fd, POLLIN, 0};
+    ASSERT_EQ(1, poll(&pfd, 1, 1000));
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    ASSERT_EQ(0, ::HandleDRMVBlank(fd, &timestamp));
+    EXPECT_LE(timestamp, std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    // 120 Hz is the preferred mode, consecutive events are at least one period apart
+    EXPECT_GE(timestamp - last, 8000000);
+    last = timestamp;
+    EXPECT_EQ(-EAGAIN, ::HandleDRMVBlank(fd, &timestamp));
+  }
+
+  // A closed fd gets no more events
+  ASSERT_EQ(0, ::RequestDRMVBlank(fd));
+  EXPECT_EQ(0, ::CloseDRMEventFd(fd));
+  EXPECT_EQ(-ENOENT, ::RequestDRMVBlank(fd));
+  EXPECT_EQ(-ENOENT, ::CloseDRMEventFd(fd));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "fake_libdrm.h"
+
+using fake_drm::AtomicProperty;
+
+struct _drmModeAtomicReq {
+  std::vector<AtomicProperty> props;
+};
+
+namespace fake_drm {
+
+namespace {
+
+struct Property {
+  uint32_t obj_id;
+  std::string name;
+  std::vector<std::string> enums;
+};
+
+struct State {
+  std::map<uint32_t, Property> props;
+  std::map<uint32_t, uint32_t> connectors;
+  std::map<uint32_t, std::vector<uint8_t>> blobs;
+  uint32_t next_prop_id = 1;
+  uint32_t next_blob_id = 1;
+  uint32_t blob_creates = 0;
+  uint32_t blob_destroys = 0;
+};
+
+State &GetState() {
+  static State state;
+  return state;
+}
+
+}  // namespace
+
+uint32_t AddProperty(uint32_t obj_id, const std::string &name,
+                     const std::vector<std::string> &enums) {
+  State &state = GetState();
+  uint32_t prop_id = state.next_prop_id++;
+  state.props[prop_id] = {obj_id, name, enums};
+  return prop_id;
+}
+
+void AddConnector(uint32_t conn_id, uint32_t conn_type) {
+  GetState().connectors[conn_id] = conn_type;
+}
+
+const std::vector<AtomicProperty> &GetRequest(drmModeAtomicReq *req) {
+  return req->props;
+}
+
+const std::map<uint32_t, std::vector<uint8_t>> &GetBlobs() {
+  return GetState().blobs;
+}
+
+uint32_t GetBlobCreates() {
+  return GetState().blob_creates;
+}
+
+uint32_t GetBlobDestroys() {
+  return GetState().blob_destroys;
+}
+
+void Reset() {
+  GetState() = State();
+}
+
+}  // namespace fake_drm
+
+using fake_drm::GetState;
+
+extern "C" {
+
+drmModeResPtr drmModeGetResources(int fd) {
+  fake_drm::State &state = GetState();
+  drmModeResPtr res = reinterpret_cast<drmModeResPtr>(calloc(1, sizeof(*res)));
+  res->count_connectors = static_cast<int>(state.connectors.size());
+  res->connectors = reinterpret_cast<uint32_t *>(calloc(state.connectors.size() + 1,
+                                                        sizeof(uint32_t)));
+  int i = 0;
+  for (auto &conn : state.connectors) {
+    res->connectors[i++] = conn.first;
+  }
+  return res;
+}
+
+void drmModeFreeResources(drmModeResPtr ptr) {
+  if (ptr) {
+    free(ptr->connectors);
+  }
+  free(ptr);
+}
+
+drmModeConnectorPtr drmModeGetConnector(int fd, uint32_t connector_id) {
+  auto it = GetState().connectors.find(connector_id);
+  if (it == GetState().connectors.end()) {
+    return nullptr;
+  }
+
+  drmModeConnectorPtr conn = reinterpret_cast<drmModeConnectorPtr>(calloc(1, sizeof(*conn)));
+  conn->connector_id = connector_id;
+  conn->connector_type = it->second;
+  conn->connection = DRM_MODE_CONNECTED;
+  return conn;
+}
+
+void drmModeFreeConnector(drmModeConnectorPtr ptr) {
+  free(ptr);
+}
+
+drmModeObjectPropertiesPtr drmModeObjectGetProperties(int fd, uint32_t object_id,
+                                                       uint32_t object_type) {
+  std::vector<uint32_t> ids;
+  for (auto &prop : GetState().props) {
+    if (prop.second.obj_id == object_id) {
+      ids.push_back(prop.first);
+    }
+  }
+
+  drmModeObjectPropertiesPtr props =
+      reinterpret_cast<drmModeObjectPropertiesPtr>(calloc(1, sizeof(*props)));
+  props->count_props = static_cast<uint32_t>(ids.size());
+  props->props = reinterpret_cast<uint32_t *>(calloc(ids.size() + 1, sizeof(uint32_t)));
+  props->prop_values = reinterpret_cast<uint64_t *>(calloc(ids.size() + 1, sizeof(uint64_t)));
+  for (size_t i = 0; i < ids.size(); i++) {
+    props->props[i] = ids[i];
+  }
+  return props;
+}
+
+void drmModeFreeObjectProperties(drmModeObjectPropertiesPtr ptr) {
+  if (ptr) {
+    free(ptr->props);
+    free(ptr->prop_values);
+  }
+  free(ptr);
+}
+
+drmModePropertyPtr drmModeGetProperty(int fd, uint32_t property_id) {
+  auto it = GetState().props.find(property_id);
+  if (it == GetState().props.end()) {
+    return nullptr;
+  }
+
+  const fake_drm::Property &prop = it->second;
+  drmModePropertyPtr info = reinterpret_cast<drmModePropertyPtr>(calloc(1, sizeof(*info)));
+  info->prop_id = property_id;
+  strncpy(info->name, prop.name.c_str(), DRM_PROP_NAME_LEN - 1);
+  if (!prop.enums.empty()) {
+    info->flags = DRM_MODE_PROP_ENUM;
+    info->count_enums = static_cast<int>(prop.enums.size());
+    info->enums = reinterpret_cast<drm_mode_property_enum *>(
+        calloc(prop.enums.size(), sizeof(drm_mode_property_enum)));
+    for (size_t i = 0; i < prop.enums.size(); i++) {
+      info->enums[i].value = i;
+      strncpy(info->enums[i].name, prop.enums[i].c_str(), DRM_PROP_NAME_LEN - 1);
+    }
+  }
+  return info;
+}
+
+void drmModeFreeProperty(drmModePropertyPtr ptr) {
+  if (ptr) {
+    free(ptr->enums);
+  }
+  free(ptr);
+}
+
+drmModePropertyBlobPtr drmModeGetPropertyBlob(int fd, uint32_t blob_id) {
+  return nullptr;
+}
+
+void drmModeFreePropertyBlob(drmModePropertyBlobPtr ptr) {
+  free(ptr);
+}
+
+drmModeAtomicReqPtr drmModeAtomicAlloc(void) {
+  return new _drmModeAtomicReq();
+}
+
+void drmModeAtomicFree(drmModeAtomicReqPtr req) {
+  delete req;
+}
+
+int drmModeAtomicAddProperty(drmModeAtomicReqPtr req, uint32_t object_id, uint32_t property_id,
+                             uint64_t value) {
+  if (!req) {
+    return -EINVAL;
+  }
+  req->props.push_back({object_id, property_id, value});
+  return static_cast<int>(req->props.size());
+}
+
+int drmModeCreatePropertyBlob(int fd, const void *data, size_t size, uint32_t *id) {
+  if (!data || !size) {
+    return -EINVAL;
+  }
+  fake_drm::State &state = GetState();
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  *id = state.next_blob_id++;
+  state.blobs[*id].assign(bytes, bytes + size);
+  state.blob_creates++;
+  return 0;
+}
+
+int drmModeDestroyPropertyBlob(int fd, uint32_t id) {
+  if (!GetState().blobs.erase(id)) {
+    return -ENOENT;
+  }
+  GetState().blob_destroys++;
+  return 0;
+}
+
+int drmIoctl(int fd, unsigned long request, void *arg) {
+  return 0;
+}
+
+}  // extern "C"
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __FAKE_LIBDRM_H__
+#define __FAKE_LIBDRM_H__
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// In-process stand-in for the libdrm mode setting calls sde-drm makes, so the managers can be
+// exercised on a host without a DRM device. Tests link it instead of libdrm.
+namespace fake_drm {
+
+struct AtomicProperty {
+  uint32_t obj_id;
+  uint32_t prop_id;
+  uint64_t value;
+};
+
+// Adds a property named name to object obj_id and returns its id. Enum values are the index
+// of the enum name.
+uint32_t AddProperty(uint32_t obj_id, const std::string &name,
+                     const std::vector<std::string> &enums = {});
+void AddConnector(uint32_t conn_id, uint32_t conn_type);
+// Properties added to req, in the order they were added.
+const std::vector<AtomicProperty> &GetRequest(drmModeAtomicReq *req);
+// Blobs that were created and not yet destroyed, by id.
+const std::map<uint32_t, std::vector<uint8_t>> &GetBlobs();
+uint32_t GetBlobCreates();
+uint32_t GetBlobDestroys();
+void Reset();
+
+}  // namespace fake_drm
+
+#endif  // __FAKE_LIBDRM_H__
@@ -27,6 +27,13 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+/*
+ * Changes from Qualcomm Innovation Center are provided under the following license:
+ *
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
 /*! @file buffer_sync_handler.h
   @brief Interface file for platform specific buffer allocator.
 
@@ -37,6 +44,8 @@
 #ifndef __BUFFER_SYNC_HANDLER_H__
 #define __BUFFER_SYNC_HANDLER_H__
 
+#include <errno.h>
+#include <stdint.h>
 #include <sstream>
 
 namespace sdm {
@@ -88,6 +97,19 @@ class BufferSyncHandler {
  */
   virtual void GetSyncInfo(int fd, std::ostringstream *os) = 0;
 
+  /*! @brief Method to get the time a sync fd was signaled
+
+    @details This method reads the CLOCK_MONOTONIC timestamp at which the fence associated to
+    given file descriptor was signaled, if it is signaled. Clients that cannot report signal
+    times need not implement it.
+
+    @param[in] fd file descriptor
+    @param[out] timestamp_ns signal time in nanoseconds
+
+    @return \link int \endlink 0 on success, -EBUSY if the fence is not signaled yet
+ */
+  virtual int GetSignalTime(int fd, int64_t *timestamp_ns) { return -ENOTSUP; }
+
  protected:
   virtual ~BufferSyncHandler() { }
 };
@@ -55,6 +55,7 @@ using std::vector;
 
 const int kMaxSDELayers = 16;   // Maximum number of layers that can be handled by MDP5 hardware
                                 // in a given layer stack.
+const uint32_t kMaxFrameROIs = 4;  // Maximum number of partial update ROIs per panel.
 #define MAX_PLANES 4
 #define MAX_DETAIL_ENHANCE_CURVE 3
 #define MAJOR 28
@@ -933,8 +934,9 @@ struct HWLayersInfo {
   shared_ptr<Fence> sync_handle = nullptr;  // Release fence id for current draw cycle.
   int set_idle_time_ms = -1;    // Set idle time to the new specified value.
                                 //    -1 indicates no change in idle time since last set value.
-  std::vector<LayerRect> left_frame_roi = {};   // Left ROI.
-  std::vector<LayerRect> right_frame_roi = {};  // Right ROI.
+  std::vector<LayerRect> left_frame_roi = {};   // Left ROIs, up to kMaxFrameROIs disjoint rects
+                                                // sorted top to bottom on single DSI panels.
+  std::vector<LayerRect> right_frame_roi = {};  // Right ROIs, paired by index with left ones.
   SprOverfetchLines spr_overfetch_lines = {};
   LayerRect partial_fb_roi = {};   // Damaged area in framebuffer.
   bool roi_split = false;          // Indicates separated left and right ROI
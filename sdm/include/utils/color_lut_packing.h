@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __COLOR_LUT_PACKING_H__
+#define __COLOR_LUT_PACKING_H__
+
+#include <stdint.h>
+
+// Conversions from the SDM color LUT layouts to the DRM post-processing payload layouts. Each
+// kernel uses NEON or SSE2 when the target has it and plain C otherwise; the *Scalar variants
+// are the reference implementations, also used for the tails the vector loops leave.
+
+namespace sdm {
+
+// out[2 * i] = c0[i], out[2 * i + 1] = c2_c1[i]: one drm_msm_3d_gamut_entry per input index.
+void PackGamutEntries(const uint32_t *c0, const uint32_t *c2_c1, uint32_t count, uint32_t *out);
+void PackGamutEntriesScalar(const uint32_t *c0, const uint32_t *c2_c1, uint32_t count,
+                            uint32_t *out);
+
+// out_c0[i] = c0_c1[i] & mask, out_c1[i] = (c0_c1[i] >> shift) & mask, out_c2[i] = c2[i] & mask.
+void UnpackIgcEntries(const uint32_t *c0_c1, const uint32_t *c2, uint32_t count, uint32_t mask,
+                      uint32_t shift, uint32_t *out_c0, uint32_t *out_c1, uint32_t *out_c2);
+void UnpackIgcEntriesScalar(const uint32_t *c0_c1, const uint32_t *c2, uint32_t count,
+                            uint32_t mask, uint32_t shift, uint32_t *out_c0, uint32_t *out_c1,
+                            uint32_t *out_c2);
+
+// out[i] = (data[2 * i] & mask) | (data[2 * i + 1] & mask) << 16, for count outputs. mask must
+// fit in 15 bits.
+void PackPgcEntries(const uint32_t *data, uint32_t count, uint32_t mask, uint32_t *out);
+void PackPgcEntriesScalar(const uint32_t *data, uint32_t count, uint32_t mask, uint32_t *out);
+
+}  // namespace sdm
+
+#endif  // __COLOR_LUT_PACKING_H__
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __EVENT_POLLER_H__
+#define __EVENT_POLLER_H__
+
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/types.h>
+
+#include <vector>
+
+namespace sdm {
+
+// Waits on a set of descriptors with one epoll instance, so a wake-up only reports the sources
+// that are ready and the interest list is not copied in on every wait. Each source is registered
+// with an id that is reported back with its events.
+// Sources added with EPOLLET are reported once per readiness change, they must be non-blocking
+// and read until EAGAIN, see Drain. Level triggered sources are reported until consumed.
+class EventPoller {
+ public:
+  struct Event {
+    uint32_t id = 0;
+    uint32_t events = 0;
+  };
+
+  ~EventPoller() { Deinit(); }
+
+  int Init();
+  void Deinit();
+  int Add(int fd, uint32_t id, uint32_t events);
+  int Remove(int fd);
+  // Blocks until a source is ready or timeout_ms expires, -1 waits forever. ready is replaced with
+  // the ready sources. Returns their count, or -errno on failure.
+  int Wait(int timeout_ms, std::vector<Event> *ready);
+
+  static int SetNonBlocking(int fd);
+  // Reads a non-blocking fd until it would block, passing each read to handler(buffer, length).
+  // Returns the number of bytes read, or -errno for errors other than EAGAIN.
+  template <typename Handler>
+  static ssize_t Drain(int fd, char *buffer, size_t size, Handler handler);
+
+ private:
+  static const int kMaxEvents = 16;
+
+  // Returns the length read, or -errno. Retries on EINTR.
+  static ssize_t ReadOnce(int fd, char *buffer, size_t size);
+
+  int epoll_fd_ = -1;
+};
+
+template <typename Handler>
+ssize_t EventPoller::Drain(int fd, char *buffer, size_t size, Handler handler) {
+  ssize_t total = 0;
+  while (true) {
+    ssize_t length = ReadOnce(fd, buffer, size);
+    if (length == -EAGAIN || length == 0) {
+      return total;
+    }
+    if (length < 0) {
+      return length;
+    }
+    handler(buffer, length);
+    total += length;
+  }
+}
+
+}  // namespace sdm
+
+#endif  // __EVENT_POLLER_H__
@@ -27,11 +27,19 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+/*
+ * Changes from Qualcomm Innovation Center are provided under the following license:
+ *
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
 #ifndef __FENCE_H__
 #define __FENCE_H__
 
 #include <core/buffer_sync_handler.h>
 #include <unistd.h>
+#include <functional>
 #include <utility>
 #include <memory>
 #include <string>
@@ -50,6 +58,9 @@ class Fence {
     kPending
   };
 
+  // Invoked with kErrorNone once the fence signals, or with the sync wait error otherwise.
+  typedef std::function<void(int)> Callback;
+
   // This class methods allow client to get access to the native file descriptor of fence object
   // during the scope of this class object. Underlying file descriptor is duped and returned to
   // the client. Duped file descriptors are closed as soon as scope ends. Client can get access
@@ -85,9 +96,18 @@ class Fence {
   static int Wait(const shared_ptr<Fence> &fence);
   static int Wait(const shared_ptr<Fence> &fence, int timeout);
 
+  // Registers callback with the shared fence waiter thread instead of blocking the caller.
+  // Callback runs on the waiter thread, or inline for a null fence. Callbacks must not block,
+  // as they delay every other pending wait.
+  static int WaitAsync(const shared_ptr<Fence> &fence, Callback callback);
+
   // Status check on null fence will return signaled.
   static Status GetStatus(const shared_ptr<Fence> &fence);
 
+  // CLOCK_MONOTONIC time the fence signaled at. Fails with -EBUSY while pending, and with
+  // -EINVAL on null fence.
+  static int GetSignalTime(const shared_ptr<Fence> &fence, int64_t *timestamp_ns);
+
   static string GetStr(const shared_ptr<Fence> &fence);
 
   // Write all fences info to the output stream.
@@ -101,6 +121,8 @@ class Fence {
   Fence& operator=(Fence &&fence) = delete;
   static int Get(const shared_ptr<Fence> &fence);
 
+  friend class FenceWaiter;
+
   static BufferSyncHandler *g_buffer_sync_handler_;
   static std::vector<std::weak_ptr<Fence>> wps_;
   int fd_ = -1;
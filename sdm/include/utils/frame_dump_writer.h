@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __FRAME_DUMP_WRITER_H__
+#define __FRAME_DUMP_WRITER_H__
+
+#include <core/sdm_types.h>
+#include <utils/fence.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sdm {
+
+struct FrameDumpRequest {
+  std::string path = "";         // Output file, ".gz" is appended when compressing
+  int fd = -1;                   // Buffer to dump, duped by Queue(); caller keeps ownership
+  uint32_t size = 0;             // Bytes to copy from the start of the buffer
+  shared_ptr<Fence> fence = nullptr;  // Buffer content is valid once this signals
+  bool clear = false;            // Zero the buffer once copied, for reused readback buffers
+  bool sync_copy = false;        // Copy before Queue() returns, the caller rewrites the buffer
+};
+
+struct FrameDumpStats {
+  uint64_t queued = 0;
+  uint64_t written = 0;
+  uint64_t dropped = 0;          // No staging slot or staging memory left when queued
+  uint64_t failed = 0;           // Fence, map or file errors
+  uint64_t bytes = 0;
+};
+
+// Takes frame dumps off the composition path. Queue() only dups the buffer fd and reserves a
+// staging slot; the copy into staging runs on a copy thread once the fence signals, and files
+// are written by a separate writer thread. Buffers the caller reuses right away are copied
+// synchronously instead, only their file write is deferred. Staging is bounded by slot count and bytes, so when
+// the writer falls behind new requests are dropped and counted rather than stalling the caller.
+class FrameDumpWriter {
+ public:
+  static FrameDumpWriter *GetInstance();
+
+  // Takes effect for requests queued after the call. Zero keeps the default for either limit.
+  void Configure(uint32_t num_slots, uint64_t max_staging_bytes, bool compress);
+  // Returns kErrorResources when the request was dropped.
+  DisplayError Queue(const FrameDumpRequest &request);
+  // Blocks until every queued request is written or failed.
+  void Flush();
+  void GetStats(FrameDumpStats *stats);
+
+ private:
+  struct StagingSlot {
+    std::vector<uint8_t> data;     // Owned by the job while busy, resized without lock_
+    uint64_t capacity = 0;         // Bytes data is allowed to hold, accounted under lock_
+    bool busy = false;
+  };
+
+  struct Job {
+    std::string path;
+    int fd = -1;
+    uint32_t size = 0;
+    bool clear = false;
+    bool compress = false;
+    StagingSlot *slot = nullptr;
+  };
+
+  FrameDumpWriter();
+  void OnFenceSignaled(const Job &job, int status);
+  void CopyAndQueueWrite(Job *job);
+  void CopyThread();
+  void WriteThread();
+  bool Copy(const Job &job);
+  bool Write(const Job &job);
+  void Release(const Job &job, bool written);
+
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::condition_variable idle_cv_;
+  std::vector<std::unique_ptr<StagingSlot>> slots_ = {};
+  uint64_t max_staging_bytes_ = 0;
+  bool compress_ = false;
+  uint32_t in_flight_ = 0;
+  std::deque<Job> copy_queue_ = {};
+  std::deque<Job> write_queue_ = {};
+  FrameDumpStats stats_ = {};
+  std::thread copy_thread_;
+  std::thread write_thread_;
+};
+
+}  // namespace sdm
+
+#endif  // __FRAME_DUMP_WRITER_H__
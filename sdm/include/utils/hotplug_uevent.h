@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __HOTPLUG_UEVENT_H__
+#define __HOTPLUG_UEVENT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace sdm {
+
+// Fields of a DRM hotplug uevent, -1 when not present.
+struct HotplugUEvent {
+  int connected = -1;           // status=
+  int bpp = -1;                 // bpp=
+  int pattern = -1;             // pattern=
+  bool sst_mst_hotplug = false;  // HOTPLUG=
+  bool mst_hotplug = false;      // MST_HOTPLUG=
+};
+
+// Parses a netlink uevent payload, an "action@devpath" header followed by KEY=value strings, all
+// NUL separated. The payload is walked once and never read past length, it does not need to be
+// NUL terminated. Returns false for events whose header does not contain devpath, compared
+// ignoring case, and for events without any of status, HOTPLUG or MST_HOTPLUG.
+bool ParseHotplugUEvent(const char *data, size_t length, const char *devpath,
+                        HotplugUEvent *event);
+
+// Connection state after a burst of hotplug uevents.
+struct HotplugState {
+  int connected = -1;  // Last reported status, kept across bursts.
+  int bpp = -1;        // bpp and pattern of the last event.
+  int pattern = -1;
+  uint32_t events = 0;  // Events collapsed into this state.
+};
+
+// Collapses hotplug uevents into the state after the last one, so that connect and disconnect
+// storms are reconciled once. The uevent thread pushes events and the handler thread waits for
+// bursts, events pushed while a burst is handled make up the next one.
+class HotplugCoalescer {
+ public:
+  void Push(const HotplugUEvent &event);
+  // Blocks until an event is pending, then until no event arrived for settle_ms or max_delay_ms
+  // passed since the first one. Returns false once terminated.
+  bool WaitBurst(uint32_t settle_ms, uint32_t max_delay_ms, HotplugState *state);
+  void Terminate();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  HotplugState state_ = {};
+  Clock::time_point first_event_ = {};
+  Clock::time_point last_event_ = {};
+  bool terminate_ = false;
+};
+
+}  // namespace sdm
+
+#endif  // __HOTPLUG_UEVENT_H__
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __LAYER_STACK_SERIALIZER_H__
+#define __LAYER_STACK_SERIALIZER_H__
+
+#include <core/layer_stack.h>
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace sdm {
+
+// Text form of the client-visible part of a LayerStack, used by the layer stack dump and by
+// tools that replay it. Each frame is a header line followed by one line per layer:
+//   frame <n> flags <hex> layers <count>
+//   layer id <id> comp <n> fmt <n> ... src <l> <t> <r> <b> ... dirty <count> <rects> name <name>
+// Buffers are recorded by geometry and handle id only, not by content.
+struct LayerStackRecord {
+  uint32_t frame = 0;
+  LayerStackFlags flags;
+  std::vector<Layer> layers = {};
+};
+
+void WriteLayerStack(const LayerStack &layer_stack, uint32_t frame, std::ostream *os);
+// Returns false at end of stream or on a malformed record.
+bool ReadLayerStack(std::istream *is, LayerStackRecord *record);
+
+}  // namespace sdm
+
+#endif  // __LAYER_STACK_SERIALIZER_H__
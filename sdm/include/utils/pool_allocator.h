@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __POOL_ALLOCATOR_H__
+#define __POOL_ALLOCATOR_H__
+
+#include <stddef.h>
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace sdm {
+
+// Allocator recycling single object allocations of T through a process wide free list, for
+// objects that are created and destroyed at a steady rate, such as per layer state. Up to
+// kMaxFree blocks are kept, array allocations go to operator new. Meant for std::allocate_shared,
+// which rebinds it to the control block type, so the control block and the object share a block.
+template <typename T>
+class PoolAllocator {
+ public:
+  typedef T value_type;
+  static const size_t kMaxFree = 64;
+
+  PoolAllocator() = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U> &) {}  // NOLINT
+
+  T *allocate(size_t n) {
+    if (n == 1) {
+      FreeList &pool = GetFreeList();
+      std::lock_guard<std::mutex> lock(pool.lock);
+      if (!pool.blocks.empty()) {
+        void *block = pool.blocks.back();
+        pool.blocks.pop_back();
+        return static_cast<T *>(block);
+      }
+    }
+
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *ptr, size_t n) {
+    if (n == 1) {
+      FreeList &pool = GetFreeList();
+      std::lock_guard<std::mutex> lock(pool.lock);
+      if (pool.blocks.size() < kMaxFree) {
+        pool.blocks.push_back(ptr);
+        return;
+      }
+    }
+
+    ::operator delete(ptr);
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U> &) const { return true; }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U> &) const { return false; }
+
+ private:
+  struct FreeList {
+    FreeList() { blocks.reserve(kMaxFree); }
+
+    std::mutex lock;
+    std::vector<void *> blocks;
+  };
+
+  // Never destroyed, pooled objects may be released from static destructors.
+  static FreeList &GetFreeList() {
+    static FreeList *pool = new FreeList();
+    return *pool;
+  }
+};
+
+}  // namespace sdm
+
+#endif  // __POOL_ALLOCATOR_H__
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __PRESENT_PACER_H__
+#define __PRESENT_PACER_H__
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace sdm {
+
+// Time source of the pacer, CLOCK_MONOTONIC in the driver. Tests substitute a simulated clock.
+class PacerClock {
+ public:
+  virtual ~PacerClock() {}
+  virtual int64_t Now() = 0;
+  // Sleeps until at least timestamp_ns, may overshoot by the scheduler wakeup latency.
+  virtual void SleepUntil(int64_t timestamp_ns) = 0;
+};
+
+class MonotonicPacerClock : public PacerClock {
+ public:
+  int64_t Now() override;
+  void SleepUntil(int64_t timestamp_ns) override;
+};
+
+// Reports the vblank timeline of a display on the pacer clock.
+class VBlankSource {
+ public:
+  virtual ~VBlankSource() {}
+  // Timestamp of the most recent vblank, returns 0 on success.
+  virtual int GetLastVBlank(int64_t *timestamp_ns) = 0;
+};
+
+struct PacingStats {
+  uint64_t frames = 0;          // Paced frames with a known present time.
+  uint64_t late = 0;            // Presented more than half a period after the target.
+  uint64_t early = 0;           // Presented more than half a period before the target.
+  int64_t max_late_ns = 0;      // Worst present delay past the target.
+  int64_t total_lead_ns = 0;    // Sum of target - commit start, for the average commit lead.
+};
+
+// Schedules commits against the present timeline. The commit-to-present latency is predicted from
+// a running history: for fixed refresh it is the commit duration, as the frame latches at the
+// first vblank after programming completes; for qsync it is commit start to present, as the panel
+// refreshes when the frame lands. A safety margin on top of the 90th percentile grows on missed
+// deadlines and decays while frames are on time, down to a floor set by the last miss that is only
+// lowered after a long run without misses.
+// Sleeping is done with an absolute deadline, the last kSpinNs is spent polling the clock, so
+// scheduler wakeup latency neither delays the commit nor lets it start early.
+class PresentPacer {
+ public:
+  static constexpr int64_t kSpinNs = 200000;
+
+  // Uses CLOCK_MONOTONIC when clock is null.
+  explicit PresentPacer(PacerClock *clock = nullptr);
+
+  int64_t Now() { return clock_->Now(); }
+
+  // Returns the time to start the commit of a frame expected to present at expected_present_ns.
+  // On fixed refresh the target is snapped to the vblank grid of vblank, when available.
+  // *target_ns is set to the present time the commit is aimed at.
+  int64_t GetCommitTime(int64_t expected_present_ns, int64_t vsync_period_ns,
+                        bool variable_refresh, VBlankSource *vblank, int64_t *target_ns);
+  // Blocks until timestamp_ns, never returning early. Returns immediately for past timestamps.
+  void WaitUntil(int64_t timestamp_ns);
+  // Records a commit that ran from commit_start_ns to commit_end_ns. target_ns is 0 for commits
+  // that were not paced, those only feed the latency history.
+  void OnCommit(int64_t target_ns, int64_t commit_start_ns, int64_t commit_end_ns,
+                int64_t vsync_period_ns, bool variable_refresh);
+  // Present time of the last commit, usually its retire fence signal time.
+  void OnPresent(int64_t present_ns);
+  // Last paced commit is known to be late without its present time, e.g. its fence is still
+  // pending past the deadline.
+  void OnMissed();
+  bool PresentPending() { return pending_.target_ns != 0; }
+  int64_t PendingDeadline();
+
+  PacingStats GetStats(uint32_t refresh_rate);
+  std::string Dump();
+
+ private:
+  static constexpr uint32_t kHistorySize = 32;
+  static constexpr int64_t kMinMarginNs = 250000;
+  static constexpr uint32_t kProbeFrames = 1024;
+
+  struct LatencyModel {
+    int64_t samples[kHistorySize] = {};
+    uint32_t count = 0;
+    uint32_t next = 0;
+    int64_t margin_ns = -1;  // Unset until the first paced frame of the current period.
+    int64_t floor_ns = kMinMarginNs;
+    uint32_t on_time = 0;  // Frames on time since the last miss or floor change.
+
+    void Add(int64_t sample_ns);
+    int64_t Percentile90();
+    int64_t Predict(int64_t vsync_period_ns, int64_t default_ns);
+    void OnLate(int64_t vsync_period_ns);
+    void OnEarly();
+    void OnTime();
+  };
+
+  struct PendingPresent {
+    int64_t target_ns = 0;
+    int64_t commit_start_ns = 0;
+    int64_t vsync_period_ns = 0;
+    bool variable_refresh = false;
+  };
+
+  void Account(int64_t present_ns, bool missed);
+  LatencyModel &Model(bool variable_refresh) { return variable_refresh ? qsync_ : fixed_; }
+  static uint32_t RefreshRate(int64_t vsync_period_ns);
+
+  MonotonicPacerClock monotonic_clock_;
+  PacerClock *clock_ = nullptr;
+  LatencyModel fixed_;
+  LatencyModel qsync_;
+  PendingPresent pending_;
+  int64_t max_wake_error_ns_ = 0;
+  std::mutex stats_lock_;  // Dump runs on the dumpsys thread.
+  std::map<uint32_t, PacingStats> stats_;
+};
+
+}  // namespace sdm
+
+#endif  // __PRESENT_PACER_H__
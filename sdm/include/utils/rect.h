@@ -25,12 +25,17 @@
 * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
 * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Changes from Qualcomm Innovation Center are provided under the following license:
+* Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+* SPDX-License-Identifier: BSD-3-Clause-Clear
 */
 
 #ifndef __RECT_H__
 #define __RECT_H__
 
 #include <stdint.h>
+#include <vector>
 #include <core/sdm_types.h>
 #include <core/layer_stack.h>
 #include <utils/debug.h>
@@ -45,10 +50,17 @@ namespace sdm {
 
   bool IsValid(const LayerRect &rect);
   bool IsCongruent(const LayerRect &rect1, const LayerRect &rect2);
+  bool IsCongruent(const std::vector<LayerRect> &rects1, const std::vector<LayerRect> &rects2);
   void LogI(DebugTag debug_tag, const char *prefix, const LayerRect &roi);
   void Log(DebugTag debug_tag, const char *prefix, const LayerRect &roi);
   void Normalize(const uint32_t &align_x, const uint32_t &align_y, LayerRect *rect);
   LayerRect Union(const LayerRect &rect1, const LayerRect &rect2);
+  float Area(const LayerRect &rect);
+  float Area(const std::vector<LayerRect> &rects);
+  // Turns rects into at most max_rects disjoint rects covering them, sorted top to bottom, left
+  // to right. Each rect costs rect_cost pixels on top of its area; two rects are merged into their
+  // bounding box whenever that is cheaper, or when there are more than max_rects.
+  void MergeRects(uint32_t max_rects, float rect_cost, std::vector<LayerRect> *rects);
   LayerRect Intersection(const LayerRect &rect1, const LayerRect &rect2);
   LayerRect Subtract(const LayerRect &rect1, const LayerRect &rect2);
   void Subtract(const LayerRect &rect1, const LayerRect &rect2, LayerRect *res);
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __SLOT_MAP_H__
+#define __SLOT_MAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+namespace sdm {
+
+// Map from a 64 bit id, such as a display or layer id, to V in one flat table with linear probing.
+// Lookups never allocate, and the table only grows when an insert would fill it past three
+// quarters, so a map sized for the usual number of ids keeps its storage for good. Erase shifts
+// the following entries back rather than leaving tombstones, which keeps probes short while ids
+// are created and destroyed. V must be default constructible and move assignable.
+template <typename V>
+class SlotMap {
+ public:
+  static const size_t kMinCapacity = 8;
+
+  explicit SlotMap(size_t capacity = kMinCapacity) {
+    size_t size = kMinCapacity;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    entries_.resize(size);
+  }
+
+  V *Find(int64_t id) {
+    size_t index = 0;
+    return Locate(id, &index) ? &entries_[index].value : nullptr;
+  }
+
+  const V *Find(int64_t id) const {
+    size_t index = 0;
+    return Locate(id, &index) ? &entries_[index].value : nullptr;
+  }
+
+  // Returns the value of id, default constructed if id was not present.
+  V *Insert(int64_t id) {
+    size_t index = 0;
+    if (Locate(id, &index)) {
+      return &entries_[index].value;
+    }
+
+    if ((size_ + 1) * 4 > entries_.size() * 3) {
+      Grow();
+      Locate(id, &index);
+    }
+
+    Entry &entry = entries_[index];
+    entry.id = id;
+    entry.used = true;
+    size_++;
+
+    return &entry.value;
+  }
+
+  bool Erase(int64_t id) {
+    size_t hole = 0;
+    if (!Locate(id, &hole)) {
+      return false;
+    }
+
+    const size_t mask = entries_.size() - 1;
+    for (size_t next = (hole + 1) & mask; entries_[next].used; next = (next + 1) & mask) {
+      // Entries whose home lies cyclically in (hole, next] are still reachable.
+      size_t home = Home(entries_[next].id);
+      if (Distance(home, next) < Distance(hole, next)) {
+        continue;
+      }
+      entries_[hole] = std::move(entries_[next]);
+      hole = next;
+    }
+    entries_[hole] = Entry();
+    size_--;
+
+    return true;
+  }
+
+  void Clear() {
+    for (Entry &entry : entries_) {
+      entry = Entry();
+    }
+    size_ = 0;
+  }
+
+  // Calls func(id, value) for each id, in no particular order.
+  template <typename Func>
+  void ForEach(Func func) {
+    for (Entry &entry : entries_) {
+      if (entry.used) {
+        func(entry.id, entry.value);
+      }
+    }
+  }
+
+  size_t Size() const { return size_; }
+  size_t Capacity() const { return entries_.size() * 3 / 4; }
+
+ private:
+  struct Entry {
+    int64_t id = 0;
+    bool used = false;
+    V value = V();
+  };
+
+  // The composer is built with the unsigned overflow sanitizer, so neither the hash nor the probe
+  // distance may wrap.
+  size_t Home(int64_t id) const {
+    // Fibonacci hashing of the id folded to 32 bits, ids are often small and sequential. The
+    // product of two 32 bit values fits in 64 bits.
+    uint64_t bits = static_cast<uint64_t>(id);
+    uint64_t hash = ((bits ^ (bits >> 32)) & 0xFFFFFFFFull) * 0x9E3779B9ull;
+    return static_cast<size_t>(hash ^ (hash >> 32)) & (entries_.size() - 1);
+  }
+
+  // Number of steps a probe takes from index from to index to, going round the end of the table.
+  size_t Distance(size_t from, size_t to) const {
+    return to >= from ? to - from : to + entries_.size() - from;
+  }
+
+  // Returns true and the index of id if present, else false and the free entry it would take.
+  bool Locate(int64_t id, size_t *index) const {
+    const size_t mask = entries_.size() - 1;
+    size_t i = Home(id);
+    while (entries_[i].used) {
+      if (entries_[i].id == id) {
+        *index = i;
+        return true;
+      }
+      i = (i + 1) & mask;
+    }
+    *index = i;
+
+    return false;
+  }
+
+  void Grow() {
+    std::vector<Entry> entries(entries_.size() * 2);
+    entries_.swap(entries);
+    const size_t mask = entries_.size() - 1;
+    for (Entry &entry : entries) {
+      if (!entry.used) {
+        continue;
+      }
+      size_t i = Home(entry.id);
+      while (entries_[i].used) {
+        i = (i + 1) & mask;
+      }
+      entries_[i] = std::move(entry);
+    }
+  }
+
+  std::vector<Entry> entries_;
+  size_t size_ = 0;
+};
+
+}  // namespace sdm
+
+#endif  // __SLOT_MAP_H__
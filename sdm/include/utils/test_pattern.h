@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __TEST_PATTERN_H__
+#define __TEST_PATTERN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compliance test patterns for external displays, with the CRC-16 of each color component the
+// sink reports for them.
+
+namespace sdm {
+
+// CRC-16 over one color component of a frame, fed one 16 bit word per pixel. The update is linear
+// in crc ^ word, so it is computed from tables of the update matrix powers, eight words per step.
+class PatternCRC {
+ public:
+  void Update(uint16_t word);
+  void Update(const uint16_t *words, size_t count);
+  // Same as feeding the words repeat times over. Feeding a row is an affine map of the crc, the
+  // map is raised to the power repeat instead.
+  void Update(const uint16_t *words, size_t count, uint32_t repeat);
+  uint16_t Get() const { return crc_; }
+  // Bit by bit reference of a single update.
+  static uint16_t UpdateBitwise(uint16_t crc, uint16_t word);
+
+ private:
+  uint16_t crc_ = 0;
+};
+
+enum TestPatternType {
+  kTestPatternColorRamp,
+  kTestPatternBWVertical,
+  kTestPatternColorSquare,
+};
+
+enum TestPatternFormat {
+  kTestPatternRGBA8888,
+  kTestPatternRGB888,
+  kTestPatternRGBA1010102,
+};
+
+struct TestPatternConfig {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t stride = 0;  // In bytes.
+  TestPatternFormat format = kTestPatternRGBA8888;
+  uint32_t panel_bpp = 24;  // 18, 24 or 30.
+};
+
+// Writes the pattern to buffer and returns the red, green and blue CRCs. Only the pixels of each
+// row are written, not the padding up to the stride. Panel depths other than 18, 24 and 30 bpp
+// have no CRC, the color ramp and color square patterns are not drawn for them either.
+int GenerateTestPattern(TestPatternType type, const TestPatternConfig &config, uint8_t *buffer,
+                        uint16_t crc[3]);
+
+}  // namespace sdm
+
+#endif  // __TEST_PATTERN_H__
@@ -90,7 +90,8 @@ DisplayBase::DisplayBase(DisplayType display_type, DisplayEventHandler *event_ha
       hw_device_type_(hw_device_type),
       buffer_allocator_(buffer_allocator),
       comp_manager_(comp_manager),
-      hw_info_intf_(hw_info_intf) {
+      hw_info_intf_(hw_info_intf),
+      layer_stack_stats_(display_type == kBuiltIn) {
   // Kick off worker thread and block the caller thread until worker thread has started and
   // ready to process commit requests.
   lock_guard<recursive_mutex> client_lock(disp_mutex_.client_mutex);
@@ -662,42 +663,26 @@ DisplayError DisplayBase::BuildLayerStackStats(LayerStack *layer_stack) {
   DTRACE_SCOPED();
   std::vector<Layer *> &layers = layer_stack->layers;
   HWLayersInfo &hw_layers_info = disp_layer_stack_->info;
-  hw_layers_info.app_layer_count = 0;
-  hw_layers_info.gpu_target_index = -1;
-  hw_layers_info.stitch_target_index = -1;
-  hw_layers_info.noise_layer_index = -1;
 
   disp_layer_stack_->stack = layer_stack;
   hw_layers_info.flags = layer_stack->flags;
   hw_layers_info.blend_cs = layer_stack->blend_cs;
-  hw_layers_info.wide_color_primaries.clear();
 
-  int index = 0;
-  for (auto &layer : layers) {
-    if (layer->buffer_map == nullptr) {
-      layer->buffer_map = std::make_shared<LayerBufferMap>();
-    }
-    if (layer->composition == kCompositionGPUTarget) {
-      hw_layers_info.gpu_target_index = hw_layers_info.app_layer_count;
-    } else if (layer->composition == kCompositionStitchTarget) {
-      hw_layers_info.stitch_target_index = index;
-    } else if (layer->flags.is_noise) {
-      hw_layers_info.flags.noise_present = true;
-      hw_layers_info.noise_layer_index = index;
-      hw_layers_info.noise_layer_info = noise_layer_info_;
-      DLOGV_IF(kTagDisplay, "Display %d-%d requested Noise at index = %d with zpos_n = %d",
-               display_id_, display_type_, index, noise_layer_info_.zpos_noise);
-    } else {
-      hw_layers_info.app_layer_count++;
-    }
-    if (IsWideColor(layer->input_buffer.color_metadata.colorPrimaries)) {
-      hw_layers_info.wide_color_primaries.push_back(
-          layer->input_buffer.color_metadata.colorPrimaries);
-    }
-    if (layer->flags.is_game) {
-      hw_layers_info.game_present = true;
-    }
-    index++;
+  const LayerStackStats::Summary &stats = layer_stack_stats_.Update(layers);
+  hw_layers_info.app_layer_count = stats.app_layer_count;
+  // Reported by the number of app layers below it.
+  hw_layers_info.gpu_target_index = stats.gpu_target_app_index;
+  hw_layers_info.stitch_target_index = stats.stitch_target_index;
+  hw_layers_info.noise_layer_index = stats.noise_layer_index;
+  hw_layers_info.wide_color_primaries = stats.wide_color_primaries;
+  if (stats.noise_layer_index >= 0) {
+    hw_layers_info.flags.noise_present = true;
+    hw_layers_info.noise_layer_info = noise_layer_info_;
+    DLOGV_IF(kTagDisplay, "Display %d-%d requested Noise at index = %d with zpos_n = %d",
+             display_id_, display_type_, stats.noise_layer_index, noise_layer_info_.zpos_noise);
+  }
+  if (stats.game_present) {
+    hw_layers_info.game_present = true;
   }
 
   DLOGD_IF(kTagDisplay,
@@ -2170,6 +2155,8 @@ std::string DisplayBase::Dump() {
     os << "\n";
   }
 
+  os << hw_intf_->Dump();
+
   uint32_t num_hw_layers = UINT32(disp_layer_stack_->info.hw_layers.size());
 
   if (num_hw_layers == 0) {
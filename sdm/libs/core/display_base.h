@@ -55,6 +55,7 @@
 #include <atomic>
 
 #include "comp_manager.h"
+#include "layer_stack_stats.h"
 #include "color_manager.h"
 
 #define GET_PANEL_FEATURE_FACTORY "GetPanelFeatureFactoryIntf"
@@ -381,6 +382,7 @@ class DisplayBase : public DisplayInterface, public CompManagerEventHandler {
   bool vsync_enable_ = false;
   uint32_t max_mixer_stages_ = 0;
   HWInfoInterface *hw_info_intf_ = NULL;
+  LayerStackStats layer_stack_stats_;
   ColorManagerProxy *color_mgr_ = NULL;  // each display object owns its ColorManagerProxy
   bool partial_update_control_ = true;
   HWEventsInterface *hw_events_intf_ = NULL;
@@ -372,15 +372,9 @@ void DisplayBuiltIn::NotifyDppsHdrPresent(LayerStack *layer_stack) {
 }
 
 void DisplayBuiltIn::CacheFrameROI() {
-  left_frame_roi_ = {};
-  right_frame_roi_ = {};
-
-  // Cache the Frame ROI.
-  if (disp_layer_stack_->info.left_frame_roi.size() &&
-      disp_layer_stack_->info.right_frame_roi.size()) {
-    left_frame_roi_ = disp_layer_stack_->info.left_frame_roi.at(0);
-    right_frame_roi_ = disp_layer_stack_->info.right_frame_roi.at(0);
-  }
+  // Cache the Frame ROIs.
+  left_frame_roi_ = disp_layer_stack_->info.left_frame_roi;
+  right_frame_roi_ = disp_layer_stack_->info.right_frame_roi;
 }
 
 void DisplayBuiltIn::UpdateQsyncMode() {
@@ -1544,8 +1538,11 @@ DisplayError DisplayBuiltIn::GetPanelBrightnessFromLevel(float level, float *bri
   } else if ((max > min) && (min <= level && level <= max)) {
     *brightness = (static_cast<float>(level) + level_remainder_ - min) / (max - min);
   } else {
-    min >= max ? DLOGE("Minimum brightness is greater than or equal to maximum brightness") :
-                 DLOGE("Invalid brightness level %f", level);
+    if (min >= max) {
+      DLOGE("Minimum brightness is greater than or equal to maximum brightness");
+    } else {
+      DLOGE("Invalid brightness level %f", level);
+    }
     return kErrorDriverData;
   }
 
@@ -2252,7 +2249,7 @@ bool DisplayBuiltIn::CanCompareFrameROI(LayerStack *layer_stack) {
   if (layer_stack->flags.demura_present)
     stack_fudge_factor++;
 
-  if (!hw_panel_info_.partial_update || (hw_panel_info_.left_roi_count != 1) ||
+  if (!hw_panel_info_.partial_update || !hw_panel_info_.left_roi_count ||
       layer_stack->flags.geometry_changed || layer_stack->flags.skip_present ||
       (layer_stack->layers.size() !=
        (disp_layer_stack_->info.app_layer_count + stack_fudge_factor))) {
@@ -2305,9 +2302,9 @@ bool DisplayBuiltIn::CanSkipDisplayPrepare(LayerStack *layer_stack) {
     return false;
   }
 
-  // Compare the cached and calculated Frame ROIs.
-  bool same_roi = IsCongruent(left_frame_roi_, disp_layer_stack_->info.left_frame_roi.at(0)) &&
-                  IsCongruent(right_frame_roi_, disp_layer_stack_->info.right_frame_roi.at(0));
+  // Compare the cached and calculated Frame ROI sets.
+  bool same_roi = IsCongruent(left_frame_roi_, disp_layer_stack_->info.left_frame_roi) &&
+                  IsCongruent(right_frame_roi_, disp_layer_stack_->info.right_frame_roi);
 
   if (same_roi) {
     // Update Surface Damage rectangle(s) in HW layers.
@@ -2409,57 +2406,43 @@ DisplayError DisplayBuiltIn::UpdateTransferTime(uint32_t transfer_time) {
 }
 
 DisplayError DisplayBuiltIn::BuildLayerStackStats(LayerStack *layer_stack) {
+  DTRACE_SCOPED();
   std::vector<Layer *> &layers = layer_stack->layers;
   HWLayersInfo &hw_layers_info = disp_layer_stack_->info;
-  hw_layers_info.app_layer_count = 0;
-  hw_layers_info.gpu_target_index = -1;
-  hw_layers_info.stitch_target_index = -1;
-  hw_layers_info.demura_target_index = -1;
-  hw_layers_info.noise_layer_index = -1;
-  hw_layers_info.cwb_target_index = -1;
 
   disp_layer_stack_->stack = layer_stack;
   hw_layers_info.flags = layer_stack->flags;
   hw_layers_info.blend_cs = layer_stack->blend_cs;
-  hw_layers_info.wide_color_primaries.clear();
 
-  int index = 0;
-  for (auto &layer : layers) {
-    if (layer->buffer_map == nullptr) {
-      layer->buffer_map = std::make_shared<LayerBufferMap>();
-    }
-    if (layer->composition == kCompositionGPUTarget) {
-      hw_layers_info.gpu_target_index = index;
-    } else if (layer->composition == kCompositionStitchTarget) {
-      hw_layers_info.stitch_target_index = index;
-      disp_layer_stack_->stack->flags.stitch_present = true;
-      hw_layers_info.stitch_present = true;
-    } else if (layer->composition == kCompositionDemura) {
-      hw_layers_info.demura_target_index = index;
-      disp_layer_stack_->stack->flags.demura_present = true;
-      hw_layers_info.demura_present = true;
-      DLOGD_IF(kTagDisplay, "Display %d-%d shall request Demura in this frame", display_id_,
-               display_type_);
-    } else if (layer->flags.is_noise) {
-      hw_layers_info.flags.noise_present = true;
-      hw_layers_info.noise_layer_index = index;
-      hw_layers_info.noise_layer_info = noise_layer_info_;
-      DLOGV_IF(kTagDisplay, "Display %d-%d requested Noise at index = %d with zpos_n = %d",
-               display_id_, display_type_, index, noise_layer_info_.zpos_noise);
-    } else if (layer->composition == kCompositionCWBTarget) {
-      hw_layers_info.cwb_target_index = index;
-      hw_layers_info.cwb_present = true;
-    } else {
-      hw_layers_info.app_layer_count++;
-    }
-    if (IsWideColor(layer->input_buffer.color_metadata.colorPrimaries)) {
-      hw_layers_info.wide_color_primaries.push_back(
-          layer->input_buffer.color_metadata.colorPrimaries);
-    }
-    if (layer->flags.is_game) {
-      hw_layers_info.game_present = true;
-    }
-    index++;
+  const LayerStackStats::Summary &stats = layer_stack_stats_.Update(layers);
+  hw_layers_info.app_layer_count = stats.app_layer_count;
+  hw_layers_info.gpu_target_index = stats.gpu_target_index;
+  hw_layers_info.stitch_target_index = stats.stitch_target_index;
+  hw_layers_info.demura_target_index = stats.demura_target_index;
+  hw_layers_info.noise_layer_index = stats.noise_layer_index;
+  hw_layers_info.cwb_target_index = stats.cwb_target_index;
+  hw_layers_info.wide_color_primaries = stats.wide_color_primaries;
+  if (stats.stitch_target_index >= 0) {
+    disp_layer_stack_->stack->flags.stitch_present = true;
+    hw_layers_info.stitch_present = true;
+  }
+  if (stats.demura_target_index >= 0) {
+    disp_layer_stack_->stack->flags.demura_present = true;
+    hw_layers_info.demura_present = true;
+    DLOGD_IF(kTagDisplay, "Display %d-%d shall request Demura in this frame", display_id_,
+             display_type_);
+  }
+  if (stats.noise_layer_index >= 0) {
+    hw_layers_info.flags.noise_present = true;
+    hw_layers_info.noise_layer_info = noise_layer_info_;
+    DLOGV_IF(kTagDisplay, "Display %d-%d requested Noise at index = %d with zpos_n = %d",
+             display_id_, display_type_, stats.noise_layer_index, noise_layer_info_.zpos_noise);
+  }
+  if (stats.cwb_target_index >= 0) {
+    hw_layers_info.cwb_present = true;
+  }
+  if (stats.game_present) {
+    hw_layers_info.game_present = true;
   }
 
   DLOGI_IF(kTagDisplay, "LayerStack layer_count: %zu, app_layer_count: %d "
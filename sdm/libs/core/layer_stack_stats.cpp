@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <utils/formats.h>
+#include <utils/pool_allocator.h>
+
+#include "layer_stack_stats.h"
+
+namespace sdm {
+
+LayerStackStats::Role LayerStackStats::Classify(const Layer &layer, bool builtin) {
+  if (layer.composition == kCompositionGPUTarget) {
+    return kRoleGPUTarget;
+  } else if (layer.composition == kCompositionStitchTarget) {
+    return kRoleStitchTarget;
+  } else if (builtin && layer.composition == kCompositionDemura) {
+    return kRoleDemuraTarget;
+  } else if (layer.flags.is_noise) {
+    return kRoleNoise;
+  } else if (builtin && layer.composition == kCompositionCWBTarget) {
+    return kRoleCWBTarget;
+  }
+
+  return kRoleApp;
+}
+
+void LayerStackStats::Evaluate(const Layer &layer, bool builtin, Entry *entry) {
+  entry->layer = &layer;
+  entry->composition = layer.composition;
+  entry->is_noise = layer.flags.is_noise;
+  entry->is_game = layer.flags.is_game;
+  entry->role = Classify(layer, builtin);
+  entry->primaries = layer.input_buffer.color_metadata.colorPrimaries;
+  entry->wide_color = IsWideColor(entry->primaries);
+}
+
+bool LayerStackStats::Changed(const Entry &entry, const Layer &layer) {
+  if (entry.layer != &layer) {
+    return true;
+  }
+
+  // The color primaries only change along with the dataspace or the buffer metadata.
+  if ((layer.geometry_changes & (kAdded | kDataspace)) || layer.update_mask.test(kMetadataUpdate) ||
+      layer.update_mask.test(kContentMetadata)) {
+    return true;
+  }
+
+  // Composition and flags are set per frame, by SDM as well, without a change mask.
+  return (entry.composition != layer.composition) || (entry.is_noise != layer.flags.is_noise) ||
+         (entry.is_game != layer.flags.is_game);
+}
+
+void LayerStackStats::Accumulate(const Entry &entry, int index, Summary *summary) {
+  switch (entry.role) {
+    case kRoleGPUTarget:
+      summary->gpu_target_index = index;
+      summary->gpu_target_app_index = summary->app_layer_count;
+      break;
+    case kRoleStitchTarget:
+      summary->stitch_target_index = index;
+      break;
+    case kRoleDemuraTarget:
+      summary->demura_target_index = index;
+      break;
+    case kRoleNoise:
+      summary->noise_layer_index = index;
+      break;
+    case kRoleCWBTarget:
+      summary->cwb_target_index = index;
+      break;
+    default:
+      summary->app_layer_count++;
+      break;
+  }
+
+  if (entry.wide_color) {
+    summary->wide_color_primaries.push_back(entry.primaries);
+  }
+  if (entry.is_game) {
+    summary->game_present = true;
+  }
+}
+
+const LayerStackStats::Summary &LayerStackStats::Update(const std::vector<Layer *> &layers) {
+  bool changed = (layers.size() != entries_.size());
+  entries_.resize(layers.size());
+  evaluated_count_ = 0;
+
+  for (size_t i = 0; i < layers.size(); i++) {
+    Layer &layer = *layers.at(i);
+    if (layer.buffer_map == nullptr) {
+      layer.buffer_map = CreateBufferMap();
+    }
+
+    Entry &entry = entries_.at(i);
+    if (!Changed(entry, layer)) {
+      continue;
+    }
+    Evaluate(layer, builtin_, &entry);
+    evaluated_count_++;
+    changed = true;
+  }
+
+  if (changed) {
+    // Keeps the wide color primaries capacity across frames.
+    std::vector<ColorPrimaries> wide_color_primaries = std::move(summary_.wide_color_primaries);
+    wide_color_primaries.clear();
+    summary_ = Summary();
+    summary_.wide_color_primaries = std::move(wide_color_primaries);
+    for (size_t i = 0; i < entries_.size(); i++) {
+      Accumulate(entries_.at(i), static_cast<int>(i), &summary_);
+    }
+  }
+
+  return summary_;
+}
+
+void LayerStackStats::Reset() {
+  entries_.clear();
+  summary_ = Summary();
+  evaluated_count_ = 0;
+}
+
+void LayerStackStats::Compute(const std::vector<Layer *> &layers, bool builtin,
+                              Summary *summary) {
+  *summary = Summary();
+  for (size_t i = 0; i < layers.size(); i++) {
+    Entry entry;
+    Evaluate(*layers.at(i), builtin, &entry);
+    Accumulate(entry, static_cast<int>(i), summary);
+  }
+}
+
+std::shared_ptr<LayerBufferMap> LayerStackStats::CreateBufferMap() {
+  return std::allocate_shared<LayerBufferMap>(PoolAllocator<LayerBufferMap>());
+}
+
+}  // namespace sdm
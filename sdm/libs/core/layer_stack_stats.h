@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __LAYER_STACK_STATS_H__
+#define __LAYER_STACK_STATS_H__
+
+#include <core/layer_stack.h>
+
+#include <memory>
+#include <vector>
+
+namespace sdm {
+
+// Maintains the per frame layer stack statistics of a display incrementally. Each layer's
+// contribution is cached by position, and a layer is re-evaluated only when it is new at its
+// position or its change mask, derived from Layer::update_mask, Layer::geometry_changes and the
+// fields SDM itself updates, says it may contribute differently. Layers that do not track their
+// changes keep geometry_changes at kDefault and are re-evaluated every frame.
+class LayerStackStats {
+ public:
+  struct Summary {
+    int app_layer_count = 0;
+    int gpu_target_index = -1;
+    int gpu_target_app_index = -1;  // Number of app layers below the GPU target.
+    int stitch_target_index = -1;
+    int demura_target_index = -1;
+    int noise_layer_index = -1;
+    int cwb_target_index = -1;
+    bool game_present = false;
+    std::vector<ColorPrimaries> wide_color_primaries = {};
+  };
+
+  // Built-in displays classify demura and CWB target layers, other displays count them as app
+  // layers.
+  explicit LayerStackStats(bool builtin) : builtin_(builtin) {}
+
+  // Brings the summary up to date with layers, allocating buffer maps for layers without one.
+  const Summary &Update(const std::vector<Layer *> &layers);
+  // Drops the cached state, the next update re-evaluates every layer.
+  void Reset();
+  // Layers re-evaluated by the last update.
+  uint32_t GetEvaluatedCount() const { return evaluated_count_; }
+
+  // Reference full recompute, with no cached state.
+  static void Compute(const std::vector<Layer *> &layers, bool builtin, Summary *summary);
+  // Buffer maps come from a pool, layers are created and destroyed at a steady rate.
+  static std::shared_ptr<LayerBufferMap> CreateBufferMap();
+
+ private:
+  enum Role : uint8_t {
+    kRoleApp,
+    kRoleGPUTarget,
+    kRoleStitchTarget,
+    kRoleDemuraTarget,
+    kRoleNoise,
+    kRoleCWBTarget,
+  };
+
+  struct Entry {
+    const Layer *layer = nullptr;
+    LayerComposition composition = kCompositionGPU;
+    bool is_noise = false;
+    bool is_game = false;
+    bool wide_color = false;
+    Role role = kRoleApp;
+    ColorPrimaries primaries = ColorPrimaries_BT709_5;
+  };
+
+  static Role Classify(const Layer &layer, bool builtin);
+  static void Evaluate(const Layer &layer, bool builtin, Entry *entry);
+  static bool Changed(const Entry &entry, const Layer &layer);
+  static void Accumulate(const Entry &entry, int index, Summary *summary);
+
+  bool builtin_ = false;
+  std::vector<Entry> entries_ = {};
+  Summary summary_ = {};
+  uint32_t evaluated_count_ = 0;
+};
+
+}  // namespace sdm
+
+#endif  // __LAYER_STACK_STATS_H__
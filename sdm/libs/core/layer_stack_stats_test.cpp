@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "layer_stack_stats.h"
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+// Deterministic random source for the stack mutations.
+class Random {
+ public:
+  uint32_t Next(uint32_t range) {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<uint32_t>(state_ >> 33) % range;
+  }
+
+ private:
+  uint64_t state_ = 7;
+};
+
+const ColorPrimaries kPrimaries[] = {ColorPrimaries_BT709_5, ColorPrimaries_DCIP3,
+                                     ColorPrimaries_BT2020};
+
+void ExpectEqual(const LayerStackStats::Summary &expected, const LayerStackStats::Summary &actual) {
+  EXPECT_EQ(expected.app_layer_count, actual.app_layer_count);
+  EXPECT_EQ(expected.gpu_target_index, actual.gpu_target_index);
+  EXPECT_EQ(expected.gpu_target_app_index, actual.gpu_target_app_index);
+  EXPECT_EQ(expected.stitch_target_index, actual.stitch_target_index);
+  EXPECT_EQ(expected.demura_target_index, actual.demura_target_index);
+  EXPECT_EQ(expected.noise_layer_index, actual.noise_layer_index);
+  EXPECT_EQ(expected.cwb_target_index, actual.cwb_target_index);
+  EXPECT_EQ(expected.game_present, actual.game_present);
+  EXPECT_EQ(expected.wide_color_primaries, actual.wide_color_primaries);
+}
+
+}  // namespace
+
+// Owns the layers like the composer does, and clears the change masks after each frame.
+class LayerStackStatsTest : public Test {
+ protected:
+  Layer *AddLayer(LayerComposition composition = kCompositionGPU) {
+    layers_.push_back(std::make_unique<Layer>());
+    Layer *layer = layers_.back().get();
+    layer->composition = composition;
+    layer->geometry_changes = kAdded;
+    stack_.push_back(layer);
+    return layer;
+  }
+
+  void EndFrame() {
+    for (auto &layer : layers_) {
+      layer->update_mask.reset();
+      layer->geometry_changes = kNone;
+    }
+  }
+
+  void ExpectMatchesFullRecompute(LayerStackStats *stats, bool builtin) {
+    LayerStackStats::Summary expected;
+    LayerStackStats::Compute(stack_, builtin, &expected);
+    ExpectEqual(expected, stats->Update(stack_));
+  }
+
+  std::vector<std::unique_ptr<Layer>> layers_;
+  std::vector<Layer *> stack_;
+};
+
+TEST_F(LayerStackStatsTest, ClassifiesTargets) {
+  AddLayer(kCompositionStitchTarget);
+  AddLayer()->flags.is_noise = true;
+  AddLayer()->input_buffer.color_metadata.colorPrimaries = ColorPrimaries_DCIP3;
+  AddLayer(kCompositionDemura);
+  AddLayer(kCompositionCWBTarget);
+  AddLayer()->flags.is_game = true;
+  AddLayer(kCompositionGPUTarget);
+
+  LayerStackStats builtin(true);
+  const LayerStackStats::Summary &summary = builtin.Update(stack_);
+  EXPECT_EQ(0, summary.stitch_target_index);
+  EXPECT_EQ(1, summary.noise_layer_index);
+  EXPECT_EQ(3, summary.demura_target_index);
+  EXPECT_EQ(4, summary.cwb_target_index);
+  EXPECT_EQ(6, summary.gpu_target_index);
+  EXPECT_EQ(2, summary.app_layer_count);
+  EXPECT_EQ(2, summary.gpu_target_app_index);
+  EXPECT_TRUE(summary.game_present);
+  EXPECT_EQ(std::vector<ColorPrimaries>({ColorPrimaries_DCIP3}), summary.wide_color_primaries);
+
+  // Other displays treat demura and CWB target layers as app layers.
+  LayerStackStats other(false);
+  EXPECT_EQ(4, other.Update(stack_).app_layer_count);
+  EXPECT_EQ(-1, other.Update(stack_).demura_target_index);
+  EXPECT_EQ(4, other.Update(stack_).gpu_target_app_index);
+
+  for (Layer *layer : stack_) {
+    EXPECT_NE(nullptr, layer->buffer_map);
+  }
+}
+
+TEST_F(LayerStackStatsTest, UnchangedLayersAreNotReevaluated) {
+  for (int i = 0; i < 32; i++) {
+    AddLayer(kCompositionSDE);
+  }
+  AddLayer(kCompositionGPUTarget);
+
+  LayerStackStats stats(true);
+  stats.Update(stack_);
+  EXPECT_EQ(33u, stats.GetEvaluatedCount());
+  EndFrame();
+
+  stats.Update(stack_);
+  EXPECT_EQ(0u, stats.GetEvaluatedCount());
+
+  // Buffer and geometry updates that cannot change the stats do not count.
+  stack_[3]->update_mask.set(kSurfaceDamage);
+  stack_[4]->geometry_changes = kDisplayFrame | kSourceCrop;
+  stack_[5]->input_buffer.color_metadata.colorPrimaries = ColorPrimaries_BT2020;
+  stack_[5]->update_mask.set(kMetadataUpdate);
+  stack_[6]->composition = kCompositionGPU;
+  EXPECT_EQ(1u, stats.Update(stack_).wide_color_primaries.size());
+  EXPECT_EQ(2u, stats.GetEvaluatedCount());
+  EndFrame();
+
+  // Layers reordered in the stack are picked up by position.
+  std::swap(stack_[0], stack_[5]);
+  stats.Update(stack_);
+  EXPECT_EQ(2u, stats.GetEvaluatedCount());
+
+  stats.Reset();
+  stats.Update(stack_);
+  EXPECT_EQ(33u, stats.GetEvaluatedCount());
+}
+
+TEST_F(LayerStackStatsTest, MatchesFullRecompute) {
+  Random random;
+  LayerStackStats builtin(true);
+  LayerStackStats other(false);
+
+  for (int i = 0; i < 8; i++) {
+    AddLayer(kCompositionSDE);
+  }
+  AddLayer(kCompositionGPUTarget);
+
+  const LayerComposition kCompositions[] = {kCompositionGPU, kCompositionSDE,
+                                            kCompositionStitchTarget, kCompositionDemura,
+                                            kCompositionCWBTarget};
+  for (int frame = 0; frame < 500; frame++) {
+    uint32_t changes = random.Next(4);
+    for (uint32_t i = 0; i < changes; i++) {
+      Layer *layer = stack_.at(random.Next(static_cast<uint32_t>(stack_.size())));
+      switch (random.Next(7)) {
+        case 0:
+          layer->composition = kCompositions[random.Next(5)];
+          break;
+        case 1:
+          layer->flags.is_noise = !layer->flags.is_noise;
+          break;
+        case 2:
+          layer->flags.is_game = !layer->flags.is_game;
+          break;
+        case 3:
+          layer->input_buffer.color_metadata.colorPrimaries = kPrimaries[random.Next(3)];
+          layer->update_mask.set(random.Next(2) ? kMetadataUpdate : kContentMetadata);
+          break;
+        case 4:
+          layer->input_buffer.color_metadata.colorPrimaries = kPrimaries[random.Next(3)];
+          layer->geometry_changes |= kDataspace;
+          break;
+        case 5:
+          if (stack_.size() < 64) {
+            AddLayer(kCompositions[random.Next(2)]);
+          }
+          break;
+        default:
+          if (stack_.size() > 1) {
+            stack_.erase(stack_.begin() + random.Next(static_cast<uint32_t>(stack_.size())));
+          }
+          break;
+      }
+    }
+
+    ExpectMatchesFullRecompute(&builtin, true);
+    ExpectMatchesFullRecompute(&other, false);
+    EndFrame();
+    if (HasFailure()) {
+      FAIL() << "frame " << frame;
+    }
+  }
+}
+
+TEST_F(LayerStackStatsTest, BufferMapsAreRecycled) {
+  std::shared_ptr<LayerBufferMap> map = LayerStackStats::CreateBufferMap();
+  LayerBufferMap *first = map.get();
+  map.reset();
+
+  map = LayerStackStats::CreateBufferMap();
+  EXPECT_EQ(first, map.get());
+  EXPECT_TRUE(map->buffer_map.empty());
+
+  std::shared_ptr<LayerBufferMap> second = LayerStackStats::CreateBufferMap();
+  EXPECT_NE(first, second.get());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -66,7 +66,9 @@
 #include <utils/sys.h>
 #include <dlfcn.h>
 #include <algorithm>
+#include <numeric>
 #include <string>
+#include <vector>
 
 #include "resource_default.h"
 
@@ -86,6 +88,7 @@ DisplayError ResourceDefault::CreateResourceDefault(const HWResourceInfo &hw_res
   error = resource_default->Init();
   if (error != kErrorNone) {
     delete resource_default;
+    return error;
   }
 
   *resource_intf = resource_default;
@@ -116,6 +119,11 @@ DisplayError ResourceDefault::Init() {
     return kErrorParameters;
   }
 
+  if (num_pipe_ > kMaxPipes) {
+    DLOGE("Number of H/W pipes %d exceeds %d", num_pipe_, kMaxPipes);
+    return kErrorParameters;
+  }
+
   src_pipes_.resize(num_pipe_);
 
   // Priority order of pipes: VIG, RGB, DMA
@@ -145,6 +153,7 @@ DisplayError ResourceDefault::Init() {
 
   for (uint32_t i = 0; i < num_pipe_; i++) {
     src_pipes_[i].priority = INT(i);
+    type_pipes_[src_pipes_[i].type] |= 1ULL << i;
   }
 
   DLOGI("hw_ver=%x, DMA=%d RGB=%d VIG=%d", hw_res_info_.hw_version, hw_res_info_.num_dma_pipe,
@@ -160,10 +169,17 @@ DisplayError ResourceDefault::Init() {
   // TODO(user): clean it up, query from driver for initial pipe status.
 #ifndef SDM_VIRTUAL_DRIVER
   rgb_index = hw_res_info_.num_vig_pipe;
-  src_pipes_[rgb_index].owner = kPipeOwnerKernelMode;
-  src_pipes_[rgb_index + 1].owner = kPipeOwnerKernelMode;
+  for (uint32_t i = rgb_index; i < std::min(rgb_index + 2, num_pipe_); i++) {
+    src_pipes_[i].owner = kPipeOwnerKernelMode;
+  }
 #endif
 
+  for (uint32_t i = 0; i < num_pipe_; i++) {
+    if (src_pipes_[i].owner == kPipeOwnerUserMode) {
+      free_pipes_ |= 1ULL << i;
+    }
+  }
+
   return error;
 }
 
@@ -241,6 +257,7 @@ DisplayError ResourceDefault::ReconfigureDisplay(Handle display_ctx,
   display_resource_ctx->display_attributes = display_attributes;
   display_resource_ctx->mixer_attributes = mixer_attributes;
   display_resource_ctx->fb_resolution = fb_resolution;
+  display_resource_ctx->last_assignment.clear();
 
   return kErrorNone;
 }
@@ -269,104 +286,185 @@ DisplayError ResourceDefault::Prepare(Handle display_ctx, DispLayerStack *disp_l
                           reinterpret_cast<DisplayResourceContext *>(display_ctx);
 
   DisplayError error = kErrorNone;
-  const struct HWLayersInfo &layer_info = disp_layer_stack->info;
+  HWLayersInfo &layer_info = disp_layer_stack->info;
   HWBlockType hw_block_type = display_resource_ctx->hw_block_type;
+  uint32_t layer_count = UINT32(layer_info.hw_layers.size());
   *feedback = LayerFeedback(0);
 
   DLOGV_IF(kTagResources, "==== Resource reserving start: hw_block_type = %d ====", hw_block_type);
 
-  if (layer_info.hw_layers.size() > 1) {
-    DLOGV_IF(kTagResources, "More than one FB layers");
+  if (!layer_count || layer_count > kMaxSDELayers ||
+      (hw_res_info_.num_blending_stages && layer_count > hw_res_info_.num_blending_stages)) {
+    DLOGV_IF(kTagResources, "Unsupported layer count %d", layer_count);
     return kErrorResources;
   }
 
-  const Layer &layer = layer_info.hw_layers.at(0);
+  for (auto &layer : layer_info.hw_layers) {
+    if (layer.composition != kCompositionGPUTarget && layer.composition != kCompositionSDE) {
+      DLOGV_IF(kTagResources, "Not an FB or SDE layer");
+      return kErrorParameters;
+    }
+  }
+
+  ReleasePipes(hw_block_type);
 
-  if (layer.composition != kCompositionGPUTarget) {
-    DLOGV_IF(kTagResources, "Not an FB layer");
-    return kErrorParameters;
+  if (ReuseAssignment(display_resource_ctx, disp_layer_stack)) {
+    DLOGV_IF(kTagResources, "Pipes of last frame reused for %d layers", layer_count);
+    return kErrorNone;
   }
+  display_resource_ctx->last_assignment.clear();
 
-  error = Config(display_resource_ctx, disp_layer_stack);
-  if (error != kErrorNone) {
-    DLOGV_IF(kTagResources, "Resource config failed");
-    return error;
+  for (uint32_t i = 0; i < layer_count; i++) {
+    error = Config(display_resource_ctx, layer_info.hw_layers.at(i), i, &layer_info.config[i]);
+    if (error != kErrorNone) {
+      DLOGV_IF(kTagResources, "Resource config failed for layer %d", i);
+      return error;
+    }
   }
 
-  for (uint32_t i = 0; i < num_pipe_; i++) {
-    if (src_pipes_[i].hw_block_type == hw_block_type && src_pipes_[i].owner == kPipeOwnerUserMode) {
-      src_pipes_[i].ResetState();
+  // Layers that can only go on VIG pipes pick first, then layers that need a scaler, so that
+  // unscaled RGB layers do not take the pipes those need when DMA pipes would do.
+  auto rank = [&](uint32_t i) {
+    const HWLayerConfig &layer_config = layer_info.config[i];
+    bool need_scale = (layer_config.left_pipe.valid && IsScalingNeeded(&layer_config.left_pipe)) ||
+                      (layer_config.right_pipe.valid && IsScalingNeeded(&layer_config.right_pipe));
+    bool need_csc = !IsRgbFormat(layer_info.hw_layers.at(i).input_buffer.format);
+    return (need_csc ? 2 : 0) + (need_scale ? 1 : 0);
+  };
+  std::vector<uint32_t> order(layer_count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return rank(a) > rank(b); });
+
+  std::vector<LayerAssignment> assignment(layer_count);
+  for (uint32_t i : order) {
+    error = AssignPipes(hw_block_type, layer_info.hw_layers.at(i), &layer_info.config[i],
+                        &assignment[i]);
+    if (error != kErrorNone) {
+      DLOGV_IF(kTagResources, "Resource reserving failed! hw_block_type = %d", hw_block_type);
+      ResourceStateLog();
+      ReleasePipes(hw_block_type);
+      return kErrorResources;
     }
   }
 
-  uint32_t left_index = num_pipe_;
-  uint32_t right_index = num_pipe_;
-  bool need_scale = false;
+  display_resource_ctx->last_assignment.swap(assignment);
+  DLOGV_IF(kTagResources, "Pipes acquired for %d layers", layer_count);
 
-  struct HWLayerConfig &layer_config = disp_layer_stack->info.config[0];
+  return kErrorNone;
+}
 
-  HWPipeInfo *left_pipe = &layer_config.left_pipe;
-  HWPipeInfo *right_pipe = &layer_config.right_pipe;
+DisplayError ResourceDefault::AssignPipes(HWBlockType hw_block_type, const Layer &layer,
+                                          HWLayerConfig *layer_config,
+                                          LayerAssignment *assignment) {
+  HWPipeInfo *left_pipe = &layer_config->left_pipe;
+  HWPipeInfo *right_pipe = &layer_config->right_pipe;
+  bool need_csc = !IsRgbFormat(layer.input_buffer.format);
+  DisplayError error = kErrorNone;
 
-  // left pipe is needed
+  // With display split, a layer entirely on the right half has no left pipe.
+  uint32_t left_index = num_pipe_;
   if (left_pipe->valid) {
-    need_scale = IsScalingNeeded(left_pipe);
-    left_index = GetPipe(hw_block_type, need_scale);
+    bool need_scale = IsScalingNeeded(left_pipe);
+    left_index = GetPipe(hw_block_type, need_scale, need_csc);
     if (left_index >= num_pipe_) {
       DLOGV_IF(kTagResources, "Get left pipe failed: hw_block_type = %d, need_scale = %d",
                hw_block_type, need_scale);
-      ResourceStateLog();
-      goto CleanupOnError;
+      return kErrorResources;
     }
-  }
 
-  error = SetDecimationFactor(left_pipe);
-  if (error != kErrorNone) {
-    goto CleanupOnError;
+    error = SetDecimationFactor(left_pipe);
+    if (error != kErrorNone) {
+      return error;
+    }
   }
 
-  if (!right_pipe->valid) {
-    // assign single pipe
-    if (left_index < num_pipe_) {
-      left_pipe->pipe_id = src_pipes_[left_index].mdss_pipe_id;
+  uint32_t right_index = num_pipe_;
+  if (right_pipe->valid) {
+    bool need_scale = IsScalingNeeded(right_pipe);
+    right_index = GetPipe(hw_block_type, need_scale, need_csc);
+    if (right_index >= num_pipe_) {
+      DLOGV_IF(kTagResources, "Get right pipe failed: hw_block_type = %d, need_scale = %d",
+               hw_block_type, need_scale);
+      return kErrorResources;
     }
-    DLOGV_IF(kTagResources, "1 pipe acquired for FB layer, left_pipe = %x", left_pipe->pipe_id);
-    return kErrorNone;
-  }
 
-  need_scale = IsScalingNeeded(right_pipe);
+    if (left_pipe->valid && src_pipes_[right_index].priority < src_pipes_[left_index].priority) {
+      // Swap pipe based on priority
+      std::swap(left_index, right_index);
+    }
 
-  right_index = GetPipe(hw_block_type, need_scale);
-  if (right_index >= num_pipe_) {
-    DLOGV_IF(kTagResources, "Get right pipe failed: hw_block_type = %d, need_scale = %d",
-             hw_block_type, need_scale);
-    ResourceStateLog();
-    goto CleanupOnError;
+    error = SetDecimationFactor(right_pipe);
+    if (error != kErrorNone) {
+      return error;
+    }
+    right_pipe->pipe_id = src_pipes_[right_index].mdss_pipe_id;
   }
 
-  if (src_pipes_[right_index].priority < src_pipes_[left_index].priority) {
-    // Swap pipe based on priority
-    std::swap(left_index, right_index);
+  if (left_pipe->valid) {
+    left_pipe->pipe_id = src_pipes_[left_index].mdss_pipe_id;
   }
 
-  // assign dual pipes
-  left_pipe->pipe_id = src_pipes_[left_index].mdss_pipe_id;
-  right_pipe->pipe_id = src_pipes_[right_index].mdss_pipe_id;
+  DLOGV_IF(kTagResources, "Pipes acquired for layer, left_pipe = %x, right_pipe = %x",
+           left_pipe->valid ? left_pipe->pipe_id : 0, right_pipe->valid ? right_pipe->pipe_id : 0);
 
-  error = SetDecimationFactor(right_pipe);
-  if (error != kErrorNone) {
-    goto CleanupOnError;
+  assignment->src_rect = layer.src_rect;
+  assignment->dst_rect = layer.dst_rect;
+  assignment->format = layer.input_buffer.format;
+  assignment->secure = layer.input_buffer.flags.secure;
+  assignment->left_pipe = *left_pipe;
+  assignment->right_pipe = *right_pipe;
+  assignment->left_index = left_index;
+  assignment->right_index = right_index;
+
+  return kErrorNone;
+}
+
+bool ResourceDefault::ReuseAssignment(DisplayResourceContext *display_resource_ctx,
+                                      DispLayerStack *disp_layer_stack) {
+  const std::vector<LayerAssignment> &last_assignment = display_resource_ctx->last_assignment;
+  HWLayersInfo &layer_info = disp_layer_stack->info;
+  if (last_assignment.empty() || last_assignment.size() != layer_info.hw_layers.size()) {
+    return false;
   }
 
-  DLOGV_IF(kTagResources, "2 pipes acquired for FB layer, left_pipe = %x, right_pipe = %x",
-           left_pipe->pipe_id,  right_pipe->pipe_id);
+  uint64_t pipes = 0;
+  for (uint32_t i = 0; i < last_assignment.size(); i++) {
+    const Layer &layer = layer_info.hw_layers.at(i);
+    const LayerAssignment &assignment = last_assignment.at(i);
+    if (!IsCongruent(layer.src_rect, assignment.src_rect) ||
+        !IsCongruent(layer.dst_rect, assignment.dst_rect) ||
+        layer.input_buffer.format != assignment.format ||
+        layer.input_buffer.flags.secure != assignment.secure) {
+      return false;
+    }
+    if (assignment.left_pipe.valid) {
+      pipes |= 1ULL << assignment.left_index;
+    }
+    if (assignment.right_pipe.valid) {
+      pipes |= 1ULL << assignment.right_index;
+    }
+  }
 
-  return kErrorNone;
+  // Another display may have taken some of the pipes since.
+  if ((free_pipes_ & pipes) != pipes) {
+    return false;
+  }
 
-CleanupOnError:
-  DLOGV_IF(kTagResources, "Resource reserving failed! hw_block_type = %d", hw_block_type);
+  for (uint32_t i = 0; i < last_assignment.size(); i++) {
+    const LayerAssignment &assignment = last_assignment.at(i);
+    HWLayerConfig &layer_config = layer_info.config[i];
+    if (assignment.left_pipe.valid) {
+      AcquirePipe(assignment.left_index, display_resource_ctx->hw_block_type);
+    }
+    layer_config.left_pipe = assignment.left_pipe;
+    layer_config.right_pipe = assignment.right_pipe;
+    if (assignment.right_pipe.valid) {
+      AcquirePipe(assignment.right_index, display_resource_ctx->hw_block_type);
+    }
+  }
 
-  return kErrorResources;
+  return true;
 }
 
 DisplayError ResourceDefault::PostPrepare(Handle display_ctx, DispLayerStack *disp_layer_stack) {
@@ -411,9 +509,9 @@ DisplayError ResourceDefault::PostCommit(Handle display_ctx, DispLayerStack *dis
   // handoff pipes which are used by splash screen
   if ((frame_count == 0) && (hw_block_type == kHWBuiltIn)) {
     for (uint32_t i = 0; i < num_pipe_; i++) {
-      if (src_pipes_[i].hw_block_type == hw_block_type &&
-          src_pipes_[i].owner == kPipeOwnerKernelMode) {
+      if (src_pipes_[i].owner == kPipeOwnerKernelMode) {
         src_pipes_[i].owner = kPipeOwnerUserMode;
+        free_pipes_ |= 1ULL << i;
       }
     }
   }
@@ -426,13 +524,9 @@ DisplayError ResourceDefault::PostCommit(Handle display_ctx, DispLayerStack *dis
 void ResourceDefault::Purge(Handle display_ctx) {
   DisplayResourceContext *display_resource_ctx =
                           reinterpret_cast<DisplayResourceContext *>(display_ctx);
-  HWBlockType hw_block_type = display_resource_ctx->hw_block_type;
 
-  for (uint32_t i = 0; i < num_pipe_; i++) {
-    if (src_pipes_[i].hw_block_type == hw_block_type && src_pipes_[i].owner == kPipeOwnerUserMode) {
-      src_pipes_[i].ResetState();
-    }
-  }
+  ReleasePipes(display_resource_ctx->hw_block_type);
+  display_resource_ctx->last_assignment.clear();
   DLOGV_IF(kTagResources, "display hw_block_type = %d", display_resource_ctx->hw_block_type);
 }
 
@@ -440,56 +534,27 @@ DisplayError ResourceDefault::SetMaxMixerStages(Handle display_ctx, uint32_t max
   return kErrorNone;
 }
 
-uint32_t ResourceDefault::SearchPipe(HWBlockType hw_block_type, SourcePipe *src_pipes,
-                                     uint32_t num_pipe) {
-  uint32_t index = num_pipe_;
-  SourcePipe *src_pipe;
-
-  // search the pipe being used
-  for (uint32_t i = 0; i < num_pipe; i++) {
-    src_pipe = &src_pipes[i];
-    if (src_pipe->owner == kPipeOwnerUserMode && src_pipe->hw_block_type == kHWBlockMax) {
-      index = src_pipe->index;
-      src_pipe->hw_block_type = hw_block_type;
-      break;
-    }
-  }
-
-  return index;
-}
-
 uint32_t ResourceDefault::NextPipe(PipeType type, HWBlockType hw_block_type) {
-  uint32_t num_pipe = 0;
-  SourcePipe *src_pipes = NULL;
-
-  switch (type) {
-  case kPipeTypeVIG:
-    src_pipes = &src_pipes_[0];
-    num_pipe = hw_res_info_.num_vig_pipe;
-    break;
-  case kPipeTypeRGB:
-    src_pipes = &src_pipes_[hw_res_info_.num_vig_pipe];
-    num_pipe = hw_res_info_.num_rgb_pipe;
-    break;
-  case kPipeTypeDMA:
-  default:
-    src_pipes = &src_pipes_[hw_res_info_.num_vig_pipe + hw_res_info_.num_rgb_pipe];
-    num_pipe = hw_res_info_.num_dma_pipe;
-    break;
+  uint64_t available = free_pipes_ & type_pipes_[type];
+  if (!available) {
+    return num_pipe_;
   }
 
-  return SearchPipe(hw_block_type, src_pipes, num_pipe);
+  uint32_t index = UINT32(__builtin_ctzll(available));
+  AcquirePipe(index, hw_block_type);
+
+  return index;
 }
 
-uint32_t ResourceDefault::GetPipe(HWBlockType hw_block_type, bool need_scale) {
+uint32_t ResourceDefault::GetPipe(HWBlockType hw_block_type, bool need_scale, bool need_csc) {
   uint32_t index = num_pipe_;
 
-  // The default behavior is to assume RGB and VG pipes have scalars
-  if (!need_scale) {
+  // The default behavior is to assume RGB and VG pipes have scalars, and only VG pipes have CSC
+  if (!need_scale && !need_csc) {
     index = NextPipe(kPipeTypeDMA, hw_block_type);
   }
 
-  if ((index >= num_pipe_) && (!need_scale || !hw_res_info_.has_non_scalar_rgb)) {
+  if ((index >= num_pipe_) && !need_csc && (!need_scale || !hw_res_info_.has_non_scalar_rgb)) {
     index = NextPipe(kPipeTypeRGB, hw_block_type);
   }
 
@@ -500,6 +565,22 @@ uint32_t ResourceDefault::GetPipe(HWBlockType hw_block_type, bool need_scale) {
   return index;
 }
 
+void ResourceDefault::AcquirePipe(uint32_t index, HWBlockType hw_block_type) {
+  uint64_t pipe = 1ULL << index;
+  free_pipes_ &= ~pipe;
+  block_pipes_[hw_block_type] |= pipe;
+  src_pipes_[index].hw_block_type = hw_block_type;
+}
+
+void ResourceDefault::ReleasePipes(HWBlockType hw_block_type) {
+  uint64_t pipes = block_pipes_[hw_block_type];
+  free_pipes_ |= pipes;
+  block_pipes_[hw_block_type] = 0;
+  for (; pipes; pipes &= pipes - 1) {
+    src_pipes_[__builtin_ctzll(pipes)].ResetState();
+  }
+}
+
 bool ResourceDefault::IsScalingNeeded(const HWPipeInfo *pipe_info) {
   const LayerRect &src_roi = pipe_info->src_roi;
   const LayerRect &dst_roi = pipe_info->dst_roi;
@@ -600,17 +681,15 @@ DisplayError ResourceDefault::DisplaySplitConfig(DisplayResourceContext *display
 }
 
 DisplayError ResourceDefault::Config(DisplayResourceContext *display_resource_ctx,
-                                     DispLayerStack *disp_layer_stack) {
-  HWLayersInfo &layer_info = disp_layer_stack->info;
+                                     const Layer &layer, uint32_t z_order,
+                                     HWLayerConfig *layer_config) {
   DisplayError error = kErrorNone;
-  const Layer &layer = layer_info.hw_layers.at(0);
 
   error = ValidateLayerParams(&layer);
   if (error != kErrorNone) {
     return error;
   }
 
-  struct HWLayerConfig *layer_config = &disp_layer_stack->info.config[0];
   HWPipeInfo &left_pipe = layer_config->left_pipe;
   HWPipeInfo &right_pipe = layer_config->right_pipe;
 
@@ -644,18 +723,18 @@ DisplayError ResourceDefault::Config(DisplayResourceContext *display_resource_ct
     return error;
   }
 
-  // set z_order, left_pipe should always be valid
-  left_pipe.z_order = 0;
-
-  DLOGV_IF(kTagResources, "==== FB layer Config ====");
+  DLOGV_IF(kTagResources, "==== Layer Config, z_order = %d ====", z_order);
   Log(kTagResources, "input layer src_rect", layer.src_rect);
   Log(kTagResources, "input layer dst_rect", layer.dst_rect);
   Log(kTagResources, "cropped src_rect", src_rect);
   Log(kTagResources, "cropped dst_rect", dst_rect);
-  Log(kTagResources, "left pipe src", layer_config->left_pipe.src_roi);
-  Log(kTagResources, "left pipe dst", layer_config->left_pipe.dst_roi);
+  if (left_pipe.valid) {
+    left_pipe.z_order = z_order;
+    Log(kTagResources, "left pipe src", layer_config->left_pipe.src_roi);
+    Log(kTagResources, "left pipe dst", layer_config->left_pipe.dst_roi);
+  }
   if (right_pipe.valid) {
-    right_pipe.z_order = 0;
+    right_pipe.z_order = z_order;
     Log(kTagResources, "right pipe src", layer_config->right_pipe.src_roi);
     Log(kTagResources, "right pipe dst", layer_config->right_pipe.dst_roi);
   }
@@ -944,20 +1023,25 @@ void ResourceDefault::SplitRect(const LayerRect &src_rect, const LayerRect &dst_
 DisplayError ResourceDefault::AlignPipeConfig(const Layer *layer, HWPipeInfo *left_pipe,
                                               HWPipeInfo *right_pipe) {
   DisplayError error = kErrorNone;
-  if (!left_pipe->valid) {
-    DLOGE_IF(kTagResources, "left_pipe should not be invalid");
+  // Only the left pipe is invalid for layers on the right half of a display split
+  if (!left_pipe->valid && !right_pipe->valid) {
+    DLOGE_IF(kTagResources, "Both pipes are invalid");
     return kErrorNotSupported;
   }
 
-  error = ValidatePipeParams(left_pipe, layer->input_buffer.format);
-  if (error != kErrorNone) {
-    goto PipeConfigExit;
+  if (left_pipe->valid) {
+    error = ValidatePipeParams(left_pipe, layer->input_buffer.format);
+    if (error != kErrorNone) {
+      goto PipeConfigExit;
+    }
   }
 
   if (right_pipe->valid) {
-    // Make sure the  left and right ROI are conjunct
-    right_pipe->src_roi.left = left_pipe->src_roi.right;
-    right_pipe->dst_roi.left = left_pipe->dst_roi.right;
+    if (left_pipe->valid) {
+      // Make sure the  left and right ROI are conjunct
+      right_pipe->src_roi.left = left_pipe->src_roi.right;
+      right_pipe->dst_roi.left = left_pipe->dst_roi.right;
+    }
     error = ValidatePipeParams(right_pipe, layer->input_buffer.format);
   }
 
@@ -160,6 +160,8 @@ class ResourceDefault : public ResourceInterface {
     kMaxDecimationDownScaleRatio = 16,
   };
 
+  static const uint32_t kMaxPipes = 64;  // Pipes tracked by the availability bitmaps
+
   struct SourcePipe {
     PipeType type;
     PipeOwner owner;
@@ -179,12 +181,25 @@ class ResourceDefault : public ResourceInterface {
     inline void ResetState() { hw_block_type = kHWBlockMax; }
   };
 
+  // Pipe assignment of one layer, kept to reuse it while the layer stack is unchanged.
+  struct LayerAssignment {
+    LayerRect src_rect = {};
+    LayerRect dst_rect = {};
+    LayerBufferFormat format = kFormatInvalid;
+    bool secure = false;
+    HWPipeInfo left_pipe = {};
+    HWPipeInfo right_pipe = {};
+    uint32_t left_index = 0;   // Positions in src_pipes_, valid with the matching pipe
+    uint32_t right_index = 0;
+  };
+
   struct DisplayResourceContext {
     HWDisplayAttributes display_attributes;
     HWBlockType hw_block_type;
     uint64_t frame_count;
     HWMixerAttributes mixer_attributes;
     Resolution fb_resolution;
+    std::vector<LayerAssignment> last_assignment;  // From the last successful Prepare
 
     DisplayResourceContext() : hw_block_type(kHWBlockMax), frame_count(0) {}
   };
@@ -198,11 +213,16 @@ class ResourceDefault : public ResourceInterface {
   DisplayError Init();
   DisplayError Deinit();
   uint32_t NextPipe(PipeType pipe_type, HWBlockType hw_block_type);
-  uint32_t SearchPipe(HWBlockType hw_block_type, SourcePipe *src_pipes, uint32_t num_pipe);
-  uint32_t GetPipe(HWBlockType hw_block_type, bool need_scale);
+  uint32_t GetPipe(HWBlockType hw_block_type, bool need_scale, bool need_csc);
+  void AcquirePipe(uint32_t index, HWBlockType hw_block_type);
+  void ReleasePipes(HWBlockType hw_block_type);
+  DisplayError AssignPipes(HWBlockType hw_block_type, const Layer &layer,
+                           HWLayerConfig *layer_config, LayerAssignment *assignment);
+  bool ReuseAssignment(DisplayResourceContext *display_resource_ctx,
+                       DispLayerStack *disp_layer_stack);
   bool IsScalingNeeded(const HWPipeInfo *pipe_info);
-  DisplayError Config(DisplayResourceContext *display_resource_ctx,
-                      DispLayerStack *disp_layer_stack);
+  DisplayError Config(DisplayResourceContext *display_resource_ctx, const Layer &layer,
+                      uint32_t z_order, HWLayerConfig *layer_config);
   DisplayError DisplaySplitConfig(DisplayResourceContext *display_resource_ctx,
                                  const LayerRect &src_rect, const LayerRect &dst_rect,
                                  HWLayerConfig *layer_config);
@@ -230,6 +250,10 @@ class ResourceDefault : public ResourceInterface {
   HWBlockContext hw_block_ctx_[kHWBlockMax];
   std::vector<SourcePipe> src_pipes_;
   uint32_t num_pipe_ = 0;
+  // Bitmaps over src_pipes_ positions, so the lowest set bit is the highest priority pipe.
+  uint64_t type_pipes_[kPipeTypeCursor + 1] = {};  // Pipes of each type
+  uint64_t free_pipes_ = 0;                        // Pipes available for reservation
+  uint64_t block_pipes_[kHWBlockMax] = {};         // Pipes reserved by each display
 };
 
 }  // namespace sdm
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/rect.h>
+#include "resource_default.h"
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+const uint32_t kVig0 = 0x10;
+const uint32_t kVig1 = 0x11;
+const uint32_t kDma0 = 0x20;
+const uint32_t kDma1 = 0x21;
+const uint32_t kDma2 = 0x22;
+
+// Two VIG and three DMA pipes, listed out of priority order.
+HWResourceInfo SyntheticResourceInfo() {
+  HWResourceInfo info = {};
+  info.num_vig_pipe = 2;
+  info.num_dma_pipe = 3;
+  info.num_blending_stages = 6;
+  info.max_scale_down = 4;
+  info.max_scale_up = 20;
+  info.max_pipe_width = 2048;
+  info.max_scaler_pipe_width = 2048;
+  info.is_src_split = true;
+  for (auto &pipe : std::vector<std::pair<PipeType, uint32_t>>{{kPipeTypeDMA, kDma0},
+                                                               {kPipeTypeVIG, kVig0},
+                                                               {kPipeTypeDMA, kDma1},
+                                                               {kPipeTypeVIG, kVig1},
+                                                               {kPipeTypeDMA, kDma2}}) {
+    HWPipeCaps caps = {};
+    caps.type = pipe.first;
+    caps.id = pipe.second;
+    info.hw_pipes.push_back(caps);
+  }
+  return info;
+}
+
+Layer MakeLayer(const LayerRect &src, const LayerRect &dst,
+                LayerBufferFormat format = kFormatRGBA8888) {
+  Layer layer;
+  layer.composition = kCompositionSDE;
+  layer.src_rect = src;
+  layer.dst_rect = dst;
+  layer.input_buffer.format = format;
+  return layer;
+}
+
+Layer FullScreen(LayerBufferFormat format = kFormatRGBA8888) {
+  return MakeLayer({0, 0, 1080, 2400}, {0, 0, 1080, 2400}, format);
+}
+
+}  // namespace
+
+class ResourceDefaultTest : public Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(kErrorNone, ResourceDefault::CreateResourceDefault(SyntheticResourceInfo(),
+                                                                 &resource_));
+    builtin_ = Register(kBuiltIn);
+    pluggable_ = Register(kPluggable);
+
+    // The first built-in commit hands over the pipes the splash screen was using.
+    DispLayerStack stack;
+    ASSERT_EQ(kErrorNone, resource_->PostCommit(builtin_, &stack));
+  }
+
+  void TearDown() override {
+    resource_->UnregisterDisplay(pluggable_);
+    resource_->UnregisterDisplay(builtin_);
+    ResourceDefault::DestroyResourceDefault(resource_);
+  }
+
+  Handle Register(DisplayType type) {
+    HWDisplayAttributes attributes;
+    attributes.x_pixels = 1080;
+    attributes.y_pixels = 2400;
+    HWMixerAttributes mixer;
+    mixer.width = 1080;
+    mixer.height = 2400;
+    Handle ctx = nullptr;
+    EXPECT_EQ(kErrorNone, resource_->RegisterDisplay(type, type, attributes, HWPanelInfo(),
+                                                     mixer, {1080, 2400}, &ctx));
+    return ctx;
+  }
+
+  DisplayError Prepare(Handle ctx, DispLayerStack *stack, const std::vector<Layer> &layers) {
+    stack->info.hw_layers = layers;
+    LayerFeedback feedback(0);
+    return resource_->Prepare(ctx, stack, &feedback);
+  }
+
+  std::vector<uint32_t> LeftPipes(const DispLayerStack &stack) {
+    std::vector<uint32_t> pipes;
+    for (uint32_t i = 0; i < stack.info.hw_layers.size(); i++) {
+      pipes.push_back(stack.info.config[i].left_pipe.pipe_id);
+    }
+    return pipes;
+  }
+
+  ResourceInterface *resource_ = nullptr;
+  Handle builtin_ = nullptr;
+  Handle pluggable_ = nullptr;
+};
+
+TEST_F(ResourceDefaultTest, SingleFramebufferLayer) {
+  DispLayerStack stack;
+  Layer fb = FullScreen();
+  fb.composition = kCompositionGPUTarget;
+
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &stack, {fb}));
+  EXPECT_EQ(std::vector<uint32_t>({kDma0}), LeftPipes(stack));
+  EXPECT_FALSE(stack.info.config[0].right_pipe.valid);
+}
+
+TEST_F(ResourceDefaultTest, LayersGetDistinctPipesInPriorityOrder) {
+  DispLayerStack stack;
+  std::vector<Layer> layers(5, FullScreen());
+
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &stack, layers));
+  EXPECT_EQ(std::vector<uint32_t>({kDma0, kDma1, kDma2, kVig0, kVig1}), LeftPipes(stack));
+  for (uint32_t i = 0; i < layers.size(); i++) {
+    EXPECT_EQ(i, stack.info.config[i].left_pipe.z_order);
+  }
+}
+
+TEST_F(ResourceDefaultTest, YuvAndScaledLayersPickVigFirst) {
+  DispLayerStack stack;
+  Layer scaled = MakeLayer({0, 0, 540, 1200}, {0, 0, 1080, 2400});
+  Layer video = FullScreen(kFormatYCbCr420SemiPlanarVenus);
+
+  // Unscaled RGB layers come first in z order but must not take the VIG pipes.
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &stack, {FullScreen(), FullScreen(), scaled, video}));
+  EXPECT_EQ(std::vector<uint32_t>({kDma0, kDma1, kVig1, kVig0}), LeftPipes(stack));
+}
+
+TEST_F(ResourceDefaultTest, FailedPrepareReleasesPipes) {
+  DispLayerStack stack;
+  std::vector<Layer> videos(3, FullScreen(kFormatYCbCr420SemiPlanarVenus));
+
+  EXPECT_EQ(kErrorResources, Prepare(builtin_, &stack, videos));
+  ASSERT_EQ(kErrorNone, Prepare(pluggable_, &stack, {videos[0], videos[1]}));
+  EXPECT_EQ(std::vector<uint32_t>({kVig0, kVig1}), LeftPipes(stack));
+}
+
+TEST_F(ResourceDefaultTest, ScalingLimitsAreChecked) {
+  DispLayerStack stack;
+  Layer downscaled = MakeLayer({0, 0, 1080, 2400}, {0, 0, 216, 480});
+
+  EXPECT_EQ(kErrorNotSupported, Prepare(builtin_, &stack, {downscaled}));
+
+  downscaled.dst_rect = {0, 0, 540, 1200};
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &stack, {downscaled}));
+  EXPECT_EQ(0, stack.info.config[0].left_pipe.horizontal_decimation);
+  EXPECT_EQ(0, stack.info.config[0].left_pipe.vertical_decimation);
+}
+
+TEST_F(ResourceDefaultTest, WideLayerUsesTwoPipes) {
+  DispLayerStack stack;
+  Layer wide = MakeLayer({0, 0, 3840, 1080}, {0, 0, 3840, 1080});
+
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &stack, {wide}));
+  const HWLayerConfig &config = stack.info.config[0];
+  ASSERT_TRUE(config.right_pipe.valid);
+  EXPECT_EQ(kDma0, config.left_pipe.pipe_id);
+  EXPECT_EQ(kDma1, config.right_pipe.pipe_id);
+  EXPECT_EQ(config.left_pipe.src_roi.right, config.right_pipe.src_roi.left);
+}
+
+TEST_F(ResourceDefaultTest, UnchangedStackKeepsItsPipes) {
+  DispLayerStack builtin_stack, pluggable_stack;
+  std::vector<Layer> layers = {FullScreen(), FullScreen(kFormatYCbCr420SemiPlanarVenus)};
+
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &builtin_stack, layers));
+  std::vector<uint32_t> first = LeftPipes(builtin_stack);
+  EXPECT_EQ(std::vector<uint32_t>({kDma0, kVig0}), first);
+
+  // The pluggable display takes pipes in between, the built-in one keeps its assignment.
+  ASSERT_EQ(kErrorNone, Prepare(pluggable_, &pluggable_stack, {FullScreen()}));
+  EXPECT_EQ(std::vector<uint32_t>({kDma1}), LeftPipes(pluggable_stack));
+  DispLayerStack next_stack;
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &next_stack, layers));
+  EXPECT_EQ(first, LeftPipes(next_stack));
+  EXPECT_EQ(1u, next_stack.info.config[1].left_pipe.z_order);
+
+  // A geometry change reallocates.
+  layers[0].dst_rect = {0, 0, 540, 1200};
+  layers[0].src_rect = {0, 0, 540, 1200};
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &builtin_stack, layers));
+  EXPECT_EQ(std::vector<uint32_t>({kDma0, kVig0}), LeftPipes(builtin_stack));
+  EXPECT_TRUE(IsCongruent(LayerRect(0, 0, 540, 1200),
+                          builtin_stack.info.config[0].left_pipe.dst_roi));
+}
+
+TEST_F(ResourceDefaultTest, AssignmentIsNotReusedWhenPipesAreTaken) {
+  DispLayerStack builtin_stack, pluggable_stack;
+
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &builtin_stack, {FullScreen()}));
+  EXPECT_EQ(std::vector<uint32_t>({kDma0}), LeftPipes(builtin_stack));
+  resource_->Purge(builtin_);
+
+  ASSERT_EQ(kErrorNone, Prepare(pluggable_, &pluggable_stack, {FullScreen()}));
+  EXPECT_EQ(std::vector<uint32_t>({kDma0}), LeftPipes(pluggable_stack));
+  ASSERT_EQ(kErrorNone, Prepare(builtin_, &builtin_stack, {FullScreen()}));
+  EXPECT_EQ(std::vector<uint32_t>({kDma1}), LeftPipes(builtin_stack));
+
+  std::vector<Layer> rest(3, FullScreen());
+  EXPECT_EQ(kErrorNone, Prepare(builtin_, &builtin_stack, rest));
+  for (uint32_t pipe : LeftPipes(builtin_stack)) {
+    EXPECT_NE(kDma0, pipe);
+  }
+}
+
+// Without source split each half of the mixer has its own pipe, layers confined to one half
+// only take a pipe on that side.
+TEST(ResourceDefaultSplitTest, LayersTakePipesOnlyForTheirHalf) {
+  HWResourceInfo info = SyntheticResourceInfo();
+  info.is_src_split = false;
+  ResourceInterface *resource = nullptr;
+  ASSERT_EQ(kErrorNone, ResourceDefault::CreateResourceDefault(info, &resource));
+
+  HWDisplayAttributes attributes;
+  attributes.x_pixels = 1080;
+  attributes.y_pixels = 2400;
+  attributes.is_device_split = true;
+  HWMixerAttributes mixer;
+  mixer.width = 1080;
+  mixer.height = 2400;
+  mixer.split_left = 540;
+  Handle ctx = nullptr;
+  ASSERT_EQ(kErrorNone, resource->RegisterDisplay(kBuiltIn, kBuiltIn, attributes, HWPanelInfo(),
+                                                  mixer, {1080, 2400}, &ctx));
+  DispLayerStack stack;
+  ASSERT_EQ(kErrorNone, resource->PostCommit(ctx, &stack));
+
+  std::vector<Layer> layers = {MakeLayer({0, 0, 400, 200}, {600, 0, 1000, 200}),
+                               MakeLayer({0, 0, 400, 200}, {100, 0, 500, 200}),
+                               FullScreen()};
+  for (int frame = 0; frame < 2; frame++) {
+    // The second frame reuses the assignment of the first.
+    stack.info.hw_layers = layers;
+    LayerFeedback feedback(0);
+    ASSERT_EQ(kErrorNone, resource->Prepare(ctx, &stack, &feedback));
+
+    const HWLayerConfig *config = stack.info.config;
+    EXPECT_FALSE(config[0].left_pipe.valid);
+    ASSERT_TRUE(config[0].right_pipe.valid);
+    EXPECT_EQ(kDma0, config[0].right_pipe.pipe_id);
+    EXPECT_EQ(0u, config[0].right_pipe.z_order);
+    EXPECT_TRUE(IsCongruent(LayerRect(600, 0, 1000, 200), config[0].right_pipe.dst_roi));
+
+    ASSERT_TRUE(config[1].left_pipe.valid);
+    EXPECT_FALSE(config[1].right_pipe.valid);
+    EXPECT_EQ(kDma1, config[1].left_pipe.pipe_id);
+
+    ASSERT_TRUE(config[2].left_pipe.valid);
+    ASSERT_TRUE(config[2].right_pipe.valid);
+    // The higher priority of the pair goes left
+    EXPECT_EQ(kVig0, config[2].left_pipe.pipe_id);
+    EXPECT_EQ(kDma2, config[2].right_pipe.pipe_id);
+  }
+
+  // Four pipes are taken, a fifth layer spanning both halves needs two more.
+  layers.push_back(FullScreen());
+  stack.info.hw_layers = layers;
+  LayerFeedback feedback(0);
+  EXPECT_EQ(kErrorResources, resource->Prepare(ctx, &stack, &feedback));
+
+  resource->UnregisterDisplay(ctx);
+  ResourceDefault::DestroyResourceDefault(resource);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -28,6 +28,7 @@
 
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <algorithm>
 #include <vector>
 
 #include "strategy.h"
@@ -37,6 +38,8 @@
 
 namespace sdm {
 
+static const float kROIRectCostLines = 16.0f;
+
 Strategy::Strategy(ExtensionInterface *extension_intf,
                    BufferAllocator *buffer_allocator,
                    int32_t display_id, DisplayType type, const HWResourceInfo &hw_resource_info,
@@ -112,6 +115,14 @@ DisplayError Strategy::Start(DispLayerStack *disp_layer_stack, uint32_t *max_att
     }
   }
 
+  // The SDE attempt belongs to the default strategy only, an extension that failed to start
+  // keeps its single GPU attempt.
+  try_sde_comp_ = false;
+  if (!strategy_intf_) {
+    try_sde_comp_ = CanComposeOnSDE(*constraints);
+    *max_attempts = try_sde_comp_ ? 2 : 1;
+  }
+
   disp_layer_stack_->stack->flags.default_strategy = !extn_start_success_;
   return error;
 }
@@ -125,6 +136,7 @@ DisplayError Strategy::Stop() {
 }
 
 DisplayError Strategy::GetNextStrategy() {
+  DTRACE_SCOPED();
   if (!disable_gpu_comp_ && !disp_layer_stack_->info.gpu_target_index) {
     DLOGE("GPU composition is enabled and GPU target buffer not provided for display %d-%d.",
           display_id_, display_type_);
@@ -135,6 +147,24 @@ DisplayError Strategy::GetNextStrategy() {
     return strategy_intf_->GetNextStrategy();
   }
 
+  HWLayersInfo &layer_info = disp_layer_stack_->info;
+  LayerStack *layer_stack = disp_layer_stack_->stack;
+  layer_info.hw_layers.clear();
+  layer_info.index.clear();
+  layer_info.roi_index.clear();
+
+  // Without a strategy extension, first try to fetch every application layer on its own pipe,
+  // resource manager rejects the attempt if the pipes or their limits do not allow it.
+  if (try_sde_comp_) {
+    try_sde_comp_ = false;
+    for (uint32_t i = 0; i < layer_info.app_layer_count; i++) {
+      layer_stack->layers.at(i)->composition = kCompositionSDE;
+      layer_stack->layers.at(i)->request.flags.request_flags = 0;  // Reset layer request
+      AddHWLayer(i);
+    }
+    return kErrorNone;
+  }
+
   // Do not fallback to GPU if GPU comp is disabled.
   if (disable_gpu_comp_) {
     return kErrorNotSupported;
@@ -142,16 +172,50 @@ DisplayError Strategy::GetNextStrategy() {
 
   // Mark all application layers for GPU composition. Find GPU target buffer and store its index for
   // programming the hardware.
-  LayerStack *layer_stack = disp_layer_stack_->stack;
-  for (uint32_t i = 0; i < disp_layer_stack_->info.app_layer_count; i++) {
+  for (uint32_t i = 0; i < layer_info.app_layer_count; i++) {
     layer_stack->layers.at(i)->composition = kCompositionGPU;
     layer_stack->layers.at(i)->request.flags.request_flags = 0;  // Reset layer request
   }
 
+  AddHWLayer(UINT32(layer_info.gpu_target_index));
+
+  return kErrorNone;
+}
+
+bool Strategy::CanComposeOnSDE(const StrategyConstraints &constraints) {
+  const HWLayersInfo &layer_info = disp_layer_stack_->info;
+  uint32_t app_layer_count = layer_info.app_layer_count;
+
+  if (constraints.safe_mode || constraints.gpu_fallback_mode || constraints.idle_timeout) {
+    return false;
+  }
+
+  uint32_t max_layers = std::min(constraints.max_layers, UINT32(kMaxSDELayers));
+  if (!app_layer_count || app_layer_count > max_layers) {
+    return false;
+  }
+
+  // Default resource manager has no rotator, tone mapping or solid fill support.
+  const LayerStackFlags &flags = layer_info.flags;
+  if (flags.skip_present || flags.hdr_present || flags.s3d_mode_present || flags.noise_present) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < app_layer_count; i++) {
+    const Layer *layer = disp_layer_stack_->stack->layers.at(i);
+    if (layer->flags.skip || layer->flags.solid_fill || layer->flags.color_transform ||
+        layer->transform.rotation != 0.0f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Strategy::AddHWLayer(uint32_t index) {
   // When mixer resolution and panel resolutions are same (1600x2560) and FB resolution is
-  // 1080x1920 FB_Target destination coordinates(mapped to FB resolution 1080x1920) need to
+  // 1080x1920 layer destination coordinates(mapped to FB resolution 1080x1920) need to
   // be mapped to destination coordinates of mixer resolution(1600x2560).
-  Layer *gpu_target_layer = layer_stack->layers.at(disp_layer_stack_->info.gpu_target_index);
   float layer_mixer_width = FLOAT(mixer_attributes_.width);
   float layer_mixer_height = FLOAT(mixer_attributes_.height);
   float fb_width = FLOAT(fb_config_.x_pixels);
@@ -159,8 +223,8 @@ DisplayError Strategy::GetNextStrategy() {
   LayerRect src_domain = (LayerRect){0.0f, 0.0f, fb_width, fb_height};
   LayerRect dst_domain = (LayerRect){0.0f, 0.0f, layer_mixer_width, layer_mixer_height};
 
-  Layer layer = *gpu_target_layer;
-  disp_layer_stack_->info.index.push_back(disp_layer_stack_->info.gpu_target_index);
+  Layer layer = *disp_layer_stack_->stack->layers.at(index);
+  disp_layer_stack_->info.index.push_back(index);
   disp_layer_stack_->info.roi_index.push_back(0);
   layer.transform.flip_horizontal ^= hw_panel_info_.panel_orientation.flip_horizontal;
   layer.transform.flip_vertical ^= hw_panel_info_.panel_orientation.flip_vertical;
@@ -169,14 +233,13 @@ DisplayError Strategy::GetNextStrategy() {
   // Scale to mixer resolution.
   MapRect(src_domain, dst_domain, layer.dst_rect, &layer.dst_rect);
   disp_layer_stack_->info.hw_layers.push_back(layer);
-
-  return kErrorNone;
 }
 
 void Strategy::GenerateROI() {
   bool split_display = false;
 
   if (partial_update_intf_ && partial_update_intf_->GenerateROI(disp_layer_stack_) == kErrorNone) {
+    MergeFrameROI();
     return;
   }
 
@@ -203,6 +266,27 @@ void Strategy::GenerateROI() {
   }
 }
 
+void Strategy::MergeFrameROI() {
+  HWLayersInfo &info = disp_layer_stack_->info;
+  // Left and right ROIs are paired by index on split panels, leave those as generated.
+  for (auto &roi : info.right_frame_roi) {
+    if (IsValid(roi)) {
+      return;
+    }
+  }
+
+  if (info.left_frame_roi.size() < 2) {
+    return;
+  }
+
+  // An extra ROI is worth about kROIRectCostLines lines of refresh, two damaged areas far apart
+  // (e.g. clock and notification) stay separate instead of refreshing everything in between.
+  uint32_t max_rects = std::min(kMaxFrameROIs, std::max(1U, hw_panel_info_.left_roi_count));
+  float rect_cost = FLOAT(mixer_attributes_.width) * kROIRectCostLines;
+  MergeRects(max_rects, rect_cost, &info.left_frame_roi);
+  info.right_frame_roi.assign(info.left_frame_roi.size(), LayerRect());
+}
+
 DisplayError Strategy::Reconfigure(const HWPanelInfo &hw_panel_info,
                                    const HWDisplayAttributes &display_attributes,
                                    const HWMixerAttributes &mixer_attributes,
@@ -68,6 +68,9 @@ class Strategy {
 
  private:
   void GenerateROI();
+  void MergeFrameROI();
+  bool CanComposeOnSDE(const StrategyConstraints &constraints);
+  void AddHWLayer(uint32_t index);
 
   ExtensionInterface *extension_intf_ = NULL;
   StrategyInterface *strategy_intf_ = NULL;
@@ -81,6 +84,7 @@ class Strategy {
   HWDisplayAttributes display_attributes_ = {};
   DisplayConfigVariableInfo fb_config_ = {};
   bool extn_start_success_ = false;
+  bool try_sde_comp_ = false;  // Default strategy offers all layers to SDE before using GPU
   bool disable_gpu_comp_ = false;
   BufferAllocator *buffer_allocator_ = NULL;
   std::shared_ptr<SPRIntf> spr_intf_ = nullptr;
@@ -67,13 +67,16 @@
 
 #include <array>
 #include <map>
+#include <cstddef>
 #include <cstring>
+#include <memory>
 #include <vector>
 #include <new>
 
 #ifdef PP_DRM_ENABLE
 #include <display/drm/msm_drm_pp.h>
 #endif
+#include <utils/color_lut_packing.h>
 #include <utils/debug.h>
 #include "hw_color_manager_drm.h"
 
@@ -124,6 +127,62 @@ static const uint32_t kSourceFeatureV5 = 5;
 
 namespace sdm {
 
+#ifdef PP_DRM_ENABLE
+// Per thread payload buffer for one feature struct type. Callers hand the payload to the DRM
+// layer, which copies it into a property blob, and free it before building the next one of the
+// same type; the buffer is kept for the next call instead of a new/delete per feature update.
+// A second payload of a type requested before the first is freed comes from the heap.
+template <class T>
+class PayloadArena {
+ public:
+  // The payload is zeroed unless clear is false, in which case the caller initializes it.
+  static T *Acquire(bool clear = true) {
+    Slot &slot = GetSlot();
+    if (slot.in_use) {
+      return new (std::nothrow) T();
+    }
+
+    if (!slot.payload) {
+      slot.payload.reset(new (std::nothrow) T());
+      if (!slot.payload) {
+        return nullptr;
+      }
+    } else if (clear) {
+      std::memset(slot.payload.get(), 0, sizeof(T));
+    }
+
+    slot.in_use = true;
+    return slot.payload.get();
+  }
+
+  static void Release(T *payload) {
+    Slot &slot = GetSlot();
+    if (payload == slot.payload.get()) {
+      slot.in_use = false;
+    } else {
+      delete payload;
+    }
+  }
+
+ private:
+  struct Slot {
+    std::unique_ptr<T> payload;
+    bool in_use = false;
+  };
+
+  static Slot &GetSlot() {
+    static thread_local Slot slot;
+    return slot;
+  }
+};
+
+// The gamut table is packed as interleaved (c0, c2_c1) pairs.
+static_assert(sizeof(drm_msm_3d_gamut_entry) == 2 * sizeof(uint32_t) &&
+              offsetof(drm_msm_3d_gamut_entry, c0) == 0 &&
+              offsetof(drm_msm_3d_gamut_entry, c2_c1) == sizeof(uint32_t),
+              "unexpected drm_msm_3d_gamut_entry layout");
+#endif
+
 typedef std::map<uint32_t, std::vector<DRMPPFeatureID>> DrmPPFeatureMap;
 
 static const DrmPPFeatureMap g_dspp_map = {
@@ -305,8 +364,7 @@ void HWColorManagerDrm::FreeDrmFeatureData(DRMPPFeatureInfo *feature) {
     switch (feature->id) {
       case kFeaturePcc: {
 #ifdef PP_DRM_ENABLE
-        drm_msm_pcc *pcc = reinterpret_cast<drm_msm_pcc *>(ptr);
-        delete pcc;
+        PayloadArena<drm_msm_pcc>::Release(reinterpret_cast<drm_msm_pcc *>(ptr));
 #endif
         break;
       }
@@ -314,16 +372,14 @@ void HWColorManagerDrm::FreeDrmFeatureData(DRMPPFeatureInfo *feature) {
       case kFeatureDgmIgc:
       case kFeatureVigIgc: {
 #ifdef PP_DRM_ENABLE
-        drm_msm_igc_lut *igc = reinterpret_cast<drm_msm_igc_lut *>(ptr);
-        delete igc;
+        PayloadArena<drm_msm_igc_lut>::Release(reinterpret_cast<drm_msm_igc_lut *>(ptr));
 #endif
         break;
       }
       case kFeaturePgc:
       case kFeatureDgmGc: {
 #ifdef PP_DRM_ENABLE
-        drm_msm_pgc_lut *pgc = reinterpret_cast<drm_msm_pgc_lut *>(ptr);
-        delete pgc;
+        PayloadArena<drm_msm_pgc_lut>::Release(reinterpret_cast<drm_msm_pgc_lut *>(ptr));
 #endif
         break;
       }
@@ -331,37 +387,32 @@ void HWColorManagerDrm::FreeDrmFeatureData(DRMPPFeatureInfo *feature) {
       case kFeatureCWBDither:
       case kFeatureSprDither: {
 #ifdef PP_DRM_ENABLE
-        drm_msm_dither *dither = reinterpret_cast<drm_msm_dither *>(ptr);
-        delete dither;
+        PayloadArena<drm_msm_dither>::Release(reinterpret_cast<drm_msm_dither *>(ptr));
 #endif
         break;
       }
       case kFeatureGamut:
       case kFeatureVigGamut: {
 #ifdef PP_DRM_ENABLE
-        drm_msm_3d_gamut *gamut = reinterpret_cast<drm_msm_3d_gamut *>(ptr);
-        delete gamut;
+        PayloadArena<drm_msm_3d_gamut>::Release(reinterpret_cast<drm_msm_3d_gamut *>(ptr));
 #endif
         break;
       }
       case kFeaturePADither: {
 #if defined(PP_DRM_ENABLE) && defined(DRM_MSM_PA_DITHER)
-        drm_msm_pa_dither *pa_dither = reinterpret_cast<drm_msm_pa_dither *>(ptr);
-        delete pa_dither;
+        PayloadArena<drm_msm_pa_dither>::Release(reinterpret_cast<drm_msm_pa_dither *>(ptr));
 #endif
         break;
       }
       case kFeaturePAHsic: {
 #if defined(PP_DRM_ENABLE) && defined(DRM_MSM_PA_HSIC)
-        drm_msm_pa_hsic *hsic = reinterpret_cast<drm_msm_pa_hsic *>(ptr);
-        delete hsic;
+        PayloadArena<drm_msm_pa_hsic>::Release(reinterpret_cast<drm_msm_pa_hsic *>(ptr));
 #endif
         break;
       }
       case kFeaturePASixZone: {
 #if defined(PP_DRM_ENABLE) && defined(DRM_MSM_SIXZONE)
-        drm_msm_sixzone *sixzone = reinterpret_cast<drm_msm_sixzone *>(ptr);
-        delete sixzone;
+        PayloadArena<drm_msm_sixzone>::Release(reinterpret_cast<drm_msm_sixzone *>(ptr));
 #endif
         break;
       }
@@ -370,8 +421,7 @@ void HWColorManagerDrm::FreeDrmFeatureData(DRMPPFeatureInfo *feature) {
       case kFeaturePAMemColFoliage:
       case kFeaturePAMemColProt: {
 #if defined(PP_DRM_ENABLE) && defined(DRM_MSM_MEMCOL)
-        drm_msm_memcol *memcol = reinterpret_cast<drm_msm_memcol *>(ptr);
-        delete memcol;
+        PayloadArena<drm_msm_memcol>::Release(reinterpret_cast<drm_msm_memcol *>(ptr));
 #endif
         break;
       }
@@ -418,7 +468,7 @@ DisplayError HWColorManagerDrm::GetDrmPCC(const PPFeatureInfo &in_data,
     return kErrorParameters;
   }
 
-  mdp_pcc = new drm_msm_pcc();
+  mdp_pcc = PayloadArena<drm_msm_pcc>::Acquire();
   if (!mdp_pcc) {
     DLOGE("Failed to allocate memory for pcc");
     return kErrorMemory;
@@ -501,7 +551,7 @@ DisplayError HWColorManagerDrm::GetDrmIGC(const PPFeatureInfo &in_data,
     return kErrorParameters;
   }
 
-  mdp_igc = new drm_msm_igc_lut();
+  mdp_igc = PayloadArena<drm_msm_igc_lut>::Acquire();
   if (!mdp_igc) {
     DLOGE("Failed to allocate memory for igc");
     return kErrorMemory;
@@ -516,20 +566,15 @@ DisplayError HWColorManagerDrm::GetDrmIGC(const PPFeatureInfo &in_data,
 
   if (!c0_c1_data_ptr || !c2_data_ptr) {
     DLOGE("Invaid igc data pointer");
-    delete mdp_igc;
+    PayloadArena<drm_msm_igc_lut>::Release(mdp_igc);
     out_data->payload = NULL;
     return kErrorParameters;
   }
 
-  int i;
-  for (i = 0; i < IGC_TBL_LEN; i++) {
-    mdp_igc->c0[i] = c0_c1_data_ptr[i] & kIgcDataMask;
-    mdp_igc->c1[i] = (c0_c1_data_ptr[i] >> kIgcShift) & kIgcDataMask;
-    mdp_igc->c2[i] = c2_data_ptr[i] & kIgcDataMask;
-  }
-  mdp_igc->c0_last = c0_c1_data_ptr[i] & kIgcDataMask;
-  mdp_igc->c1_last = (c0_c1_data_ptr[i] >> kIgcShift) & kIgcDataMask;
-  mdp_igc->c2_last = c2_data_ptr[i] & kIgcDataMask;
+  UnpackIgcEntries(c0_c1_data_ptr, c2_data_ptr, IGC_TBL_LEN, kIgcDataMask, kIgcShift,
+                   mdp_igc->c0, mdp_igc->c1, mdp_igc->c2);
+  UnpackIgcEntries(c0_c1_data_ptr + IGC_TBL_LEN, c2_data_ptr + IGC_TBL_LEN, 1, kIgcDataMask,
+                   kIgcShift, &mdp_igc->c0_last, &mdp_igc->c1_last, &mdp_igc->c2_last);
 
   out_data->payload = mdp_igc;
 #endif
@@ -558,7 +603,7 @@ DisplayError HWColorManagerDrm::GetDrmPGC(const PPFeatureInfo &in_data,
     return kErrorParameters;
   }
 
-  mdp_pgc = new drm_msm_pgc_lut();
+  mdp_pgc = PayloadArena<drm_msm_pgc_lut>::Acquire();
   if (!mdp_pgc) {
     DLOGE("Failed to allocate memory for pgc");
     return kErrorMemory;
@@ -566,14 +611,9 @@ DisplayError HWColorManagerDrm::GetDrmPGC(const PPFeatureInfo &in_data,
 
   mdp_pgc->flags = 0;
 
-  for (int i = 0, j = 0; i < PGC_TBL_LEN; i++, j += 2) {
-    mdp_pgc->c0[i] = (sde_pgc->c0_data[j] & kPgcDataMask) |
-        (sde_pgc->c0_data[j + 1] & kPgcDataMask) << kPgcShift;
-    mdp_pgc->c1[i] = (sde_pgc->c1_data[j] & kPgcDataMask) |
-        (sde_pgc->c1_data[j + 1] & kPgcDataMask) << kPgcShift;
-    mdp_pgc->c2[i] = (sde_pgc->c2_data[j] & kPgcDataMask) |
-        (sde_pgc->c2_data[j + 1] & kPgcDataMask) << kPgcShift;
-  }
+  PackPgcEntries(sde_pgc->c0_data, PGC_TBL_LEN, kPgcDataMask, mdp_pgc->c0);
+  PackPgcEntries(sde_pgc->c1_data, PGC_TBL_LEN, kPgcDataMask, mdp_pgc->c1);
+  PackPgcEntries(sde_pgc->c2_data, PGC_TBL_LEN, kPgcDataMask, mdp_pgc->c2);
   out_data->payload = mdp_pgc;
 #endif
   return ret;
@@ -618,7 +658,7 @@ DisplayError HWColorManagerDrm::GetDrmPAHsic(const PPFeatureInfo &in_data,
     return ret;
   }
 
-  mdp_hsic = new drm_msm_pa_hsic();
+  mdp_hsic = PayloadArena<drm_msm_pa_hsic>::Acquire();
   if (!mdp_hsic) {
     DLOGE("Failed to allocate memory for pa hsic");
     return kErrorMemory;
@@ -648,7 +688,7 @@ DisplayError HWColorManagerDrm::GetDrmPAHsic(const PPFeatureInfo &in_data,
     out_data->payload_size = sizeof(struct drm_msm_pa_hsic);
   } else {
     /* PA HSIC configuration unchanged, no better return code available */
-    delete mdp_hsic;
+    PayloadArena<drm_msm_pa_hsic>::Release(mdp_hsic);
     ret = kErrorPermission;
   }
 #endif
@@ -691,7 +731,7 @@ DisplayError HWColorManagerDrm::GetDrmPASixZone(const PPFeatureInfo &in_data,
         return kErrorParameters;
     }
 
-    mdp_sixzone = new drm_msm_sixzone();
+    mdp_sixzone = PayloadArena<drm_msm_sixzone>::Acquire();
     if (!mdp_sixzone) {
       DLOGE("Failed to allocate memory for six zone");
       return kErrorMemory;
@@ -772,7 +812,7 @@ DisplayError HWColorManagerDrm::GetDrmPAMemColSkin(const PPFeatureInfo &in_data,
     struct drm_msm_memcol *mdp_memcol = NULL;
     struct SDEPaMemColorData *pa_memcol = &sde_pa->skin;
 
-    mdp_memcol = new drm_msm_memcol();
+    mdp_memcol = PayloadArena<drm_msm_memcol>::Acquire();
     if (!mdp_memcol) {
       DLOGE("Failed to allocate memory for memory color skin");
       return kErrorMemory;
@@ -829,7 +869,7 @@ DisplayError HWColorManagerDrm::GetDrmPAMemColSky(const PPFeatureInfo &in_data,
     struct drm_msm_memcol *mdp_memcol = NULL;
     struct SDEPaMemColorData *pa_memcol = &sde_pa->sky;
 
-    mdp_memcol = new drm_msm_memcol();
+    mdp_memcol = PayloadArena<drm_msm_memcol>::Acquire();
     if (!mdp_memcol) {
       DLOGE("Failed to allocate memory for memory color sky");
       return kErrorMemory;
@@ -886,7 +926,7 @@ DisplayError HWColorManagerDrm::GetDrmPAMemColFoliage(const PPFeatureInfo &in_da
     struct drm_msm_memcol *mdp_memcol = NULL;
     struct SDEPaMemColorData *pa_memcol = &sde_pa->foliage;
 
-    mdp_memcol = new drm_msm_memcol();
+    mdp_memcol = PayloadArena<drm_msm_memcol>::Acquire();
     if (!mdp_memcol) {
       DLOGE("Failed to allocate memory for memory color foliage");
       return kErrorMemory;
@@ -941,7 +981,7 @@ DisplayError HWColorManagerDrm::GetDrmPAMemColProt(const PPFeatureInfo &in_data,
     return ret;
   }
 
-  mdp_memcol = new drm_msm_memcol();
+  mdp_memcol = PayloadArena<drm_msm_memcol>::Acquire();
   if (!mdp_memcol) {
     DLOGE("Failed to allocate memory for memory color prot");
     return kErrorMemory;
@@ -980,7 +1020,7 @@ DisplayError HWColorManagerDrm::GetDrmDither(const PPFeatureInfo &in_data,
     return kErrorParameters;
   }
 
-  mdp_dither = new drm_msm_dither();
+  mdp_dither = PayloadArena<drm_msm_dither>::Acquire();
   if (!mdp_dither) {
     DLOGE("Failed to allocate memory for dither");
     return kErrorMemory;
@@ -1025,12 +1065,15 @@ DisplayError HWColorManagerDrm::GetDrmGamut(const PPFeatureInfo &in_data,
     return kErrorParameters;
   }
 
-  mdp_gamut = new(std::nothrow) drm_msm_3d_gamut();
+  // Only the table entries in use are written below, the rest is cleared here instead of
+  // zeroing the whole 17x17x17 payload first.
+  mdp_gamut = PayloadArena<drm_msm_3d_gamut>::Acquire(false);
   if (!mdp_gamut) {
     DLOGE("Failed to allocate memory for gamut");
     return kErrorMemory;
   }
 
+  std::memset(mdp_gamut, 0, offsetof(drm_msm_3d_gamut, col));
   if (sde_gamut->map_en)
     mdp_gamut->flags = GAMUT_3D_MAP_EN;
   else
@@ -1051,7 +1094,7 @@ DisplayError HWColorManagerDrm::GetDrmGamut(const PPFeatureInfo &in_data,
       break;
     default:
       DLOGE("Invalid gamut mode %d", sde_gamut->mode);
-      delete mdp_gamut;
+      PayloadArena<drm_msm_3d_gamut>::Release(mdp_gamut);
       return kErrorParameters;
   }
 
@@ -1065,10 +1108,10 @@ DisplayError HWColorManagerDrm::GetDrmGamut(const PPFeatureInfo &in_data,
   }
 
   for (uint32_t row = 0; row < GAMUT_3D_TBL_NUM; row++) {
-    for (uint32_t col = 0; col < size; col++) {
-      mdp_gamut->col[row][col].c0 = sde_gamut->c0_data[row][col];
-      mdp_gamut->col[row][col].c2_c1 = sde_gamut->c1_c2_data[row][col];
-    }
+    PackGamutEntries(sde_gamut->c0_data[row], sde_gamut->c1_c2_data[row], size,
+                     reinterpret_cast<uint32_t *>(&mdp_gamut->col[row][0]));
+    std::memset(&mdp_gamut->col[row][size], 0,
+                sizeof(drm_msm_3d_gamut_entry) * (GAMUT_3D_MODE17_TBL_SZ - size));
   }
   out_data->payload = mdp_gamut;
 #endif
@@ -1102,7 +1145,7 @@ DisplayError HWColorManagerDrm::GetDrmPADither(const PPFeatureInfo &in_data,
     return kErrorParameters;
   }
 
-  mdp_dither = new drm_msm_pa_dither();
+  mdp_dither = PayloadArena<drm_msm_pa_dither>::Acquire();
   if (!mdp_dither) {
     DLOGE("Failed to allocate memory for dither");
     return kErrorMemory;
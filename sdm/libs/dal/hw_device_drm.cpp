@@ -52,6 +52,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <xf86drm.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
 #include <utils/formats.h>
@@ -292,46 +293,19 @@ static void GetDRMFormat(LayerBufferFormat format, uint32_t *drm_format,
   }
 }
 
-FrameBufferObject::FrameBufferObject(uint32_t fb_id, LayerBufferFormat format, uint32_t width,
-                                     uint32_t height, bool shallow, bool secure)
-    : fb_id_(fb_id),
-      format_(format),
-      width_(width),
-      height_(height),
-      shallow_(shallow),
-      secure_(secure) {}
-
-FrameBufferObject::~FrameBufferObject() {
-  // Don't call RemoveFbId in case its a shallow copy from other display
-  if (shallow_) {
-    DLOGI("FBID: %d is a shallow copy", fb_id_);
-    return;
-  }
-
-  DRMMaster *master;
-  DRMMaster::GetInstance(&master);
-  int ret = master->RemoveFbId(fb_id_);
-  if (ret < 0) {
-    DLOGE("Removing fb_id %d failed with error %d", fb_id_, errno);
-  }
-}
-
-uint32_t FrameBufferObject::GetFbId() {
-  return fb_id_;
-}
-
-bool FrameBufferObject::IsEqual(LayerBufferFormat format, uint32_t width, uint32_t height,
-                                bool secure) {
-  // Create a new framebuffer object when the format, width, height, or secure flag gets updated
-  return (format == format_ && width == width_ && height == height_ && secure == secure_);
-}
-
 HWDeviceDRM::Registry::Registry(BufferAllocator *buffer_allocator) :
-  buffer_allocator_(buffer_allocator) {
+  buffer_allocator_(buffer_allocator),
+  fbid_cache_([this](const LayerBuffer &buffer, uint32_t *fb_id) {
+    return CreateFbId(buffer, fb_id);
+  }, DISPLAY_FBID_LIMIT) {
   int value = 0;
   if (Debug::GetProperty(DISABLE_FBID_CACHE, &value) == kErrorNone) {
     disable_fbid_cache_ = (value == 1);
   }
+  value = 0;
+  if (Debug::GetProperty(FBID_CACHE_LIMIT, &value) == kErrorNone && value > 0) {
+    fbid_cache_.SetLimit(UINT32(value));
+  }
 }
 
 int HWDeviceDRM::Registry::Register(HWLayersInfo *hw_layers_info) {
@@ -359,6 +333,8 @@ int HWDeviceDRM::Registry::Register(HWLayersInfo *hw_layers_info) {
       }
     }
   }
+  fbid_cache_.Evict();
+
   return err;
 }
 
@@ -411,51 +387,35 @@ int HWDeviceDRM::Registry::MapBufferToFbId(Layer *layer, const LayerBuffer &buff
   uint64_t handle_id = buffer.handle_id;
   bool secure_present =
       (buffer.flags.secure || buffer.flags.secure_display || buffer.flags.secure_camera);
+  auto &layer_map = layer->buffer_map->buffer_map;
 
   if (!handle_id || disable_fbid_cache_) {
     // In legacy path, clear fb_id map in each frame.
-    layer->buffer_map->buffer_map.clear();
-  } else {
-    if (layer->composition == kCompositionCWBTarget) {
-      layer->buffer_map->buffer_map.clear();
-      auto it2 = output_buffer_map_.find(handle_id);
-      if (it2 != output_buffer_map_.end()) {
-        FrameBufferObject *fb_obj = static_cast<FrameBufferObject*>(it2->second.get());
-        if (fb_obj->IsEqual(buffer.format, buffer.width, buffer.height, secure_present)) {
-          layer->buffer_map->buffer_map[handle_id] = output_buffer_map_[handle_id];
-          // Found fb_id for given handle_id key
-          return 0;
-        }
-      }
+    layer_map.clear();
+    uint32_t fb_id = 0;
+    if (CreateFbId(buffer, &fb_id) < 0) {
+      return -EINVAL;
     }
-    auto it = layer->buffer_map->buffer_map.find(handle_id);
-    if (it != layer->buffer_map->buffer_map.end()) {
-      FrameBufferObject *fb_obj = static_cast<FrameBufferObject*>(it->second.get());
+    layer_map[handle_id] = std::make_shared<FrameBufferObject>(
+        fb_id, buffer.format, buffer.width, buffer.height, false /* shallow */, secure_present);
+    *fb_modified = true;
+    return 0;
+  }
+
+  if (layer->composition == kCompositionCWBTarget) {
+    layer_map.clear();
+    auto it2 = output_buffer_map_.find(handle_id);
+    if (it2 != output_buffer_map_.end()) {
+      FrameBufferObject *fb_obj = static_cast<FrameBufferObject*>(it2->second.get());
       if (fb_obj->IsEqual(buffer.format, buffer.width, buffer.height, secure_present)) {
+        layer_map[handle_id] = output_buffer_map_[handle_id];
         // Found fb_id for given handle_id key
         return 0;
-      } else {
-        // Erase from fb_id map if format or size have been modified
-        layer->buffer_map->buffer_map.erase(it);
       }
     }
-
-    if (layer->buffer_map->buffer_map.size() >= fbid_cache_limit_) {
-      // Clear fb_id map, if the size reaches cache limit.
-      layer->buffer_map->buffer_map.clear();
-    }
-  }
-
-  uint32_t fb_id = 0;
-  if (CreateFbId(buffer, &fb_id) < 0) {
-    return -EINVAL;
   }
-  // Create and cache the fb_id in map
-  layer->buffer_map->buffer_map[handle_id] = std::make_shared<FrameBufferObject>(
-      fb_id, buffer.format, buffer.width, buffer.height, false /* shallow */, secure_present);
-  *fb_modified = true;
 
-  return 0;
+  return fbid_cache_.Map(layer->buffer_map.get(), buffer, fbid_cache_limit_, fb_modified);
 }
 
 void HWDeviceDRM::Registry::MapOutputBufferToFbId(std::shared_ptr<LayerBuffer> output_buffer,
@@ -502,6 +462,17 @@ void HWDeviceDRM::Registry::Clear() {
   output_buffer_map_.clear();
 }
 
+void HWDeviceDRM::Registry::ClearFbIdCache() {
+  fbid_cache_.Clear();
+}
+
+std::string HWDeviceDRM::Registry::Dump() {
+  std::ostringstream os;
+  os << "\nFB ID cache" << (disable_fbid_cache_ ? " (disabled)" : "") << ": "
+     << fbid_cache_.Dump();
+  return os.str();
+}
+
 uint32_t HWDeviceDRM::Registry::GetFbId(Layer *layer, uint64_t handle_id) {
   auto it = layer->buffer_map->buffer_map.find(handle_id);
   if (it != layer->buffer_map->buffer_map.end()) {
@@ -654,6 +625,7 @@ DisplayError HWDeviceDRM::Deinit() {
   }
   delete hw_scale_;
   registry_.Clear();
+  registry_.ClearFbIdCache();
   display_attributes_ = {};
   drm_mgr_intf_->DestroyAtomicReq(drm_atomic_intf_);
   drm_atomic_intf_ = {};
@@ -1403,6 +1375,7 @@ DisplayError HWDeviceDRM::Standby(SyncPoints *sync_points) {
 
 void HWDeviceDRM::SetupAtomic(Fence::ScopedRef &scoped_ref, HWLayersInfo *hw_layers_info,
                               bool validate, int64_t *release_fence_fd, int64_t *retire_fence_fd) {
+  DTRACE_SCOPED();
   if (default_mode_) {
     return;
   }
@@ -1427,13 +1400,15 @@ void HWDeviceDRM::SetupAtomic(Fence::ScopedRef &scoped_ref, HWLayersInfo *hw_lay
     if (IsFullFrameUpdate(*hw_layers_info)) {
       ResetROI();
     } else {
-      const int kNumMaxROIs = 4;
-      DRMRect crtc_rects[kNumMaxROIs] = {{0, 0, mixer_attributes_.width, mixer_attributes_.height}};
-      DRMRect conn_rects[kNumMaxROIs] = {{0, 0, display_attributes_[index].x_pixels,
-                                          display_attributes_[index].y_pixels}};
-      DRMRect spr_rects[kNumMaxROIs] = {{0, 0, mixer_attributes_.width, mixer_attributes_.height}};
-
-      for (uint32_t i = 0; i < hw_layers_info->left_frame_roi.size(); i++) {
+      DRMRect crtc_rects[kMaxFrameROIs] = {{0, 0, mixer_attributes_.width,
+                                            mixer_attributes_.height}};
+      DRMRect conn_rects[kMaxFrameROIs] = {{0, 0, display_attributes_[index].x_pixels,
+                                            display_attributes_[index].y_pixels}};
+      DRMRect spr_rects[kMaxFrameROIs] = {{0, 0, mixer_attributes_.width,
+                                           mixer_attributes_.height}};
+      uint32_t num_rects = std::min(kMaxFrameROIs, UINT32(hw_layers_info->left_frame_roi.size()));
+
+      for (uint32_t i = 0; i < num_rects; i++) {
         auto &roi = hw_layers_info->left_frame_roi.at(i);
         // TODO(user): In multi PU, stitch ROIs vertically adjacent and upate plane destination
         crtc_rects[i].left = UINT32(roi.left);
@@ -1450,7 +1425,7 @@ void HWDeviceDRM::SetupAtomic(Fence::ScopedRef &scoped_ref, HWLayersInfo *hw_lay
         spr_rects[i].bottom = UINT32(roi.bottom);
       }
 
-      uint32_t num_rects = std::max(1u, UINT32(hw_layers_info->left_frame_roi.size()));
+      num_rects = std::max(1u, num_rects);
       drm_atomic_intf_->Perform(DRMOps::CRTC_SET_ROI, token_.crtc_id, num_rects, crtc_rects,
                                 spr_rects);
       drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_ROI, token_.conn_id, num_rects, conn_rects);
@@ -1987,6 +1962,48 @@ DisplayError HWDeviceDRM::DefaultCommit(HWLayersInfo *hw_layers_info) {
   return kErrorNone;
 }
 
+// Queries the timestamp of the last vblank on the crtc, without waiting for one.
+class DRMVBlankSource : public VBlankSource {
+ public:
+  DRMVBlankSource(int fd, uint32_t crtc_index) : fd_(fd), crtc_index_(crtc_index) {}
+  int GetLastVBlank(int64_t *timestamp_ns) {
+    drmVBlank vblank {};
+    uint32_t high_crtc = crtc_index_ << DRM_VBLANK_HIGH_CRTC_SHIFT;
+    vblank.request.type = (drmVBlankSeqType)(DRM_VBLANK_RELATIVE |
+                                             (high_crtc & DRM_VBLANK_HIGH_CRTC_MASK));
+    vblank.request.sequence = 0;
+    if (drmWaitVBlank(fd_, &vblank) < 0) {
+      return -errno;
+    }
+    *timestamp_ns = static_cast<int64_t>(vblank.reply.tval_sec) * 1000000000LL +
+                    static_cast<int64_t>(vblank.reply.tval_usec) * 1000LL;
+    return 0;
+  }
+
+ private:
+  int fd_ = -1;
+  uint32_t crtc_index_ = 0;
+};
+
+void HWDeviceDRM::AccountPacedPresent() {
+  if (!present_pacer_.PresentPending()) {
+    return;
+  }
+
+  int64_t present_time = 0;
+  int error = Fence::GetSignalTime(paced_retire_fence_, &present_time);
+  if (!error) {
+    present_pacer_.OnPresent(present_time);
+  } else if (error == -EBUSY) {
+    if (present_pacer_.Now() <= present_pacer_.PendingDeadline()) {
+      return;
+    }
+    present_pacer_.OnMissed();
+  }
+  // Without a signal time the frame is left out of the statistics.
+  paced_retire_fence_ = nullptr;
+}
+
 DisplayError HWDeviceDRM::AtomicCommit(HWLayersInfo *hw_layers_info) {
   DTRACE_SCOPED();
 
@@ -2000,31 +2017,35 @@ DisplayError HWDeviceDRM::AtomicCommit(HWLayersInfo *hw_layers_info) {
                                    &release_fence_fd, &retire_fence_fd);
 
   bool sync_commit = synchronous_commit_ || first_cycle_;
-  uint64_t elapse_timestamp = hw_layers_info->elapse_timestamp;
-
-  struct timespec t = {0, 0};
-  clock_gettime(CLOCK_MONOTONIC, &t);
-  uint64_t current_time = (UINT64(t.tv_sec) * 1000000000LL + t.tv_nsec);
-
-  // Handle the case where EPT and Current time delta is beyond the QSync MinFps period.
-  if (hw_panel_info_.qsync_support && (hw_layers_info->hw_avr_info.mode != kQsyncNone) &&
-      (connector_info_.qsync_fps > 0)) {
-    uint64_t qsync_fps_period = (1000.0f / FLOAT(connector_info_.qsync_fps)) * 1000000;
-    if (hw_layers_info->expected_present_time > current_time) {
-      if ((hw_layers_info->expected_present_time - current_time) > qsync_fps_period) {
-        uint64_t vsync_period = display_attributes_[current_mode_index_].vsync_period_ns;
-        if (hw_layers_info->expected_present_time > vsync_period) {
-          elapse_timestamp = hw_layers_info->expected_present_time - vsync_period;
-        }
-      }
-    }
-  }
+  int64_t commit_time = static_cast<int64_t>(hw_layers_info->elapse_timestamp);
+  int64_t expected_present_time = static_cast<int64_t>(hw_layers_info->expected_present_time);
+  int64_t vsync_period = display_attributes_[current_mode_index_].vsync_period_ns;
+  bool qsync = hw_panel_info_.qsync_support && (hw_layers_info->hw_avr_info.mode != kQsyncNone) &&
+               (connector_info_.qsync_fps > 0);
 
-  if ((elapse_timestamp > 0) && (current_time < elapse_timestamp)) {
-    usleep(UINT32((elapse_timestamp - current_time) / 1000));
+  AccountPacedPresent();
+
+  // Pace frames whose expected present time lies beyond the next refresh, committing right away
+  // would present them early. With QSync the panel refreshes by itself once the QSync MinFps
+  // period runs out, so only expected present times beyond that period are paced.
+  int64_t current_time = present_pacer_.Now();
+  int64_t pacing_window = vsync_period;
+  if (qsync) {
+    pacing_window = static_cast<int64_t>((1000.0f / FLOAT(connector_info_.qsync_fps)) * 1000000);
+  }
+  int64_t target_present_time = 0;
+  if ((vsync_period > 0) && (expected_present_time - current_time > pacing_window)) {
+    DRMVBlankSource vblank(dev_fd_, token_.crtc_index);
+    int64_t paced_commit_time = present_pacer_.GetCommitTime(expected_present_time, vsync_period,
+                                                             qsync, &vblank, &target_present_time);
+    commit_time = std::max(commit_time, paced_commit_time);
   }
 
+  present_pacer_.WaitUntil(commit_time);
+
+  int64_t commit_start = present_pacer_.Now();
   int ret = drm_atomic_intf_->Commit(sync_commit, false /* retain_planes*/);
+  int64_t commit_end = present_pacer_.Now();
   shared_ptr<Fence> release_fence = Fence::Create(INT(release_fence_fd), "release");
   shared_ptr<Fence> retire_fence = Fence::Create(INT(retire_fence_fd), "retire");
   if (ret) {
@@ -2042,6 +2063,8 @@ DisplayError HWDeviceDRM::AtomicCommit(HWLayersInfo *hw_layers_info) {
   DLOGD_IF(kTagDriverConfig, "RETIRE fence: fd: %s", Fence::GetStr(retire_fence).c_str());
 
   hw_layers_info->retire_fence = retire_fence;
+  present_pacer_.OnCommit(target_present_time, commit_start, commit_end, vsync_period, qsync);
+  paced_retire_fence_ = target_present_time ? retire_fence : nullptr;
 
   for (uint32_t i = 0; i < hw_layers_info->hw_layers.size(); i++) {
     Layer &layer = hw_layers_info->hw_layers.at(i);
@@ -3365,16 +3388,16 @@ void HWDeviceDRM::ConfigureConcurrentWriteback(const HWLayersInfo &hw_layer_info
       drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_ROI, vitual_conn_id, 0, nullptr);
       DLOGV_IF(kTagDriverConfig, "roi_v1 of virtual connector is set NULL (Full Frame update).");
     } else {
-      const int kNumMaxROIs = 4;
-      sde_drm::DRMRect conn_rects[kNumMaxROIs] = {full_frame};
-      for (uint32_t i = 0; i < hw_layer_info.left_frame_roi.size(); i++) {
+      sde_drm::DRMRect conn_rects[kMaxFrameROIs] = {full_frame};
+      uint32_t num_rects = std::min(kMaxFrameROIs, UINT32(hw_layer_info.left_frame_roi.size()));
+      for (uint32_t i = 0; i < num_rects; i++) {
         auto &roi = hw_layer_info.left_frame_roi.at(i);
         conn_rects[i].left = UINT32(roi.left);
         conn_rects[i].right = UINT32(roi.right);
         conn_rects[i].top = UINT32(roi.top);
         conn_rects[i].bottom = UINT32(roi.bottom);
       }
-      uint32_t num_rects = std::max(1u, UINT32(hw_layer_info.left_frame_roi.size()));
+      num_rects = std::max(1u, num_rects);
       drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_ROI, vitual_conn_id, num_rects, conn_rects);
     }
 
@@ -67,6 +67,7 @@
 #define __HW_DEVICE_DRM_H__
 
 #include <utils/formats.h>
+#include <utils/present_pacer.h>
 #include <private/hw_interface.h>
 #include <drm_interface.h>
 #include <errno.h>
@@ -81,6 +82,7 @@
 
 #include "hw_scale_drm.h"
 #include "hw_color_manager_drm.h"
+#include "hw_fbid_cache.h"
 
 #define IOCTL_LOGE(ioctl, type) \
   DLOGE("ioctl %s, device = %d errno = %d, desc = %s", #ioctl, type, errno, strerror(errno))
@@ -88,6 +90,7 @@
 #define UI_FBID_LIMIT 4
 #define VIDEO_FBID_LIMIT 32
 #define OFFLINE_ROTATOR_FBID_LIMIT 2
+#define DISPLAY_FBID_LIMIT 64
 
 using sde_drm::DRMPowerMode;
 namespace sdm {
@@ -166,6 +169,7 @@ class HWDeviceDRM : public HWInterface {
   virtual DisplayError GetMixerAttributes(HWMixerAttributes *mixer_attributes);
   virtual void InitializeConfigs();
   virtual DisplayError DumpDebugData();
+  virtual std::string Dump() { return registry_.Dump() + present_pacer_.Dump(); }
   virtual void PopulateHWPanelInfo();
   virtual DisplayError SetDppsFeature(void *payload, size_t size) { return kErrorNotSupported; }
   virtual DisplayError GetDppsFeatureInfo(void *payload, size_t size) { return kErrorNotSupported; }
@@ -294,9 +298,12 @@ class HWDeviceDRM : public HWInterface {
     int Register(HWLayersInfo *hw_layers_info);
     // Called on display disconnect to clear output buffer map and remove fb_ids.
     void Clear();
+    // Called on display teardown to drop the display wide fb_id cache.
+    void ClearFbIdCache();
     // Create the fd_id for the given buffer.
     int CreateFbId(const LayerBuffer &buffer, uint32_t *fb_id);
-    // Find handle_id in the layer map. Else create fb_id and add <handle_id,fb_id> in map.
+    // Find buffer in the display fb_id cache. Else create fb_id and add it to the cache. In both
+    // cases the layer map references the fb_id for GetFbId().
     int MapBufferToFbId(Layer *layer, const LayerBuffer &buffer, bool *fb_modified);
     // Find handle_id in output buffer map. Else create fb_id and add <handle_id,fb_id> in map.
     void MapOutputBufferToFbId(std::shared_ptr<LayerBuffer> buffer, bool *fb_modified);
@@ -304,16 +311,20 @@ class HWDeviceDRM : public HWInterface {
     uint32_t GetFbId(Layer *layer, uint64_t handle_id);
     // Find fb_id for given handle_id in output buffer map.
     uint32_t GetOutputFbId(uint64_t handle_id);
+    std::string Dump();
 
    private:
     bool disable_fbid_cache_ = false;
     std::unordered_map<uint64_t, std::shared_ptr<LayerBufferObject>> output_buffer_map_ {};
     BufferAllocator *buffer_allocator_ = {};
     uint8_t fbid_cache_limit_ = UI_FBID_LIMIT;
+    FbIdCache fbid_cache_;
   };
 
  protected:
   void SetDisplaySwitchMode(uint32_t index);
+  // Feeds the present time of the last paced commit to the pacer once its retire fence signaled.
+  void AccountPacedPresent();
   bool IsSeamlessTransition() {
     return (hw_panel_info_.dynamic_fps && (vrefresh_ || seamless_mode_switch_)) ||
      panel_mode_changed_ || bit_clk_rate_;
@@ -374,6 +385,8 @@ class HWDeviceDRM : public HWInterface {
   HWCwbConfig cwb_config_ = {};
   static std::mutex cwb_state_lock_;  // cwb state lock. Set before accesing or updating cwb_config_
   uint32_t transfer_time_updated_ = 0;
+  PresentPacer present_pacer_;
+  shared_ptr<Fence> paced_retire_fence_ = nullptr;  // Retire fence of the last paced commit.
   bool force_tonemapping_ = false;
   bool enable_brightness_drm_prop_ = false;
   int cached_brightness_level_ = -1;
@@ -30,7 +30,7 @@
 /*
 * Changes from Qualcomm Innovation Center are provided under the following license:
 *
-* Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+* Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
 *
 * Redistribution and use in source and binary forms, with or without
 * modification, are permitted (subject to the limitations in the
@@ -63,6 +63,7 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <drm_lib_loader.h>
 #include <drm_master.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -112,21 +113,56 @@
 
 namespace sdm {
 
+using drm_utils::DRMLibLoader;
 using drm_utils::DRMMaster;
 
+// Events the SDE driver raises on a DRM node fd of their own
+static bool IsDriverEvent(HWEvent event) {
+  switch (event) {
+    case HWEvent::IDLE_POWER_COLLAPSE:
+    case HWEvent::PANEL_DEAD:
+    case HWEvent::HW_RECOVERY:
+    case HWEvent::HISTOGRAM:
+    case HWEvent::MMRM:
+    case HWEvent::POWER_EVENT:
+    case HWEvent::VM_RELEASE_EVENT:
+      return true;
+    default:
+      return false;
+  }
+}
+
 DisplayError HWEventsDRM::InitializePollFd() {
+  int ret = event_poller_.Init();
+  if (ret < 0) {
+    DLOGE("Failed to create event poller, error = %d", ret);
+    return kErrorResources;
+  }
+
   for (uint32_t i = 0; i < event_data_list_.size(); i++) {
     char data[kMaxStringLength]{};
     HWEventData &event_data = event_data_list_[i];
     poll_fds_[i] = {};
     poll_fds_[i].fd = -1;
 
+    // A backend without a DRM node never raises driver events, their indices stay unset so that
+    // registering them is a no-op.
+    if (func_open_event_fd_ && IsDriverEvent(event_data.event_type)) {
+      continue;
+    }
+
     switch (event_data.event_type) {
       case HWEvent::VSYNC: {
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
-        if (is_primary_) {
+        poll_fds_[i].events = EPOLLIN | EPOLLPRI;
+        if (func_open_event_fd_) {
+          ret = func_open_event_fd_(&poll_fds_[i].fd);
+          if (ret < 0) {
+            DLOGE("Failed to open the backend's event fd, error = %d", ret);
+            return kErrorResources;
+          }
+        } else if (is_primary_) {
           DRMMaster *master = nullptr;
-          int ret = DRMMaster::GetInstance(&master);
+          ret = DRMMaster::GetInstance(&master);
           if (ret < 0) {
             DLOGE("Failed to acquire DRMMaster instance");
             return kErrorNotSupported;
@@ -138,10 +174,10 @@ DisplayError HWEventsDRM::InitializePollFd() {
         vsync_index_ = i;
       } break;
       case HWEvent::EXIT: {
-        // Create an eventfd to be used to unblock the poll system call when
+        // Create an eventfd to be used to unblock the epoll wait when
         // a thread is exiting.
-        poll_fds_[i].fd = Sys::eventfd_(0, 0);
-        poll_fds_[i].events |= POLLIN;
+        poll_fds_[i].fd = Sys::eventfd_(0, EFD_NONBLOCK);
+        poll_fds_[i].events = EPOLLIN | EPOLLET;
         // Clear any existing data
         Sys::pread_(poll_fds_[i].fd, data, kMaxStringLength, 0);
       } break;
@@ -151,7 +187,7 @@ DisplayError HWEventsDRM::InitializePollFd() {
           DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
+        poll_fds_[i].events = EPOLLIN | EPOLLPRI;
         idle_pc_index_ = i;
       } break;
       case HWEvent::PANEL_DEAD: {
@@ -160,7 +196,7 @@ DisplayError HWEventsDRM::InitializePollFd() {
           DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
+        poll_fds_[i].events = EPOLLIN | EPOLLPRI;
         panel_dead_index_ = i;
       } break;
       case HWEvent::HW_RECOVERY: {
@@ -169,7 +205,7 @@ DisplayError HWEventsDRM::InitializePollFd() {
           DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
+        poll_fds_[i].events = EPOLLIN | EPOLLPRI;
         hw_recovery_index_ = i;
       } break;
       case HWEvent::HISTOGRAM: {
@@ -178,7 +214,7 @@ DisplayError HWEventsDRM::InitializePollFd() {
           DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
+        poll_fds_[i].events = EPOLLIN | EPOLLPRI;
         histogram_index_ = i;
       } break;
       case HWEvent::BACKLIGHT_EVENT: {
@@ -188,8 +224,10 @@ DisplayError HWEventsDRM::InitializePollFd() {
           DLOGE("inotify init failed");
           return kErrorResources;
         }
+        // Drained until empty on each wake-up, see HandleBacklightNotify.
+        EventPoller::SetNonBlocking(inotify_fd);
         poll_fds_[i].fd = inotify_fd;
-        poll_fds_[i].events = POLLIN;
+        poll_fds_[i].events = EPOLLIN | EPOLLET;
         backlight_event_index_ = i;
         DLOGI("%s backlight_event_index_ %d", brightness_node_.c_str(), backlight_event_index_);
       } break;
@@ -199,7 +237,7 @@ DisplayError HWEventsDRM::InitializePollFd() {
           DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
+        poll_fds_[i].events = EPOLLIN | EPOLLPRI;
         mmrm_index_ = i;
       } break;
       case HWEvent::POWER_EVENT: {
@@ -208,7 +246,7 @@ DisplayError HWEventsDRM::InitializePollFd() {
           DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
+        poll_fds_[i].events = EPOLLIN | EPOLLPRI;
         power_event_index_ = i;
       } break;
       case HWEvent::VM_RELEASE_EVENT: {
@@ -217,12 +255,23 @@ DisplayError HWEventsDRM::InitializePollFd() {
           DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
+        poll_fds_[i].events = EPOLLIN | EPOLLPRI;
         vm_release_event_index_ = i;
       } break;
       default:
         break;
     }
+
+    // DRM event fds are read one response at a time and the primary vsync fd is shared with
+    // DRMMaster, so those stay level triggered.
+    if (poll_fds_[i].fd >= 0) {
+      ret = event_poller_.Add(poll_fds_[i].fd, i, poll_fds_[i].events);
+      if (ret < 0) {
+        DLOGE("Failed to add fd %d of event %d, error = %d", poll_fds_[i].fd,
+              event_data.event_type, ret);
+        return kErrorResources;
+      }
+    }
   }
 
   return kErrorNone;
@@ -310,6 +359,15 @@ DisplayError HWEventsDRM::Init(int display_id, DisplayType display_type,
   event_handler_ = event_handler;
   poll_fds_.resize(event_list.size());
 
+  DRMLibLoader *drm_lib_loader = DRMLibLoader::GetInstance();
+  if (drm_lib_loader->IsLoaded() && drm_lib_loader->FuncOpenDRMEventFd()) {
+    func_open_event_fd_ = drm_lib_loader->FuncOpenDRMEventFd();
+    func_close_event_fd_ = drm_lib_loader->FuncCloseDRMEventFd();
+    func_request_vblank_ = drm_lib_loader->FuncRequestDRMVBlank();
+    func_handle_vblank_ = drm_lib_loader->FuncHandleDRMVBlank();
+    DLOGI("Vsync is raised by the DRM backend, driver events are not supported");
+  }
+
   DLOGI("poll_fd size %d", (int)poll_fds_.size());
   event_thread_name_ += " - " + std::to_string(display_id) + "-" + std::to_string(display_type);
 
@@ -394,12 +452,21 @@ DisplayError HWEventsDRM::SetEventState(HWEvent event, bool enable, void *arg) {
           Sys::inotify_rm_watch_(inotify_fd, backlight_wd_);
         }
         backlight_wd_ = -1;
+        if (brightness_fd_ >= 0) {
+          Sys::close_(brightness_fd_);
+          brightness_fd_ = -1;
+        }
       } else if (enable && backlight_wd_ < 0) {
         backlight_wd_ = Sys::inotify_add_watch_(inotify_fd, brightness_node_.c_str(), IN_MODIFY);
         if (backlight_wd_ < 0) {
           DLOGE("inotify_add_watch failed %d", backlight_wd_);
           return kErrorResources;
         }
+        // Kept open while watched, each change is read back with pread at offset 0.
+        brightness_fd_ = Sys::open_(brightness_node_.c_str(), O_RDONLY);
+        if (brightness_fd_ < 0) {
+          DLOGW("Failed to open %s, error = %s", brightness_node_.c_str(), strerror(errno));
+        }
       }
     } break;
     case HWEvent::POWER_EVENT: {
@@ -458,7 +525,9 @@ void HWEventsDRM::CloseFds() {
   for (uint32_t i = 0; i < event_data_list_.size(); i++) {
     switch (event_data_list_[i].event_type) {
       case HWEvent::VSYNC:
-        if (!is_primary_) {
+        if (func_close_event_fd_) {
+          func_close_event_fd_(poll_fds_[i].fd);
+        } else if (!is_primary_) {
           drmClose(poll_fds_[i].fd);
         }
         poll_fds_[i].fd = -1;
@@ -472,6 +541,10 @@ void HWEventsDRM::CloseFds() {
         Sys::inotify_rm_watch_(poll_fds_[i].fd, backlight_wd_);
         Sys::close_(poll_fds_[i].fd);
         poll_fds_[i].fd = -1;
+        if (brightness_fd_ >= 0) {
+          Sys::close_(brightness_fd_);
+          brightness_fd_ = -1;
+        }
       } break;
       case HWEvent::MMRM:
       case HWEvent::IDLE_POWER_COLLAPSE:
@@ -480,7 +553,9 @@ void HWEventsDRM::CloseFds() {
       case HWEvent::HISTOGRAM:
       case HWEvent::POWER_EVENT:
       case HWEvent::VM_RELEASE_EVENT:
-        drmClose(poll_fds_[i].fd);
+        if (poll_fds_[i].fd >= 0) {
+          drmClose(poll_fds_[i].fd);
+        }
         poll_fds_[i].fd = -1;
         break;
       case HWEvent::CEC_READ_MESSAGE:
@@ -492,6 +567,8 @@ void HWEventsDRM::CloseFds() {
         break;
     }
   }
+
+  event_poller_.Deinit();
 }
 
 void *HWEventsDRM::DisplayEventThread(void *context) {
@@ -513,16 +590,20 @@ void *HWEventsDRM::DisplayEventHandler() {
   param.sched_priority = sched_get_priority_min(SCHED_FIFO);
   sched_setscheduler(0, SCHED_FIFO, &param);
 
+  std::vector<EventPoller::Event> ready;
   while (!exit_threads_) {
-    int error = Sys::poll_(poll_fds_.data(), UINT32(poll_fds_.size()), -1);
-    if (error <= 0) {
-      DLOGW("poll failed. error = %s", strerror(errno));
+    int count = event_poller_.Wait(-1, &ready);
+    if (count <= 0) {
+      DLOGW("epoll_wait failed. error = %s", strerror(-count));
       continue;
     }
 
-    for (uint32_t i = 0; i < event_data_list_.size(); i++) {
-      pollfd &poll_fd = poll_fds_[i];
-      if (poll_fd.fd < 0) {
+    // Handles every ready source before reporting vsync, idle power collapse and histogram
+    // events, once per wake-up.
+    for (auto &event : ready) {
+      uint32_t i = event.id;
+      int fd = poll_fds_[i].fd;
+      if (fd < 0) {
         continue;
       }
 
@@ -535,42 +616,26 @@ void *HWEventsDRM::DisplayEventHandler() {
         case HWEvent::MMRM:
         case HWEvent::POWER_EVENT:
         case HWEvent::VM_RELEASE_EVENT:
-          if (poll_fd.revents & (POLLIN | POLLPRI | POLLERR)) {
+          if (event.events & (EPOLLIN | EPOLLPRI | EPOLLERR)) {
             (this->*(event_data_list_[i]).event_parser)(nullptr);
           }
           break;
         case HWEvent::EXIT:
-          if ((poll_fd.revents & POLLIN) &&
-              (Sys::read_(poll_fd.fd, data, kMaxStringLength) > 0)) {
+          // A single read resets the eventfd counter.
+          if ((event.events & EPOLLIN) && (Sys::read_(fd, data, kMaxStringLength) > 0)) {
             (this->*(event_data_list_[i]).event_parser)(data);
           }
           break;
         case HWEvent::BACKLIGHT_EVENT:
-          if ((poll_fd.revents & POLLIN)) {
-            char buffer[kMaxEventBufferLength] = {};
-            int len = 0;
-            int length = Sys::read_(poll_fd.fd, buffer, kMaxEventBufferLength);
-            while (len < length) {
-              struct inotify_event *event = (struct inotify_event *) &buffer[len];
-              DLOGI("event masks %x in_modify %x", event->mask, IN_MODIFY);
-              if (event->mask & IN_MODIFY) {
-                int brightness_fd = Sys::open_(brightness_node_.c_str(), O_RDONLY);
-                if (brightness_fd > 0) {
-                  if (Sys::read_(brightness_fd, data, kMaxStringLength) > 0) {
-                      (this->*(event_data_list_[i]).event_parser)(data);
-                  }
-                  Sys::close_(brightness_fd);
-                }
-              }
-              len += sizeof(struct inotify_event) + event->len;
-            }
-          }  break;
+          if ((event.events & EPOLLIN) && HandleBacklightNotify(fd, data)) {
+            (this->*(event_data_list_[i]).event_parser)(data);
+          }
+          break;
         case HWEvent::CEC_READ_MESSAGE:
         case HWEvent::SHOW_BLANK_EVENT:
         case HWEvent::THERMAL_LEVEL:
         case HWEvent::PINGPONG_TIMEOUT:
-          if ((poll_fd.revents & POLLPRI) &&
-              (Sys::pread_(poll_fd.fd, data, kMaxStringLength, 0) > 0)) {
+          if ((event.events & EPOLLPRI) && (Sys::pread_(fd, data, kMaxStringLength, 0) > 0)) {
             (this->*(event_data_list_[i]).event_parser)(data);
           }
           break;
@@ -578,6 +643,8 @@ void *HWEventsDRM::DisplayEventHandler() {
           break;
       }
     }
+
+    DispatchPendingEvents();
   }
 
   DLOGI("Exiting the thread");
@@ -586,8 +653,72 @@ void *HWEventsDRM::DisplayEventHandler() {
   return nullptr;
 }
 
+bool HWEventsDRM::HandleBacklightNotify(int inotify_fd, char *data) {
+  bool modified = false;
+  char buffer[kMaxEventBufferLength];
+  ssize_t ret = EventPoller::Drain(inotify_fd, buffer, kMaxEventBufferLength,
+                                   [&](char *events, ssize_t length) {
+    ssize_t len = 0;
+    while (len < length) {
+      struct inotify_event *event = (struct inotify_event *) &events[len];
+      DLOGI("event masks %x in_modify %x", event->mask, IN_MODIFY);
+      modified |= ((event->mask & IN_MODIFY) != 0);
+      len += sizeof(struct inotify_event) + event->len;
+    }
+  });
+  if (ret < 0) {
+    DLOGW("inotify read failed. error = %s", strerror(-ret));
+  }
+
+  // Several modifications in one wake-up are reported once with the current brightness.
+  if (!modified) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(backlight_mutex_);
+  if (brightness_fd_ < 0) {
+    return false;
+  }
+
+  ssize_t length = Sys::pread_(brightness_fd_, data, kMaxStringLength - 1, 0);
+  if (length <= 0) {
+    return false;
+  }
+  data[length] = '\0';
+
+  return true;
+}
+
+void HWEventsDRM::DispatchPendingEvents() {
+  PendingEvents pending = pending_events_;
+  pending_events_ = {};
+
+  if (pending.vsync) {
+    DTRACE_SCOPED();
+    event_handler_->VSync(pending.vsync_timestamp);
+  }
+
+  if (pending.idle_power_collapse) {
+    DLOGV("Received Idle power collapse event");
+    event_handler_->IdlePowerCollapse();
+  }
+
+  if (pending.histogram) {
+    event_handler_->Histogram(poll_fds_[histogram_index_].fd, pending.histogram_blob_id);
+  }
+}
+
 DisplayError HWEventsDRM::RegisterVSync() {
   DTRACE_SCOPED();
+  if (func_request_vblank_) {
+    int error = func_request_vblank_(poll_fds_[vsync_index_].fd);
+    if (error < 0) {
+      DLOGE("Failed to request a vblank from the backend, error = %d", error);
+      return kErrorResources;
+    }
+    return kErrorNone;
+  }
+
   drmVBlank vblank {};
   uint32_t high_crtc = token_.crtc_index << DRM_VBLANK_HIGH_CRTC_SHIFT;
   vblank.request.type = (drmVBlankSeqType)(DRM_VBLANK_RELATIVE | DRM_VBLANK_EVENT |
@@ -804,12 +935,23 @@ void HWEventsDRM::HandleVSync(char *data) {
     }
   }
 
-  drmEventContext event = {};
-  event.version = DRM_EVENT_CONTEXT_VERSION;
-  event.vblank_handler = &HWEventsDRM::VSyncHandlerCallback;
-  int error = drmHandleEvent(poll_fds_[vsync_index_].fd, &event);
-  if (error != 0) {
-    DLOGE("drmHandleEvent failed: %i", error);
+  if (func_handle_vblank_) {
+    int64_t timestamp = 0;
+    int error = func_handle_vblank_(poll_fds_[vsync_index_].fd, &timestamp);
+    if (error == 0) {
+      VSyncHandlerCallback(poll_fds_[vsync_index_].fd, 0, UINT32(timestamp / 1000000000),
+                           UINT32((timestamp % 1000000000) / 1000), this);
+    } else if (error != -EAGAIN) {
+      DLOGE("Failed to handle the backend's vblank, error = %d", error);
+    }
+  } else {
+    drmEventContext event = {};
+    event.version = DRM_EVENT_CONTEXT_VERSION;
+    event.vblank_handler = &HWEventsDRM::VSyncHandlerCallback;
+    int error = drmHandleEvent(poll_fds_[vsync_index_].fd, &event);
+    if (error != 0) {
+      DLOGE("drmHandleEvent failed: %i", error);
+    }
   }
 
   if (vsync_handler_count_ > 1) {
@@ -870,8 +1012,9 @@ void HWEventsDRM::VSyncHandlerCallback(int fd, unsigned int sequence, unsigned i
   HWEventsDRM *ev_data = reinterpret_cast<HWEventsDRM *>(data);
   ev_data->vsync_handler_count_++;
   int64_t timestamp = (int64_t)(tv_sec)*1000000000 + (int64_t)(tv_usec)*1000;
-  DTRACE_SCOPED();
-  ev_data->event_handler_->VSync(timestamp);
+  // Stale vblanks handled in the same wake-up are superseded by the latest one.
+  ev_data->pending_events_.vsync = true;
+  ev_data->pending_events_.vsync_timestamp = timestamp;
 }
 
 void HWEventsDRM::HandleCECMessage(char *data) {
@@ -907,8 +1050,7 @@ void HWEventsDRM::HandleIdlePowerCollapse(char *data) {
       {
         uint32_t* event_payload = reinterpret_cast<uint32_t *>(event_resp->data);
         if (*event_payload == 0) {
-          DLOGV("Received Idle power collapse event");
-          event_handler_->IdlePowerCollapse();
+          pending_events_.idle_power_collapse = true;
         }
         break;
       }
@@ -1008,7 +1150,9 @@ void HWEventsDRM::HandleHistogram(char * /*data*/) {
 
   auto msm_event = reinterpret_cast<struct drm_msm_event_resp *>(event_data.data());
   auto blob_id = reinterpret_cast<uint32_t *>(msm_event->data);
-  event_handler_->Histogram(poll_fds_[histogram_index_].fd, *blob_id);
+  // Only the latest histogram blob is reported.
+  pending_events_.histogram = true;
+  pending_events_.histogram_blob_id = *blob_id;
 }
 
 void HWEventsDRM::HandleBacklightEvent(char *data) {
@@ -30,7 +30,7 @@
 /*
 * Changes from Qualcomm Innovation Center are provided under the following license:
 *
-* Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+* Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
 *
 * Redistribution and use in source and binary forms, with or without
 * modification, are permitted (subject to the limitations in the
@@ -71,6 +71,7 @@
 #include <sys/inotify.h>
 #include <private/hw_events_interface.h>
 #include <private/hw_interface.h>
+#include <utils/event_poller.h>
 #include <map>
 #include <mutex>
 #include <string>
@@ -103,6 +104,15 @@ class HWEventsDRM : public HWEventsInterface {
     EventParser event_parser {};
   };
 
+  // Events collected while handling one wake-up, reported once after all sources are read.
+  struct PendingEvents {
+    bool vsync = false;
+    int64_t vsync_timestamp = 0;
+    bool idle_power_collapse = false;
+    bool histogram = false;
+    uint32_t histogram_blob_id = 0;
+  };
+
   static void *DisplayEventThread(void *context);
   static void VSyncHandlerCallback(int fd, unsigned int sequence, unsigned int tv_sec,
                                    unsigned int tv_usec, void *data);
@@ -121,6 +131,8 @@ class HWEventsDRM : public HWEventsInterface {
   void HandleMMRM(char *data);
   void HandlePowerEvent(char * /*data*/);
   void HandleVmReleaseEvent(char * /*data*/);
+  bool HandleBacklightNotify(int inotify_fd, char *data);
+  void DispatchPendingEvents();
   int SetHwRecoveryEvent(const uint32_t hw_event_code, HWRecoveryEvent *sdm_event_code);
   void PopulateHWEventData(const vector<HWEvent> &event_list);
   void WakeUpEventThread();
@@ -139,6 +151,8 @@ class HWEventsDRM : public HWEventsInterface {
   HWEventHandler *event_handler_{};
   vector<HWEventData> event_data_list_{};
   vector<pollfd> poll_fds_{};
+  EventPoller event_poller_;
+  PendingEvents pending_events_ = {};
   pthread_t event_thread_{};
   std::string event_thread_name_ = "SDM_EventThread";
   bool exit_threads_ = false;
@@ -158,11 +172,18 @@ class HWEventsDRM : public HWEventsInterface {
   uint32_t backlight_event_index_ = UINT32_MAX;
   std::string brightness_node_ = {};
   int backlight_wd_ = -1;
+  int brightness_fd_ = -1;
   bool disable_mmrm_ = false;
   uint32_t mmrm_index_ = UINT32_MAX;
   uint32_t power_event_index_ = UINT32_MAX;
   uint32_t vm_release_event_index_ = UINT32_MAX;
   std::bitset<HW_EVENT_MAX> registered_hw_events_ = {};
+  // Vblank hooks of a backend without a DRM node, vsync is then polled on an fd the backend
+  // opens and no driver event is registered
+  sde_drm::OpenDRMEventFd func_open_event_fd_ = {};
+  sde_drm::CloseDRMEventFd func_close_event_fd_ = {};
+  sde_drm::RequestDRMVBlank func_request_vblank_ = {};
+  sde_drm::HandleDRMVBlank func_handle_vblank_ = {};
 };
 
 }  // namespace sdm
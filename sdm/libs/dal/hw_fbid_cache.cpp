@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <drm_master.h>
+#include <errno.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+
+#include <iterator>
+#include <sstream>
+
+#include "hw_fbid_cache.h"
+
+#define __CLASS__ "FbIdCache"
+
+using drm_utils::DRMMaster;
+
+namespace sdm {
+
+FrameBufferObject::FrameBufferObject(uint32_t fb_id, LayerBufferFormat format, uint32_t width,
+                                     uint32_t height, bool shallow, bool secure)
+    : fb_id_(fb_id),
+      format_(format),
+      width_(width),
+      height_(height),
+      shallow_(shallow),
+      secure_(secure) {}
+
+FrameBufferObject::~FrameBufferObject() {
+  // Don't call RemoveFbId in case its a shallow copy from other display
+  if (shallow_) {
+    DLOGI("FBID: %d is a shallow copy", fb_id_);
+    return;
+  }
+
+  DRMMaster *master;
+  DRMMaster::GetInstance(&master);
+  int ret = master->RemoveFbId(fb_id_);
+  if (ret < 0) {
+    DLOGE("Removing fb_id %d failed with error %d", fb_id_, errno);
+  }
+}
+
+uint32_t FrameBufferObject::GetFbId() {
+  return fb_id_;
+}
+
+bool FrameBufferObject::IsEqual(LayerBufferFormat format, uint32_t width, uint32_t height,
+                                bool secure) {
+  // Create a new framebuffer object when the format, width, height, or secure flag gets updated
+  return (format == format_ && width == width_ && height == height_ && secure == secure_);
+}
+
+size_t FbIdCache::KeyHash::operator()(const Key &key) const {
+  size_t hash = std::hash<uint64_t>()(key.handle_id);
+  hash ^= std::hash<uint64_t>()((UINT64(key.format) << 32) | key.width) + 0x9e3779b9 +
+          (hash << 6) + (hash >> 2);
+  hash ^= std::hash<uint64_t>()((UINT64(key.height) << 1) | UINT64(key.interlace)) + 0x9e3779b9 +
+          (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+int FbIdCache::Map(LayerBufferMap *layer_map, const LayerBuffer &buffer, uint32_t layer_limit,
+                   bool *fb_modified) {
+  uint64_t handle_id = buffer.handle_id;
+  bool secure = (buffer.flags.secure || buffer.flags.secure_display || buffer.flags.secure_camera);
+  std::shared_ptr<LayerBufferObject> fb_obj;
+
+  if (secure) {
+    // Only the layer map holds secure fb_ids, so they are removed once the layers let go.
+    auto it = layer_map->buffer_map.find(handle_id);
+    if (it != layer_map->buffer_map.end()) {
+      FrameBufferObject *layer_fb_obj = static_cast<FrameBufferObject *>(it->second.get());
+      if (layer_fb_obj->IsEqual(buffer.format, buffer.width, buffer.height, secure)) {
+        return 0;
+      }
+      layer_map->buffer_map.erase(it);
+    }
+
+    int ret = Create(buffer, secure, &fb_obj);
+    if (ret < 0) {
+      return ret;
+    }
+    Reference(layer_map, handle_id, fb_obj, layer_limit, fb_modified);
+    return 0;
+  }
+
+  Key key;
+  key.handle_id = handle_id;
+  key.format = buffer.format;
+  key.width = buffer.width;
+  key.height = buffer.height;
+  key.interlace = buffer.flags.interlace;
+
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    hits_++;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    it->second->last_use = register_count_;
+    Reference(layer_map, handle_id, it->second->fb_obj, layer_limit, fb_modified);
+    return 0;
+  }
+
+  misses_++;
+  int ret = Create(buffer, secure, &fb_obj);
+  if (ret < 0) {
+    return ret;
+  }
+  lru_.push_front({key, fb_obj, register_count_});
+  cache_[key] = lru_.begin();
+  Reference(layer_map, handle_id, fb_obj, layer_limit, fb_modified);
+
+  return 0;
+}
+
+int FbIdCache::Create(const LayerBuffer &buffer, bool secure,
+                      std::shared_ptr<LayerBufferObject> *fb_obj) {
+  uint32_t fb_id = 0;
+  if (create_fb_id_(buffer, &fb_id) < 0) {
+    return -EINVAL;
+  }
+
+  *fb_obj = std::make_shared<FrameBufferObject>(fb_id, buffer.format, buffer.width, buffer.height,
+                                                false /* shallow */, secure);
+  return 0;
+}
+
+void FbIdCache::Reference(LayerBufferMap *layer_map, uint64_t handle_id,
+                          const std::shared_ptr<LayerBufferObject> &fb_obj, uint32_t layer_limit,
+                          bool *fb_modified) {
+  auto &buffer_map = layer_map->buffer_map;
+  auto it = buffer_map.find(handle_id);
+  if (it != buffer_map.end()) {
+    if (it->second == fb_obj) {
+      return;
+    }
+    it->second = fb_obj;
+  } else {
+    // The layer map only pins what this layer may scan out next; the display cache owns reuse.
+    if (buffer_map.size() >= layer_limit) {
+      buffer_map.clear();
+    }
+    buffer_map[handle_id] = fb_obj;
+  }
+
+  *fb_modified = true;
+}
+
+void FbIdCache::Evict() {
+  register_count_++;
+
+  while (lru_.size() > limit_) {
+    cache_.erase(lru_.back().key);
+    lru_.pop_back();
+    evictions_++;
+  }
+
+  // Buffers freed by their producer must not stay pinned until the limit is reached: once no layer
+  // map references an entry and it went unused for kIdleRegistrations, its fb_id is removed.
+  auto it = lru_.end();
+  while (it != lru_.begin()) {
+    auto entry = std::prev(it);
+    if (register_count_ - entry->last_use <= kIdleRegistrations) {
+      break;
+    }
+    if (entry->fb_obj.use_count() == 1) {
+      cache_.erase(entry->key);
+      lru_.erase(entry);
+      evictions_++;
+    } else {
+      it = entry;
+    }
+  }
+}
+
+void FbIdCache::Clear() {
+  cache_.clear();
+  lru_.clear();
+}
+
+std::string FbIdCache::Dump() {
+  std::ostringstream os;
+  os << lru_.size() << "/" << limit_ << " hits: " << hits_ << " misses: " << misses_
+     << " evictions: " << evictions_;
+  return os.str();
+}
+
+}  // namespace sdm
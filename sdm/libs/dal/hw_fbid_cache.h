@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __HW_FBID_CACHE_H__
+#define __HW_FBID_CACHE_H__
+
+#include <core/layer_stack.h>
+#include <private/hw_info_types.h>
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace sdm {
+
+// Display wide cache of fb_ids, keyed by buffer id and the attributes the fb_id was created with.
+// Entries are refcounted FrameBufferObjects shared with the layer buffer maps, so a buffer seen
+// on any layer of the display is scanned out through the same fb_id, and a layer map dropping its
+// references does not remove fb_ids the display still reuses. Secure buffers are only ever held
+// by the layer maps that scan them out, never by the cache, so they go with their last layer.
+class FbIdCache {
+ public:
+  typedef std::function<int(const LayerBuffer &buffer, uint32_t *fb_id)> CreateFbIdFunc;
+
+  FbIdCache(CreateFbIdFunc create_fb_id, uint32_t limit)
+    : create_fb_id_(create_fb_id), limit_(limit) {}
+  // Makes layer_map reference an fb_id for buffer, from the cache or newly created. layer_map
+  // keeps up to layer_limit fb_ids. fb_modified is set if the fb_id the layer scans out changed.
+  int Map(LayerBufferMap *layer_map, const LayerBuffer &buffer, uint32_t layer_limit,
+          bool *fb_modified);
+  // Called once per registration. Evicts the least recently used entries past the display limit,
+  // and entries no layer references that went unused for a while.
+  void Evict();
+  void Clear();
+  void SetLimit(uint32_t limit) { limit_ = limit; }
+  size_t GetSize() { return lru_.size(); }
+  std::string Dump();
+
+  // Registrations an entry no layer references survives unused.
+  static const uint64_t kIdleRegistrations = 60;
+
+ private:
+  // fb_id attributes. The DRM format modifier is derived from format, so it is implied here.
+  struct Key {
+    uint64_t handle_id = 0;
+    LayerBufferFormat format = kFormatInvalid;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool interlace = false;
+
+    bool operator==(const Key &other) const {
+      return handle_id == other.handle_id && format == other.format && width == other.width &&
+             height == other.height && interlace == other.interlace;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+  struct Entry {
+    Key key;
+    std::shared_ptr<LayerBufferObject> fb_obj;
+    uint64_t last_use = 0;
+  };
+  // Most recently used entry at the front.
+  typedef std::list<Entry> EntryList;
+
+  int Create(const LayerBuffer &buffer, bool secure, std::shared_ptr<LayerBufferObject> *fb_obj);
+  void Reference(LayerBufferMap *layer_map, uint64_t handle_id,
+                 const std::shared_ptr<LayerBufferObject> &fb_obj, uint32_t layer_limit,
+                 bool *fb_modified);
+
+  CreateFbIdFunc create_fb_id_;
+  EntryList lru_ {};
+  std::unordered_map<Key, EntryList::iterator, KeyHash> cache_ {};
+  uint32_t limit_ = 0;
+  uint64_t register_count_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+};
+
+}  // namespace sdm
+
+#endif  // __HW_FBID_CACHE_H__
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <drm_master.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "hw_fbid_cache.h"
+
+using drm_utils::DRMBuffer;
+using drm_utils::DRMMaster;
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+// fb_ids the mock DRM master currently has, and how many it ever created.
+std::set<uint32_t> g_fb_ids;
+uint32_t g_created = 0;
+
+// Registry::CreateFbId without the buffer layout, straight into the mock master.
+int CreateFbId(const LayerBuffer &buffer, uint32_t *fb_id) {
+  DRMMaster *master = nullptr;
+  DRMMaster::GetInstance(&master);
+  DRMBuffer layout;
+  layout.fd = buffer.planes[0].fd;
+  layout.width = buffer.width;
+  layout.height = buffer.height;
+  return master->CreateFbId(layout, fb_id);
+}
+
+LayerBuffer MakeBuffer(uint64_t handle_id, LayerBufferFormat format = kFormatRGBA8888) {
+  LayerBuffer buffer;
+  buffer.planes[0].fd = 100;
+  buffer.handle_id = handle_id;
+  buffer.format = format;
+  buffer.width = 1088;
+  buffer.height = 2400;
+  return buffer;
+}
+
+uint32_t GetFbId(const LayerBufferMap &layer_map, uint64_t handle_id) {
+  auto it = layer_map.buffer_map.find(handle_id);
+  if (it == layer_map.buffer_map.end()) {
+    return 0;
+  }
+  return static_cast<FrameBufferObject *>(it->second.get())->GetFbId();
+}
+
+class FbIdCacheTest : public Test {
+ protected:
+  void SetUp() override {
+    g_fb_ids.clear();
+    g_created = 0;
+  }
+
+  void TearDown() override {
+    cache_.Clear();
+    EXPECT_TRUE(g_fb_ids.empty());
+  }
+
+  FbIdCache cache_ {CreateFbId, 64};
+};
+
+}  // namespace
+
+namespace drm_utils {
+
+DRMMaster::~DRMMaster() {}
+
+int DRMMaster::GetInstance(DRMMaster **master) {
+  static DRMMaster instance;
+  *master = &instance;
+  return 0;
+}
+
+int DRMMaster::CreateFbId(const DRMBuffer &drm_buffer, uint32_t *fb_id) {
+  if (drm_buffer.fd < 0) {
+    return -EINVAL;
+  }
+  *fb_id = ++g_created;
+  g_fb_ids.insert(*fb_id);
+  return 0;
+}
+
+int DRMMaster::RemoveFbId(uint32_t fb_id) {
+  return g_fb_ids.erase(fb_id) ? 0 : -ENOENT;
+}
+
+}  // namespace drm_utils
+
+TEST_F(FbIdCacheTest, SharesFbIdsAcrossLayers) {
+  LayerBufferMap first, second;
+  bool modified = false;
+  ASSERT_EQ(0, cache_.Map(&first, MakeBuffer(1), 4, &modified));
+  EXPECT_TRUE(modified);
+
+  // The second layer picks up the same buffer: no new fb_id, but its scanout object changed.
+  modified = false;
+  ASSERT_EQ(0, cache_.Map(&second, MakeBuffer(1), 4, &modified));
+  EXPECT_TRUE(modified);
+  EXPECT_EQ(1u, g_created);
+  EXPECT_EQ(GetFbId(first, 1), GetFbId(second, 1));
+
+  modified = false;
+  ASSERT_EQ(0, cache_.Map(&second, MakeBuffer(1), 4, &modified));
+  EXPECT_FALSE(modified);
+}
+
+TEST_F(FbIdCacheTest, SwapchainDeeperThanLayerLimit) {
+  LayerBufferMap layer;
+  for (int frame = 0; frame < 60; frame++) {
+    bool modified = false;
+    ASSERT_EQ(0, cache_.Map(&layer, MakeBuffer(10 + frame % 6), 4, &modified));
+    cache_.Evict();
+    EXPECT_NE(0u, GetFbId(layer, 10 + frame % 6));
+  }
+  EXPECT_EQ(6u, g_created);
+  EXPECT_LE(layer.buffer_map.size(), 4u);
+}
+
+TEST_F(FbIdCacheTest, ModifiedWhenCacheHitReplacesLayerObject) {
+  LayerBufferMap layer;
+  bool modified = false;
+  ASSERT_EQ(0, cache_.Map(&layer, MakeBuffer(1, kFormatRGBA8888), 4, &modified));
+  uint32_t rgba = GetFbId(layer, 1);
+  ASSERT_EQ(0, cache_.Map(&layer, MakeBuffer(1, kFormatRGBX8888), 4, &modified));
+  EXPECT_NE(rgba, GetFbId(layer, 1));
+
+  // Back to the first format: the display cache still has that fb_id, the layer map does not.
+  modified = false;
+  ASSERT_EQ(0, cache_.Map(&layer, MakeBuffer(1, kFormatRGBA8888), 4, &modified));
+  EXPECT_TRUE(modified);
+  EXPECT_EQ(rgba, GetFbId(layer, 1));
+  EXPECT_EQ(2u, g_created);
+}
+
+TEST_F(FbIdCacheTest, EvictsIdleEntriesNoLayerReferences) {
+  auto dropped = std::make_shared<LayerBufferMap>();
+  LayerBufferMap kept;
+  bool modified = false;
+  ASSERT_EQ(0, cache_.Map(dropped.get(), MakeBuffer(1), 4, &modified));
+  ASSERT_EQ(0, cache_.Map(&kept, MakeBuffer(2), 4, &modified));
+  uint32_t dropped_fb_id = GetFbId(*dropped, 1);
+  uint32_t kept_fb_id = GetFbId(kept, 2);
+
+  // The layer goes away, its buffer lingers only until it has been idle for a while.
+  dropped.reset();
+  for (uint64_t i = 0; i < FbIdCache::kIdleRegistrations; i++) {
+    cache_.Evict();
+  }
+  EXPECT_EQ(1u, g_fb_ids.count(dropped_fb_id));
+  cache_.Evict();
+  EXPECT_EQ(0u, g_fb_ids.count(dropped_fb_id));
+
+  // Idle but still referenced by a layer.
+  EXPECT_EQ(1u, g_fb_ids.count(kept_fb_id));
+  EXPECT_EQ(1u, cache_.GetSize());
+}
+
+TEST_F(FbIdCacheTest, SecureBuffersGoWithTheirLayer) {
+  auto layer = std::make_shared<LayerBufferMap>();
+  LayerBuffer secure = MakeBuffer(7);
+  secure.flags.secure = true;
+  bool modified = false;
+  ASSERT_EQ(0, cache_.Map(layer.get(), secure, 4, &modified));
+  EXPECT_TRUE(modified);
+  EXPECT_EQ(0u, cache_.GetSize());
+
+  modified = false;
+  ASSERT_EQ(0, cache_.Map(layer.get(), secure, 4, &modified));
+  EXPECT_FALSE(modified);
+  EXPECT_EQ(1u, g_created);
+
+  layer.reset();
+  EXPECT_TRUE(g_fb_ids.empty());
+}
+
+TEST_F(FbIdCacheTest, EvictsLeastRecentlyUsedPastLimit) {
+  cache_.SetLimit(4);
+  std::vector<LayerBufferMap> layers(6);
+  bool modified = false;
+  for (uint64_t i = 0; i < 6; i++) {
+    ASSERT_EQ(0, cache_.Map(&layers[i], MakeBuffer(20 + i), 4, &modified));
+  }
+  cache_.Evict();
+  EXPECT_EQ(4u, cache_.GetSize());
+  // Evicted entries stay valid for the layers still scanning them out.
+  EXPECT_EQ(6u, g_fb_ids.size());
+
+  // The two oldest were evicted, so mapping them again creates new fb_ids.
+  LayerBufferMap other;
+  ASSERT_EQ(0, cache_.Map(&other, MakeBuffer(25), 4, &modified));
+  EXPECT_EQ(6u, g_created);
+  ASSERT_EQ(0, cache_.Map(&other, MakeBuffer(20), 4, &modified));
+  EXPECT_EQ(7u, g_created);
+  layers.clear();
+}
+
+TEST_F(FbIdCacheTest, CreateFailure) {
+  LayerBufferMap layer;
+  LayerBuffer buffer = MakeBuffer(1);
+  buffer.planes[0].fd = -1;
+  bool modified = false;
+  EXPECT_EQ(-EINVAL, cache_.Map(&layer, buffer, 4, &modified));
+  EXPECT_FALSE(modified);
+  EXPECT_TRUE(layer.buffer_map.empty());
+  EXPECT_EQ(0u, cache_.GetSize());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
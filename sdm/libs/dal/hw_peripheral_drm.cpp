@@ -946,6 +946,7 @@ DisplayError HWPeripheralDRM::EnableSelfRefresh(SelfRefreshState self_refresh_st
 void HWPeripheralDRM::ResetPropertyCache() {
   drm_atomic_intf_->Perform(sde_drm::DRMOps::PLANES_RESET_CACHE, token_.crtc_id);
   drm_atomic_intf_->Perform(sde_drm::DRMOps::CRTC_RESET_CACHE, token_.crtc_id);
+  drm_atomic_intf_->Perform(sde_drm::DRMOps::CONNECTOR_RESET_CACHE, token_.conn_id);
 }
 
 void HWPeripheralDRM::CreatePanelFeaturePropertyMap() {
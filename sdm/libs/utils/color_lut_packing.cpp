@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <utils/color_lut_packing.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define COLOR_LUT_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define COLOR_LUT_SSE2
+#endif
+
+namespace sdm {
+
+void PackGamutEntriesScalar(const uint32_t *c0, const uint32_t *c2_c1, uint32_t count,
+                            uint32_t *out) {
+  for (uint32_t i = 0; i < count; i++) {
+    out[2 * i] = c0[i];
+    out[2 * i + 1] = c2_c1[i];
+  }
+}
+
+void UnpackIgcEntriesScalar(const uint32_t *c0_c1, const uint32_t *c2, uint32_t count,
+                            uint32_t mask, uint32_t shift, uint32_t *out_c0, uint32_t *out_c1,
+                            uint32_t *out_c2) {
+  for (uint32_t i = 0; i < count; i++) {
+    out_c0[i] = c0_c1[i] & mask;
+    out_c1[i] = (c0_c1[i] >> shift) & mask;
+    out_c2[i] = c2[i] & mask;
+  }
+}
+
+void PackPgcEntriesScalar(const uint32_t *data, uint32_t count, uint32_t mask, uint32_t *out) {
+  for (uint32_t i = 0; i < count; i++) {
+    out[i] = (data[2 * i] & mask) | (data[2 * i + 1] & mask) << 16;
+  }
+}
+
+// The vector loops handle 4 outputs per step with unaligned loads and stores, LUT tables are
+// packed into structs with no alignment guarantee beyond 4 bytes.
+
+void PackGamutEntries(const uint32_t *c0, const uint32_t *c2_c1, uint32_t count, uint32_t *out) {
+  uint32_t i = 0;
+#if defined(COLOR_LUT_NEON)
+  for (; i + 4 <= count; i += 4) {
+    uint32x4x2_t entries = {{vld1q_u32(c0 + i), vld1q_u32(c2_c1 + i)}};
+    vst2q_u32(out + 2 * i, entries);
+  }
+#elif defined(COLOR_LUT_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c0 + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c2_c1 + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_unpacklo_epi32(a, b));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i + 4), _mm_unpackhi_epi32(a, b));
+  }
+#endif
+  PackGamutEntriesScalar(c0 + i, c2_c1 + i, count - i, out + 2 * i);
+}
+
+void UnpackIgcEntries(const uint32_t *c0_c1, const uint32_t *c2, uint32_t count, uint32_t mask,
+                      uint32_t shift, uint32_t *out_c0, uint32_t *out_c1, uint32_t *out_c2) {
+  uint32_t i = 0;
+#if defined(COLOR_LUT_NEON)
+  uint32x4_t vmask = vdupq_n_u32(mask);
+  int32x4_t vshift = vdupq_n_s32(-static_cast<int32_t>(shift));
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t packed = vld1q_u32(c0_c1 + i);
+    vst1q_u32(out_c0 + i, vandq_u32(packed, vmask));
+    vst1q_u32(out_c1 + i, vandq_u32(vshlq_u32(packed, vshift), vmask));
+    vst1q_u32(out_c2 + i, vandq_u32(vld1q_u32(c2 + i), vmask));
+  }
+#elif defined(COLOR_LUT_SSE2)
+  __m128i vmask = _mm_set1_epi32(static_cast<int32_t>(mask));
+  __m128i vshift = _mm_cvtsi32_si128(static_cast<int32_t>(shift));
+  for (; i + 4 <= count; i += 4) {
+    __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c0_c1 + i));
+    __m128i c2_data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c2 + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out_c0 + i), _mm_and_si128(packed, vmask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out_c1 + i),
+                     _mm_and_si128(_mm_srl_epi32(packed, vshift), vmask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out_c2 + i), _mm_and_si128(c2_data, vmask));
+  }
+#endif
+  UnpackIgcEntriesScalar(c0_c1 + i, c2 + i, count - i, mask, shift, out_c0 + i, out_c1 + i,
+                         out_c2 + i);
+}
+
+void PackPgcEntries(const uint32_t *data, uint32_t count, uint32_t mask, uint32_t *out) {
+  uint32_t i = 0;
+#if defined(COLOR_LUT_NEON)
+  uint32x4_t vmask = vdupq_n_u32(mask);
+  for (; i + 4 <= count; i += 4) {
+    // Narrowing the 8 masked values to 16 bits lays each pair out as (low | high << 16).
+    uint16x4_t low = vmovn_u32(vandq_u32(vld1q_u32(data + 2 * i), vmask));
+    uint16x4_t high = vmovn_u32(vandq_u32(vld1q_u32(data + 2 * i + 4), vmask));
+    vst1q_u32(out + i, vreinterpretq_u32_u16(vcombine_u16(low, high)));
+  }
+#elif defined(COLOR_LUT_SSE2)
+  __m128i vmask = _mm_set1_epi32(static_cast<int32_t>(mask));
+  for (; i + 4 <= count; i += 4) {
+    __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 2 * i));
+    __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 2 * i + 4));
+    // Masked values are below 0x8000, so the signed saturating pack never saturates.
+    __m128i packed = _mm_packs_epi32(_mm_and_si128(low, vmask), _mm_and_si128(high, vmask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+  }
+#endif
+  PackPgcEntriesScalar(data + 2 * i, count - i, mask, out + i);
+}
+
+}  // namespace sdm
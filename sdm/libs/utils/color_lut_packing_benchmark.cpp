@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// Time per table for each color LUT conversion the DRM color manager does, reference loops
+// against the vectorized kernels, with table sizes matching the DRM payloads.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#include <utils/color_lut_packing.h>
+
+namespace {
+
+const int kIterations = 20000;
+const uint32_t kGamutRows = 4;
+// A 17x17x17 table split across 4 rows of 1229 entries.
+const uint32_t kGamutEntries = 1229;
+const uint32_t kIgcEntries = 256;
+const uint32_t kPgcEntries = 512;
+const uint32_t kIgcDataMask = 0xFFF;
+const uint32_t kIgcShift = 16;
+const uint32_t kPgcDataMask = 0x3FF;
+
+template <typename Body>
+double MeasureNs(Body body) {
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; i++) {
+    body();
+  }
+  std::chrono::nanoseconds total = std::chrono::steady_clock::now() - begin;
+  return static_cast<double>(total.count()) / kIterations;
+}
+
+}  // namespace
+
+int main() {
+  std::vector<uint32_t> input(2 * kGamutEntries);
+  for (uint32_t i = 0; i < input.size(); i++) {
+    input[i] = i * 2654435761u;
+  }
+  std::vector<uint32_t> output(kGamutRows * 2 * kGamutEntries);
+  uint32_t *in = input.data(), *out = output.data();
+
+  auto gamut = [&](decltype(sdm::PackGamutEntries) *pack) {
+    return MeasureNs([&] {
+      for (uint32_t row = 0; row < kGamutRows; row++) {
+        pack(in, in + kGamutEntries, kGamutEntries, out + row * 2 * kGamutEntries);
+      }
+    });
+  };
+  auto igc = [&](decltype(sdm::UnpackIgcEntries) *unpack) {
+    return MeasureNs([&] {
+      unpack(in, in + kIgcEntries + 1, kIgcEntries + 1, kIgcDataMask, kIgcShift, out,
+             out + kIgcEntries + 1, out + 2 * (kIgcEntries + 1));
+    });
+  };
+  auto pgc = [&](decltype(sdm::PackPgcEntries) *pack) {
+    return MeasureNs([&] {
+      for (uint32_t component = 0; component < 3; component++) {
+        pack(in + component * 2 * kPgcEntries, kPgcEntries, kPgcDataMask,
+             out + component * kPgcEntries);
+      }
+    });
+  };
+
+  printf("%-20s %10s %10s\n", "table", "scalar ns", "vector ns");
+  printf("%-20s %10.1f %10.1f\n", "gamut 4x1229", gamut(sdm::PackGamutEntriesScalar),
+         gamut(sdm::PackGamutEntries));
+  printf("%-20s %10.1f %10.1f\n", "igc 3x257", igc(sdm::UnpackIgcEntriesScalar),
+         igc(sdm::UnpackIgcEntries));
+  printf("%-20s %10.1f %10.1f\n", "pgc 3x512", pgc(sdm::PackPgcEntriesScalar),
+         pgc(sdm::PackPgcEntries));
+
+  // Keeps the stores observable.
+  uint32_t checksum = 0;
+  for (uint32_t value : output) {
+    checksum ^= value;
+  }
+  return checksum == 0xFFFFFFFF ? 1 : 0;
+}
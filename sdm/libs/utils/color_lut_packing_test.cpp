@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/color_lut_packing.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+// Values the DRM color manager passes for IGC and PGC.
+const uint32_t kIgcDataMask = 0xFFF;
+const uint32_t kIgcShift = 16;
+const uint32_t kPgcDataMask = 0x3FF;
+
+// Odd sizes exercise the scalar tails, the large ones match the real tables: a 1229 entry gamut
+// row in mode 17, 256 IGC entries and 512 PGC outputs.
+const uint32_t kCounts[] = {0, 1, 3, 4, 5, 17, 256, 257, 512, 1229};
+
+std::vector<uint32_t> RandomData(uint32_t count, uint32_t seed) {
+  std::mt19937 generator(seed);
+  std::vector<uint32_t> data(count);
+  for (auto &value : data) {
+    value = generator();
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST(ColorLutPackingTest, GamutGolden) {
+  const uint32_t c0[] = {0x1, 0x2, 0x3, 0x4, 0x5};
+  const uint32_t c2_c1[] = {0x10001, 0x20002, 0x30003, 0x40004, 0x50005};
+  const uint32_t expected[] = {0x1, 0x10001, 0x2, 0x20002, 0x3, 0x30003,
+                               0x4, 0x40004, 0x5, 0x50005, 0xDEAD};
+  uint32_t out[11] = {};
+  out[10] = 0xDEAD;
+  PackGamutEntries(c0, c2_c1, 5, out);
+
+  for (int i = 0; i < 11; i++) {
+    EXPECT_EQ(expected[i], out[i]) << "index " << i;
+  }
+}
+
+TEST(ColorLutPackingTest, IgcGolden) {
+  const uint32_t c0_c1[] = {0xABCD1234, 0x0FFF0FFF, 0xF000F000, 0x00010002, 0x12345678};
+  const uint32_t c2[] = {0xFFFFFFFF, 0x1000, 0x0ABC, 0x0, 0x8765};
+  const uint32_t expected_c0[] = {0x234, 0xFFF, 0x000, 0x002, 0x678};
+  const uint32_t expected_c1[] = {0xBCD, 0xFFF, 0x000, 0x001, 0x234};
+  const uint32_t expected_c2[] = {0xFFF, 0x000, 0xABC, 0x000, 0x765};
+  uint32_t c0[5] = {}, c1[5] = {}, out_c2[5] = {};
+  UnpackIgcEntries(c0_c1, c2, 5, kIgcDataMask, kIgcShift, c0, c1, out_c2);
+
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(expected_c0[i], c0[i]) << "index " << i;
+    EXPECT_EQ(expected_c1[i], c1[i]) << "index " << i;
+    EXPECT_EQ(expected_c2[i], out_c2[i]) << "index " << i;
+  }
+}
+
+TEST(ColorLutPackingTest, PgcGolden) {
+  // Out of range bits above the mask must not leak into the neighbouring half.
+  const uint32_t data[] = {0x000, 0x3FF, 0x123, 0x321, 0xFFFFFFFF, 0x400,
+                           0x001, 0x002, 0x7FF, 0xC00, 0x3FE, 0x001};
+  const uint32_t expected[] = {0x03FF0000, 0x03210123, 0x000003FF, 0x00020001,
+                               0x000003FF, 0x000103FE};
+  uint32_t out[6] = {};
+  PackPgcEntries(data, 6, kPgcDataMask, out);
+
+  for (int i = 0; i < 6; i++) {
+    EXPECT_EQ(expected[i], out[i]) << "index " << i;
+  }
+}
+
+TEST(ColorLutPackingTest, GamutMatchesScalar) {
+  for (uint32_t count : kCounts) {
+    std::vector<uint32_t> c0 = RandomData(count, 1), c2_c1 = RandomData(count, 2);
+    std::vector<uint32_t> out(2 * count + 1, 0xDEAD), reference(2 * count + 1, 0xDEAD);
+    PackGamutEntries(c0.data(), c2_c1.data(), count, out.data());
+    PackGamutEntriesScalar(c0.data(), c2_c1.data(), count, reference.data());
+
+    EXPECT_EQ(reference, out) << "count " << count;
+  }
+}
+
+TEST(ColorLutPackingTest, IgcMatchesScalar) {
+  for (uint32_t count : kCounts) {
+    std::vector<uint32_t> c0_c1 = RandomData(count, 3), c2 = RandomData(count, 4);
+    std::vector<uint32_t> out[3], reference[3];
+    for (int i = 0; i < 3; i++) {
+      out[i].assign(count + 1, 0xDEAD);
+      reference[i].assign(count + 1, 0xDEAD);
+    }
+    UnpackIgcEntries(c0_c1.data(), c2.data(), count, kIgcDataMask, kIgcShift, out[0].data(),
+                     out[1].data(), out[2].data());
+    UnpackIgcEntriesScalar(c0_c1.data(), c2.data(), count, kIgcDataMask, kIgcShift,
+                           reference[0].data(), reference[1].data(), reference[2].data());
+
+    for (int i = 0; i < 3; i++) {
+      EXPECT_EQ(reference[i], out[i]) << "count " << count << " component " << i;
+    }
+  }
+}
+
+TEST(ColorLutPackingTest, PgcMatchesScalar) {
+  for (uint32_t count : kCounts) {
+    std::vector<uint32_t> data = RandomData(2 * count, 5);
+    std::vector<uint32_t> out(count + 1, 0xDEAD), reference(count + 1, 0xDEAD);
+    PackPgcEntries(data.data(), count, kPgcDataMask, out.data());
+    PackPgcEntriesScalar(data.data(), count, kPgcDataMask, reference.data());
+
+    EXPECT_EQ(reference, out) << "count " << count;
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utils/event_poller.h>
+#include <utils/sys.h>
+
+namespace sdm {
+
+int EventPoller::Init() {
+  Deinit();
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  return (epoll_fd_ < 0) ? -errno : 0;
+}
+
+void EventPoller::Deinit() {
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+}
+
+int EventPoller::Add(int fd, uint32_t id, uint32_t events) {
+  struct epoll_event event = {};
+  event.events = events;
+  event.data.u32 = id;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+    return -errno;
+  }
+
+  return 0;
+}
+
+int EventPoller::Remove(int fd) {
+  // A non null event keeps kernels older than 2.6.9 happy.
+  struct epoll_event event = {};
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, &event) < 0) {
+    return -errno;
+  }
+
+  return 0;
+}
+
+int EventPoller::Wait(int timeout_ms, std::vector<Event> *ready) {
+  struct epoll_event events[kMaxEvents];
+  ready->clear();
+  int count = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+  if (count < 0) {
+    return -errno;
+  }
+
+  for (int i = 0; i < count; i++) {
+    Event event;
+    event.id = events[i].data.u32;
+    event.events = events[i].events;
+    ready->push_back(event);
+  }
+
+  return count;
+}
+
+int EventPoller::SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    return -errno;
+  }
+
+  return 0;
+}
+
+ssize_t EventPoller::ReadOnce(int fd, char *buffer, size_t size) {
+  while (true) {
+    ssize_t length = Sys::read_(fd, buffer, size);
+    if (length >= 0) {
+      return length;
+    }
+    if (errno != EINTR) {
+      return -errno;
+    }
+  }
+}
+
+}  // namespace sdm
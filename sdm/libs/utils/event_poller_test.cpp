@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/event_poller.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+enum SourceId {
+  kExitSource,
+  kDrmSource,
+  kInotifySource,
+};
+
+// Display event sources stand-ins: a non-blocking eventfd for the exit event and pipes for the
+// DRM event and inotify descriptors.
+class EventPollerTest : public Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(0, poller_.Init());
+    exit_fd_ = eventfd(0, EFD_NONBLOCK);
+    ASSERT_GE(exit_fd_, 0);
+    ASSERT_EQ(0, pipe(drm_fds_));
+    ASSERT_EQ(0, pipe(inotify_fds_));
+    ASSERT_EQ(0, EventPoller::SetNonBlocking(inotify_fds_[0]));
+  }
+
+  void TearDown() override {
+    close(exit_fd_);
+    close(drm_fds_[0]);
+    close(drm_fds_[1]);
+    close(inotify_fds_[0]);
+    close(inotify_fds_[1]);
+  }
+
+  void WriteString(int fd, const std::string &data) {
+    ASSERT_EQ(static_cast<ssize_t>(data.size()), write(fd, data.data(), data.size()));
+  }
+
+  std::vector<uint32_t> WaitIds(int timeout_ms) {
+    std::vector<EventPoller::Event> ready;
+    EXPECT_LE(0, poller_.Wait(timeout_ms, &ready));
+    std::vector<uint32_t> ids;
+    for (auto &event : ready) {
+      EXPECT_NE(0u, event.events & EPOLLIN);
+      ids.push_back(event.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+
+  EventPoller poller_;
+  int exit_fd_ = -1;
+  int drm_fds_[2] = {-1, -1};
+  int inotify_fds_[2] = {-1, -1};
+};
+
+}  // namespace
+
+TEST_F(EventPollerTest, ReportsAllReadySourcesInOneWait) {
+  ASSERT_EQ(0, poller_.Add(exit_fd_, kExitSource, EPOLLIN | EPOLLET));
+  ASSERT_EQ(0, poller_.Add(drm_fds_[0], kDrmSource, EPOLLIN | EPOLLPRI));
+  ASSERT_EQ(0, poller_.Add(inotify_fds_[0], kInotifySource, EPOLLIN | EPOLLET));
+  EXPECT_TRUE(WaitIds(0).empty());
+
+  ASSERT_EQ(0, eventfd_write(exit_fd_, 1));
+  WriteString(drm_fds_[1], "vblank");
+  WriteString(inotify_fds_[1], "modify");
+  EXPECT_EQ(std::vector<uint32_t>({kExitSource, kDrmSource, kInotifySource}), WaitIds(1000));
+}
+
+TEST_F(EventPollerTest, EdgeTriggeredSourcesReportOncePerChange) {
+  ASSERT_EQ(0, poller_.Add(exit_fd_, kExitSource, EPOLLIN | EPOLLET));
+  ASSERT_EQ(0, poller_.Add(drm_fds_[0], kDrmSource, EPOLLIN | EPOLLPRI));
+
+  ASSERT_EQ(0, eventfd_write(exit_fd_, 1));
+  WriteString(drm_fds_[1], "vblank");
+  EXPECT_EQ(std::vector<uint32_t>({kExitSource, kDrmSource}), WaitIds(1000));
+
+  // Left unread, the edge triggered source is not reported again, the level triggered one is.
+  EXPECT_EQ(std::vector<uint32_t>({kDrmSource}), WaitIds(0));
+
+  char buffer[16];
+  ASSERT_EQ(6, read(drm_fds_[0], buffer, sizeof(buffer)));
+  EXPECT_TRUE(WaitIds(0).empty());
+
+  // A new write is a new edge.
+  ASSERT_EQ(0, eventfd_write(exit_fd_, 1));
+  EXPECT_EQ(std::vector<uint32_t>({kExitSource}), WaitIds(1000));
+
+  ASSERT_EQ(0, poller_.Remove(drm_fds_[0]));
+  WriteString(drm_fds_[1], "vblank");
+  EXPECT_TRUE(WaitIds(0).empty());
+  EXPECT_EQ(-ENOENT, poller_.Remove(drm_fds_[0]));
+}
+
+TEST_F(EventPollerTest, DrainReadsUntilEmpty) {
+  ASSERT_EQ(0, poller_.Add(inotify_fds_[0], kInotifySource, EPOLLIN | EPOLLET));
+  std::string written;
+  for (int i = 0; i < 100; i++) {
+    written += "event" + std::to_string(i) + ";";
+  }
+  WriteString(inotify_fds_[1], written);
+  EXPECT_EQ(std::vector<uint32_t>({kInotifySource}), WaitIds(1000));
+
+  // Smaller than the queued data, so draining takes several reads.
+  char buffer[64];
+  std::string read_back;
+  int reads = 0;
+  ssize_t total = EventPoller::Drain(inotify_fds_[0], buffer, sizeof(buffer),
+                                     [&](const char *data, ssize_t length) {
+                                       read_back.append(data, length);
+                                       reads++;
+                                     });
+  EXPECT_EQ(static_cast<ssize_t>(written.size()), total);
+  EXPECT_EQ(written, read_back);
+  EXPECT_GT(reads, 1);
+  EXPECT_EQ(0, EventPoller::Drain(inotify_fds_[0], buffer, sizeof(buffer),
+                                  [](const char *, ssize_t) {}));
+
+  // Blocking descriptors can not be drained, the caller must set them non-blocking.
+  int flags = fcntl(drm_fds_[0], F_GETFL);
+  EXPECT_EQ(0, EventPoller::SetNonBlocking(drm_fds_[0]));
+  EXPECT_NE(0, fcntl(drm_fds_[0], F_GETFL) & O_NONBLOCK);
+  EXPECT_EQ(0, flags & O_NONBLOCK);
+}
+
+// The brightness node is kept open and read at offset 0 on every change, a regular file rewritten
+// in place stands in for the sysfs attribute.
+TEST_F(EventPollerTest, PersistentDescriptorRereadsWithPread) {
+  char path[] = "/tmp/event_poller_testXXXXXX";
+  int writer = mkstemp(path);
+  ASSERT_GE(writer, 0);
+  int reader = open(path, O_RDONLY);
+  ASSERT_GE(reader, 0);
+
+  const char *values[] = {"255\n", "12\n", "1023\n"};
+  for (const char *value : values) {
+    ASSERT_EQ(0, ftruncate(writer, 0));
+    ASSERT_EQ(static_cast<ssize_t>(strlen(value)), pwrite(writer, value, strlen(value), 0));
+    char buffer[16] = {};
+    ssize_t length = pread(reader, buffer, sizeof(buffer) - 1, 0);
+    ASSERT_EQ(static_cast<ssize_t>(strlen(value)), length);
+    EXPECT_STREQ(value, buffer);
+  }
+
+  close(reader);
+  close(writer);
+  unlink(path);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
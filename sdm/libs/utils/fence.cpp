@@ -27,13 +27,27 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+/*
+ * Changes from Qualcomm Innovation Center are provided under the following license:
+ *
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
 #include <utils/fence.h>
 #include <core/sdm_types.h>
 #include <debug_handler.h>
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 #define __CLASS__ "Fence"
 
@@ -103,16 +117,37 @@ shared_ptr<Fence> Fence::Merge(const shared_ptr<Fence> &fence1, const shared_ptr
 shared_ptr<Fence> Fence::Merge(const std::vector<shared_ptr<Fence>> &fences, bool ignore_signaled) {
   ASSERT_IF_NO_BUFFER_SYNC(g_buffer_sync_handler_);
 
-  shared_ptr<Fence> merged_fence = nullptr;
+  std::vector<shared_ptr<Fence>> pending;
+  pending.reserve(fences.size());
   for (auto &fence : fences) {
-    if (ignore_signaled && (Fence::Wait(fence, 0) == kErrorNone)) {
+    if (!fence || (ignore_signaled && (Fence::Wait(fence, 0) == kErrorNone))) {
       continue;
     }
 
-    merged_fence = Fence::Merge(fence, merged_fence);
+    pending.push_back(fence);
+  }
+
+  if (pending.size() == 1) {
+    // Caller always gets a new fence, as with a merge against null.
+    return Fence::Merge(pending[0], nullptr);
   }
 
-  return merged_fence;
+  // Merge in pairs so that each sync point is copied O(log n) times instead of once per fence
+  // that follows it in the list.
+  while (pending.size() > 1) {
+    std::vector<shared_ptr<Fence>> merged;
+    merged.reserve((pending.size() + 1) / 2);
+    for (size_t i = 0; i < pending.size(); i += 2) {
+      if (i + 1 < pending.size()) {
+        merged.push_back(Fence::Merge(pending[i], pending[i + 1]));
+      } else {
+        merged.push_back(pending[i]);
+      }
+    }
+    pending.swap(merged);
+  }
+
+  return pending.empty() ? nullptr : pending[0];
 }
 
 int Fence::Wait(const shared_ptr<Fence> &fence) {
@@ -127,6 +162,110 @@ int Fence::Wait(const shared_ptr<Fence> &fence, int timeout) {
   return g_buffer_sync_handler_->SyncWait(Fence::Get(fence), timeout);
 }
 
+// Single epoll thread shared by all async fence waits. Each registration polls its own dup of
+// the fence fd, so the same fence may be registered any number of times.
+class FenceWaiter {
+ public:
+  static FenceWaiter *GetInstance() {
+    // Lives for the process lifetime, pending callbacks may fire until exit.
+    static FenceWaiter *waiter = new FenceWaiter();
+    return waiter;
+  }
+
+  int Add(int fd, Fence::Callback callback) {
+    if (epoll_fd_ < 0) {
+      return -ENODEV;
+    }
+
+    std::lock_guard<std::mutex> lock(lock_);
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      return -errno;
+    }
+    callbacks_[fd] = std::move(callback);
+
+    return 0;
+  }
+
+ private:
+  FenceWaiter() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+      DLOGE("epoll_create1 failed errno = %d, desc = %s", errno, strerror(errno));
+      return;
+    }
+    thread_ = std::thread(&FenceWaiter::Run, this);
+  }
+
+  void Run() {
+    const int kMaxEvents = 16;
+    struct epoll_event events[kMaxEvents];
+
+    while (true) {
+      int count = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+      if (count < 0) {
+        if (errno != EINTR) {
+          DLOGE("epoll_wait failed errno = %d, desc = %s", errno, strerror(errno));
+        }
+        continue;
+      }
+
+      for (int i = 0; i < count; i++) {
+        int fd = events[i].data.fd;
+        Fence::Callback callback = nullptr;
+        {
+          std::lock_guard<std::mutex> lock(lock_);
+          auto it = callbacks_.find(fd);
+          if (it == callbacks_.end()) {
+            continue;
+          }
+          callback = std::move(it->second);
+          callbacks_.erase(it);
+          epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        }
+
+        // Readable means signaled or errored, a zero timeout wait tells the two apart.
+        int status = Fence::g_buffer_sync_handler_->SyncWait(fd, 0);
+        close(fd);
+        if (callback) {
+          callback(status);
+        }
+      }
+    }
+  }
+
+  int epoll_fd_ = -1;
+  std::mutex lock_;
+  std::map<int, Fence::Callback> callbacks_;
+  std::thread thread_;
+};
+
+int Fence::WaitAsync(const shared_ptr<Fence> &fence, Callback callback) {
+  ASSERT_IF_NO_BUFFER_SYNC(g_buffer_sync_handler_);
+
+  if (!fence) {
+    if (callback) {
+      callback(kErrorNone);
+    }
+    return kErrorNone;
+  }
+
+  int fd = Fence::Dup(fence);
+  if (fd < 0) {
+    return -errno;
+  }
+
+  int ret = FenceWaiter::GetInstance()->Add(fd, std::move(callback));
+  if (ret < 0) {
+    DLOGE("Failed to register fence %d for async wait, error = %d", fence->fd_, ret);
+    close(fd);
+  }
+
+  return ret;
+}
+
 Fence::Status Fence::GetStatus(const shared_ptr<Fence> &fence) {
   ASSERT_IF_NO_BUFFER_SYNC(g_buffer_sync_handler_);
 
@@ -139,6 +278,16 @@ Fence::Status Fence::GetStatus(const shared_ptr<Fence> &fence) {
                                     Fence::Status::kPending : Fence::Status::kSignaled);
 }
 
+int Fence::GetSignalTime(const shared_ptr<Fence> &fence, int64_t *timestamp_ns) {
+  ASSERT_IF_NO_BUFFER_SYNC(g_buffer_sync_handler_);
+
+  if (!fence) {
+    return -EINVAL;
+  }
+
+  return g_buffer_sync_handler_->GetSignalTime(Fence::Get(fence), timestamp_ns);
+}
+
 string Fence::GetStr(const shared_ptr<Fence> &fence) {
   return std::to_string(Fence::Get(fence));
 }
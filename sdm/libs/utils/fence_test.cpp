@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <fcntl.h>
+#include <linux/sync_file.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/fence.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+// sw_sync debug interface, the kernel does not export it in the uapi headers.
+struct sw_sync_create_fence_data {
+  uint32_t value;
+  char name[32];
+  int32_t fence;
+};
+#define SW_SYNC_IOC_CREATE_FENCE _IOWR('W', 0, struct sw_sync_create_fence_data)
+#define SW_SYNC_IOC_INC _IOW('W', 1, uint32_t)
+
+// Waits by polling the fd, like sync_wait. Merges sync files through SYNC_IOC_MERGE. eventfd
+// stand-ins cannot be merged by the kernel, so their merges get a placeholder fd that remembers
+// which eventfds it covers and waits on all of them.
+class TestSyncHandler : public BufferSyncHandler {
+ public:
+  int SyncWait(int fd, int timeout) override {
+    std::vector<int> fds = {fd};
+    auto it = merged_.find(fd);
+    if (it != merged_.end()) {
+      fds.assign(it->second.begin(), it->second.end());
+    }
+
+    for (int wait_fd : fds) {
+      struct pollfd pfd = {wait_fd, POLLIN, 0};
+      int ret = poll(&pfd, 1, timeout);
+      if (ret == 0) {
+        return -ETIME;
+      }
+      if (ret < 0) {
+        return -errno;
+      }
+    }
+    return 0;
+  }
+
+  int SyncMerge(int fd1, int fd2, int *merged_fd) override {
+    // Same contract as the composer handler: a single valid fd is duped.
+    if (fd1 < 0 || fd2 < 0 || fd1 == fd2) {
+      int fd = fd1 < 0 ? fd2 : fd1;
+      *merged_fd = dup(fd);
+      if (merged_.count(fd)) {
+        merged_[*merged_fd] = merged_[fd];
+        depth_[*merged_fd] = depth_[fd];
+      }
+      last_merged_ = *merged_fd;
+      return 0;
+    }
+
+    merges_++;
+    int depth = std::max(GetDepth(fd1), GetDepth(fd2)) + 1;
+    if (sync_file_) {
+      struct sync_merge_data data = {};
+      strncpy(data.name, "fence_test", sizeof(data.name) - 1);
+      data.fd2 = fd2;
+      *merged_fd = (ioctl(fd1, SYNC_IOC_MERGE, &data) < 0) ? -1 : data.fence;
+      return *merged_fd < 0 ? -errno : 0;
+    }
+
+    *merged_fd = eventfd(0, 0);
+    std::set<int> leaves;
+    for (int fd : {fd1, fd2}) {
+      auto it = merged_.find(fd);
+      if (it != merged_.end()) {
+        leaves.insert(it->second.begin(), it->second.end());
+      } else {
+        leaves.insert(fd);
+      }
+    }
+    merged_[*merged_fd] = leaves;
+    depth_[*merged_fd] = depth;
+    last_merged_ = *merged_fd;
+    return 0;
+  }
+
+  void GetSyncInfo(int fd, std::ostringstream *os) override {}
+
+  int GetDepth(int fd) {
+    auto it = depth_.find(fd);
+    return it == depth_.end() ? 0 : it->second;
+  }
+
+  // eventfds a placeholder from SyncMerge covers, and how many merges deep it is. fds are reused
+  // once closed, so entries only hold while the fences they describe are alive.
+  std::map<int, std::set<int>> merged_;
+  std::map<int, int> depth_;
+  int last_merged_ = -1;
+  uint32_t merges_ = 0;
+  bool sync_file_ = false;
+};
+
+// Collects WaitAsync completions from the waiter thread.
+class Completions {
+ public:
+  Fence::Callback Add(int id) {
+    return [this, id](int status) {
+      std::lock_guard<std::mutex> lock(lock_);
+      order_.push_back(id);
+      status_[id] = status;
+      cv_.notify_all();
+    };
+  }
+
+  bool WaitFor(size_t count) {
+    std::unique_lock<std::mutex> lock(lock_);
+    return cv_.wait_for(lock, std::chrono::seconds(2), [&] { return order_.size() >= count; });
+  }
+
+  std::vector<int> Order() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return order_;
+  }
+
+  std::map<int, int> Status() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return status_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::vector<int> order_;
+  std::map<int, int> status_;
+};
+
+class FenceTest : public Test {
+ protected:
+  void SetUp() override { Fence::Set(&handler_); }
+
+  shared_ptr<Fence> CreateEventFence(int *event_fd) {
+    *event_fd = eventfd(0, 0);
+    return Fence::Create(dup(*event_fd), "eventfd");
+  }
+
+  void Signal(int event_fd) {
+    uint64_t one = 1;
+    ASSERT_EQ(ssize_t(sizeof(one)), write(event_fd, &one, sizeof(one)));
+  }
+
+  TestSyncHandler handler_;
+};
+
+class SwSyncTimeline {
+ public:
+  SwSyncTimeline() {
+    for (const char *path : {"/sys/kernel/debug/sync/sw_sync", "/dev/sw_sync"}) {
+      fd_ = open(path, O_RDWR | O_CLOEXEC);
+      if (fd_ >= 0) {
+        break;
+      }
+    }
+  }
+  ~SwSyncTimeline() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+  bool IsValid() { return fd_ >= 0; }
+
+  shared_ptr<Fence> CreateFence(uint32_t value) {
+    struct sw_sync_create_fence_data data = {};
+    data.value = value;
+    strncpy(data.name, "fence_test", sizeof(data.name) - 1);
+    if (ioctl(fd_, SW_SYNC_IOC_CREATE_FENCE, &data) < 0) {
+      return nullptr;
+    }
+    return Fence::Create(data.fence, "sw_sync");
+  }
+
+  void Inc(uint32_t count) { ioctl(fd_, SW_SYNC_IOC_INC, &count); }
+
+ private:
+  int fd_ = -1;
+};
+
+}  // namespace
+
+TEST_F(FenceTest, MergeIsBalanced) {
+  for (size_t count : {2u, 3u, 8u, 9u, 33u}) {
+    handler_.merged_.clear();
+    handler_.depth_.clear();
+    std::vector<int> event_fds(count);
+    std::vector<shared_ptr<Fence>> fences;
+    for (auto &event_fd : event_fds) {
+      fences.push_back(CreateEventFence(&event_fd));
+    }
+
+    handler_.merges_ = 0;
+    shared_ptr<Fence> merged = Fence::Merge(fences, false);
+    ASSERT_NE(nullptr, merged);
+    EXPECT_EQ(count - 1, handler_.merges_);
+
+    // The last merge produced the result, it covers every source at log2 depth.
+    int merged_fd = handler_.last_merged_;
+    int depth = 0;
+    while ((size_t(1) << depth) < count) {
+      depth++;
+    }
+    EXPECT_EQ(depth, handler_.GetDepth(merged_fd)) << count << " fences";
+    EXPECT_EQ(count, handler_.merged_[merged_fd].size()) << count << " fences";
+
+    for (int event_fd : event_fds) {
+      EXPECT_EQ(Fence::Status::kPending, Fence::GetStatus(merged));
+      Signal(event_fd);
+    }
+    EXPECT_EQ(Fence::Status::kSignaled, Fence::GetStatus(merged));
+    for (int event_fd : event_fds) {
+      close(event_fd);
+    }
+  }
+}
+
+TEST_F(FenceTest, MergeSkipsNullAndSignaled) {
+  int pending_fd = -1, signaled_fd = -1;
+  shared_ptr<Fence> pending = CreateEventFence(&pending_fd);
+  shared_ptr<Fence> signaled = CreateEventFence(&signaled_fd);
+  Signal(signaled_fd);
+
+  shared_ptr<Fence> merged = Fence::Merge({nullptr, pending, signaled, nullptr}, true);
+  // A single surviving fence still comes back as a new fence.
+  ASSERT_NE(nullptr, merged);
+  EXPECT_NE(pending, merged);
+  EXPECT_EQ(0u, handler_.merges_);
+  EXPECT_EQ(Fence::Status::kPending, Fence::GetStatus(merged));
+
+  EXPECT_EQ(nullptr, Fence::Merge({nullptr, signaled}, true));
+  EXPECT_EQ(nullptr, Fence::Merge(std::vector<shared_ptr<Fence>>(), false));
+  close(pending_fd);
+  close(signaled_fd);
+}
+
+TEST_F(FenceTest, WaitAsyncRunsInSignalOrder) {
+  std::vector<int> event_fds(3);
+  std::vector<shared_ptr<Fence>> fences;
+  Completions completions;
+  for (size_t i = 0; i < event_fds.size(); i++) {
+    fences.push_back(CreateEventFence(&event_fds[i]));
+    ASSERT_EQ(0, Fence::WaitAsync(fences[i], completions.Add(static_cast<int>(i))));
+  }
+  // The waiter polls its own dup, the caller may drop its reference right away.
+  fences.clear();
+
+  size_t signaled = 0;
+  for (int i : {2, 0, 1}) {
+    Signal(event_fds[i]);
+    ASSERT_TRUE(completions.WaitFor(++signaled));
+  }
+  EXPECT_EQ(std::vector<int>({2, 0, 1}), completions.Order());
+  for (auto &status : completions.Status()) {
+    EXPECT_EQ(0, status.second);
+  }
+  for (int event_fd : event_fds) {
+    close(event_fd);
+  }
+}
+
+TEST_F(FenceTest, WaitAsyncSameFenceTwice) {
+  int event_fd = -1;
+  shared_ptr<Fence> fence = CreateEventFence(&event_fd);
+  Completions completions;
+  ASSERT_EQ(0, Fence::WaitAsync(fence, completions.Add(0)));
+  ASSERT_EQ(0, Fence::WaitAsync(fence, completions.Add(1)));
+  Signal(event_fd);
+  EXPECT_TRUE(completions.WaitFor(2));
+  close(event_fd);
+}
+
+TEST_F(FenceTest, NullFence) {
+  int calls = 0;
+  EXPECT_EQ(0, Fence::WaitAsync(nullptr, [&calls](int status) { calls++; }));
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(Fence::Status::kSignaled, Fence::GetStatus(nullptr));
+  int64_t timestamp = 0;
+  EXPECT_EQ(-EINVAL, Fence::GetSignalTime(nullptr, &timestamp));
+}
+
+TEST_F(FenceTest, SwSyncMergeAndWaitAsync) {
+  SwSyncTimeline timeline;
+  if (!timeline.IsValid()) {
+    GTEST_SKIP() << "sw_sync is not available";
+  }
+  handler_.sync_file_ = true;
+
+  std::vector<shared_ptr<Fence>> fences;
+  for (uint32_t value = 1; value <= 5; value++) {
+    fences.push_back(timeline.CreateFence(value));
+    ASSERT_NE(nullptr, fences.back());
+  }
+  shared_ptr<Fence> merged = Fence::Merge(fences, false);
+  ASSERT_NE(nullptr, merged);
+  EXPECT_EQ(4u, handler_.merges_);
+
+  Completions completions;
+  ASSERT_EQ(0, Fence::WaitAsync(fences[0], completions.Add(0)));
+  ASSERT_EQ(0, Fence::WaitAsync(merged, completions.Add(1)));
+
+  timeline.Inc(1);
+  ASSERT_TRUE(completions.WaitFor(1));
+  EXPECT_EQ(Fence::Status::kPending, Fence::GetStatus(merged));
+  timeline.Inc(4);
+  ASSERT_TRUE(completions.WaitFor(2));
+  EXPECT_EQ(std::vector<int>({0, 1}), completions.Order());
+  EXPECT_EQ(Fence::Status::kSignaled, Fence::GetStatus(merged));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <linux/dma-buf.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/frame_dump_writer.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#define __CLASS__ "FrameDumpWriter"
+
+namespace sdm {
+
+static const uint32_t kDefaultSlots = 3;
+static const uint64_t kDefaultStagingBytes = 128 * 1024 * 1024;
+// Large sequential writes, the files are tens of megabytes each.
+static const size_t kWriteChunkBytes = 1024 * 1024;
+
+FrameDumpWriter *FrameDumpWriter::GetInstance() {
+  // Lives for the process lifetime, like the fence waiter it depends on.
+  static FrameDumpWriter *writer = new FrameDumpWriter();
+  return writer;
+}
+
+FrameDumpWriter::FrameDumpWriter() {
+  for (uint32_t i = 0; i < kDefaultSlots; i++) {
+    slots_.emplace_back(new StagingSlot());
+  }
+  max_staging_bytes_ = kDefaultStagingBytes;
+  copy_thread_ = std::thread(&FrameDumpWriter::CopyThread, this);
+  write_thread_ = std::thread(&FrameDumpWriter::WriteThread, this);
+}
+
+void FrameDumpWriter::Configure(uint32_t num_slots, uint64_t max_staging_bytes, bool compress) {
+  std::lock_guard<std::mutex> lock(lock_);
+  num_slots = num_slots ? num_slots : kDefaultSlots;
+
+  // Jobs point at their slot, so only idle slots are removed.
+  for (auto it = slots_.begin(); it != slots_.end() && slots_.size() > num_slots;) {
+    it = (*it)->busy ? (it + 1) : slots_.erase(it);
+  }
+  while (slots_.size() < num_slots) {
+    slots_.emplace_back(new StagingSlot());
+  }
+
+  max_staging_bytes_ = max_staging_bytes ? max_staging_bytes : kDefaultStagingBytes;
+  compress_ = compress;
+  DLOGI("slots %zu, staging %" PRIu64 " bytes, compress %d", slots_.size(), max_staging_bytes_,
+        compress_);
+}
+
+DisplayError FrameDumpWriter::Queue(const FrameDumpRequest &request) {
+  Job job = {};
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stats_.queued++;
+
+    // Prefer an idle slot that already has the capacity, then any idle slot. Busy slots are
+    // resized by the copy thread, so only their accounted capacity is read here.
+    StagingSlot *slot = nullptr;
+    uint64_t capacity = 0;
+    for (auto &iter : slots_) {
+      capacity += iter->capacity;
+      if (!iter->busy && (!slot || iter->capacity >= request.size)) {
+        slot = iter.get();
+      }
+    }
+
+    if (!slot) {
+      stats_.dropped++;
+      DLOGV("No staging slot, dropping %s", request.path.c_str());
+      return kErrorResources;
+    }
+
+    uint64_t slot_capacity = std::max(slot->capacity, UINT64(request.size));
+    if (capacity - slot->capacity + slot_capacity > max_staging_bytes_) {
+      stats_.dropped++;
+      DLOGV("Staging memory exhausted, dropping %s", request.path.c_str());
+      return kErrorResources;
+    }
+
+    job.fd = dup(request.fd);
+    if (job.fd < 0) {
+      stats_.failed++;
+      DLOGE("dup failed for %s errno = %d, desc = %s", request.path.c_str(), errno,
+            strerror(errno));
+      return kErrorUndefined;
+    }
+
+    job.path = request.path;
+    job.size = request.size;
+    job.clear = request.clear;
+    job.compress = compress_;
+    job.slot = slot;
+    slot->capacity = slot_capacity;
+    slot->busy = true;
+    in_flight_++;
+  }
+
+  if (request.sync_copy) {
+    int status = Fence::Wait(request.fence);
+    if (status != kErrorNone) {
+      DLOGW("Fence wait failed for %s, error = %d", job.path.c_str(), status);
+      close(job.fd);
+      Release(job, false);
+      return kErrorUndefined;
+    }
+    CopyAndQueueWrite(&job);
+    return kErrorNone;
+  }
+
+  // Null fences run the callback inline, so the lock must not be held here.
+  int ret = Fence::WaitAsync(request.fence, [this, job](int status) {
+    OnFenceSignaled(job, status);
+  });
+  if (ret != 0) {
+    OnFenceSignaled(job, ret);
+  }
+
+  return kErrorNone;
+}
+
+void FrameDumpWriter::OnFenceSignaled(const Job &job, int status) {
+  if (status != kErrorNone) {
+    DLOGW("Fence wait failed for %s, error = %d", job.path.c_str(), status);
+    close(job.fd);
+    Release(job, false);
+    return;
+  }
+
+  // Runs on the fence waiter thread, which must not block; hand the copy to our own thread.
+  std::lock_guard<std::mutex> lock(lock_);
+  copy_queue_.push_back(job);
+  cv_.notify_all();
+}
+
+void FrameDumpWriter::CopyThread() {
+  while (true) {
+    Job job = {};
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      cv_.wait(lock, [this] { return !copy_queue_.empty(); });
+      job = std::move(copy_queue_.front());
+      copy_queue_.pop_front();
+    }
+
+    CopyAndQueueWrite(&job);
+  }
+}
+
+void FrameDumpWriter::CopyAndQueueWrite(Job *job) {
+  bool copied = Copy(*job);
+  close(job->fd);
+  job->fd = -1;
+  if (!copied) {
+    Release(*job, false);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  write_queue_.push_back(std::move(*job));
+  cv_.notify_all();
+}
+
+void FrameDumpWriter::WriteThread() {
+  while (true) {
+    Job job = {};
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      cv_.wait(lock, [this] { return !write_queue_.empty(); });
+      job = std::move(write_queue_.front());
+      write_queue_.pop_front();
+    }
+
+    Release(job, Write(job));
+  }
+}
+
+bool FrameDumpWriter::Copy(const Job &job) {
+  int prot = PROT_READ | (job.clear ? PROT_WRITE : 0);
+  void *base = mmap(NULL, job.size, prot, MAP_SHARED, job.fd, 0);
+  if (base == MAP_FAILED) {
+    DLOGE("mmap failed for %s errno = %d, desc = %s", job.path.c_str(), errno, strerror(errno));
+    return false;
+  }
+
+  // A busy slot is only touched by the job owning it, resizing it needs no lock. Reserve the
+  // exact size first so the slot never holds more than Queue() accounted for.
+  std::vector<uint8_t> &data = job.slot->data;
+  data.reserve(job.size);
+  data.resize(job.size);
+
+  // Cache maintenance for dma-bufs; other fds (e.g. memfd) just fail the ioctl.
+  struct dma_buf_sync sync = {};
+  sync.flags = DMA_BUF_SYNC_START | (job.clear ? DMA_BUF_SYNC_RW : DMA_BUF_SYNC_READ);
+  ioctl(job.fd, DMA_BUF_IOCTL_SYNC, &sync);
+
+  memcpy(data.data(), base, job.size);
+  if (job.clear) {
+    memset(base, 0, job.size);
+  }
+
+  sync.flags = DMA_BUF_SYNC_END | (job.clear ? DMA_BUF_SYNC_RW : DMA_BUF_SYNC_READ);
+  ioctl(job.fd, DMA_BUF_IOCTL_SYNC, &sync);
+  munmap(base, job.size);
+
+  return true;
+}
+
+bool FrameDumpWriter::Write(const Job &job) {
+  const uint8_t *data = job.slot->data.data();
+  size_t remaining = job.size;
+
+  if (job.compress) {
+    std::string path = job.path + ".gz";
+    // Level 1, the writer has to keep up with the display rate more than it needs small files.
+    gzFile gz = gzopen(path.c_str(), "wb1");
+    if (!gz) {
+      DLOGW("Failed to open %s errno = %d, desc = %s", path.c_str(), errno, strerror(errno));
+      return false;
+    }
+    gzbuffer(gz, UINT32(kWriteChunkBytes));
+
+    while (remaining) {
+      uint32_t chunk = UINT32(std::min(remaining, kWriteChunkBytes));
+      if (gzwrite(gz, data, chunk) != static_cast<int>(chunk)) {
+        DLOGW("gzwrite failed for %s", path.c_str());
+        gzclose(gz);
+        return false;
+      }
+      data += chunk;
+      remaining -= chunk;
+    }
+
+    return (gzclose(gz) == Z_OK);
+  }
+
+  int fd = open(job.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd < 0) {
+    DLOGW("Failed to open %s errno = %d, desc = %s", job.path.c_str(), errno, strerror(errno));
+    return false;
+  }
+
+  while (remaining) {
+    ssize_t written = write(fd, data, std::min(remaining, kWriteChunkBytes));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      DLOGW("write failed for %s errno = %d, desc = %s", job.path.c_str(), errno,
+            strerror(errno));
+      close(fd);
+      return false;
+    }
+    data += written;
+    remaining -= size_t(written);
+  }
+
+  close(fd);
+  return true;
+}
+
+void FrameDumpWriter::Release(const Job &job, bool written) {
+  std::lock_guard<std::mutex> lock(lock_);
+  job.slot->busy = false;
+  if (written) {
+    stats_.written++;
+    stats_.bytes += job.size;
+    DLOGI("Frame Dump %s is Successful", job.path.c_str());
+  } else {
+    stats_.failed++;
+    DLOGW("Frame Dump %s Failed", job.path.c_str());
+  }
+
+  in_flight_--;
+  if (!in_flight_) {
+    // Dumps come in bursts; hand the staging memory back once the writer has caught up.
+    for (auto &slot : slots_) {
+      std::vector<uint8_t>().swap(slot->data);
+      slot->capacity = 0;
+    }
+    idle_cv_.notify_all();
+  }
+}
+
+void FrameDumpWriter::Flush() {
+  std::unique_lock<std::mutex> lock(lock_);
+  idle_cv_.wait(lock, [this] { return !in_flight_; });
+}
+
+void FrameDumpWriter::GetStats(FrameDumpStats *stats) {
+  std::lock_guard<std::mutex> lock(lock_);
+  *stats = stats_;
+}
+
+}  // namespace sdm
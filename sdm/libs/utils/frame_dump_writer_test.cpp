@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <core/buffer_sync_handler.h>
+#include <utils/constants.h>
+#include <utils/fence.h>
+#include <utils/frame_dump_writer.h>
+
+using namespace sdm;
+using namespace testing;
+
+// eventfd backed fences, signaled by writing to the eventfd. Like the composer handler, an
+// invalid fd counts as signaled.
+struct EventFdSyncHandler : BufferSyncHandler {
+  int SyncWait(int fd, int timeout) final {
+    if (fd < 0) {
+      return 0;
+    }
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return (poll(&pfd, 1, timeout) == 1) ? 0 : -1;
+  }
+  int SyncMerge(int fd1, int fd2, int *merged_fd) final { return -1; }
+  void GetSyncInfo(int fd, std::ostringstream *os) final {}
+};
+
+struct TestFence {
+  TestFence() : fd(eventfd(0, EFD_CLOEXEC)), fence(Fence::Create(dup(fd), "test")) {}
+  ~TestFence() { close(fd); }
+  void signal() {
+    uint64_t one = 1;
+    ASSERT_EQ(write(fd, &one, sizeof(one)), ssize_t(sizeof(one)));
+  }
+
+  int fd;
+  shared_ptr<Fence> fence;
+};
+
+struct TestBuffer {
+  explicit TestBuffer(uint32_t size, uint8_t seed) : size(size) {
+    fd = memfd_create("frame_dump_writer_test", MFD_CLOEXEC);
+    EXPECT_EQ(ftruncate(fd, size), 0);
+    contents.resize(size);
+    for (uint32_t i = 0; i < size; i++) {
+      contents[i] = uint8_t(seed + i * 7);
+    }
+    EXPECT_EQ(pwrite(fd, contents.data(), size, 0), ssize_t(size));
+  }
+  ~TestBuffer() { close(fd); }
+
+  std::vector<uint8_t> read() const {
+    std::vector<uint8_t> data(size);
+    EXPECT_EQ(pread(fd, data.data(), size, 0), ssize_t(size));
+    return data;
+  }
+
+  int fd = -1;
+  uint32_t size = 0;
+  std::vector<uint8_t> contents;
+};
+
+static std::vector<uint8_t> readFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+}
+
+class FrameDumpWriterTest : public Test {
+ protected:
+  static void SetUpTestSuite() { Fence::Set(new EventFdSyncHandler()); }
+
+  void SetUp() override {
+    writer->Configure(0, 0, false);
+    writer->GetStats(&start);
+  }
+
+  FrameDumpStats delta() {
+    FrameDumpStats now = {};
+    writer->GetStats(&now);
+    return {now.queued - start.queued, now.written - start.written, now.dropped - start.dropped,
+            now.failed - start.failed, now.bytes - start.bytes};
+  }
+
+  std::string path(const std::string &name) {
+    return TempDir() + "frame_dump_writer_test_" + name;
+  }
+
+  FrameDumpRequest request(const TestBuffer &buffer, const std::string &name,
+                           shared_ptr<Fence> fence = nullptr) {
+    FrameDumpRequest request = {};
+    request.path = path(name);
+    request.fd = buffer.fd;
+    request.size = buffer.size;
+    request.fence = fence;
+    return request;
+  }
+
+  FrameDumpWriter *writer = FrameDumpWriter::GetInstance();
+  FrameDumpStats start = {};
+};
+
+TEST_F(FrameDumpWriterTest, WritesBufferAfterFenceSignals) {
+  TestBuffer buffer(4096 * 3 + 17, 1);
+  TestFence fence;
+  unlink(path("fenced.raw").c_str());
+
+  EXPECT_EQ(writer->Queue(request(buffer, "fenced.raw", fence.fence)), kErrorNone);
+  usleep(20000);
+  EXPECT_EQ(access(path("fenced.raw").c_str(), F_OK), -1);
+
+  fence.signal();
+  writer->Flush();
+  EXPECT_EQ(readFile(path("fenced.raw")), buffer.contents);
+  EXPECT_EQ(delta().written, 1u);
+  EXPECT_EQ(delta().bytes, buffer.size);
+}
+
+TEST_F(FrameDumpWriterTest, SyncCopyClearsBufferBeforeReturning) {
+  TestBuffer buffer(65536, 2);
+  FrameDumpRequest req = request(buffer, "cleared.raw");
+  req.clear = true;
+  req.sync_copy = true;
+
+  EXPECT_EQ(writer->Queue(req), kErrorNone);
+  EXPECT_EQ(buffer.read(), std::vector<uint8_t>(buffer.size, 0));
+
+  writer->Flush();
+  EXPECT_EQ(readFile(path("cleared.raw")), buffer.contents);
+}
+
+TEST_F(FrameDumpWriterTest, DropsWhenSlotsAreExhausted) {
+  writer->Configure(2, 0, false);
+  TestBuffer buffer(4096, 3);
+  TestFence fence;
+
+  EXPECT_EQ(writer->Queue(request(buffer, "drop0.raw", fence.fence)), kErrorNone);
+  EXPECT_EQ(writer->Queue(request(buffer, "drop1.raw", fence.fence)), kErrorNone);
+  EXPECT_EQ(writer->Queue(request(buffer, "drop2.raw", fence.fence)), kErrorResources);
+  EXPECT_EQ(writer->Queue(request(buffer, "drop3.raw", fence.fence)), kErrorResources);
+
+  fence.signal();
+  writer->Flush();
+  FrameDumpStats stats = delta();
+  EXPECT_EQ(stats.queued, 4u);
+  EXPECT_EQ(stats.written, 2u);
+  EXPECT_EQ(stats.dropped, 2u);
+  EXPECT_EQ(stats.failed, 0u);
+
+  // Slots come back once written.
+  EXPECT_EQ(writer->Queue(request(buffer, "drop4.raw")), kErrorNone);
+  writer->Flush();
+}
+
+TEST_F(FrameDumpWriterTest, DropsWhenStagingBytesAreExhausted) {
+  writer->Configure(4, 3 * 4096, false);
+  TestBuffer buffer(2 * 4096, 4);
+  TestFence fence;
+
+  EXPECT_EQ(writer->Queue(request(buffer, "bytes0.raw", fence.fence)), kErrorNone);
+  fence.signal();
+  writer->Flush();
+
+  // The first slot still holds its capacity while the next fence is pending.
+  TestFence pending;
+  EXPECT_EQ(writer->Queue(request(buffer, "bytes1.raw", pending.fence)), kErrorNone);
+  pending.signal();
+  writer->Flush();
+  EXPECT_EQ(delta().dropped, 0u);
+
+  writer->Configure(4, 4096, false);
+  EXPECT_EQ(writer->Queue(request(buffer, "bytes2.raw")), kErrorResources);
+  EXPECT_EQ(delta().dropped, 1u);
+}
+
+TEST_F(FrameDumpWriterTest, CompressesWhenConfigured) {
+  writer->Configure(0, 0, true);
+  TestBuffer buffer(100000, 5);
+
+  EXPECT_EQ(writer->Queue(request(buffer, "compressed.raw")), kErrorNone);
+  writer->Flush();
+
+  gzFile gz = gzopen(path("compressed.raw.gz").c_str(), "rb");
+  ASSERT_NE(gz, nullptr);
+  std::vector<uint8_t> data(buffer.size + 1);
+  EXPECT_EQ(gzread(gz, data.data(), UINT32(data.size())), int(buffer.size));
+  gzclose(gz);
+  data.resize(buffer.size);
+  EXPECT_EQ(data, buffer.contents);
+}
+
+TEST_F(FrameDumpWriterTest, QueueCostDoesNotGrowWithDumpCount) {
+  // Roughly one 1080p RGBA frame per dump.
+  const uint32_t kSize = 1920 * 1088 * 4;
+  TestBuffer buffer(kSize, 6);
+  writer->Configure(40, UINT64(kSize) * 40, false);
+
+  // Median per-call cost, so a single preempted call does not decide the result.
+  std::vector<double> median_us;
+  for (uint32_t frames : {1, 8, 32}) {
+    TestFence fence;
+    std::vector<double> call_us;
+    for (uint32_t i = 0; i < frames; i++) {
+      std::string name = "latency" + std::to_string(frames) + "_" + std::to_string(i) + ".raw";
+      FrameDumpRequest req = request(buffer, name, fence.fence);
+      auto begin = std::chrono::steady_clock::now();
+      EXPECT_EQ(writer->Queue(req), kErrorNone);
+      auto end = std::chrono::steady_clock::now();
+      call_us.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+    }
+    auto queued = std::chrono::steady_clock::now();
+    fence.signal();
+    writer->Flush();
+    auto flushed = std::chrono::steady_clock::now();
+
+    std::sort(call_us.begin(), call_us.end());
+    median_us.push_back(call_us[call_us.size() / 2]);
+    double flush_us = std::chrono::duration<double, std::micro>(flushed - queued).count();
+    std::cout << frames << " frames: " << median_us.back() << " us per Queue(), "
+              << flush_us / frames << " us per written frame" << std::endl;
+
+    for (uint32_t i = 0; i < frames; i++) {
+      unlink(path("latency" + std::to_string(frames) + "_" + std::to_string(i) + ".raw").c_str());
+    }
+  }
+
+  // Queue() never touches the pixels, so its cost stays flat as the backlog grows.
+  EXPECT_LT(median_us[2], median_us[1] * 4 + 50);
+  EXPECT_EQ(delta().written, 41u);
+  EXPECT_EQ(delta().dropped, 0u);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
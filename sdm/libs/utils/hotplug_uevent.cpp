@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <ctype.h>
+#include <string.h>
+#include <utils/constants.h>
+#include <utils/hotplug_uevent.h>
+
+#include <algorithm>
+
+namespace sdm {
+
+namespace {
+
+bool ContainsIgnoreCase(const char *str, size_t size, const char *pattern) {
+  size_t pattern_size = strlen(pattern);
+  for (size_t i = 0; i + pattern_size <= size; i++) {
+    size_t j = 0;
+    while (j < pattern_size && tolower(UINT8(str[i + j])) == tolower(UINT8(pattern[j]))) {
+      j++;
+    }
+    if (j == pattern_size) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Returns the value of a KEY=value string, or null for other keys.
+const char *GetValue(const char *str, size_t size, const char *key, size_t key_size) {
+  if (size < key_size || memcmp(str, key, key_size)) {
+    return nullptr;
+  }
+
+  return str + key_size;
+}
+
+// Same as atoi, bounded by end.
+int ParseInt(const char *str, const char *end) {
+  while (str < end && isspace(UINT8(*str))) {
+    str++;
+  }
+
+  bool negative = false;
+  if (str < end && (*str == '-' || *str == '+')) {
+    negative = (*str == '-');
+    str++;
+  }
+
+  int value = 0;
+  while (str < end && isdigit(UINT8(*str))) {
+    value = value * 10 + (*str - '0');
+    str++;
+  }
+
+  return negative ? -value : value;
+}
+
+}  // namespace
+
+bool ParseHotplugUEvent(const char *data, size_t length, const char *devpath,
+                        HotplugUEvent *event) {
+  static const char kStatus[] = "status=";
+  static const char kConnected[] = "connected";
+  static const char kHotplug[] = "HOTPLUG=";
+  static const char kMstHotplug[] = "MST_HOTPLUG=";
+  static const char kBpp[] = "bpp=";
+  static const char kPattern[] = "pattern=";
+
+  *event = {};
+  const char *end = data + length;
+  bool hotplug = false;
+  for (const char *str = data; str < end && *str;) {
+    size_t remaining = static_cast<size_t>(end - str);
+    const char *str_end = reinterpret_cast<const char *>(memchr(str, '\0', remaining));
+    if (!str_end) {
+      str_end = end;
+    }
+    size_t size = static_cast<size_t>(str_end - str);
+
+    const char *value = nullptr;
+    if (str == data) {
+      // Most uevents are for other devices, they are rejected on the header.
+      if (!ContainsIgnoreCase(str, size, devpath)) {
+        return false;
+      }
+    } else if ((value = GetValue(str, size, kStatus, sizeof(kStatus) - 1))) {
+      size_t value_size = static_cast<size_t>(str_end - value);
+      bool connected = (value_size >= sizeof(kConnected) - 1) &&
+                       !memcmp(value, kConnected, sizeof(kConnected) - 1);
+      event->connected = connected ? 1 : 0;
+      hotplug = true;
+    } else if ((value = GetValue(str, size, kHotplug, sizeof(kHotplug) - 1))) {
+      event->sst_mst_hotplug = true;
+      hotplug = true;
+    } else if ((value = GetValue(str, size, kMstHotplug, sizeof(kMstHotplug) - 1))) {
+      event->mst_hotplug = true;
+      hotplug = true;
+    } else if ((value = GetValue(str, size, kBpp, sizeof(kBpp) - 1))) {
+      event->bpp = ParseInt(value, str_end);
+    } else if ((value = GetValue(str, size, kPattern, sizeof(kPattern) - 1))) {
+      event->pattern = ParseInt(value, str_end);
+    }
+
+    str = str_end + 1;
+  }
+
+  return hotplug;
+}
+
+void HotplugCoalescer::Push(const HotplugUEvent &event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Clock::time_point now = Clock::now();
+  if (!state_.events) {
+    first_event_ = now;
+  }
+  last_event_ = now;
+
+  if (event.connected != -1) {
+    state_.connected = event.connected;
+  }
+  state_.bpp = event.bpp;
+  state_.pattern = event.pattern;
+  state_.events++;
+  cv_.notify_one();
+}
+
+bool HotplugCoalescer::WaitBurst(uint32_t settle_ms, uint32_t max_delay_ms,
+                                 HotplugState *state) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return terminate_ || state_.events; });
+
+  // Each push moves the settle deadline, up to max_delay_ms after the first event of the burst.
+  while (!terminate_) {
+    Clock::time_point wake_time = std::min(last_event_ + std::chrono::milliseconds(settle_ms),
+                                           first_event_ + std::chrono::milliseconds(max_delay_ms));
+    if (Clock::now() >= wake_time) {
+      break;
+    }
+    cv_.wait_until(lock, wake_time);
+  }
+
+  if (terminate_) {
+    return false;
+  }
+
+  *state = state_;
+  state_.events = 0;
+
+  return true;
+}
+
+void HotplugCoalescer::Terminate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  terminate_ = true;
+  cv_.notify_one();
+}
+
+}  // namespace sdm
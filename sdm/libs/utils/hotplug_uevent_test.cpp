@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/hotplug_uevent.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+const char kDevpath[] = "mdss_mdp/drm/card";
+const char kCardHeader[] = "change@/devices/platform/soc/ae00000.qcom,mdss_mdp/drm/card0";
+
+// Joins the strings of a uevent payload the way the kernel sends them, each NUL terminated.
+std::string UEvent(const std::vector<std::string> &strings) {
+  std::string payload;
+  for (auto &str : strings) {
+    payload += str;
+    payload.push_back('\0');
+  }
+  return payload;
+}
+
+std::string DrmHotplug(const char *status, bool mst = false) {
+  std::vector<std::string> strings = {
+      kCardHeader, "ACTION=change", "DEVPATH=/devices/platform/soc/ae00000.qcom,mdss_mdp/drm/card0",
+      "SUBSYSTEM=drm", "HOTPLUG=1", "DEVNAME=dri/card0", "DEVTYPE=drm_minor", "SEQNUM=4211",
+      "MAJOR=226", "MINOR=0"};
+  strings.push_back(std::string("status=") + status);
+  if (mst) {
+    strings.push_back("MST_HOTPLUG=1");
+  }
+  return UEvent(strings);
+}
+
+std::string BatteryUEvent() {
+  return UEvent({"change@/devices/platform/soc/c440000.qcom,spmi/power_supply/battery",
+                 "ACTION=change", "SUBSYSTEM=power_supply", "POWER_SUPPLY_NAME=battery",
+                 "POWER_SUPPLY_STATUS=Charging", "POWER_SUPPLY_CAPACITY=81", "SEQNUM=4212"});
+}
+
+// Replays uevents through a socket pair, with the threads of the composer: the top half receives
+// and parses each datagram into the coalescer, the bottom half reconciles each burst, taking
+// handle_ms as the display teardown or creation would.
+class HotplugReplay {
+ public:
+  HotplugReplay(uint32_t settle_ms, uint32_t max_delay_ms, uint32_t handle_ms) {
+    EXPECT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds_));
+    top_ = std::thread([this] { Top(); });
+    bottom_ = std::thread([=] { Bottom(settle_ms, max_delay_ms, handle_ms); });
+  }
+
+  ~HotplugReplay() { Stop(); }
+
+  void Send(const std::string &payload) {
+    EXPECT_EQ(static_cast<ssize_t>(payload.size()), send(fds_[0], payload.data(),
+                                                         payload.size(), 0));
+  }
+
+  // Waits for count reconciliations, returns false on timeout.
+  bool WaitReconciled(size_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bursts_.size() >= count) {
+          return true;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+
+  void Stop() {
+    if (top_.joinable()) {
+      shutdown(fds_[0], SHUT_RDWR);
+      top_.join();
+      close(fds_[0]);
+      close(fds_[1]);
+    }
+    if (bottom_.joinable()) {
+      coalescer_.Terminate();
+      bottom_.join();
+    }
+  }
+
+  std::vector<HotplugState> Bursts() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bursts_;
+  }
+
+ private:
+  void Top() {
+    char buffer[4096];
+    while (true) {
+      ssize_t length = recv(fds_[1], buffer, sizeof(buffer), 0);
+      if (length <= 0) {
+        return;
+      }
+      HotplugUEvent event;
+      if (ParseHotplugUEvent(buffer, static_cast<size_t>(length), kDevpath, &event)) {
+        coalescer_.Push(event);
+      }
+    }
+  }
+
+  void Bottom(uint32_t settle_ms, uint32_t max_delay_ms, uint32_t handle_ms) {
+    HotplugState state;
+    while (coalescer_.WaitBurst(settle_ms, max_delay_ms, &state)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(handle_ms));
+      std::lock_guard<std::mutex> lock(mutex_);
+      bursts_.push_back(state);
+    }
+  }
+
+  int fds_[2] = {-1, -1};
+  HotplugCoalescer coalescer_;
+  std::thread top_;
+  std::thread bottom_;
+  std::mutex mutex_;
+  std::vector<HotplugState> bursts_;
+};
+
+uint32_t TotalEvents(const std::vector<HotplugState> &bursts) {
+  uint32_t events = 0;
+  for (auto &burst : bursts) {
+    events += burst.events;
+  }
+  return events;
+}
+
+}  // namespace
+
+TEST(HotplugUEventTest, ParsesDrmHotplug) {
+  HotplugUEvent event;
+  std::string payload = DrmHotplug("connected");
+  ASSERT_TRUE(ParseHotplugUEvent(payload.data(), payload.size(), kDevpath, &event));
+  EXPECT_EQ(1, event.connected);
+  EXPECT_TRUE(event.sst_mst_hotplug);
+  EXPECT_FALSE(event.mst_hotplug);
+  EXPECT_EQ(-1, event.bpp);
+  EXPECT_EQ(-1, event.pattern);
+
+  payload = DrmHotplug("disconnected", true);
+  ASSERT_TRUE(ParseHotplugUEvent(payload.data(), payload.size(), kDevpath, &event));
+  EXPECT_EQ(0, event.connected);
+  EXPECT_TRUE(event.mst_hotplug);
+
+  // Compliance test requests carry the panel depth and the pattern.
+  payload = UEvent({"change@/devices/platform/soc/AE00000.QCOM,MDSS_MDP/DRM/CARD0",
+                    "status=connected", "bpp=24", "pattern=1"});
+  ASSERT_TRUE(ParseHotplugUEvent(payload.data(), payload.size(), kDevpath, &event));
+  EXPECT_EQ(1, event.connected);
+  EXPECT_EQ(24, event.bpp);
+  EXPECT_EQ(1, event.pattern);
+
+  // Only MST_HOTPLUG, without status.
+  payload = UEvent({kCardHeader, "MST_HOTPLUG=1"});
+  ASSERT_TRUE(ParseHotplugUEvent(payload.data(), payload.size(), kDevpath, &event));
+  EXPECT_EQ(-1, event.connected);
+  EXPECT_TRUE(event.mst_hotplug);
+  EXPECT_FALSE(event.sst_mst_hotplug);
+}
+
+TEST(HotplugUEventTest, RejectsOtherEvents) {
+  HotplugUEvent event;
+  std::string payload = BatteryUEvent();
+  EXPECT_FALSE(ParseHotplugUEvent(payload.data(), payload.size(), kDevpath, &event));
+
+  // The keys of other devices do not count.
+  payload = UEvent({"change@/devices/virtual/switch/usb", "status=connected", "HOTPLUG=1"});
+  EXPECT_FALSE(ParseHotplugUEvent(payload.data(), payload.size(), kDevpath, &event));
+
+  payload = UEvent({kCardHeader, "ACTION=change", "SUBSYSTEM=drm"});
+  EXPECT_FALSE(ParseHotplugUEvent(payload.data(), payload.size(), kDevpath, &event));
+
+  EXPECT_FALSE(ParseHotplugUEvent(payload.data(), 0, kDevpath, &event));
+}
+
+TEST(HotplugUEventTest, StaysWithinLength) {
+  // The received length cuts the last value, without a terminating NUL.
+  std::string payload = UEvent({kCardHeader, "status=connected", "bpp=30"});
+  payload.resize(payload.size() - 2);
+  std::vector<char> buffer(payload.begin(), payload.end());
+  HotplugUEvent event;
+  ASSERT_TRUE(ParseHotplugUEvent(buffer.data(), buffer.size(), kDevpath, &event));
+  EXPECT_EQ(1, event.connected);
+  EXPECT_EQ(3, event.bpp);
+
+  // Cut inside the status value.
+  payload = UEvent({kCardHeader, "status=connected"});
+  buffer.assign(payload.begin(), payload.begin() + payload.find("conn") + 4);
+  ASSERT_TRUE(ParseHotplugUEvent(buffer.data(), buffer.size(), kDevpath, &event));
+  EXPECT_EQ(0, event.connected);
+
+  // An empty string ends the payload, like the double NUL termination.
+  payload = UEvent({kCardHeader, "", "status=connected"});
+  EXPECT_FALSE(ParseHotplugUEvent(payload.data(), payload.size(), kDevpath, &event));
+}
+
+TEST(HotplugUEventTest, CoalescerKeepsLastState) {
+  HotplugCoalescer coalescer;
+  HotplugUEvent event;
+  event.connected = 1;
+  event.bpp = 24;
+  event.pattern = 2;
+  coalescer.Push(event);
+  event = {};
+  event.mst_hotplug = true;
+  coalescer.Push(event);
+
+  HotplugState state;
+  ASSERT_TRUE(coalescer.WaitBurst(0, 0, &state));
+  EXPECT_EQ(2u, state.events);
+  // The status is kept, the test pattern request only applies to its own event.
+  EXPECT_EQ(1, state.connected);
+  EXPECT_EQ(-1, state.bpp);
+  EXPECT_EQ(-1, state.pattern);
+
+  event.connected = 0;
+  coalescer.Push(event);
+  ASSERT_TRUE(coalescer.WaitBurst(0, 0, &state));
+  EXPECT_EQ(1u, state.events);
+  EXPECT_EQ(0, state.connected);
+
+  std::thread terminate([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    coalescer.Terminate();
+  });
+  EXPECT_FALSE(coalescer.WaitBurst(0, 0, &state));
+  terminate.join();
+}
+
+// A flapping DP link: a storm of connects and disconnects ends up connected, reconciled once
+// after the storm settles, or once more for the events received during the first reconciliation.
+TEST(HotplugUEventTest, ReplayCollapsesStorm) {
+  HotplugReplay replay(30, 1000, 20);
+  for (int i = 0; i < 40; i++) {
+    replay.Send(DrmHotplug((i % 2) ? "connected" : "disconnected", i % 4 == 3));
+    replay.Send(BatteryUEvent());
+  }
+  ASSERT_TRUE(replay.WaitReconciled(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  replay.Stop();
+
+  std::vector<HotplugState> bursts = replay.Bursts();
+  ASSERT_GE(bursts.size(), 1u);
+  EXPECT_LE(bursts.size(), 2u);
+  EXPECT_EQ(40u, TotalEvents(bursts));
+  EXPECT_EQ(1, bursts.back().connected);
+}
+
+TEST(HotplugUEventTest, ReplaySeparateBursts) {
+  HotplugReplay replay(5, 100, 0);
+  replay.Send(DrmHotplug("connected"));
+  ASSERT_TRUE(replay.WaitReconciled(1));
+  replay.Send(BatteryUEvent());
+  replay.Send(DrmHotplug("disconnected"));
+  ASSERT_TRUE(replay.WaitReconciled(2));
+  replay.Stop();
+
+  std::vector<HotplugState> bursts = replay.Bursts();
+  ASSERT_EQ(2u, bursts.size());
+  EXPECT_EQ(1, bursts[0].connected);
+  EXPECT_EQ(0, bursts[1].connected);
+  EXPECT_EQ(1u, bursts[0].events);
+  EXPECT_EQ(1u, bursts[1].events);
+}
+
+// Events that keep coming do not hold the reconciliation back past the maximum delay.
+TEST(HotplugUEventTest, ReplayBoundsDelay) {
+  HotplugReplay replay(50, 40, 0);
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  uint32_t sent = 0;
+  while (std::chrono::steady_clock::now() < end) {
+    replay.Send(DrmHotplug((sent % 2) ? "connected" : "disconnected"));
+    sent++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  replay.Send(DrmHotplug("connected"));
+  sent++;
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  replay.Stop();
+
+  std::vector<HotplugState> bursts = replay.Bursts();
+  EXPECT_GE(bursts.size(), 3u);
+  EXPECT_LT(bursts.size(), sent);
+  EXPECT_EQ(sent, TotalEvents(bursts));
+  EXPECT_EQ(1, bursts.back().connected);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <stdio.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/layer_stack_serializer.h>
+
+#include <sstream>
+#include <string>
+
+#define __CLASS__ "LayerStackSerializer"
+
+namespace sdm {
+
+// Enough digits to read back the same float, the stream default of 6 is not.
+static void WriteFloat(float value, std::ostream *os) {
+  char str[32];
+  snprintf(str, sizeof(str), " %.9g", value);
+  *os << str;
+}
+
+static void WriteRect(const LayerRect &rect, std::ostream *os) {
+  WriteFloat(rect.left, os);
+  WriteFloat(rect.top, os);
+  WriteFloat(rect.right, os);
+  WriteFloat(rect.bottom, os);
+}
+
+static void WriteRects(const char *key, const std::vector<LayerRect> &rects, std::ostream *os) {
+  *os << " " << key << " " << rects.size();
+  for (auto &rect : rects) {
+    WriteRect(rect, os);
+  }
+}
+
+static bool ReadRects(std::istream *is, std::vector<LayerRect> *rects) {
+  size_t count = 0;
+  if (!(*is >> count)) {
+    return false;
+  }
+  rects->resize(count);
+  for (auto &rect : *rects) {
+    if (!(*is >> rect.left >> rect.top >> rect.right >> rect.bottom)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class T>
+static bool ReadEnum(std::istream *is, T *value) {
+  int32_t raw = 0;
+  if (!(*is >> raw)) {
+    return false;
+  }
+  *value = static_cast<T>(raw);
+  return true;
+}
+
+void WriteLayerStack(const LayerStack &layer_stack, uint32_t frame, std::ostream *os) {
+  *os << "frame " << frame << std::hex << " flags 0x" << layer_stack.flags.flags << std::dec
+      << " layers " << layer_stack.layers.size() << "\n";
+
+  for (auto layer : layer_stack.layers) {
+    const LayerBuffer &buffer = layer->input_buffer;
+    *os << "layer id " << layer->layer_id << " comp " << layer->composition
+        << " fmt " << buffer.format << " w " << buffer.width << " h " << buffer.height
+        << " uw " << buffer.unaligned_width << " uh " << buffer.unaligned_height
+        << std::hex << " bflags 0x" << buffer.flags.flags << " usage 0x" << buffer.usage
+        << std::dec << " handle " << buffer.handle_id
+        << " cm " << buffer.color_metadata.colorPrimaries << " "
+        << buffer.color_metadata.transfer << " " << buffer.color_metadata.range;
+    *os << " src";
+    WriteRect(layer->src_rect, os);
+    *os << " dst";
+    WriteRect(layer->dst_rect, os);
+    *os << " blend " << layer->blending << " alpha " << UINT32(layer->plane_alpha) << " rot";
+    WriteFloat(layer->transform.rotation, os);
+    *os << " fliph " << layer->transform.flip_horizontal
+        << " flipv " << layer->transform.flip_vertical << std::hex
+        << " flags 0x" << layer->flags.flags << " geom 0x" << layer->geometry_changes
+        << " fill 0x" << layer->solid_fill_color << std::dec << " fps " << layer->frame_rate;
+    WriteRects("dirty", layer->dirty_regions, os);
+    WriteRects("visible", layer->visible_regions, os);
+    // Name goes last, it runs to the end of the line and may contain spaces.
+    *os << " name " << layer->layer_name << "\n";
+  }
+}
+
+static bool ReadLayer(const std::string &line, Layer *layer) {
+  std::istringstream is(line);
+  LayerBuffer &buffer = layer->input_buffer;
+  std::string key;
+
+  if (!(is >> key) || key != "layer") {
+    return false;
+  }
+
+  while (is >> key) {
+    bool ok = true;
+    if (key == "id") {
+      ok = !!(is >> layer->layer_id);
+    } else if (key == "comp") {
+      ok = ReadEnum(&is, &layer->composition);
+    } else if (key == "fmt") {
+      ok = ReadEnum(&is, &buffer.format);
+    } else if (key == "w") {
+      ok = !!(is >> buffer.width);
+    } else if (key == "h") {
+      ok = !!(is >> buffer.height);
+    } else if (key == "uw") {
+      ok = !!(is >> buffer.unaligned_width);
+    } else if (key == "uh") {
+      ok = !!(is >> buffer.unaligned_height);
+    } else if (key == "bflags") {
+      ok = !!(is >> std::hex >> buffer.flags.flags >> std::dec);
+    } else if (key == "usage") {
+      ok = !!(is >> std::hex >> buffer.usage >> std::dec);
+    } else if (key == "handle") {
+      ok = !!(is >> buffer.handle_id);
+      buffer.buffer_id = buffer.handle_id;
+    } else if (key == "cm") {
+      ok = ReadEnum(&is, &buffer.color_metadata.colorPrimaries) &&
+           ReadEnum(&is, &buffer.color_metadata.transfer) &&
+           ReadEnum(&is, &buffer.color_metadata.range);
+    } else if (key == "src") {
+      LayerRect &r = layer->src_rect;
+      ok = !!(is >> r.left >> r.top >> r.right >> r.bottom);
+    } else if (key == "dst") {
+      LayerRect &r = layer->dst_rect;
+      ok = !!(is >> r.left >> r.top >> r.right >> r.bottom);
+    } else if (key == "blend") {
+      ok = ReadEnum(&is, &layer->blending);
+    } else if (key == "alpha") {
+      uint32_t alpha = 0;
+      ok = !!(is >> alpha);
+      layer->plane_alpha = UINT8(alpha);
+    } else if (key == "rot") {
+      ok = !!(is >> layer->transform.rotation);
+    } else if (key == "fliph") {
+      ok = !!(is >> layer->transform.flip_horizontal);
+    } else if (key == "flipv") {
+      ok = !!(is >> layer->transform.flip_vertical);
+    } else if (key == "flags") {
+      ok = !!(is >> std::hex >> layer->flags.flags >> std::dec);
+    } else if (key == "geom") {
+      ok = !!(is >> std::hex >> layer->geometry_changes >> std::dec);
+    } else if (key == "fill") {
+      ok = !!(is >> std::hex >> layer->solid_fill_color >> std::dec);
+    } else if (key == "fps") {
+      ok = !!(is >> layer->frame_rate);
+    } else if (key == "dirty") {
+      ok = ReadRects(&is, &layer->dirty_regions);
+    } else if (key == "visible") {
+      ok = ReadRects(&is, &layer->visible_regions);
+    } else if (key == "name") {
+      std::getline(is >> std::ws, layer->layer_name);
+      break;
+    } else {
+      DLOGW("Skipping unknown key %s", key.c_str());
+    }
+
+    if (!ok) {
+      DLOGE("Malformed value for %s in \"%s\"", key.c_str(), line.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ReadLayerStack(std::istream *is, LayerStackRecord *record) {
+  std::string line;
+  while (std::getline(*is, line) && line.empty()) {
+  }
+  if (line.empty()) {
+    return false;
+  }
+
+  std::istringstream header(line);
+  std::string frame_key, flags_key, layers_key;
+  size_t count = 0;
+  header >> frame_key >> record->frame >> flags_key >> std::hex >> record->flags.flags >>
+      std::dec >> layers_key >> count;
+  if (!header || frame_key != "frame" || flags_key != "flags" || layers_key != "layers") {
+    DLOGE("Malformed frame header \"%s\"", line.c_str());
+    return false;
+  }
+
+  record->layers.clear();
+  record->layers.resize(count);
+  for (auto &layer : record->layers) {
+    if (!std::getline(*is, line) || !ReadLayer(line, &layer)) {
+      DLOGE("Truncated or malformed layer in frame %u", record->frame);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace sdm
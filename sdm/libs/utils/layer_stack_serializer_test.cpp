@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/layer_stack_serializer.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+void ExpectRect(const LayerRect &expected, const LayerRect &actual) {
+  EXPECT_EQ(expected.left, actual.left);
+  EXPECT_EQ(expected.top, actual.top);
+  EXPECT_EQ(expected.right, actual.right);
+  EXPECT_EQ(expected.bottom, actual.bottom);
+}
+
+void ExpectRects(const std::vector<LayerRect> &expected, const std::vector<LayerRect> &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ExpectRect(expected[i], actual[i]);
+  }
+}
+
+void ExpectLayer(const Layer &expected, const Layer &actual) {
+  const LayerBuffer &in = expected.input_buffer;
+  const LayerBuffer &out = actual.input_buffer;
+  EXPECT_EQ(expected.layer_id, actual.layer_id);
+  EXPECT_EQ(expected.composition, actual.composition);
+  EXPECT_EQ(in.format, out.format);
+  EXPECT_EQ(in.width, out.width);
+  EXPECT_EQ(in.height, out.height);
+  EXPECT_EQ(in.unaligned_width, out.unaligned_width);
+  EXPECT_EQ(in.unaligned_height, out.unaligned_height);
+  EXPECT_EQ(in.flags.flags, out.flags.flags);
+  EXPECT_EQ(in.usage, out.usage);
+  EXPECT_EQ(in.handle_id, out.handle_id);
+  EXPECT_EQ(in.handle_id, out.buffer_id);
+  EXPECT_EQ(in.color_metadata.colorPrimaries, out.color_metadata.colorPrimaries);
+  EXPECT_EQ(in.color_metadata.transfer, out.color_metadata.transfer);
+  EXPECT_EQ(in.color_metadata.range, out.color_metadata.range);
+  ExpectRect(expected.src_rect, actual.src_rect);
+  ExpectRect(expected.dst_rect, actual.dst_rect);
+  EXPECT_EQ(expected.blending, actual.blending);
+  EXPECT_EQ(expected.plane_alpha, actual.plane_alpha);
+  EXPECT_EQ(expected.transform.rotation, actual.transform.rotation);
+  EXPECT_EQ(expected.transform.flip_horizontal, actual.transform.flip_horizontal);
+  EXPECT_EQ(expected.transform.flip_vertical, actual.transform.flip_vertical);
+  EXPECT_EQ(expected.flags.flags, actual.flags.flags);
+  EXPECT_EQ(expected.geometry_changes, actual.geometry_changes);
+  EXPECT_EQ(expected.solid_fill_color, actual.solid_fill_color);
+  EXPECT_EQ(expected.frame_rate, actual.frame_rate);
+  ExpectRects(expected.dirty_regions, actual.dirty_regions);
+  ExpectRects(expected.visible_regions, actual.visible_regions);
+  EXPECT_EQ(expected.layer_name, actual.layer_name);
+}
+
+class LayerStackSerializerTest : public Test {
+ protected:
+  void SetUp() override {
+    Layer &app = layers_[0];
+    app.layer_id = 7;
+    app.composition = kCompositionSDE;
+    app.input_buffer.format = kFormatYCbCr420SPVenusUbwc;
+    app.input_buffer.width = 1088;
+    app.input_buffer.height = 2432;
+    app.input_buffer.unaligned_width = 1080;
+    app.input_buffer.unaligned_height = 2400;
+    app.input_buffer.flags.secure = 1;
+    app.input_buffer.usage = 0xdeadbeef00ULL;
+    app.input_buffer.handle_id = 99;
+    app.input_buffer.color_metadata.colorPrimaries = ColorPrimaries_BT2020;
+    app.input_buffer.color_metadata.transfer = Transfer_SMPTE_ST2084;
+    app.input_buffer.color_metadata.range = Range_Limited;
+    // Fractional crops from scaled video, none of them exact in 6 digits
+    app.src_rect = {0.333333343f, 12.0078125f, 1079.66663f, 2399.99976f};
+    app.dst_rect = {0, 0, 1080, 2400};
+    app.blending = kBlendingCoverage;
+    app.plane_alpha = 128;
+    app.transform.rotation = 90.0f;
+    app.transform.flip_vertical = true;
+    app.flags.skip = 1;
+    app.geometry_changes = kBufferGeometry | kSourceCrop;
+    app.frame_rate = 24;
+    app.dirty_regions = {{1.5f, 2.25f, 1023.125f, 4.0f}, {0, 2000, 1080, 2400}};
+    app.visible_regions = {{0, 0, 1080, 2400}};
+    app.layer_name = "com.example.app/Main Activity#0";
+
+    Layer &fill = layers_[1];
+    fill.layer_id = 8;
+    fill.composition = kCompositionSDE;
+    fill.flags.solid_fill = 1;
+    fill.solid_fill_color = 0xff00ff00;
+    fill.dst_rect = {0, 100, 1080, 200};
+    fill.layer_name = "dim";
+
+    Layer &target = layers_[2];
+    target.composition = kCompositionGPUTarget;
+    target.input_buffer.width = 1080;
+    target.input_buffer.height = 2400;
+    target.input_buffer.handle_id = 100;
+    target.layer_name = "target";
+
+    for (auto &layer : layers_) {
+      layer_stack_.layers.push_back(&layer);
+    }
+    layer_stack_.flags.geometry_changed = 1;
+    layer_stack_.flags.skip_present = 1;
+  }
+
+  Layer layers_[3];
+  LayerStack layer_stack_;
+};
+
+}  // namespace
+
+TEST_F(LayerStackSerializerTest, RoundTrip) {
+  std::stringstream ss;
+  WriteLayerStack(layer_stack_, 3, &ss);
+  layer_stack_.flags.geometry_changed = 0;
+  WriteLayerStack(layer_stack_, 4, &ss);
+
+  for (uint32_t frame : {3u, 4u}) {
+    LayerStackRecord record;
+    ASSERT_TRUE(ReadLayerStack(&ss, &record));
+    EXPECT_EQ(frame, record.frame);
+    EXPECT_EQ(frame == 3, record.flags.geometry_changed);
+    EXPECT_TRUE(record.flags.skip_present);
+    ASSERT_EQ(layer_stack_.layers.size(), record.layers.size());
+    for (size_t i = 0; i < record.layers.size(); i++) {
+      SCOPED_TRACE(i);
+      ExpectLayer(*layer_stack_.layers[i], record.layers[i]);
+    }
+  }
+
+  LayerStackRecord record;
+  EXPECT_FALSE(ReadLayerStack(&ss, &record));
+}
+
+// Writing what was read gives back the same text, so dumps of replays diff cleanly.
+TEST_F(LayerStackSerializerTest, RewriteIsStable) {
+  std::stringstream ss;
+  WriteLayerStack(layer_stack_, 1, &ss);
+  std::string text = ss.str();
+
+  LayerStackRecord record;
+  ASSERT_TRUE(ReadLayerStack(&ss, &record));
+  LayerStack layer_stack;
+  layer_stack.flags = record.flags;
+  for (auto &layer : record.layers) {
+    layer_stack.layers.push_back(&layer);
+  }
+  std::stringstream rewritten;
+  WriteLayerStack(layer_stack, record.frame, &rewritten);
+  EXPECT_EQ(text, rewritten.str());
+}
+
+TEST_F(LayerStackSerializerTest, UnknownKeysAreSkipped) {
+  std::istringstream is("\n\nframe 9 flags 0x0 layers 1\n"
+                        "layer id 5 future 1 fps 60 name a b\n");
+  LayerStackRecord record;
+  ASSERT_TRUE(ReadLayerStack(&is, &record));
+  EXPECT_EQ(9u, record.frame);
+  ASSERT_EQ(1u, record.layers.size());
+  EXPECT_EQ(5u, record.layers[0].layer_id);
+  EXPECT_EQ(60u, record.layers[0].frame_rate);
+  EXPECT_EQ("a b", record.layers[0].layer_name);
+}
+
+TEST_F(LayerStackSerializerTest, MalformedRecords) {
+  const char *records[] = {
+    "frame 1 flags 0x0\n",
+    "frame x flags 0x0 layers 0\n",
+    "frame 1 flags 0x0 layers 2\nlayer id 1\n",
+    "frame 1 flags 0x0 layers 1\nlayer id one\n",
+    "frame 1 flags 0x0 layers 1\nlayer src 0 0 10\n",
+    "frame 1 flags 0x0 layers 1\nlayer dirty 2 0 0 1 1\n",
+    "frame 1 flags 0x0 layers 1\nlayers id 1\n",
+  };
+  for (auto text : records) {
+    std::istringstream is(text);
+    LayerStackRecord record;
+    EXPECT_FALSE(ReadLayerStack(&is, &record)) << text;
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <utils/present_pacer.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace sdm {
+
+int64_t MonotonicPacerClock::Now() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+void MonotonicPacerClock::SleepUntil(int64_t timestamp_ns) {
+  struct timespec ts = {};
+  ts.tv_sec = static_cast<time_t>(timestamp_ns / 1000000000LL);
+  ts.tv_nsec = static_cast<long>(timestamp_ns % 1000000000LL);  // NOLINT
+  // An absolute deadline does not drift when the sleep is interrupted and restarted.
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+}
+
+void PresentPacer::LatencyModel::Add(int64_t sample_ns) {
+  samples[next] = std::max(sample_ns, INT64_C(0));
+  next = (next + 1) % kHistorySize;
+  count = std::min(count + 1, kHistorySize);
+}
+
+int64_t PresentPacer::LatencyModel::Percentile90() {
+  int64_t sorted[kHistorySize];
+  std::copy(samples, samples + count, sorted);
+  uint32_t index = (count * 9) / 10;
+  index = std::min(index, count - 1);
+  std::nth_element(sorted, sorted + index, sorted + count);
+  return sorted[index];
+}
+
+int64_t PresentPacer::LatencyModel::Predict(int64_t vsync_period_ns, int64_t default_ns) {
+  if (margin_ns < 0) {
+    margin_ns = std::max(vsync_period_ns / 4, floor_ns);
+  }
+  if (!count) {
+    return default_ns;
+  }
+
+  return Percentile90() + margin_ns;
+}
+
+void PresentPacer::LatencyModel::OnLate(int64_t vsync_period_ns) {
+  // Do not decay back below the margin that just failed.
+  int64_t max_margin = std::max(vsync_period_ns / 2, kMinMarginNs);
+  floor_ns = std::min(std::max(margin_ns, kMinMarginNs) + vsync_period_ns / 16, max_margin);
+  margin_ns = std::min(std::max(2 * margin_ns, floor_ns), max_margin);
+  on_time = 0;
+}
+
+void PresentPacer::LatencyModel::OnEarly() {
+  margin_ns = std::max(margin_ns / 2, kMinMarginNs);
+  floor_ns = std::max(floor_ns / 2, kMinMarginNs);
+}
+
+void PresentPacer::LatencyModel::OnTime() {
+  margin_ns = std::max(margin_ns - margin_ns / 32, floor_ns);
+  // Probe for a tighter margin only after a long run without misses.
+  if (++on_time >= kProbeFrames) {
+    floor_ns = std::max(floor_ns - floor_ns / 8, kMinMarginNs);
+    on_time = 0;
+  }
+}
+
+PresentPacer::PresentPacer(PacerClock *clock) : clock_(clock ? clock : &monotonic_clock_) {
+}
+
+uint32_t PresentPacer::RefreshRate(int64_t vsync_period_ns) {
+  if (vsync_period_ns <= 0) {
+    return 0;
+  }
+
+  return static_cast<uint32_t>((1000000000LL + vsync_period_ns / 2) / vsync_period_ns);
+}
+
+int64_t PresentPacer::GetCommitTime(int64_t expected_present_ns, int64_t vsync_period_ns,
+                                    bool variable_refresh, VBlankSource *vblank,
+                                    int64_t *target_ns) {
+  int64_t target = expected_present_ns;
+  int64_t latency = 0;
+
+  if (variable_refresh) {
+    // Without history, commit one vsync period ahead of the expected present time.
+    latency = std::min(qsync_.Predict(vsync_period_ns, vsync_period_ns), 2 * vsync_period_ns);
+  } else {
+    int64_t last_vblank = 0;
+    if (vblank && vsync_period_ns > 0 && !vblank->GetLastVBlank(&last_vblank) &&
+        last_vblank > 0) {
+      // Snap to the nearest vblank, at least the next one.
+      int64_t vblanks = (expected_present_ns - last_vblank + vsync_period_ns / 2) /
+                        vsync_period_ns;
+      target = last_vblank + std::max(vblanks, INT64_C(1)) * vsync_period_ns;
+    }
+    // A commit more than a period ahead would latch on the vblank before the target.
+    latency = std::min(fixed_.Predict(vsync_period_ns, vsync_period_ns / 2),
+                       vsync_period_ns - vsync_period_ns / 8);
+  }
+
+  *target_ns = target;
+  return target - latency;
+}
+
+void PresentPacer::WaitUntil(int64_t timestamp_ns) {
+  int64_t now = clock_->Now();
+  if (now >= timestamp_ns) {
+    return;
+  }
+
+  if (timestamp_ns - now > kSpinNs) {
+    clock_->SleepUntil(timestamp_ns - kSpinNs);
+  }
+  while ((now = clock_->Now()) < timestamp_ns) {
+  }
+
+  std::lock_guard<std::mutex> lock(stats_lock_);
+  max_wake_error_ns_ = std::max(max_wake_error_ns_, now - timestamp_ns);
+}
+
+void PresentPacer::OnCommit(int64_t target_ns, int64_t commit_start_ns, int64_t commit_end_ns,
+                            int64_t vsync_period_ns, bool variable_refresh) {
+  if (!variable_refresh) {
+    fixed_.Add(commit_end_ns - commit_start_ns);
+  }
+
+  pending_ = {};
+  if (target_ns) {
+    pending_.target_ns = target_ns;
+    pending_.commit_start_ns = commit_start_ns;
+    pending_.vsync_period_ns = vsync_period_ns;
+    pending_.variable_refresh = variable_refresh;
+  }
+}
+
+void PresentPacer::OnPresent(int64_t present_ns) {
+  if (PresentPending()) {
+    Account(present_ns, false);
+  }
+}
+
+void PresentPacer::OnMissed() {
+  if (PresentPending()) {
+    Account(clock_->Now(), true);
+  }
+}
+
+int64_t PresentPacer::PendingDeadline() {
+  return pending_.target_ns + pending_.vsync_period_ns / 2;
+}
+
+void PresentPacer::Account(int64_t present_ns, bool missed) {
+  int64_t period = pending_.vsync_period_ns;
+  int64_t late_ns = present_ns - pending_.target_ns;
+  LatencyModel &model = Model(pending_.variable_refresh);
+
+  std::lock_guard<std::mutex> lock(stats_lock_);
+  PacingStats &stats = stats_[RefreshRate(period)];
+  stats.frames++;
+  stats.total_lead_ns += pending_.target_ns - pending_.commit_start_ns;
+  if (missed || late_ns > period / 2) {
+    stats.late++;
+    stats.max_late_ns = std::max(stats.max_late_ns, late_ns);
+    model.OnLate(period);
+  } else if (late_ns < -period / 2) {
+    stats.early++;
+    model.OnEarly();
+  } else {
+    model.OnTime();
+  }
+
+  if (pending_.variable_refresh && !missed) {
+    qsync_.Add(present_ns - pending_.commit_start_ns);
+  }
+  pending_ = {};
+}
+
+PacingStats PresentPacer::GetStats(uint32_t refresh_rate) {
+  std::lock_guard<std::mutex> lock(stats_lock_);
+  auto it = stats_.find(refresh_rate);
+  return (it != stats_.end()) ? it->second : PacingStats();
+}
+
+std::string PresentPacer::Dump() {
+  std::lock_guard<std::mutex> lock(stats_lock_);
+  std::ostringstream os;
+  os << "\nPresent pacing: max wake error: " << max_wake_error_ns_ / 1000 << "us";
+  for (auto &it : stats_) {
+    const PacingStats &stats = it.second;
+    int64_t avg_lead_ns = stats.frames ? stats.total_lead_ns / static_cast<int64_t>(stats.frames)
+                                       : 0;
+    os << "\n  " << it.first << "Hz frames: " << stats.frames << " late: " << stats.late
+       << " early: " << stats.early << " max late: " << stats.max_late_ns / 1000 << "us"
+       << " avg lead: " << avg_lead_ns / 1000 << "us";
+  }
+
+  return os.str();
+}
+
+}  // namespace sdm
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <utils/present_pacer.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+const int64_t kPeriod120 = 8333333;
+const int64_t kPeriod60 = 16666667;
+
+// Deterministic jitter source.
+class Jitter {
+ public:
+  int64_t Next(int64_t min_ns, int64_t max_ns) {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return min_ns + static_cast<int64_t>((state_ >> 33) % static_cast<uint64_t>(max_ns - min_ns));
+  }
+
+ private:
+  uint64_t state_ = 1;
+};
+
+// Every clock read costs 100ns, sleeps wake 20-150us late like a loaded scheduler would.
+class SimClock : public PacerClock {
+ public:
+  int64_t Now() override { return now_ += 100; }
+  void SleepUntil(int64_t timestamp_ns) override {
+    now_ = std::max(now_, timestamp_ns) + jitter_.Next(20000, 150000);
+    sleeps_++;
+  }
+  void Advance(int64_t ns) { now_ += ns; }
+  int64_t Peek() { return now_; }
+
+  uint32_t sleeps_ = 0;
+
+ private:
+  int64_t now_ = 1000000000;
+  Jitter jitter_;
+};
+
+// Vblanks every period since a fixed phase.
+class SimVBlank : public VBlankSource {
+ public:
+  SimVBlank(SimClock *clock, int64_t period) : clock_(clock), period_(period) {}
+  int GetLastVBlank(int64_t *timestamp_ns) override {
+    *timestamp_ns = Last(clock_->Peek());
+    return 0;
+  }
+  int64_t Last(int64_t now) { return now - (now - kPhase) % period_; }
+  int64_t Next(int64_t now) { return Last(now) + period_; }
+
+  static const int64_t kPhase = 1234567;
+
+ private:
+  SimClock *clock_;
+  int64_t period_;
+};
+
+struct Result {
+  uint32_t late = 0;
+  uint32_t early = 0;
+  int64_t total_lead_ns = 0;
+};
+
+// Fixed refresh panel: the commit takes 300-700us and the frame latches on the first vblank at
+// least 800us after programming completes. Clients render for 0.5-3ms after a vblank and target
+// the vblank two periods out.
+Result RunFixed(PresentPacer *pacer, SimClock *clock, int64_t period, uint32_t frames,
+                uint32_t warmup) {
+  SimVBlank vblank(clock, period);
+  Jitter jitter;
+  Result result;
+  for (uint32_t i = 0; i < frames; i++) {
+    clock->Advance(vblank.Next(clock->Peek()) - clock->Peek() + jitter.Next(500000, 3000000));
+    int64_t expected = vblank.Last(clock->Peek()) + 2 * period;
+
+    int64_t target = 0;
+    int64_t commit = pacer->GetCommitTime(expected, period, false, &vblank, &target);
+    EXPECT_EQ(expected, target);
+    pacer->WaitUntil(commit);
+    int64_t start = clock->Peek();
+    clock->Advance(jitter.Next(300000, 700000));
+    int64_t end = clock->Peek();
+    pacer->OnCommit(target, start, end, period, false);
+
+    int64_t present = vblank.Next(end + 800000 - 1);
+    pacer->OnPresent(present);
+    if (i >= warmup) {
+      result.late += (present > target);
+      result.early += (present < target);
+      result.total_lead_ns += target - start;
+    }
+  }
+
+  return result;
+}
+
+}  // namespace
+
+TEST(PresentPacerTest, WaitUntilNeverWakesEarly) {
+  SimClock clock;
+  PresentPacer pacer(&clock);
+
+  for (int64_t delay : {50000, 150000, 400000, 1000000, 8000000}) {
+    int64_t deadline = clock.Peek() + delay;
+    pacer.WaitUntil(deadline);
+    int64_t woke = clock.Peek();
+    EXPECT_GE(woke, deadline);
+    // The spin tail absorbs the sleep overshoot, only the cost of a clock read remains.
+    EXPECT_LE(woke - deadline, 100);
+  }
+  EXPECT_EQ(3u, clock.sleeps_);
+
+  int64_t now = clock.Peek();
+  pacer.WaitUntil(now - 1000000);
+  EXPECT_LE(clock.Peek() - now, 100);
+}
+
+TEST(PresentPacerTest, FixedRefreshConvergesWithoutMissingFrames) {
+  SimClock clock;
+  PresentPacer pacer(&clock);
+
+  Result result = RunFixed(&pacer, &clock, kPeriod120, 600, 0);
+  EXPECT_EQ(0u, result.early);
+  EXPECT_LE(result.late, 2u);
+
+  // Once converged the commit starts close to the vblank it targets, far later than the full
+  // vsync period ahead that the previous sleep used.
+  result = RunFixed(&pacer, &clock, kPeriod120, 300, 0);
+  EXPECT_EQ(0u, result.early);
+  EXPECT_EQ(0u, result.late);
+  EXPECT_LT(result.total_lead_ns / 300, 3000000);
+}
+
+TEST(PresentPacerTest, ExpectedPresentSnapsToVBlankGrid) {
+  SimClock clock;
+  PresentPacer pacer(&clock);
+  SimVBlank vblank(&clock, kPeriod60);
+
+  int64_t next = vblank.Next(clock.Peek());
+  int64_t target = 0;
+  pacer.GetCommitTime(next + 2 * kPeriod60 + 1000000, kPeriod60, false, &vblank, &target);
+  EXPECT_EQ(next + 2 * kPeriod60, target);
+
+  // A present time already behind the next vblank targets the next vblank.
+  pacer.GetCommitTime(next - kPeriod60, kPeriod60, false, &vblank, &target);
+  EXPECT_EQ(next, target);
+
+  // No vblank source, the expected present time is taken as is.
+  int64_t commit = pacer.GetCommitTime(next + 1000, kPeriod60, false, nullptr, &target);
+  EXPECT_EQ(next + 1000, target);
+  EXPECT_EQ(next + 1000 - kPeriod60 / 2, commit);
+}
+
+TEST(PresentPacerTest, QsyncPresentsAtExpectedTime) {
+  SimClock clock;
+  PresentPacer pacer(&clock);
+  Jitter jitter;
+  const int64_t period = kPeriod120;
+
+  int64_t worst_error = 0;
+  for (uint32_t i = 0; i < 200; i++) {
+    // Content at 48 fps on a qsync panel with a 120 Hz mode.
+    int64_t expected = clock.Peek() + 20833333;
+
+    int64_t target = 0;
+    int64_t commit = pacer.GetCommitTime(expected, period, true, nullptr, &target);
+    EXPECT_EQ(expected, target);
+    if (i == 0) {
+      EXPECT_EQ(expected - period, commit);
+    }
+    pacer.WaitUntil(commit);
+    int64_t start = clock.Peek();
+    clock.Advance(jitter.Next(300000, 700000));
+    pacer.OnCommit(target, start, clock.Peek(), period, true);
+
+    // The panel refreshes once the frame has landed.
+    int64_t present = clock.Peek() + jitter.Next(1000000, 1500000);
+    pacer.OnPresent(present);
+    clock.Advance(present - clock.Peek() + 1000000);
+    if (i >= 20) {
+      worst_error = std::max(worst_error, std::abs(present - expected));
+    }
+  }
+
+  EXPECT_LT(worst_error, 2000000);
+  PacingStats stats = pacer.GetStats(120);
+  EXPECT_EQ(200u, stats.frames);
+  EXPECT_EQ(0u, stats.late);
+}
+
+TEST(PresentPacerTest, StatsAreKeptPerRefreshRate) {
+  SimClock clock;
+  PresentPacer pacer(&clock);
+
+  RunFixed(&pacer, &clock, kPeriod60, 100, 0);
+  RunFixed(&pacer, &clock, kPeriod120, 50, 0);
+
+  // A commit whose retire fence never signals counts as late.
+  SimVBlank vblank(&clock, kPeriod120);
+  int64_t target = 0;
+  int64_t commit = pacer.GetCommitTime(vblank.Next(clock.Peek()) + kPeriod120, kPeriod120, false,
+                                       &vblank, &target);
+  pacer.WaitUntil(commit);
+  pacer.OnCommit(target, clock.Peek(), clock.Peek() + 500000, kPeriod120, false);
+  ASSERT_TRUE(pacer.PresentPending());
+  clock.Advance(pacer.PendingDeadline() - clock.Peek() + 1);
+  pacer.OnMissed();
+  EXPECT_FALSE(pacer.PresentPending());
+
+  PacingStats stats60 = pacer.GetStats(60);
+  PacingStats stats120 = pacer.GetStats(120);
+  EXPECT_EQ(100u, stats60.frames);
+  EXPECT_EQ(51u, stats120.frames);
+  EXPECT_GE(stats120.late, 1u);
+  EXPECT_GT(stats120.max_late_ns, kPeriod120 / 2);
+  EXPECT_EQ(0u, pacer.GetStats(90).frames);
+
+  std::string dump = pacer.Dump();
+  EXPECT_NE(std::string::npos, dump.find("60Hz frames: 100"));
+  EXPECT_NE(std::string::npos, dump.find("120Hz frames: 51"));
+
+  // Unpaced commits are not accounted.
+  pacer.OnCommit(0, clock.Peek(), clock.Peek() + 500000, kPeriod120, false);
+  EXPECT_FALSE(pacer.PresentPending());
+  pacer.OnPresent(clock.Peek());
+  EXPECT_EQ(51u, pacer.GetStats(120).frames);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
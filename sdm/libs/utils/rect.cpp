@@ -25,6 +25,10 @@
 * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
 * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Changes from Qualcomm Innovation Center are provided under the following license:
+* Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+* SPDX-License-Identifier: BSD-3-Clause-Clear
 */
 
 #include <math.h>
@@ -47,6 +51,21 @@ bool IsCongruent(const LayerRect &rect1, const LayerRect &rect2) {
           (rect1.bottom == rect2.bottom));
 }
 
+// Same rects in the same order; MergeRects output is sorted, so equal sets compare equal.
+bool IsCongruent(const std::vector<LayerRect> &rects1, const std::vector<LayerRect> &rects2) {
+  if (rects1.size() != rects2.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < rects1.size(); i++) {
+    if (!IsCongruent(rects1.at(i), rects2.at(i))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 void LogI(DebugTag debug_tag, const char *prefix, const LayerRect &roi) {
   DLOGI_IF(debug_tag, "%s: left = %.0f, top = %.0f, right = %.0f, bottom = %.0f",
            prefix, roi.left, roi.top, roi.right, roi.bottom);
@@ -185,6 +204,91 @@ LayerRect Union(const LayerRect &rect1, const LayerRect &rect2) {
   return res;
 }
 
+float Area(const LayerRect &rect) {
+  if (!IsValid(rect)) {
+    return 0.0f;
+  }
+
+  return (rect.right - rect.left) * (rect.bottom - rect.top);
+}
+
+float Area(const std::vector<LayerRect> &rects) {
+  float area = 0.0f;
+  for (auto &rect : rects) {
+    area += Area(rect);
+  }
+
+  return area;
+}
+
+// Rects sharing only an edge are disjoint.
+static bool Overlaps(const LayerRect &rect1, const LayerRect &rect2) {
+  return IsValid(Intersection(rect1, rect2));
+}
+
+// Replaces rects[index] with its union with every rect it overlaps, until nothing overlaps it.
+static void AbsorbOverlaps(size_t index, std::vector<LayerRect> *rects) {
+  bool absorbed = true;
+  while (absorbed) {
+    absorbed = false;
+    for (size_t i = 0; i < rects->size(); i++) {
+      if (i != index && Overlaps(rects->at(index), rects->at(i))) {
+        rects->at(index) = Union(rects->at(index), rects->at(i));
+        rects->erase(rects->begin() + static_cast<std::ptrdiff_t>(i));
+        index -= (i < index) ? 1 : 0;
+        absorbed = true;
+        break;
+      }
+    }
+  }
+}
+
+void MergeRects(uint32_t max_rects, float rect_cost, std::vector<LayerRect> *rects) {
+  rects->erase(std::remove_if(rects->begin(), rects->end(),
+                              [](const LayerRect &rect) { return !IsValid(rect); }),
+               rects->end());
+
+  // Overlapping rects would refresh the overlap twice, fold them into their bounding box first.
+  for (size_t i = 0; i < rects->size(); i++) {
+    AbsorbOverlaps(i, rects);
+  }
+
+  max_rects = std::max(max_rects, 1U);
+  while (rects->size() > 1) {
+    // Cheapest pair to merge: extra pixels the bounding box refreshes minus the rect it saves.
+    size_t first = 0;
+    size_t second = 0;
+    float best_cost = 0.0f;
+    bool found = false;
+    for (size_t i = 0; i < rects->size(); i++) {
+      for (size_t j = i + 1; j < rects->size(); j++) {
+        const LayerRect &rect1 = rects->at(i);
+        const LayerRect &rect2 = rects->at(j);
+        float cost = Area(Union(rect1, rect2)) - Area(rect1) - Area(rect2) - rect_cost;
+        if (!found || cost < best_cost) {
+          first = i;
+          second = j;
+          best_cost = cost;
+          found = true;
+        }
+      }
+    }
+
+    if (best_cost > 0.0f && rects->size() <= max_rects) {
+      break;
+    }
+
+    // The bounding box may now overlap others; those are cheaper merged than left overlapping.
+    rects->at(first) = Union(rects->at(first), rects->at(second));
+    rects->erase(rects->begin() + static_cast<std::ptrdiff_t>(second));
+    AbsorbOverlaps(first, rects);
+  }
+
+  std::sort(rects->begin(), rects->end(), [](const LayerRect &rect1, const LayerRect &rect2) {
+    return (rect1.top != rect2.top) ? (rect1.top < rect2.top) : (rect1.left < rect2.left);
+  });
+}
+
 void SplitLeftRight(const LayerRect &in_rect, uint32_t split_count, uint32_t align_x,
                     bool flip_horizontal, LayerRect *out_rects) {
   LayerRect rect_temp = in_rect;
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/rect.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+const float kWidth = 1080.0f;
+const float kHeight = 2400.0f;
+// 16 lines of panel width per extra rect.
+const float kRectCost = kWidth * 16.0f;
+
+void ExpectRects(const std::vector<LayerRect> &expected, const std::vector<LayerRect> &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_TRUE(IsCongruent(expected[i], actual[i]))
+        << "rect " << i << ": " << actual[i].left << "," << actual[i].top << " "
+        << actual[i].right << "," << actual[i].bottom;
+  }
+}
+
+bool Disjoint(const std::vector<LayerRect> &rects) {
+  for (size_t i = 0; i < rects.size(); i++) {
+    for (size_t j = i + 1; j < rects.size(); j++) {
+      if (IsValid(Intersection(rects[i], rects[j]))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Covers(const std::vector<LayerRect> &rects, const LayerRect &rect) {
+  for (auto &cover : rects) {
+    if (Contains(cover, rect)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST(RectTest, AreaOfInvalidRectIsZero) {
+  EXPECT_EQ(Area(LayerRect(0, 0, 10, 20)), 200.0f);
+  EXPECT_EQ(Area(LayerRect(10, 0, 0, 20)), 0.0f);
+  EXPECT_EQ(Area(std::vector<LayerRect>{{0, 0, 10, 10}, {20, 20, 30, 40}}), 300.0f);
+}
+
+TEST(RectTest, FarApartRegionsStaySeparate) {
+  // Status bar clock and a notification near the bottom of the screen.
+  std::vector<LayerRect> rects = {{0, 2000, kWidth, 2200}, {900, 0, 1000, 64}};
+  MergeRects(4, kRectCost, &rects);
+
+  ExpectRects({{900, 0, 1000, 64}, {0, 2000, kWidth, 2200}}, rects);
+  EXPECT_LT(Area(rects), Area(Union(rects[0], rects[1])) / 10.0f);
+}
+
+TEST(RectTest, NearbyRegionsAreMerged) {
+  // The gap costs less to refresh than a second rect does.
+  std::vector<LayerRect> rects = {{0, 100, 500, 200}, {0, 204, 500, 300}};
+  MergeRects(4, kRectCost, &rects);
+
+  ExpectRects({{0, 100, 500, 300}}, rects);
+}
+
+TEST(RectTest, OverlapsAreResolvedTransitively) {
+  // The bounding box of the first two overlaps the third, which must then be absorbed too.
+  std::vector<LayerRect> rects = {{0, 0, 100, 100}, {50, 50, 300, 150}, {250, 120, 400, 400},
+                                  {0, 2000, 100, 2100}};
+  MergeRects(4, 0.0f, &rects);
+
+  EXPECT_TRUE(Disjoint(rects));
+  ExpectRects({{0, 0, 400, 400}, {0, 2000, 100, 2100}}, rects);
+}
+
+TEST(RectTest, MergesDownToMaxRects) {
+  std::vector<LayerRect> rects;
+  for (float top = 0; top < kHeight; top += 400) {
+    rects.push_back({0, top, 100, top + 50});
+  }
+  std::vector<LayerRect> inputs = rects;
+  MergeRects(4, 0.0f, &rects);
+
+  EXPECT_EQ(rects.size(), 4u);
+  EXPECT_TRUE(Disjoint(rects));
+  for (auto &input : inputs) {
+    EXPECT_TRUE(Covers(rects, input));
+  }
+}
+
+TEST(RectTest, CheapestPairIsMergedFirst) {
+  // Three rects for two slots: only the close pair gets merged.
+  std::vector<LayerRect> rects = {{0, 0, 100, 100}, {0, 110, 100, 200}, {0, 1500, 100, 1600}};
+  MergeRects(2, 0.0f, &rects);
+
+  ExpectRects({{0, 0, 100, 200}, {0, 1500, 100, 1600}}, rects);
+}
+
+TEST(RectTest, InvalidRectsAreDropped) {
+  std::vector<LayerRect> rects = {{0, 0, 0, 0}, {10, 10, 20, 20}, {30, 30, 20, 40}};
+  MergeRects(4, kRectCost, &rects);
+
+  ExpectRects({{10, 10, 20, 20}}, rects);
+}
+
+TEST(RectTest, MergedSetsCompareRegardlessOfInputOrder) {
+  std::vector<LayerRect> rects1 = {{0, 2000, kWidth, 2200}, {900, 0, 1000, 64}};
+  std::vector<LayerRect> rects2 = {{900, 0, 1000, 64}, {0, 2000, kWidth, 2200}};
+  MergeRects(4, kRectCost, &rects1);
+  MergeRects(4, kRectCost, &rects2);
+
+  EXPECT_TRUE(IsCongruent(rects1, rects2));
+  rects2.pop_back();
+  EXPECT_FALSE(IsCongruent(rects1, rects2));
+  EXPECT_TRUE(IsCongruent(std::vector<LayerRect>(), std::vector<LayerRect>()));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
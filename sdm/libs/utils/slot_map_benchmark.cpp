@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// Time per synthetic command batch, shaped like the composer3 executeCommands of one frame: for
+// each display a buffer slot lookup per layer, then the release fence and changed composition
+// lists and the result payloads. The per call path keeps layers in an unordered_map and builds
+// its lists from scratch, the arena path keeps layers in a SlotMap and reuses per display lists.
+// Both hand out fresh result payloads every batch, as binder takes ownership of them. Heap
+// allocations per batch are counted through the global operator new.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include <utils/slot_map.h>
+
+static uint64_t g_allocations = 0;
+
+void *operator new(size_t size) {
+  g_allocations++;
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  free(ptr);
+}
+
+namespace {
+
+const int kIterations = 20000;
+const int kSlots = 3;
+
+struct LayerBuffers {
+  std::vector<const void *> buffers;
+  const void *sideband = nullptr;
+};
+
+struct Fence {
+  int fd = -1;
+};
+
+struct Payload {
+  int64_t display = 0;
+  std::vector<int64_t> layers;
+  std::vector<int> fences;
+};
+
+struct Arena {
+  std::vector<int64_t> layers;
+  std::vector<std::shared_ptr<Fence>> fences;
+  std::vector<int> fds;
+  std::vector<int64_t> changed_layers;
+  std::vector<int32_t> composition_types;
+};
+
+struct Batch {
+  int64_t display;
+  std::vector<int64_t> layers;
+};
+
+std::vector<Batch> MakeBatches(int displays, int layers) {
+  std::vector<Batch> batches(displays);
+  for (int d = 0; d < displays; d++) {
+    batches[d].display = d;
+    for (int l = 0; l < layers; l++) {
+      // Layer ids are unique across displays, as the composer hands them out.
+      batches[d].layers.push_back((int64_t(d) << 32) + 1000 + l);
+    }
+  }
+  return batches;
+}
+
+const void *FakeBuffer(int64_t layer, int slot) {
+  return reinterpret_cast<const void *>(static_cast<uintptr_t>(layer * kSlots + slot + 1) << 4);
+}
+
+class PerCallEngine {
+ public:
+  explicit PerCallEngine(const std::vector<Batch> &batches) {
+    for (auto &batch : batches) {
+      auto &layers = displays_[batch.display];
+      for (int64_t id : batch.layers) {
+        auto &layer = layers[id];
+        layer.buffers.resize(kSlots);
+        for (int s = 0; s < kSlots; s++) {
+          layer.buffers[s] = FakeBuffer(id, s);
+        }
+      }
+    }
+    fence_ = std::make_shared<Fence>();
+  }
+
+  uintptr_t Execute(const std::vector<Batch> &batches, uint32_t frame,
+                    std::vector<Payload> *results) {
+    uintptr_t sum = 0;
+    for (auto &batch : batches) {
+      auto &layers = displays_[batch.display];
+      for (int64_t id : batch.layers) {
+        auto layer = layers.find(id);
+        sum += reinterpret_cast<uintptr_t>(layer->second.buffers[frame % kSlots]);
+      }
+
+      std::vector<int64_t> fence_layers(batch.layers);
+      std::vector<std::shared_ptr<Fence>> fences(fence_layers.size(), fence_);
+      std::vector<int> fds;
+      for (auto &fence : fences) {
+        fds.push_back(fence->fd);
+      }
+      std::vector<int64_t> changed_layers(batch.layers.begin(), batch.layers.begin() + 2);
+      std::vector<int32_t> composition_types(changed_layers.size(), 1);
+
+      Payload changed;
+      changed.display = batch.display;
+      changed.layers = static_cast<std::vector<int64_t>>(changed_layers);
+      results->push_back(std::move(changed));
+      Payload release;
+      release.display = batch.display;
+      release.layers = fence_layers;
+      release.fences = std::move(fds);
+      results->push_back(std::move(release));
+    }
+    return sum;
+  }
+
+ private:
+  std::unordered_map<int64_t, std::unordered_map<int64_t, LayerBuffers>> displays_;
+  std::shared_ptr<Fence> fence_;
+};
+
+class ArenaEngine {
+ public:
+  explicit ArenaEngine(const std::vector<Batch> &batches) {
+    for (auto &batch : batches) {
+      auto layers = displays_.Insert(batch.display);
+      for (int64_t id : batch.layers) {
+        auto layer = layers->Insert(id);
+        layer->buffers.resize(kSlots);
+        for (int s = 0; s < kSlots; s++) {
+          layer->buffers[s] = FakeBuffer(id, s);
+        }
+      }
+    }
+    fence_ = std::make_shared<Fence>();
+  }
+
+  uintptr_t Execute(const std::vector<Batch> &batches, uint32_t frame,
+                    std::vector<Payload> *results) {
+    uintptr_t sum = 0;
+    results->reserve(last_results_);
+    for (auto &batch : batches) {
+      auto layers = displays_.Find(batch.display);
+      for (int64_t id : batch.layers) {
+        sum += reinterpret_cast<uintptr_t>(layers->Find(id)->buffers[frame % kSlots]);
+      }
+
+      Arena *arena = arenas_.Insert(batch.display);
+      arena->layers.assign(batch.layers.begin(), batch.layers.end());
+      arena->fences.assign(arena->layers.size(), fence_);
+      arena->fds.clear();
+      for (auto &fence : arena->fences) {
+        arena->fds.push_back(fence->fd);
+      }
+      arena->changed_layers.assign(batch.layers.begin(), batch.layers.begin() + 2);
+      arena->composition_types.assign(arena->changed_layers.size(), 1);
+
+      Payload changed;
+      changed.display = batch.display;
+      changed.layers.assign(arena->changed_layers.begin(), arena->changed_layers.end());
+      results->push_back(std::move(changed));
+      Payload release;
+      release.display = batch.display;
+      release.layers.assign(arena->layers.begin(), arena->layers.end());
+      release.fences.assign(arena->fds.begin(), arena->fds.end());
+      results->push_back(std::move(release));
+    }
+    last_results_ = results->size();
+    return sum;
+  }
+
+ private:
+  sdm::SlotMap<sdm::SlotMap<LayerBuffers>> displays_;
+  sdm::SlotMap<Arena> arenas_;
+  std::shared_ptr<Fence> fence_;
+  size_t last_results_ = 0;
+};
+
+template <typename Engine>
+void Measure(const char *name, int displays, int layers, uintptr_t *checksum) {
+  std::vector<Batch> batches = MakeBatches(displays, layers);
+  Engine engine(batches);
+  // Warm up, the arenas settle after the first frame.
+  std::vector<Payload> first;
+  *checksum ^= engine.Execute(batches, 0, &first);
+
+  uint64_t allocations = g_allocations;
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; i++) {
+    std::vector<Payload> results;
+    *checksum ^= engine.Execute(batches, static_cast<uint32_t>(i), &results);
+  }
+  std::chrono::duration<double, std::nano> total = std::chrono::steady_clock::now() - begin;
+  allocations = g_allocations - allocations;
+
+  printf("%-10s %8d %7d %12.1f %12.1f\n", name, displays, layers, total.count() / kIterations,
+         double(allocations) / kIterations);
+}
+
+}  // namespace
+
+int main() {
+  const int kShapes[][2] = {{1, 8}, {1, 32}, {2, 32}, {3, 64}};
+
+  uintptr_t checksum = 0;
+  printf("%-10s %8s %7s %12s %12s\n", "path", "displays", "layers", "ns/batch", "allocs/batch");
+  for (auto &shape : kShapes) {
+    Measure<PerCallEngine>("per call", shape[0], shape[1], &checksum);
+    Measure<ArenaEngine>("arena", shape[0], shape[1], &checksum);
+  }
+
+  // Keeps the results observable.
+  return checksum == 1 ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/slot_map.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+// Shaped like a layer buffer cache, the handle count tells which values are still held.
+struct Tracked {
+  std::shared_ptr<int> handle;
+  std::vector<int> slots;
+};
+
+// xorshift64, which unlike a multiplicative generator does not wrap under the overflow sanitizer.
+uint64_t NextRandom(uint64_t state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+}  // namespace
+
+TEST(SlotMapTest, InsertFindErase) {
+  SlotMap<int> map;
+  EXPECT_EQ(nullptr, map.Find(1));
+
+  *map.Insert(1) = 10;
+  *map.Insert(-5) = 20;
+  EXPECT_EQ(10, *map.Find(1));
+  EXPECT_EQ(20, *map.Find(-5));
+  EXPECT_EQ(2u, map.Size());
+
+  // Inserting a present id returns its value.
+  EXPECT_EQ(10, *map.Insert(1));
+  EXPECT_EQ(2u, map.Size());
+
+  EXPECT_TRUE(map.Erase(1));
+  EXPECT_FALSE(map.Erase(1));
+  EXPECT_EQ(nullptr, map.Find(1));
+  EXPECT_EQ(0, *map.Insert(1));
+  EXPECT_EQ(2u, map.Size());
+
+  map.Clear();
+  EXPECT_EQ(0u, map.Size());
+  EXPECT_EQ(nullptr, map.Find(-5));
+}
+
+TEST(SlotMapTest, StorageStableWithinCapacity) {
+  SlotMap<int> map(64);
+  ASSERT_GE(map.Capacity(), 48u);
+
+  int *first = map.Insert(0);
+  for (int64_t id = 1; id < 48; id++) {
+    *map.Insert(id) = static_cast<int>(id);
+  }
+  EXPECT_EQ(first, map.Find(0));
+
+  // Growing keeps every value.
+  for (int64_t id = 48; id < 200; id++) {
+    *map.Insert(id) = static_cast<int>(id);
+  }
+  EXPECT_GE(map.Capacity(), 200u);
+  for (int64_t id = 1; id < 200; id++) {
+    ASSERT_NE(nullptr, map.Find(id));
+    EXPECT_EQ(id, *map.Find(id));
+  }
+}
+
+TEST(SlotMapTest, MatchesReferenceUnderChurn) {
+  SlotMap<int64_t> map;
+  std::map<int64_t, int64_t> reference;
+  uint64_t state = 1;
+
+  // Layer ids like those of a composer, sequential with bursts of creates and destroys.
+  for (int i = 0; i < 20000; i++) {
+    state = NextRandom(state);
+    int64_t id = static_cast<int64_t>((state >> 33) % 96) + ((state >> 20) & 1 ? 0 : 1LL << 40);
+    if ((state >> 40) % 3) {
+      *map.Insert(id) = i;
+      reference[id] = i;
+    } else {
+      EXPECT_EQ(reference.erase(id) == 1, map.Erase(id));
+    }
+
+    if (i % 1000 == 0) {
+      ASSERT_EQ(reference.size(), map.Size());
+      for (auto &entry : reference) {
+        ASSERT_NE(nullptr, map.Find(entry.first));
+        EXPECT_EQ(entry.second, *map.Find(entry.first));
+      }
+    }
+  }
+
+  size_t visited = 0;
+  map.ForEach([&](int64_t id, int64_t &value) {
+    EXPECT_EQ(reference[id], value);
+    visited++;
+  });
+  EXPECT_EQ(reference.size(), visited);
+}
+
+// A full minimum size table, where probes and the shifts of erase run past the last entry, with
+// ids at the ends of the range.
+TEST(SlotMapTest, WrappingProbes) {
+  const int64_t ids[] = {INT64_MIN, INT64_MAX, -1, 0, 1, 2, 1LL << 32, (1LL << 32) + 1, 8, 16};
+  const size_t count = sizeof(ids) / sizeof(ids[0]);
+  uint64_t state = 7;
+
+  for (int round = 0; round < 500; round++) {
+    SlotMap<int64_t> map;
+    std::vector<int64_t> present;
+    for (size_t i = 0; present.size() < map.Capacity(); i++) {
+      state = NextRandom(state);
+      int64_t id = ids[state % count];
+      if (!map.Find(id)) {
+        *map.Insert(id) = id;
+        present.push_back(id);
+      }
+    }
+    ASSERT_EQ(SlotMap<int64_t>::kMinCapacity * 3 / 4, map.Capacity());
+
+    while (!present.empty()) {
+      state = NextRandom(state);
+      size_t victim = state % present.size();
+      ASSERT_TRUE(map.Erase(present[victim]));
+      present.erase(present.begin() + static_cast<std::ptrdiff_t>(victim));
+      ASSERT_EQ(present.size(), map.Size());
+      for (int64_t id : present) {
+        ASSERT_NE(nullptr, map.Find(id));
+        EXPECT_EQ(id, *map.Find(id));
+      }
+    }
+  }
+}
+
+TEST(SlotMapTest, ReleasesErasedValues) {
+  SlotMap<Tracked> map;
+  auto handle = std::make_shared<int>(0);
+
+  for (int64_t id = 0; id < 32; id++) {
+    Tracked *value = map.Insert(id);
+    value->handle = handle;
+    value->slots.resize(3);
+  }
+  EXPECT_EQ(33, handle.use_count());
+
+  for (int64_t id = 0; id < 32; id += 2) {
+    EXPECT_TRUE(map.Erase(id));
+  }
+  EXPECT_EQ(17, handle.use_count());
+  for (int64_t id = 1; id < 32; id += 2) {
+    ASSERT_NE(nullptr, map.Find(id));
+    EXPECT_EQ(3u, map.Find(id)->slots.size());
+  }
+
+  map.Clear();
+  EXPECT_EQ(1, handle.use_count());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
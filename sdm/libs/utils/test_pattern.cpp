@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <utils/test_pattern.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace sdm {
+
+namespace {
+
+const uint32_t kSliceWords = 8;
+
+// tables[k][b] is the update matrix to the power k + 1 applied to byte b, low byte in lo and high
+// byte in hi.
+struct CRCTables {
+  uint16_t lo[kSliceWords][256];
+  uint16_t hi[kSliceWords][256];
+};
+
+uint16_t Parity(uint32_t value) {
+  return static_cast<uint16_t>(__builtin_parity(value));
+}
+
+// One update of a crc whose previous value xor the input word is x.
+uint16_t Step(uint16_t x) {
+  uint16_t crc = 0;
+  crc |= Parity(x & 0xBFFF);  // Bits 0-13, 15.
+  crc |= Parity(x & 0x7FFE) << 1;  // Bits 1-14.
+  crc |= Parity(x & 0x4003) << 2;  // Bits 0, 1, 14.
+  crc |= Parity(x & 0x8006) << 3;  // Bits 1, 2, 15.
+  for (uint32_t bit = 4; bit < 15; bit++) {
+    crc |= Parity(x & (0x3u << (bit - 2))) << bit;
+  }
+  crc |= Parity(x & 0xDFFF) << 15;  // Bits 0-12, 14, 15.
+
+  return crc;
+}
+
+CRCTables BuildTables() {
+  CRCTables tables = {};
+  for (uint32_t byte = 0; byte < 256; byte++) {
+    uint16_t lo = static_cast<uint16_t>(byte);
+    uint16_t hi = static_cast<uint16_t>(byte << 8);
+    for (uint32_t power = 0; power < kSliceWords; power++) {
+      lo = Step(lo);
+      hi = Step(hi);
+      tables.lo[power][byte] = lo;
+      tables.hi[power][byte] = hi;
+    }
+  }
+
+  return tables;
+}
+
+const CRCTables &GetTables() {
+  static const CRCTables tables = BuildTables();
+  return tables;
+}
+
+// GF(2) matrix acting on crc values, column j is the image of bit j.
+struct Matrix {
+  uint16_t columns[16] = {};
+};
+
+uint16_t Apply(const Matrix &matrix, uint16_t value) {
+  uint16_t result = 0;
+  for (uint32_t bit = 0; value; bit++, value >>= 1) {
+    if (value & 1) {
+      result ^= matrix.columns[bit];
+    }
+  }
+
+  return result;
+}
+
+Matrix Multiply(const Matrix &a, const Matrix &b) {
+  Matrix result;
+  for (uint32_t bit = 0; bit < 16; bit++) {
+    result.columns[bit] = Apply(a, b.columns[bit]);
+  }
+
+  return result;
+}
+
+// crc -> matrix * crc ^ constant.
+struct AffineMap {
+  Matrix matrix;
+  uint16_t constant = 0;
+};
+
+// Map equal to applying second after first.
+AffineMap Compose(const AffineMap &first, const AffineMap &second) {
+  AffineMap result;
+  result.matrix = Multiply(second.matrix, first.matrix);
+  result.constant = Apply(second.matrix, first.constant) ^ second.constant;
+  return result;
+}
+
+AffineMap Power(AffineMap map, uint64_t exponent) {
+  AffineMap result;
+  for (uint32_t bit = 0; bit < 16; bit++) {
+    result.matrix.columns[bit] = static_cast<uint16_t>(1u << bit);
+  }
+  for (; exponent; exponent >>= 1) {
+    if (exponent & 1) {
+      result = Compose(result, map);
+    }
+    map = Compose(map, map);
+  }
+
+  return result;
+}
+
+// Constructed rather than aggregate initialized, C++11 does not allow both with default member
+// initializers.
+struct Color {
+  constexpr Color(uint32_t r = 0, uint32_t g = 0, uint32_t b = 0) : red(r), green(g), blue(b) {}
+
+  uint32_t red;
+  uint32_t green;
+  uint32_t blue;
+};
+
+// Builds one row of the pattern at a time and writes it to as many rows of the buffer as it
+// repeats for. Runs of one color are filled with one packed 32 bit pixel, and rows are copied
+// whole, both of which vectorize. The CRC is fed each distinct row once.
+class PatternWriter {
+ public:
+  PatternWriter(const TestPatternConfig &config, uint8_t *buffer, PatternCRC *crc)
+    : config_(config), buffer_(buffer), crc_(crc) {
+    row_.resize(config.width);
+    for (auto &words : words_) {
+      words.resize(config.width);
+    }
+    switch (config.format) {
+      case kTestPatternRGBA8888:
+      case kTestPatternRGBA1010102:
+        pixel_size_ = 4;
+        break;
+      case kTestPatternRGB888:
+        pixel_size_ = 3;
+        break;
+    }
+  }
+
+  // Sets pixels [begin, end) of the row being built.
+  void Fill(uint32_t begin, uint32_t end, const Color &color) {
+    uint32_t pixel = Pack(color);
+    if (pixel_size_ == 4) {
+      std::fill(row_.begin() + begin, row_.begin() + end, pixel);
+    } else {
+      uint8_t *bytes = reinterpret_cast<uint8_t *>(row_.data());
+      for (uint32_t i = begin; i < end; i++) {
+        memcpy(bytes + i * pixel_size_, &pixel, pixel_size_);
+      }
+    }
+
+    std::fill(words_[0].begin() + begin, words_[0].begin() + end, GetWord(color.red));
+    std::fill(words_[1].begin() + begin, words_[1].begin() + end, GetWord(color.green));
+    std::fill(words_[2].begin() + begin, words_[2].begin() + end, GetWord(color.blue));
+  }
+
+  // Writes the row built to the next count rows of the buffer.
+  void Emit(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++, next_row_++) {
+      memcpy(buffer_ + next_row_ * config_.stride, row_.data(), config_.width * pixel_size_);
+    }
+
+    if (HasCRC()) {
+      for (uint32_t component = 0; component < 3; component++) {
+        crc_[component].Update(words_[component].data(), config_.width, count);
+      }
+    }
+  }
+
+  bool HasCRC() {
+    return (config_.panel_bpp == 18) || (config_.panel_bpp == 24) || (config_.panel_bpp == 30);
+  }
+
+ private:
+  // Pixel in memory order, alpha is always 0.
+  uint32_t Pack(const Color &color) {
+    uint8_t bytes[4] = {};
+    switch (config_.format) {
+      case kTestPatternRGBA8888:
+      case kTestPatternRGB888:
+        bytes[0] = static_cast<uint8_t>(color.red & 0xFF);
+        bytes[1] = static_cast<uint8_t>(color.green & 0xFF);
+        bytes[2] = static_cast<uint8_t>(color.blue & 0xFF);
+        break;
+      case kTestPatternRGBA1010102:
+        bytes[0] = static_cast<uint8_t>(color.red & 0xFF);
+        bytes[1] = static_cast<uint8_t>(((color.green & 0x3F) << 2) | ((color.red >> 8) & 0x3));
+        bytes[2] = static_cast<uint8_t>(((color.blue & 0xF) << 4) | ((color.green >> 6) & 0xF));
+        bytes[3] = static_cast<uint8_t>((color.blue >> 4) & 0x3F);
+        break;
+    }
+
+    uint32_t pixel = 0;
+    memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+  }
+
+  // Component value as the CRC takes it for the panel depth.
+  uint16_t GetWord(uint32_t value) {
+    switch (config_.panel_bpp) {
+      case 18:
+        return static_cast<uint16_t>((value & 0xFC) << 8);
+      case 24:
+        return static_cast<uint16_t>(value << 8);
+      case 30:
+        return static_cast<uint16_t>(value << 6);
+      default:
+        return 0;
+    }
+  }
+
+  const TestPatternConfig &config_;
+  uint8_t *buffer_ = nullptr;
+  PatternCRC *crc_ = nullptr;
+  uint32_t pixel_size_ = 0;
+  uint32_t next_row_ = 0;
+  std::vector<uint32_t> row_ = {};
+  std::array<std::vector<uint16_t>, 3> words_ = {};
+};
+
+// Red, green, blue and white ramps in bands of ramp_height rows. At 30 bpp each color gets a
+// band of its 256 upper values and a band of every fourth value.
+void GenerateColorRamp(const TestPatternConfig &config, PatternWriter *writer) {
+  uint32_t color_ramp = 0;
+  uint32_t start_color_val = 0;
+  uint32_t step_size = 1;
+  uint32_t ramp_width = 0;
+  uint32_t ramp_height = 0;
+  uint32_t shift_by = 0;
+
+  switch (config.panel_bpp) {
+    case 18:
+      ramp_height = 64;
+      ramp_width = 64;
+      shift_by = 2;
+      break;
+    case 24:
+      ramp_height = 64;
+      ramp_width = 256;
+      break;
+    case 30:
+      ramp_height = 32;
+      ramp_width = 256;
+      start_color_val = 0x180;
+      break;
+    default:
+      return;
+  }
+
+  uint32_t row = 0;
+  while (row < config.height) {
+    // The first pixel of a row is the start value, unshifted.
+    uint32_t color_value = start_color_val;
+    for (uint32_t x = 0; x < config.width; x++) {
+      Color color;
+      color.red = (color_ramp == 0 || color_ramp == 3) ? color_value : 0;
+      color.green = (color_ramp == 1 || color_ramp == 3) ? color_value : 0;
+      color.blue = (color_ramp == 2 || color_ramp == 3) ? color_value : 0;
+      writer->Fill(x, x + 1, color);
+      color_value = (start_color_val + (((x + 1) % ramp_width) * step_size)) << shift_by;
+    }
+
+    uint32_t band_end = std::min((row / ramp_height + 1) * ramp_height, config.height);
+    writer->Emit(band_end - row);
+    row = band_end;
+    if (row % ramp_height) {
+      break;
+    }
+
+    if (config.panel_bpp == 30) {
+      if (start_color_val == 0x180) {
+        start_color_val = 0;
+        step_size = 4;
+      } else {
+        start_color_val = 0x180;
+        step_size = 1;
+        color_ramp = (color_ramp + 1) % 4;
+      }
+    } else {
+      color_ramp = (color_ramp + 1) % 4;
+    }
+  }
+}
+
+// Alternating black and white columns, one pixel wide.
+void GenerateBWVertical(const TestPatternConfig &config, PatternWriter *writer) {
+  uint32_t max_color_val = (1u << (config.panel_bpp / 3)) - 1;
+  if (config.panel_bpp == 18) {
+    max_color_val <<= 2;
+  }
+
+  Color white;
+  white.red = white.green = white.blue = max_color_val;
+  for (uint32_t x = 0; x < config.width; x++) {
+    writer->Fill(x, x + 1, (x % 2) ? white : Color());
+  }
+  writer->Emit(config.height);
+}
+
+// 64x64 squares of the 8 primary and secondary colors, the order of all but black reversing
+// every 64 rows.
+void GenerateColorSquare(const TestPatternConfig &config, PatternWriter *writer) {
+  const uint32_t kSquareSize = 64;
+  uint32_t max_color_val = 0;
+  uint32_t min_color_val = 0;
+
+  switch (config.panel_bpp) {
+    case 18:
+      max_color_val = 63 << 2;  // CEA Dynamic range for 18bpp 0 - 63
+      min_color_val = 0;
+      break;
+    case 24:
+      max_color_val = 235;  // CEA Dynamic range for 24bpp 16 - 235
+      min_color_val = 16;
+      break;
+    case 30:
+      max_color_val = 940;  // CEA Dynamic range for 30bpp 64 - 940
+      min_color_val = 64;
+      break;
+    default:
+      return;
+  }
+
+  uint32_t max = max_color_val, min = min_color_val;
+  std::array<Color, 8> colors = {{
+      {max, max, max},  // White Color
+      {max, max, min},  // Yellow Color
+      {min, max, max},  // Cyan Color
+      {min, max, min},  // Green Color
+      {max, min, max},  // Megenta Color
+      {max, min, min},  // Red Color
+      {min, min, max},  // Blue Color
+      {min, min, min},  // Black Color
+  }};
+
+  for (uint32_t row = 0; row < config.height; row += kSquareSize) {
+    for (uint32_t x = 0; x < config.width; x += kSquareSize) {
+      uint32_t color = (x / kSquareSize) % colors.size();
+      writer->Fill(x, std::min(x + kSquareSize, config.width), colors[color]);
+    }
+
+    uint32_t band_end = std::min(row + kSquareSize, config.height);
+    writer->Emit(band_end - row);
+    if (band_end - row == kSquareSize) {
+      std::reverse(colors.begin(), (colors.end() - 1));
+    }
+  }
+}
+
+}  // namespace
+
+uint16_t PatternCRC::UpdateBitwise(uint16_t crc, uint16_t word) {
+  return Step(crc ^ word);
+}
+
+void PatternCRC::Update(uint16_t word) {
+  const CRCTables &tables = GetTables();
+  uint16_t x = crc_ ^ word;
+  crc_ = tables.lo[0][x & 0xFF] ^ tables.hi[0][x >> 8];
+}
+
+void PatternCRC::Update(const uint16_t *words, size_t count) {
+  const CRCTables &tables = GetTables();
+  uint16_t crc = crc_;
+  size_t i = 0;
+
+  // The crc only feeds the lookup of the first word of a slice, the other lookups are independent
+  // of it and of each other.
+  for (; i + kSliceWords <= count; i += kSliceWords) {
+    uint16_t x = crc ^ words[i];
+    crc = tables.lo[kSliceWords - 1][x & 0xFF] ^ tables.hi[kSliceWords - 1][x >> 8];
+    for (uint32_t j = 1; j < kSliceWords; j++) {
+      uint16_t word = words[i + j];
+      uint32_t power = kSliceWords - 1 - j;
+      crc ^= tables.lo[power][word & 0xFF] ^ tables.hi[power][word >> 8];
+    }
+  }
+
+  for (; i < count; i++) {
+    uint16_t x = crc ^ words[i];
+    crc = tables.lo[0][x & 0xFF] ^ tables.hi[0][x >> 8];
+  }
+
+  crc_ = crc;
+}
+
+void PatternCRC::Update(const uint16_t *words, size_t count, uint32_t repeat) {
+  if (repeat == 1) {
+    Update(words, count);
+    return;
+  }
+
+  // One pass over the words from 0 gives the constant, the matrix is the single word update
+  // matrix to the power count.
+  PatternCRC row;
+  row.Update(words, count);
+  AffineMap step;
+  for (uint32_t bit = 0; bit < 16; bit++) {
+    step.matrix.columns[bit] = Step(static_cast<uint16_t>(1u << bit));
+  }
+  AffineMap row_map = Power(step, count);
+  row_map.constant = row.Get();
+
+  AffineMap map = Power(row_map, repeat);
+  crc_ = Apply(map.matrix, crc_) ^ map.constant;
+}
+
+int GenerateTestPattern(TestPatternType type, const TestPatternConfig &config, uint8_t *buffer,
+                        uint16_t crc[3]) {
+  PatternCRC component_crc[3];
+  PatternWriter writer(config, buffer, component_crc);
+
+  switch (type) {
+    case kTestPatternColorRamp:
+      GenerateColorRamp(config, &writer);
+      break;
+    case kTestPatternBWVertical:
+      GenerateBWVertical(config, &writer);
+      break;
+    case kTestPatternColorSquare:
+      GenerateColorSquare(config, &writer);
+      break;
+    default:
+      return -EINVAL;
+  }
+
+  for (uint32_t component = 0; component < 3; component++) {
+    crc[component] = component_crc[component].Get();
+  }
+
+  return 0;
+}
+
+}  // namespace sdm
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// Time per frame for each compliance test pattern at 1080p and 4K, and the CRC throughput of the
+// bit by bit update against the sliced table update.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#include <utils/test_pattern.h>
+
+namespace {
+
+const int kIterations = 10;
+const uint32_t kCRCWords = 1 << 20;
+
+template <typename Body>
+double MeasureMs(int iterations, Body body) {
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    body();
+  }
+  std::chrono::duration<double, std::milli> total = std::chrono::steady_clock::now() - begin;
+  return total.count() / iterations;
+}
+
+}  // namespace
+
+int main() {
+  const sdm::TestPatternType kTypes[] = {sdm::kTestPatternColorRamp, sdm::kTestPatternBWVertical,
+                                         sdm::kTestPatternColorSquare};
+  const char *kTypeNames[] = {"color ramp", "bw vertical", "color square"};
+  const uint32_t kSizes[][2] = {{1920, 1080}, {3840, 2160}};
+
+  uint32_t checksum = 0;
+  printf("%-14s %-10s %10s\n", "pattern", "size", "ms/frame");
+  for (auto &size : kSizes) {
+    sdm::TestPatternConfig config;
+    config.width = size[0];
+    config.height = size[1];
+    config.stride = size[0] * 4;
+    std::vector<uint8_t> buffer(config.stride * config.height);
+    for (int i = 0; i < 3; i++) {
+      uint16_t crc[3] = {};
+      double ms = MeasureMs(kIterations, [&] {
+        sdm::GenerateTestPattern(kTypes[i], config, buffer.data(), crc);
+      });
+      printf("%-14s %4ux%-5u %10.2f\n", kTypeNames[i], size[0], size[1], ms);
+      checksum ^= crc[0] ^ crc[1] ^ crc[2] ^ buffer[buffer.size() / 2];
+    }
+  }
+
+  std::vector<uint16_t> words(kCRCWords);
+  for (uint32_t i = 0; i < kCRCWords; i++) {
+    words[i] = static_cast<uint16_t>(i * 40503u);
+  }
+  uint16_t bitwise = 0;
+  double bitwise_ms = MeasureMs(kIterations, [&] {
+    for (uint16_t word : words) {
+      bitwise = sdm::PatternCRC::UpdateBitwise(bitwise, word);
+    }
+  });
+  sdm::PatternCRC sliced;
+  double sliced_ms = MeasureMs(kIterations, [&] { sliced.Update(words.data(), words.size()); });
+
+  printf("\n%-14s %10s\n", "crc", "ns/word");
+  printf("%-14s %10.2f\n", "bitwise", bitwise_ms * 1e6 / kCRCWords);
+  printf("%-14s %10.2f\n", "sliced", sliced_ms * 1e6 / kCRCWords);
+
+  // Keeps the results observable.
+  checksum ^= bitwise ^ sliced.Get();
+  return checksum == 0xFFFFFFFF ? 1 : 0;
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/test_pattern.h>
+
+using namespace sdm;
+using namespace testing;
+
+namespace {
+
+// Per pixel generators the pluggable test display used before, kept as the reference.
+class ReferencePattern {
+ public:
+  explicit ReferencePattern(const TestPatternConfig &config) : config_(config) {}
+
+  void Generate(TestPatternType type, uint8_t *buffer, uint16_t crc[3]) {
+    switch (type) {
+      case kTestPatternColorRamp:
+        GenerateColorRamp(buffer);
+        break;
+      case kTestPatternBWVertical:
+        GenerateBWVertical(buffer);
+        break;
+      case kTestPatternColorSquare:
+        GenerateColorSquare(buffer);
+        break;
+    }
+    crc[0] = static_cast<uint16_t>(crc_red_.to_ulong());
+    crc[1] = static_cast<uint16_t>(crc_green_.to_ulong());
+    crc[2] = static_cast<uint16_t>(crc_blue_.to_ulong());
+  }
+
+  static void CalcCRC(uint32_t panel_bpp, uint32_t color_val, std::bitset<16> *crc_data) {
+    std::bitset<16> color = {};
+    std::bitset<16> temp_crc = {};
+
+    switch (panel_bpp) {
+      case 18:
+        color = (color_val & 0xFC) << 8;
+        break;
+      case 24:
+        color = color_val << 8;
+        break;
+      case 30:
+        color = color_val << 6;
+        break;
+      default:
+        return;
+    }
+
+    std::bitset<16> &c = *crc_data;
+    temp_crc[15] = c[0] ^ c[1] ^ c[2] ^ c[3] ^ c[4] ^ c[5] ^ c[6] ^ c[7] ^ c[8] ^ c[9] ^ c[10] ^
+                   c[11] ^ c[12] ^ c[14] ^ c[15] ^ color[0] ^ color[1] ^ color[2] ^ color[3] ^
+                   color[4] ^ color[5] ^ color[6] ^ color[7] ^ color[8] ^ color[9] ^ color[10] ^
+                   color[11] ^ color[12] ^ color[14] ^ color[15];
+    temp_crc[14] = c[12] ^ c[13] ^ color[12] ^ color[13];
+    temp_crc[13] = c[11] ^ c[12] ^ color[11] ^ color[12];
+    temp_crc[12] = c[10] ^ c[11] ^ color[10] ^ color[11];
+    temp_crc[11] = c[9] ^ c[10] ^ color[9] ^ color[10];
+    temp_crc[10] = c[8] ^ c[9] ^ color[8] ^ color[9];
+    temp_crc[9] = c[7] ^ c[8] ^ color[7] ^ color[8];
+    temp_crc[8] = c[6] ^ c[7] ^ color[6] ^ color[7];
+    temp_crc[7] = c[5] ^ c[6] ^ color[5] ^ color[6];
+    temp_crc[6] = c[4] ^ c[5] ^ color[4] ^ color[5];
+    temp_crc[5] = c[3] ^ c[4] ^ color[3] ^ color[4];
+    temp_crc[4] = c[2] ^ c[3] ^ color[2] ^ color[3];
+    temp_crc[3] = c[1] ^ c[2] ^ c[15] ^ color[1] ^ color[2] ^ color[15];
+    temp_crc[2] = c[0] ^ c[1] ^ c[14] ^ color[0] ^ color[1] ^ color[14];
+    temp_crc[1] = c[1] ^ c[2] ^ c[3] ^ c[4] ^ c[5] ^ c[6] ^ c[7] ^ c[8] ^ c[9] ^ c[10] ^ c[11] ^
+                  c[12] ^ c[13] ^ c[14] ^ color[1] ^ color[2] ^ color[3] ^ color[4] ^ color[5] ^
+                  color[6] ^ color[7] ^ color[8] ^ color[9] ^ color[10] ^ color[11] ^ color[12] ^
+                  color[13] ^ color[14];
+    temp_crc[0] = c[0] ^ c[1] ^ c[2] ^ c[3] ^ c[4] ^ c[5] ^ c[6] ^ c[7] ^ c[8] ^ c[9] ^ c[10] ^
+                  c[11] ^ c[12] ^ c[13] ^ c[15] ^ color[0] ^ color[1] ^ color[2] ^ color[3] ^
+                  color[4] ^ color[5] ^ color[6] ^ color[7] ^ color[8] ^ color[9] ^ color[10] ^
+                  color[11] ^ color[12] ^ color[13] ^ color[15];
+
+    c = temp_crc;
+  }
+
+ private:
+  void Pixel(uint32_t red, uint32_t green, uint32_t blue, uint8_t **buffer) {
+    CalcCRC(config_.panel_bpp, red, &crc_red_);
+    CalcCRC(config_.panel_bpp, green, &crc_green_);
+    CalcCRC(config_.panel_bpp, blue, &crc_blue_);
+
+    switch (config_.format) {
+      case kTestPatternRGBA8888:
+        *(*buffer)++ = red & 0xFF;
+        *(*buffer)++ = green & 0xFF;
+        *(*buffer)++ = blue & 0xFF;
+        *(*buffer)++ = 0;
+        break;
+      case kTestPatternRGB888:
+        *(*buffer)++ = red & 0xFF;
+        *(*buffer)++ = green & 0xFF;
+        *(*buffer)++ = blue & 0xFF;
+        break;
+      case kTestPatternRGBA1010102:
+        *(*buffer)++ = red & 0xFF;
+        *(*buffer)++ = ((green & 0x3F) << 2) | ((red >> 0x8) & 0x3);
+        *(*buffer)++ = ((blue & 0xF) << 4) | ((green >> 6) & 0xF);
+        *(*buffer)++ = (blue >> 4) & 0x3F;
+        break;
+    }
+  }
+
+  void GenerateColorRamp(uint8_t *buffer) {
+    uint32_t color_ramp = 0, start_color_val = 0, step_size = 1;
+    uint32_t ramp_width = 0, ramp_height = 0, shift_by = 0;
+    switch (config_.panel_bpp) {
+      case 18:
+        ramp_height = 64;
+        ramp_width = 64;
+        shift_by = 2;
+        break;
+      case 24:
+        ramp_height = 64;
+        ramp_width = 256;
+        break;
+      case 30:
+        ramp_height = 32;
+        ramp_width = 256;
+        start_color_val = 0x180;
+        break;
+      default:
+        return;
+    }
+
+    for (uint32_t loop_height = 0; loop_height < config_.height; loop_height++) {
+      uint32_t color_value = start_color_val;
+      uint8_t *temp = buffer + (loop_height * config_.stride);
+      for (uint32_t loop_width = 0; loop_width < config_.width; loop_width++) {
+        switch (color_ramp) {
+          case 0:
+            Pixel(color_value, 0, 0, &temp);
+            break;
+          case 1:
+            Pixel(0, color_value, 0, &temp);
+            break;
+          case 2:
+            Pixel(0, 0, color_value, &temp);
+            break;
+          default:
+            Pixel(color_value, color_value, color_value, &temp);
+            break;
+        }
+        color_value = (start_color_val + (((loop_width + 1) % ramp_width) * step_size)) << shift_by;
+      }
+
+      if (config_.panel_bpp == 30 && ((loop_height + 1) % ramp_height) == 0) {
+        if (start_color_val == 0x180) {
+          start_color_val = 0;
+          step_size = 4;
+        } else {
+          start_color_val = 0x180;
+          step_size = 1;
+          color_ramp = (color_ramp + 1) % 4;
+        }
+        continue;
+      }
+      if (((loop_height + 1) % ramp_height) == 0) {
+        color_ramp = (color_ramp + 1) % 4;
+      }
+    }
+  }
+
+  void GenerateBWVertical(uint8_t *buffer) {
+    uint32_t max_color_val = (1 << (config_.panel_bpp / 3)) - 1;
+    if (config_.panel_bpp == 18) {
+      max_color_val <<= 2;
+    }
+
+    for (uint32_t loop_height = 0; loop_height < config_.height; loop_height++) {
+      uint8_t *temp = buffer + (loop_height * config_.stride);
+      for (uint32_t loop_width = 0; loop_width < config_.width; loop_width++) {
+        uint32_t value = (loop_width % 2) ? max_color_val : 0;
+        Pixel(value, value, value, &temp);
+      }
+    }
+  }
+
+  void GenerateColorSquare(uint8_t *buffer) {
+    uint32_t max = 0, min = 0;
+    switch (config_.panel_bpp) {
+      case 18:
+        max = 63 << 2;
+        break;
+      case 24:
+        max = 235;
+        min = 16;
+        break;
+      case 30:
+        max = 940;
+        min = 64;
+        break;
+      default:
+        return;
+    }
+
+    std::array<std::array<uint32_t, 3>, 8> colors = {{
+        {{max, max, max}}, {{max, max, min}}, {{min, max, max}}, {{min, max, min}},
+        {{max, min, max}}, {{max, min, min}}, {{min, min, max}}, {{min, min, min}},
+    }};
+
+    for (uint32_t loop_height = 0; loop_height < config_.height; loop_height++) {
+      uint32_t color = 0;
+      uint8_t *temp = buffer + (loop_height * config_.stride);
+      for (uint32_t loop_width = 0; loop_width < config_.width; loop_width++) {
+        Pixel(colors[color][0], colors[color][1], colors[color][2], &temp);
+        if (((loop_width + 1) % 64) == 0) {
+          color = (color + 1) % colors.size();
+        }
+      }
+      if (((loop_height + 1) % 64) == 0) {
+        std::reverse(colors.begin(), (colors.end() - 1));
+      }
+    }
+  }
+
+  const TestPatternConfig &config_;
+  std::bitset<16> crc_red_ = {};
+  std::bitset<16> crc_green_ = {};
+  std::bitset<16> crc_blue_ = {};
+};
+
+uint32_t GetPixelSize(TestPatternFormat format) {
+  return (format == kTestPatternRGB888) ? 3 : 4;
+}
+
+}  // namespace
+
+TEST(TestPatternTest, CRCMatchesBitwiseReference) {
+  uint32_t state = 1;
+  for (uint32_t panel_bpp : {18, 24, 30}) {
+    std::bitset<16> reference = {};
+    PatternCRC crc;
+    for (int i = 0; i < 10000; i++) {
+      state = state * 1103515245 + 12345;
+      uint32_t value = (state >> 16) & 0x3FF;
+      ReferencePattern::CalcCRC(panel_bpp, value, &reference);
+      uint16_t word = (panel_bpp == 18)   ? static_cast<uint16_t>((value & 0xFC) << 8)
+                      : (panel_bpp == 24) ? static_cast<uint16_t>(value << 8)
+                                          : static_cast<uint16_t>(value << 6);
+      uint16_t bitwise = PatternCRC::UpdateBitwise(crc.Get(), word);
+      crc.Update(word);
+      EXPECT_EQ(bitwise, crc.Get());
+      ASSERT_EQ(reference.to_ulong(), crc.Get()) << "bpp " << panel_bpp << " word " << i;
+    }
+  }
+}
+
+TEST(TestPatternTest, SlicedCRCMatchesSingleWordUpdates) {
+  std::vector<uint16_t> words(1000);
+  for (uint32_t i = 0; i < words.size(); i++) {
+    words[i] = static_cast<uint16_t>(i * 40503u);
+  }
+
+  // Every length exercises a different split between the slices and the tail.
+  for (size_t count : {0, 1, 7, 8, 9, 63, 64, 999, 1000}) {
+    PatternCRC sliced, single;
+    sliced.Update(words.data(), count);
+    for (size_t i = 0; i < count; i++) {
+      single.Update(words[i]);
+    }
+    EXPECT_EQ(single.Get(), sliced.Get()) << count;
+  }
+}
+
+TEST(TestPatternTest, RepeatedCRCMatchesRepeatedUpdates) {
+  std::vector<uint16_t> words(333);
+  for (uint32_t i = 0; i < words.size(); i++) {
+    words[i] = static_cast<uint16_t>(i * 2654435761u >> 7);
+  }
+
+  for (uint32_t repeat : {0, 1, 2, 3, 64, 1079}) {
+    PatternCRC repeated, fed;
+    repeated.Update(0x1234);
+    fed.Update(0x1234);
+    repeated.Update(words.data(), words.size(), repeat);
+    for (uint32_t i = 0; i < repeat; i++) {
+      fed.Update(words.data(), words.size());
+    }
+    EXPECT_EQ(fed.Get(), repeated.Get()) << repeat;
+  }
+}
+
+TEST(TestPatternTest, PatternsMatchReference) {
+  const TestPatternType kTypes[] = {kTestPatternColorRamp, kTestPatternBWVertical,
+                                    kTestPatternColorSquare};
+  const TestPatternFormat kFormats[] = {kTestPatternRGBA8888, kTestPatternRGB888,
+                                        kTestPatternRGBA1010102};
+  // Sizes with partial bands, partial squares and ramps wider than the frame.
+  const uint32_t kSizes[][2] = {{520, 200}, {333, 131}, {1, 1}, {100, 64}};
+
+  for (TestPatternType type : kTypes) {
+    for (TestPatternFormat format : kFormats) {
+      for (uint32_t panel_bpp : {18, 24, 30, 36}) {
+        for (auto &size : kSizes) {
+          TestPatternConfig config;
+          config.width = size[0];
+          config.height = size[1];
+          config.stride = ((size[0] + 63) & ~63u) * GetPixelSize(format);
+          config.format = format;
+          config.panel_bpp = panel_bpp;
+
+          // Padding is not written, both buffers start with the same fill.
+          std::vector<uint8_t> expected(config.stride * config.height, 0xA5);
+          std::vector<uint8_t> actual(expected);
+          uint16_t expected_crc[3] = {}, actual_crc[3] = {};
+          ReferencePattern(config).Generate(type, expected.data(), expected_crc);
+          ASSERT_EQ(0, GenerateTestPattern(type, config, actual.data(), actual_crc));
+
+          ASSERT_TRUE(expected == actual) << "type " << type << " format " << format << " bpp "
+                                          << panel_bpp << " size " << size[0] << "x" << size[1];
+          for (int component = 0; component < 3; component++) {
+            EXPECT_EQ(expected_crc[component], actual_crc[component]);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(TestPatternTest, GoldenCRCs) {
+  TestPatternConfig config;
+  config.width = 1920;
+  config.height = 1080;
+  config.stride = config.width * 4;
+  std::vector<uint8_t> buffer(config.stride * config.height);
+
+  // Values of the per pixel generators for a 1080p RGBA8888 frame on a 24 bpp sink.
+  const uint16_t kGolden[][3] = {
+      {0x1f83, 0xfceb, 0x47cf},
+      {0x5b2c, 0x5b2c, 0x5b2c},
+      {0xe098, 0x886f, 0xa475},
+  };
+  const TestPatternType kTypes[] = {kTestPatternColorRamp, kTestPatternBWVertical,
+                                    kTestPatternColorSquare};
+  for (int i = 0; i < 3; i++) {
+    uint16_t crc[3] = {};
+    ASSERT_EQ(0, GenerateTestPattern(kTypes[i], config, buffer.data(), crc));
+    for (int component = 0; component < 3; component++) {
+      EXPECT_EQ(kGolden[i][component], crc[component]);
+    }
+  }
+}
+
+TEST(TestPatternTest, RejectsUnknownPattern) {
+  TestPatternConfig config;
+  uint16_t crc[3] = {};
+  EXPECT_EQ(-EINVAL, GenerateTestPattern(static_cast<TestPatternType>(7), config, nullptr, crc));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,596 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+// Replays a layer stack dump (HWCDisplay frame dump with the LAYER_STACK_DUMP bit) against the
+// primary built-in display and reports per stage latency. Stages are the DTRACE_SCOPED scopes
+// that sdm core enters while the frame is prepared and committed, timed through the
+// DebugHandler trace hooks, plus the client side Prepare and Commit calls.
+//
+//   sdm_replay [-l loops] [-w warmup] [-s] [-v] [-p name=value]... <layer_stack_dump>
+//
+// Buffers are stand-ins sized from the recorded geometry; their content is not replayed. They
+// come from the system dma-buf heap so the DRM driver can import them as framebuffers.
+
+#include <core/buffer_allocator.h>
+#include <core/buffer_sync_handler.h>
+#include <core/core_interface.h>
+#include <core/display_interface.h>
+#include <core/socket_handler.h>
+#include <debug_handler.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <linux/dma-heap.h>
+#include <linux/sync_file.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utils/constants.h>
+#include <utils/fence.h>
+#include <utils/formats.h>
+#include <utils/layer_stack_serializer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define __CLASS__ "SDMReplay"
+
+using std::chrono::steady_clock;
+
+namespace sdm {
+
+typedef std::pair<const char *, const char *> StageKey;
+
+// Routes sdm logs to stderr and times every trace scope. Class and function names are string
+// literals, so scopes are keyed by pointer and named only when the report is printed.
+class ReplayDebugHandler : public display::DebugHandler {
+ public:
+  void SetVerbose(bool verbose) { verbose_ = verbose; }
+  void SetRecording(bool recording) { recording_ = recording; }
+  void SetProperty(const std::string &name, const std::string &value) { props_[name] = value; }
+
+  void Record(const StageKey &key, uint64_t ns) {
+    std::lock_guard<std::mutex> lock(lock_);
+    samples_[key].push_back(ns);
+  }
+
+  std::map<std::string, std::vector<uint64_t>> GetSamples() {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::map<std::string, std::vector<uint64_t>> samples;
+    for (auto &stage : samples_) {
+      std::string name = std::string(stage.first.first) + "::" + stage.first.second;
+      auto &merged = samples[name];
+      merged.insert(merged.end(), stage.second.begin(), stage.second.end());
+    }
+    return samples;
+  }
+
+  virtual void Error(const char *format, ...) {
+    va_list list;
+    va_start(list, format);
+    Log("E", format, list);
+    va_end(list);
+  }
+
+  virtual void Warning(const char *format, ...) {
+    va_list list;
+    va_start(list, format);
+    Log("W", format, list);
+    va_end(list);
+  }
+
+  virtual void Info(const char *format, ...) {
+    va_list list;
+    va_start(list, format);
+    if (verbose_) {
+      Log("I", format, list);
+    }
+    va_end(list);
+  }
+
+  virtual void Debug(const char *format, ...) {
+    va_list list;
+    va_start(list, format);
+    if (verbose_) {
+      Log("D", format, list);
+    }
+    va_end(list);
+  }
+
+  virtual void Verbose(const char *format, ...) {}
+
+  virtual void BeginTrace(const char *class_name, const char *function_name,
+                          const char *custom_string) {
+    scopes_.push_back({StageKey(class_name, function_name), steady_clock::now()});
+  }
+
+  virtual void EndTrace() {
+    if (scopes_.empty()) {
+      return;
+    }
+    auto scope = scopes_.back();
+    scopes_.pop_back();
+    if (recording_) {
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() -
+                                                                     scope.second).count();
+      Record(scope.first, UINT64(ns));
+    }
+  }
+
+  virtual int GetProperty(const char *property_name, int *value) {
+    auto it = props_.find(property_name);
+    if (it == props_.end()) {
+      return kErrorNotSupported;
+    }
+    *value = atoi(it->second.c_str());
+    return kErrorNone;
+  }
+
+  virtual int GetProperty(const char *property_name, char *value) {
+    auto it = props_.find(property_name);
+    if (it == props_.end()) {
+      return kErrorNotSupported;
+    }
+    snprintf(value, kPropertyValueMax, "%s", it->second.c_str());
+    return kErrorNone;
+  }
+
+ private:
+  static const int kPropertyValueMax = 92;  // PROPERTY_VALUE_MAX of the Android clients
+
+  void Log(const char *level, const char *format, va_list list) {
+    std::lock_guard<std::mutex> lock(log_lock_);
+    fprintf(stderr, "%s: ", level);
+    vfprintf(stderr, format, list);
+    fprintf(stderr, "\n");
+  }
+
+  static thread_local std::vector<std::pair<StageKey, steady_clock::time_point>> scopes_;
+  bool verbose_ = false;
+  std::atomic<bool> recording_ {false};
+  std::map<std::string, std::string> props_ = {};
+  std::mutex log_lock_;
+  std::mutex lock_;
+  std::map<StageKey, std::vector<uint64_t>> samples_ = {};
+};
+
+thread_local std::vector<std::pair<StageKey, steady_clock::time_point>>
+    ReplayDebugHandler::scopes_;
+
+// dma-bufs of the requested geometry from the system heap, enough for sdm to import and fence.
+// Without a heap, e.g. on a host running the virtual DRM backend, falls back to memfd, which
+// only a backend that owns framebuffer ids accepts.
+class ReplayBufferAllocator : public BufferAllocator {
+ public:
+  ~ReplayBufferAllocator() {
+    if (heap_fd_ >= 0) {
+      close(heap_fd_);
+    }
+  }
+
+  virtual int AllocateBuffer(BufferInfo *buffer_info) {
+    AllocatedBufferInfo &alloc = buffer_info->alloc_buffer_info;
+    GetAllocatedBufferInfo(buffer_info->buffer_config, &alloc);
+
+    int fd = (GetHeapFd() >= 0) ? AllocateDmaBuf(alloc.size) : AllocateMemFd(alloc.size);
+    if (fd < 0) {
+      DLOGE("Failed to allocate %u bytes, errno = %d", alloc.size, errno);
+      return -ENOMEM;
+    }
+
+    alloc.fd = fd;
+    alloc.id = ++id_;
+    return 0;
+  }
+
+  virtual int FreeBuffer(BufferInfo *buffer_info) {
+    if (buffer_info->alloc_buffer_info.fd >= 0) {
+      close(buffer_info->alloc_buffer_info.fd);
+      buffer_info->alloc_buffer_info.fd = -1;
+    }
+    return 0;
+  }
+
+  virtual uint32_t GetBufferSize(BufferInfo *buffer_info) {
+    AllocatedBufferInfo alloc = {};
+    GetAllocatedBufferInfo(buffer_info->buffer_config, &alloc);
+    return alloc.size;
+  }
+
+  virtual int GetAllocatedBufferInfo(const BufferConfig &buffer_config,
+                                     AllocatedBufferInfo *allocated_buffer_info) {
+    float bpp = GetBufferFormatBpp(buffer_config.format);
+    bpp = (bpp > 0.0f) ? bpp : 4.0f;
+
+    AllocatedBufferInfo &alloc = *allocated_buffer_info;
+    alloc.aligned_width = CeilToMultipleOf(buffer_config.width, 32U);
+    alloc.aligned_height = CeilToMultipleOf(buffer_config.height, 32U);
+    // Luma stride for YUV, chroma planes follow the luma plane.
+    alloc.stride = IsRgbFormat(buffer_config.format) ? UINT32(FLOAT(alloc.aligned_width) * bpp) :
+                                                       alloc.aligned_width;
+    alloc.format = buffer_config.format;
+    alloc.size = CeilToMultipleOf(UINT32(FLOAT(alloc.aligned_width * alloc.aligned_height) * bpp),
+                                  4096U);
+    return 0;
+  }
+
+ private:
+  int GetHeapFd() {
+    if (heap_probed_) {
+      return heap_fd_;
+    }
+    heap_probed_ = true;
+    for (auto name : {"/dev/dma_heap/qcom,system", "/dev/dma_heap/system"}) {
+      heap_fd_ = open(name, O_RDONLY | O_CLOEXEC);
+      if (heap_fd_ >= 0) {
+        DLOGI("Allocating from %s", name);
+        return heap_fd_;
+      }
+    }
+    DLOGW("No system dma-buf heap, buffers are memfd and need a virtual DRM backend");
+    return heap_fd_;
+  }
+
+  int AllocateDmaBuf(uint32_t size) {
+    struct dma_heap_allocation_data data = {};
+    data.len = size;
+    data.fd_flags = O_RDWR | O_CLOEXEC;
+    if (ioctl(heap_fd_, DMA_HEAP_IOCTL_ALLOC, &data) != 0) {
+      return -1;
+    }
+    return INT(data.fd);
+  }
+
+  int AllocateMemFd(uint32_t size) {
+    int fd = memfd_create("sdm_replay", MFD_CLOEXEC);
+    if (fd >= 0 && ftruncate(fd, size) != 0) {
+      close(fd);
+      fd = -1;
+    }
+    return fd;
+  }
+
+  uint64_t id_ = 0;
+  int heap_fd_ = -1;
+  bool heap_probed_ = false;
+};
+
+class ReplayBufferSyncHandler : public BufferSyncHandler {
+ public:
+  virtual int SyncWait(int fd, int timeout) {
+    struct pollfd fds = {fd, POLLIN, 0};
+    int ret = poll(&fds, 1, timeout);
+    if (ret > 0) {
+      return 0;
+    }
+    errno = (ret == 0) ? ETIME : errno;
+    return -1;
+  }
+
+  virtual int SyncMerge(int fd1, int fd2, int *merged_fd) {
+    struct sync_merge_data data = {};
+    snprintf(data.name, sizeof(data.name), "sdm_replay");
+    data.fd2 = fd2;
+    if (ioctl(fd1, SYNC_IOC_MERGE, &data) == 0) {
+      *merged_fd = data.fence;
+      return 0;
+    }
+
+    // Not sync files, e.g. the software fences of a virtual DRM backend. Resolve the first one
+    // here, the second stands for both.
+    SyncWait(fd1, -1);
+    *merged_fd = dup(fd2);
+    return (*merged_fd < 0) ? -1 : 0;
+  }
+
+  virtual void GetSyncInfo(int fd, std::ostringstream *os) { *os << "fd " << fd; }
+};
+
+class ReplaySocketHandler : public SocketHandler {
+ public:
+  virtual int GetSocketFd(SocketType socket_type) { return -1; }
+};
+
+class ReplayEventHandler : public DisplayEventHandler {
+ public:
+  virtual DisplayError VSync(const DisplayEventVSync &vsync) { return kErrorNone; }
+  virtual DisplayError Refresh() { return kErrorNone; }
+  virtual DisplayError CECMessage(char *message) { return kErrorNone; }
+  virtual DisplayError HistogramEvent(int source_fd, uint32_t blob_id) { return kErrorNone; }
+  virtual DisplayError HandleEvent(DisplayEvent event) { return kErrorNone; }
+  virtual void MMRMEvent(bool restricted) {}
+};
+
+class Replay {
+ public:
+  Replay(ReplayDebugHandler *debug_handler) : debug_handler_(debug_handler) {}
+  int Init();
+  void Deinit();
+  int Run(const std::vector<LayerStackRecord> &frames, uint32_t loops, uint32_t warmup,
+          bool sync);
+  void Report(FILE *out);
+
+ private:
+  static const char *kClientClass;
+
+  void RecordClient(const char *stage, steady_clock::time_point start);
+  int BindBuffer(Layer *layer);
+
+  ReplayDebugHandler *debug_handler_ = nullptr;
+  ReplayBufferAllocator buffer_allocator_;
+  ReplayBufferSyncHandler buffer_sync_handler_;
+  ReplaySocketHandler socket_handler_;
+  ReplayEventHandler event_handler_;
+  CoreInterface *core_intf_ = nullptr;
+  DisplayInterface *display_intf_ = nullptr;
+  std::map<uint64_t, BufferInfo> buffers_ = {};
+  bool recording_ = false;
+};
+
+const char *Replay::kClientClass = "Client";
+
+int Replay::Init() {
+  DisplayError error = CoreInterface::CreateCore(&buffer_allocator_, &buffer_sync_handler_,
+                                                 &socket_handler_, nullptr, &core_intf_);
+  if (error != kErrorNone) {
+    DLOGE("CreateCore failed, error = %d", error);
+    return -ENODEV;
+  }
+
+  HWDisplaysInfo hw_displays_info = {};
+  core_intf_->GetDisplaysStatus(&hw_displays_info);
+  for (auto &iter : hw_displays_info) {
+    HWDisplayInfo &info = iter.second;
+    if (info.display_type != kBuiltIn || !info.is_primary) {
+      continue;
+    }
+    error = core_intf_->CreateDisplay(info.display_id, &event_handler_, &display_intf_);
+    if (error != kErrorNone) {
+      DLOGE("CreateDisplay %d failed, error = %d", info.display_id, error);
+      return -ENODEV;
+    }
+    break;
+  }
+
+  if (!display_intf_) {
+    DLOGE("No primary built-in display");
+    return -ENODEV;
+  }
+
+  shared_ptr<Fence> release_fence = nullptr;
+  error = display_intf_->SetDisplayState(kStateOn, false /* teardown */, &release_fence);
+  if (error != kErrorNone) {
+    DLOGE("Power on failed, error = %d", error);
+    return -EIO;
+  }
+
+  return 0;
+}
+
+void Replay::Deinit() {
+  if (display_intf_) {
+    shared_ptr<Fence> release_fence = nullptr;
+    display_intf_->SetDisplayState(kStateOff, false /* teardown */, &release_fence);
+    core_intf_->DestroyDisplay(display_intf_);
+    display_intf_ = nullptr;
+  }
+
+  for (auto &buffer : buffers_) {
+    buffer_allocator_.FreeBuffer(&buffer.second);
+  }
+  buffers_.clear();
+
+  if (core_intf_) {
+    CoreInterface::DestroyCore();
+    core_intf_ = nullptr;
+  }
+}
+
+int Replay::BindBuffer(Layer *layer) {
+  LayerBuffer &input = layer->input_buffer;
+  if (!input.handle_id || !input.width || !input.height) {
+    return 0;
+  }
+
+  // One stand-in per recorded buffer, so swapchain reuse replays as buffer reuse.
+  auto it = buffers_.find(input.handle_id);
+  if (it == buffers_.end()) {
+    BufferInfo info = {};
+    info.buffer_config.width = input.width;
+    info.buffer_config.height = input.height;
+    info.buffer_config.format = input.format;
+    info.buffer_config.buffer_count = 1;
+    if (buffer_allocator_.AllocateBuffer(&info)) {
+      return -ENOMEM;
+    }
+    it = buffers_.emplace(input.handle_id, info).first;
+  }
+
+  const AllocatedBufferInfo &alloc = it->second.alloc_buffer_info;
+  input.planes[0].fd = alloc.fd;
+  input.planes[0].offset = 0;
+  input.planes[0].stride = alloc.stride;
+  input.size = alloc.size;
+  return 0;
+}
+
+void Replay::RecordClient(const char *stage, steady_clock::time_point start) {
+  if (recording_) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - start);
+    debug_handler_->Record(StageKey(kClientClass, stage), UINT64(ns.count()));
+  }
+}
+
+int Replay::Run(const std::vector<LayerStackRecord> &frames, uint32_t loops, uint32_t warmup,
+                bool sync) {
+  uint32_t count = 0;
+
+  for (uint32_t loop = 0; loop < loops; loop++) {
+    for (auto &frame : frames) {
+      recording_ = (count++ >= warmup);
+      debug_handler_->SetRecording(recording_);
+
+      std::vector<Layer> layers = frame.layers;
+      LayerStack layer_stack = {};
+      layer_stack.flags = frame.flags;
+      for (auto &layer : layers) {
+        if (BindBuffer(&layer)) {
+          return -ENOMEM;
+        }
+        layer_stack.layers.push_back(&layer);
+      }
+
+      auto frame_start = steady_clock::now();
+      auto start = frame_start;
+      DisplayError error = display_intf_->Prepare(&layer_stack);
+      RecordClient("Prepare", start);
+      if (error != kErrorNone && error != kErrorNeedsCommit) {
+        DLOGW("Prepare failed for frame %u, error = %d", frame.frame, error);
+        continue;
+      }
+
+      start = steady_clock::now();
+      error = display_intf_->Commit(&layer_stack);
+      RecordClient("Commit", start);
+      RecordClient("Frame", frame_start);
+      if (error != kErrorNone) {
+        DLOGW("Commit failed for frame %u, error = %d", frame.frame, error);
+        continue;
+      }
+
+      if (sync) {
+        Fence::Wait(layer_stack.retire_fence);
+      }
+    }
+  }
+
+  debug_handler_->SetRecording(false);
+  return 0;
+}
+
+void Replay::Report(FILE *out) {
+  auto samples = debug_handler_->GetSamples();
+
+  std::vector<std::pair<uint64_t, std::string>> order;
+  for (auto &stage : samples) {
+    uint64_t total = 0;
+    for (auto ns : stage.second) {
+      total += ns;
+    }
+    order.push_back(std::make_pair(total, stage.first));
+  }
+  std::sort(order.rbegin(), order.rend());
+
+  fprintf(out, "%-48s %8s %10s %10s %10s\n", "stage", "count", "p50(us)", "p99(us)", "max(us)");
+  for (auto &entry : order) {
+    std::vector<uint64_t> &ns = samples[entry.second];
+    std::sort(ns.begin(), ns.end());
+    auto percentile = [&ns](uint32_t p) {
+      size_t rank = (ns.size() * p + 99) / 100;
+      return FLOAT(ns[rank ? rank - 1 : 0]) / 1000.0f;
+    };
+    fprintf(out, "%-48s %8zu %10.1f %10.1f %10.1f\n", entry.second.c_str(), ns.size(),
+            percentile(50), percentile(99), FLOAT(ns.back()) / 1000.0f);
+  }
+}
+
+}  // namespace sdm
+
+static void Usage(const char *name) {
+  fprintf(stderr, "usage: %s [-l loops] [-w warmup_frames] [-s] [-v] [-p name=value]... "
+          "<layer_stack_dump>\n"
+          "  -l  replay the dump this many times (default 1)\n"
+          "  -w  frames to run before recording latency (default 10)\n"
+          "  -s  wait for the retire fence after every commit\n"
+          "  -v  print sdm info and debug logs\n"
+          "  -p  value returned for a debug property, may be repeated\n", name);
+}
+
+int main(int argc, char **argv) {
+  sdm::ReplayDebugHandler debug_handler;
+  uint32_t loops = 1;
+  uint32_t warmup = 10;
+  bool sync = false;
+  int opt = 0;
+
+  while ((opt = getopt(argc, argv, "l:w:svp:h")) != -1) {
+    switch (opt) {
+      case 'l':
+        loops = UINT32(strtoul(optarg, nullptr, 0));
+        break;
+      case 'w':
+        warmup = UINT32(strtoul(optarg, nullptr, 0));
+        break;
+      case 's':
+        sync = true;
+        break;
+      case 'v':
+        debug_handler.SetVerbose(true);
+        break;
+      case 'p': {
+        std::string prop = optarg;
+        size_t pos = prop.find('=');
+        if (pos == std::string::npos) {
+          Usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        debug_handler.SetProperty(prop.substr(0, pos), prop.substr(pos + 1));
+      } break;
+      default:
+        Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (optind >= argc) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  display::DebugHandler::Set(&debug_handler);
+
+  std::ifstream ifs(argv[optind]);
+  if (!ifs) {
+    fprintf(stderr, "Cannot open %s\n", argv[optind]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<sdm::LayerStackRecord> frames;
+  sdm::LayerStackRecord record;
+  while (sdm::ReadLayerStack(&ifs, &record)) {
+    frames.push_back(record);
+  }
+  if (frames.empty()) {
+    fprintf(stderr, "No frames in %s\n", argv[optind]);
+    return EXIT_FAILURE;
+  }
+
+  sdm::Replay replay(&debug_handler);
+  int ret = replay.Init();
+  if (!ret) {
+    ret = replay.Run(frames, loops, warmup, sync);
+  }
+  replay.Deinit();
+
+  if (!ret) {
+    fprintf(stdout, "%zu frames x %u loops, %u warmup\n", frames.size(), loops, warmup);
+    replay.Report(stdout);
+  }
+
+  display::DebugHandler::Set(nullptr);
+  return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
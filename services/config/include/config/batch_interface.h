@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __BATCH_INTERFACE_H__
+#define __BATCH_INTERFACE_H__
+
+#include <stdint.h>
+#include <config/client_interface.h>
+
+namespace DisplayConfig {
+
+// Queries of a ClientInterface sent to the service in one transaction. Each query takes the
+// arguments of its ClientInterface counterpart plus the status it gets, both of which are written
+// by Perform. Output of a query whose status is not 0 is left as is.
+class BatchInterface {
+ public:
+  // intf must come from ClientInterface::Create and outlive the batch.
+  static int Create(ClientInterface *intf, BatchInterface **batch);
+  static void Destroy(BatchInterface *batch);
+
+  // Queue a query. Return -EINVAL on null arguments and -E2BIG when the batch is full.
+  virtual int IsDisplayConnected(DisplayType dpy, bool *connected, int *status) = 0;
+  virtual int GetConfigCount(DisplayType dpy, uint32_t *count, int *status) = 0;
+  virtual int GetActiveConfig(DisplayType dpy, uint32_t *config, int *status) = 0;
+  virtual int GetDisplayAttributes(uint32_t config_index, DisplayType dpy,
+                                   Attributes *attributes, int *status) = 0;
+  virtual int GetPanelBrightness(uint32_t *level, int *status) = 0;
+  virtual int IsHDRSupported(uint32_t disp_id, bool *supported, int *status) = 0;
+  virtual int IsWCGSupported(uint32_t disp_id, bool *supported, int *status) = 0;
+  virtual int IsBuiltInDisplay(uint32_t disp_id, bool *is_builtin, int *status) = 0;
+
+  // Sends the queued queries and empties the batch. Statuses are only set when this returns 0.
+  virtual int Perform() = 0;
+
+ protected:
+  virtual ~BatchInterface() { }
+};
+
+}  // namespace DisplayConfig
+
+#endif  // __BATCH_INTERFACE_H__
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#include "batch_impl.h"
+
+namespace DisplayConfig {
+
+int BatchImpl::Add(uint32_t op_code, const void *input, size_t input_size, void *output,
+                   size_t output_size, int *status) {
+  if (!output || !status) {
+    return -EINVAL;
+  }
+
+  int error = request_.Add(op_code, input, input_size);
+  if (error) {
+    return error;
+  }
+
+  Output entry;
+  entry.op_code = op_code;
+  entry.data = output;
+  entry.size = output_size;
+  entry.status = status;
+  outputs_.push_back(entry);
+
+  return 0;
+}
+
+int BatchImpl::IsDisplayConnected(DisplayType dpy, bool *connected, int *status) {
+  return Add(kIsDisplayConnected, dpy, connected, status);
+}
+
+int BatchImpl::GetConfigCount(DisplayType dpy, uint32_t *count, int *status) {
+  return Add(kGetConfigCount, dpy, count, status);
+}
+
+int BatchImpl::GetActiveConfig(DisplayType dpy, uint32_t *config, int *status) {
+  return Add(kGetActiveConfig, dpy, config, status);
+}
+
+int BatchImpl::GetDisplayAttributes(uint32_t config_index, DisplayType dpy,
+                                    Attributes *attributes, int *status) {
+  struct AttributesParams input = {config_index, dpy};
+  return Add(kGetDisplayAttributes, input, attributes, status);
+}
+
+int BatchImpl::GetPanelBrightness(uint32_t *level, int *status) {
+  return Add(kGetPanelBrightness, nullptr, 0, level, sizeof(uint32_t), status);
+}
+
+int BatchImpl::IsHDRSupported(uint32_t disp_id, bool *supported, int *status) {
+  return Add(kIsHdrSupported, disp_id, supported, status);
+}
+
+int BatchImpl::IsWCGSupported(uint32_t disp_id, bool *supported, int *status) {
+  return Add(kIsWcgSupported, disp_id, supported, status);
+}
+
+int BatchImpl::IsBuiltInDisplay(uint32_t disp_id, bool *is_builtin, int *status) {
+  return Add(kIsBuiltinDisplay, disp_id, is_builtin, status);
+}
+
+int BatchImpl::Perform() {
+  std::vector<Output> outputs;
+  outputs.swap(outputs_);
+  BatchWriter request;
+  std::swap(request, request_);
+  if (outputs.empty()) {
+    return 0;
+  }
+
+  ByteStream response;
+  int error = client_->PerformBatch(request, &response);
+  if (error) {
+    return error;
+  }
+
+  BatchReader reader(response.data(), response.size());
+  BatchOp op = {};
+  for (auto &output : outputs) {
+    if (!reader.Next(&op) || op.op_code != output.op_code) {
+      *output.status = -ENODATA;
+      continue;
+    }
+
+    *output.status = op.error;
+    if (op.error) {
+      continue;
+    }
+
+    if (op.size < output.size) {
+      *output.status = -ENODATA;
+      continue;
+    }
+    memcpy(output.data, op.data, output.size);
+  }
+
+  return 0;
+}
+
+}  // namespace DisplayConfig
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __BATCH_IMPL_H__
+#define __BATCH_IMPL_H__
+
+#include <config/batch_interface.h>
+#include <vector>
+
+#include "batch_stream.h"
+#include "client_impl.h"
+
+namespace DisplayConfig {
+
+class BatchImpl : public BatchInterface {
+ public:
+  explicit BatchImpl(ClientImpl *client) : client_(client) { }
+
+  virtual int IsDisplayConnected(DisplayType dpy, bool *connected, int *status);
+  virtual int GetConfigCount(DisplayType dpy, uint32_t *count, int *status);
+  virtual int GetActiveConfig(DisplayType dpy, uint32_t *config, int *status);
+  virtual int GetDisplayAttributes(uint32_t config_index, DisplayType dpy,
+                                   Attributes *attributes, int *status);
+  virtual int GetPanelBrightness(uint32_t *level, int *status);
+  virtual int IsHDRSupported(uint32_t disp_id, bool *supported, int *status);
+  virtual int IsWCGSupported(uint32_t disp_id, bool *supported, int *status);
+  virtual int IsBuiltInDisplay(uint32_t disp_id, bool *is_builtin, int *status);
+  virtual int Perform();
+
+ private:
+  struct Output {
+    uint32_t op_code = 0;
+    void *data = nullptr;
+    size_t size = 0;
+    int *status = nullptr;
+  };
+
+  int Add(uint32_t op_code, const void *input, size_t input_size, void *output,
+          size_t output_size, int *status);
+  template <typename T, typename U>
+  int Add(uint32_t op_code, const T &input, U *output, int *status) {
+    return Add(op_code, &input, sizeof(T), output, sizeof(U), status);
+  }
+
+  ClientImpl *client_ = nullptr;
+  BatchWriter request_;
+  std::vector<Output> outputs_;
+};
+
+}  // namespace DisplayConfig
+
+#endif  // __BATCH_IMPL_H__
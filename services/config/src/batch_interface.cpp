@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include "batch_impl.h"
+
+namespace DisplayConfig {
+
+int BatchInterface::Create(ClientInterface *intf, BatchInterface **batch) {
+  if (!intf || !batch) {
+    return -1;
+  }
+
+  ClientImpl *client = static_cast<ClientImpl *>(intf);
+  BatchImpl *impl = new BatchImpl(client);
+  if (!impl) {
+    return -1;
+  }
+
+  *batch = impl;
+  return 0;
+}
+
+void BatchInterface::Destroy(BatchInterface *batch) {
+  if (batch) {
+    delete static_cast<BatchImpl *>(batch);
+  }
+}
+
+}  // namespace DisplayConfig
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "batch_stream.h"
+
+namespace DisplayConfig {
+
+static size_t AlignSize(size_t size) {
+  return (size + kBatchAlign - 1) & ~static_cast<size_t>(kBatchAlign - 1);
+}
+
+bool IsBatchable(uint32_t op_code) {
+  return op_code != kSetCwbOutputBuffer && op_code != kDestroy && op_code != kBatch;
+}
+
+BatchWriter::BatchWriter() {
+  BatchHeader header = {};
+  header.version = kBatchVersion;
+  data_.resize(AlignSize(sizeof(header)));
+  memcpy(data_.data(), &header, sizeof(header));
+}
+
+int BatchWriter::Add(uint32_t op_code, const void *data, size_t size, int32_t error) {
+  BatchHeader *header = reinterpret_cast<BatchHeader *>(data_.data());
+  if (header->count >= kBatchMaxOps || size > UINT32_MAX) {
+    return -E2BIG;
+  }
+
+  BatchEntry entry = {};
+  entry.op_code = op_code;
+  entry.error = error;
+  entry.size = static_cast<uint32_t>(size);
+
+  size_t offset = data_.size();
+  data_.resize(offset + sizeof(entry) + AlignSize(size));
+  memcpy(data_.data() + offset, &entry, sizeof(entry));
+  if (size) {
+    memcpy(data_.data() + offset + sizeof(entry), data, size);
+  }
+
+  header = reinterpret_cast<BatchHeader *>(data_.data());
+  header->count++;
+
+  return 0;
+}
+
+uint32_t BatchWriter::GetCount() const {
+  return reinterpret_cast<const BatchHeader *>(data_.data())->count;
+}
+
+BatchReader::BatchReader(const uint8_t *data, size_t size) : data_(data), size_(size) {
+  BatchHeader header = {};
+  if (!data || size < AlignSize(sizeof(header))) {
+    return;
+  }
+
+  memcpy(&header, data, sizeof(header));
+  if (header.version != kBatchVersion || header.count > kBatchMaxOps) {
+    return;
+  }
+
+  count_ = header.count;
+  offset_ = AlignSize(sizeof(header));
+  valid_ = true;
+}
+
+bool BatchReader::Next(BatchOp *op) {
+  if (!valid_ || read_ == count_ || size_ - offset_ < sizeof(BatchEntry)) {
+    return false;
+  }
+
+  BatchEntry entry = {};
+  memcpy(&entry, data_ + offset_, sizeof(entry));
+  size_t payload_offset = offset_ + sizeof(entry);
+  if (AlignSize(entry.size) > size_ - payload_offset) {
+    return false;
+  }
+
+  op->op_code = entry.op_code;
+  op->error = entry.error;
+  op->data = entry.size ? data_ + payload_offset : nullptr;
+  op->size = entry.size;
+  offset_ = payload_offset + AlignSize(entry.size);
+  read_++;
+
+  return true;
+}
+
+}  // namespace DisplayConfig
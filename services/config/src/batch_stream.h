@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __BATCH_STREAM_H__
+#define __BATCH_STREAM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "opcode_types.h"
+
+namespace DisplayConfig {
+
+// Payload of kBatch transactions, several operations in one ByteStream. A request holds the
+// op code and input of each operation, the same input its own transaction takes. The response
+// holds the status and output of each operation, in request order.
+//   BatchHeader, then per operation a BatchEntry followed by size bytes, padded to kBatchAlign.
+struct BatchHeader {
+  uint32_t version = 0;
+  uint32_t count = 0;
+};
+
+struct BatchEntry {
+  uint32_t op_code = 0;
+  int32_t error = 0;
+  uint32_t size = 0;
+  uint32_t reserved = 0;
+};
+
+static const uint32_t kBatchVersion = 1;
+static const uint32_t kBatchMaxOps = 64;
+// Keeps each payload aligned for the parameter structs it is read as.
+static const uint32_t kBatchAlign = 8;
+
+// Operations that pass handles or end the client are not batched, nor are nested batches.
+bool IsBatchable(uint32_t op_code);
+
+struct BatchOp {
+  uint32_t op_code = 0;
+  int32_t error = 0;
+  const uint8_t *data = nullptr;
+  uint32_t size = 0;
+};
+
+class BatchWriter {
+ public:
+  BatchWriter();
+  // Returns -E2BIG past kBatchMaxOps operations.
+  int Add(uint32_t op_code, const void *data, size_t size, int32_t error = 0);
+  template <typename T>
+  int Add(uint32_t op_code, const T &params) {
+    return Add(op_code, &params, sizeof(T));
+  }
+  uint32_t GetCount() const;
+  const uint8_t *GetData() const { return data_.data(); }
+  size_t GetSize() const { return data_.size(); }
+
+ private:
+  std::vector<uint8_t> data_;
+};
+
+// Walks a batch in place, the operations point into the stream and are valid as long as it is.
+class BatchReader {
+ public:
+  BatchReader(const uint8_t *data, size_t size);
+  bool IsValid() const { return valid_; }
+  uint32_t GetCount() const { return count_; }
+  // Returns false after the last operation, or at an entry that does not fit in the stream.
+  bool Next(BatchOp *op);
+  // All operations were read and the stream holds nothing else.
+  bool AtEnd() const { return valid_ && read_ == count_ && offset_ == size_; }
+
+ private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  size_t offset_ = 0;
+  uint32_t count_ = 0;
+  uint32_t read_ = 0;
+  bool valid_ = false;
+};
+
+}  // namespace DisplayConfig
+
+#endif  // __BATCH_STREAM_H__
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "batch_impl.h"
+#include "batch_stream.h"
+#include "client_impl.h"
+#include "device_impl.h"
+
+using namespace DisplayConfig;
+using namespace testing;
+
+namespace {
+
+// Round trip cost of a hwbinder transaction between two processes.
+const std::chrono::microseconds kTransactionCost(30);
+const uint32_t kConfigCount = 4;
+
+// Stands in for the composer on a device with one built-in display.
+class TestConfig : public ConfigInterface {
+ public:
+  int IsDisplayConnected(DisplayType dpy, bool *connected) override {
+    calls_++;
+    *connected = (dpy == DisplayType::kPrimary);
+    return 0;
+  }
+
+  int GetConfigCount(DisplayType dpy, uint32_t *count) override {
+    calls_++;
+    *count = kConfigCount;
+    return 0;
+  }
+
+  int GetActiveConfig(DisplayType dpy, uint32_t *config) override {
+    calls_++;
+    *config = 2;
+    return 0;
+  }
+
+  int GetDisplayAttributes(uint32_t config_index, DisplayType dpy,
+                           Attributes *attributes) override {
+    calls_++;
+    if (config_index >= kConfigCount) {
+      return -EINVAL;
+    }
+    attributes->vsync_period = 16666666 / (config_index + 1);
+    attributes->x_res = 1080;
+    attributes->y_res = 2400;
+    return 0;
+  }
+
+  int GetPanelBrightness(uint32_t *level) override {
+    calls_++;
+    *level = 200;
+    return 0;
+  }
+
+  int IsHDRSupported(uint32_t disp_id, bool *supported) override {
+    calls_++;
+    *supported = true;
+    return 0;
+  }
+
+  uint32_t GetCalls() { return calls_; }
+
+ private:
+  uint32_t calls_ = 0;
+};
+
+class TestContext : public ClientContext {
+ public:
+  int RegisterClientContext(std::shared_ptr<ConfigCallback> callback,
+                            ConfigInterface **intf) override {
+    *intf = &config_;
+    return 0;
+  }
+
+  void UnRegisterClientContext(ConfigInterface *intf) override { }
+
+  TestConfig *GetConfig() { return &config_; }
+
+ private:
+  TestConfig config_;
+};
+
+// Sits between the client and the real service in one process. Each transaction copies its
+// input in and its output out, as the transport would, and waits kTransactionCost.
+class LoopbackService : public IDisplayConfig {
+ public:
+  explicit LoopbackService(ClientContext *context) : device_(new DeviceImpl(context)) { }
+
+  Return<void> registerClient(const hidl_string &client_name,
+                              const sp<IDisplayConfigCallback> &callback,
+                              registerClient_cb _hidl_cb) override {
+    return device_->registerClient(client_name, callback, _hidl_cb);
+  }
+
+  Return<void> perform(uint64_t client_handle, uint32_t op_code, const ByteStream &input_params,
+                       const HandleStream &input_handles, perform_cb _hidl_cb) override {
+    round_trips_++;
+    auto end = std::chrono::steady_clock::now() + kTransactionCost;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+
+    if (fail_next_) {
+      int error = fail_next_;
+      fail_next_ = 0;
+      _hidl_cb(error, {}, {});
+      return Void();
+    }
+
+    // Services that predate kBatch end up in the default case of their op code switch.
+    if (op_code == kBatch && !batch_supported_) {
+      _hidl_cb(-EINVAL, {}, {});
+      return Void();
+    }
+
+    ByteStream received(input_params);
+    auto reply_cb = [&_hidl_cb] (int32_t error, const ByteStream &output_params,
+                                 const HandleStream &output_handles) {
+      ByteStream sent(output_params);
+      _hidl_cb(error, sent, output_handles);
+    };
+    return device_->perform(client_handle, op_code, received, input_handles, reply_cb);
+  }
+
+  void SetBatchSupported(bool supported) { batch_supported_ = supported; }
+  // The next transaction fails with error before it reaches the service.
+  void FailNext(int error) { fail_next_ = error; }
+  uint32_t GetRoundTrips() { return round_trips_; }
+
+ private:
+  sp<IDisplayConfig> device_;
+  bool batch_supported_ = true;
+  int fail_next_ = 0;
+  uint32_t round_trips_ = 0;
+};
+
+// What a settings client reads when it opens: connection, configs and attributes of each, one
+// config past the last to see a failed query, brightness and HDR support.
+struct DisplayInfo {
+  bool connected = false;
+  uint32_t config_count = 0;
+  uint32_t active_config = 0;
+  Attributes attributes[kConfigCount + 1] = {};
+  uint32_t brightness = 0;
+  bool hdr_supported = false;
+  std::vector<int> status;
+};
+
+const size_t kQueryCount = kConfigCount + 6;
+
+void QueryEach(ClientImpl *client, DisplayInfo *info) {
+  info->status.push_back(client->IsDisplayConnected(DisplayType::kPrimary, &info->connected));
+  info->status.push_back(client->GetConfigCount(DisplayType::kPrimary, &info->config_count));
+  info->status.push_back(client->GetActiveConfig(DisplayType::kPrimary, &info->active_config));
+  for (uint32_t config = 0; config <= kConfigCount; config++) {
+    info->status.push_back(client->GetDisplayAttributes(config, DisplayType::kPrimary,
+                                                        &info->attributes[config]));
+  }
+  info->status.push_back(client->GetPanelBrightness(&info->brightness));
+  info->status.push_back(client->IsHDRSupported(0, &info->hdr_supported));
+}
+
+int QueryBatch(BatchInterface *batch, DisplayInfo *info) {
+  info->status.assign(kQueryCount, 1);
+  int *status = info->status.data();
+  EXPECT_EQ(0, batch->IsDisplayConnected(DisplayType::kPrimary, &info->connected, status++));
+  EXPECT_EQ(0, batch->GetConfigCount(DisplayType::kPrimary, &info->config_count, status++));
+  EXPECT_EQ(0, batch->GetActiveConfig(DisplayType::kPrimary, &info->active_config, status++));
+  for (uint32_t config = 0; config <= kConfigCount; config++) {
+    EXPECT_EQ(0, batch->GetDisplayAttributes(config, DisplayType::kPrimary,
+                                             &info->attributes[config], status++));
+  }
+  EXPECT_EQ(0, batch->GetPanelBrightness(&info->brightness, status++));
+  EXPECT_EQ(0, batch->IsHDRSupported(0, &info->hdr_supported, status++));
+
+  return batch->Perform();
+}
+
+void ExpectSameInfo(const DisplayInfo &expected, const DisplayInfo &actual) {
+  EXPECT_EQ(expected.status, actual.status);
+  EXPECT_EQ(expected.connected, actual.connected);
+  EXPECT_EQ(expected.config_count, actual.config_count);
+  EXPECT_EQ(expected.active_config, actual.active_config);
+  for (uint32_t config = 0; config <= kConfigCount; config++) {
+    EXPECT_EQ(expected.attributes[config].vsync_period, actual.attributes[config].vsync_period);
+    EXPECT_EQ(expected.attributes[config].x_res, actual.attributes[config].x_res);
+    EXPECT_EQ(expected.attributes[config].y_res, actual.attributes[config].y_res);
+  }
+  EXPECT_EQ(expected.brightness, actual.brightness);
+  EXPECT_EQ(expected.hdr_supported, actual.hdr_supported);
+}
+
+class BatchTest : public Test {
+ protected:
+  void SetUp() override {
+    service_ = new LoopbackService(&context_);
+    ASSERT_EQ(0, client_.Init("batch_stream_test", nullptr, service_));
+    ASSERT_EQ(0, BatchInterface::Create(&client_, &batch_));
+  }
+
+  void TearDown() override {
+    BatchInterface::Destroy(batch_);
+    client_.DeInit();
+  }
+
+  // Round trips since the last call.
+  uint32_t GetRoundTrips() {
+    uint32_t round_trips = service_->GetRoundTrips();
+    uint32_t count = round_trips - round_trips_;
+    round_trips_ = round_trips;
+    return count;
+  }
+
+  TestContext context_;
+  sp<LoopbackService> service_;
+  ClientImpl client_;
+  BatchInterface *batch_ = nullptr;
+  uint32_t round_trips_ = 0;
+};
+
+}  // namespace
+
+TEST(BatchStreamTest, RoundTripsOperations) {
+  BatchWriter writer;
+  EXPECT_EQ(0, writer.Add(kGetActiveConfig, 0));
+  EXPECT_EQ(0, writer.Add(kRefreshScreen, nullptr, 0));
+  const char property[] = "vendor.display.enable_x";
+  EXPECT_EQ(0, writer.Add(kGetDebugProperty, property, sizeof(property), -ENOENT));
+  EXPECT_EQ(3u, writer.GetCount());
+
+  BatchReader reader(writer.GetData(), writer.GetSize());
+  ASSERT_TRUE(reader.IsValid());
+  EXPECT_EQ(3u, reader.GetCount());
+
+  BatchOp op = {};
+  ASSERT_TRUE(reader.Next(&op));
+  EXPECT_EQ(uint32_t(kGetActiveConfig), op.op_code);
+  ASSERT_EQ(sizeof(int), op.size);
+  EXPECT_EQ(0, *reinterpret_cast<const int *>(op.data));
+
+  ASSERT_TRUE(reader.Next(&op));
+  EXPECT_EQ(uint32_t(kRefreshScreen), op.op_code);
+  EXPECT_EQ(0u, op.size);
+  EXPECT_EQ(nullptr, op.data);
+
+  ASSERT_TRUE(reader.Next(&op));
+  EXPECT_EQ(-ENOENT, op.error);
+  EXPECT_STREQ(property, reinterpret_cast<const char *>(op.data));
+  // Payloads point into the stream and stay aligned for the parameter structs.
+  EXPECT_GE(op.data, writer.GetData());
+  EXPECT_LE(op.data + op.size, writer.GetData() + writer.GetSize());
+  EXPECT_EQ(0u, static_cast<size_t>(op.data - writer.GetData()) % kBatchAlign);
+
+  EXPECT_FALSE(reader.Next(&op));
+  EXPECT_TRUE(reader.AtEnd());
+}
+
+TEST(BatchStreamTest, RejectsMalformedStreams) {
+  BatchWriter writer;
+  writer.Add(kGetDisplayAttributes, AttributesParams{1, DisplayType::kPrimary});
+  writer.Add(kGetActiveConfig, 0);
+  std::vector<uint8_t> stream(writer.GetData(), writer.GetData() + writer.GetSize());
+
+  EXPECT_FALSE(BatchReader(nullptr, 0).IsValid());
+  EXPECT_FALSE(BatchReader(stream.data(), sizeof(BatchHeader) - 1).IsValid());
+
+  std::vector<uint8_t> bad_version(stream);
+  bad_version[0] = 2;
+  EXPECT_FALSE(BatchReader(bad_version.data(), bad_version.size()).IsValid());
+
+  // Truncated inside the second payload, the first operation is still read.
+  BatchReader truncated(stream.data(), stream.size() - 1);
+  BatchOp op = {};
+  EXPECT_TRUE(truncated.Next(&op));
+  EXPECT_FALSE(truncated.Next(&op));
+  EXPECT_FALSE(truncated.AtEnd());
+
+  // An entry size past the end of the stream.
+  std::vector<uint8_t> oversized(stream);
+  BatchEntry entry = {};
+  memcpy(&entry, oversized.data() + sizeof(BatchHeader), sizeof(entry));
+  entry.size = UINT32_MAX;
+  memcpy(oversized.data() + sizeof(BatchHeader), &entry, sizeof(entry));
+  BatchReader overflow(oversized.data(), oversized.size());
+  EXPECT_FALSE(overflow.Next(&op));
+
+  // Trailing data after the last operation.
+  stream.resize(stream.size() + kBatchAlign);
+  BatchReader trailing(stream.data(), stream.size());
+  while (trailing.Next(&op)) {
+  }
+  EXPECT_FALSE(trailing.AtEnd());
+
+  BatchWriter full;
+  for (uint32_t i = 0; i < kBatchMaxOps; i++) {
+    EXPECT_EQ(0, full.Add(kRefreshScreen, nullptr, 0));
+  }
+  EXPECT_EQ(-E2BIG, full.Add(kRefreshScreen, nullptr, 0));
+}
+
+TEST_F(BatchTest, MatchesPerCallResults) {
+  DisplayInfo each;
+  QueryEach(&client_, &each);
+  EXPECT_EQ(kQueryCount, GetRoundTrips());
+  EXPECT_EQ(kQueryCount, context_.GetConfig()->GetCalls());
+  EXPECT_TRUE(each.connected);
+  EXPECT_EQ(kConfigCount, each.config_count);
+  EXPECT_EQ(-EINVAL, each.status[kConfigCount + 3]);
+
+  // The first batch probes the service once.
+  DisplayInfo batched;
+  ASSERT_EQ(0, QueryBatch(batch_, &batched));
+  EXPECT_EQ(2u, GetRoundTrips());
+  EXPECT_EQ(2 * kQueryCount, context_.GetConfig()->GetCalls());
+  ExpectSameInfo(each, batched);
+
+  batched = DisplayInfo();
+  ASSERT_EQ(0, QueryBatch(batch_, &batched));
+  EXPECT_EQ(1u, GetRoundTrips());
+  ExpectSameInfo(each, batched);
+}
+
+TEST_F(BatchTest, ServiceWithoutBatch) {
+  DisplayInfo each;
+  QueryEach(&client_, &each);
+  GetRoundTrips();
+
+  service_->SetBatchSupported(false);
+  for (uint32_t probes : {1u, 0u}) {
+    DisplayInfo batched;
+    ASSERT_EQ(0, QueryBatch(batch_, &batched));
+    EXPECT_EQ(probes + kQueryCount, GetRoundTrips());
+    ExpectSameInfo(each, batched);
+  }
+}
+
+// A batch that fails says nothing about kBatch support, the next one is still one transaction.
+TEST_F(BatchTest, ErrorsDoNotDisableBatching) {
+  DisplayInfo info;
+  ASSERT_EQ(0, QueryBatch(batch_, &info));
+  GetRoundTrips();
+
+  service_->FailNext(-EINVAL);
+  EXPECT_EQ(-EINVAL, QueryBatch(batch_, &info));
+  EXPECT_EQ(std::vector<int>(kQueryCount, 1), info.status);
+  EXPECT_EQ(1u, GetRoundTrips());
+
+  DisplayInfo expected;
+  QueryEach(&client_, &expected);
+  GetRoundTrips();
+  ASSERT_EQ(0, QueryBatch(batch_, &info));
+  EXPECT_EQ(1u, GetRoundTrips());
+  ExpectSameInfo(expected, info);
+}
+
+TEST_F(BatchTest, UnbatchableOperations) {
+  for (bool batch_supported : {true, false}) {
+    SCOPED_TRACE(batch_supported);
+    service_->SetBatchSupported(batch_supported);
+    ClientImpl client;
+    ASSERT_EQ(0, client.Init("unbatchable", nullptr, service_));
+
+    BatchWriter request;
+    request.Add(kGetActiveConfig, DisplayType::kPrimary);
+    request.Add(kSetCwbOutputBuffer, nullptr, 0);
+    request.Add(kDestroy, nullptr, 0);
+    request.Add(kBatch, BatchWriter().GetData(), BatchWriter().GetSize());
+    ByteStream response;
+    ASSERT_EQ(0, client.PerformBatch(request, &response));
+
+    BatchReader reader(response.data(), response.size());
+    std::vector<int> errors;
+    BatchOp op = {};
+    while (reader.Next(&op)) {
+      errors.push_back(op.error);
+    }
+    EXPECT_TRUE(reader.AtEnd());
+    EXPECT_EQ(std::vector<int>({0, -EINVAL, -EINVAL, -EINVAL}), errors);
+
+    // The client is still registered.
+    uint32_t config = 0;
+    EXPECT_EQ(0, client.GetActiveConfig(DisplayType::kPrimary, &config));
+    EXPECT_EQ(2u, config);
+    client.DeInit();
+  }
+}
+
+TEST_F(BatchTest, Queue) {
+  bool connected = false;
+  int status = 1;
+  EXPECT_EQ(-EINVAL, batch_->IsDisplayConnected(DisplayType::kPrimary, nullptr, &status));
+  EXPECT_EQ(-EINVAL, batch_->IsDisplayConnected(DisplayType::kPrimary, &connected, nullptr));
+  EXPECT_EQ(0, batch_->Perform());
+  EXPECT_EQ(0u, GetRoundTrips());
+
+  std::vector<uint32_t> levels(kBatchMaxOps);
+  std::vector<int> statuses(kBatchMaxOps, 1);
+  for (uint32_t i = 0; i < kBatchMaxOps; i++) {
+    EXPECT_EQ(0, batch_->GetPanelBrightness(&levels[i], &statuses[i]));
+  }
+  EXPECT_EQ(-E2BIG, batch_->IsDisplayConnected(DisplayType::kPrimary, &connected, &status));
+  ASSERT_EQ(0, batch_->Perform());
+  EXPECT_EQ(std::vector<int>(kBatchMaxOps, 0), statuses);
+  EXPECT_EQ(std::vector<uint32_t>(kBatchMaxOps, 200), levels);
+  EXPECT_EQ(1, status);
+
+  // Performed queries are gone.
+  GetRoundTrips();
+  EXPECT_EQ(0, batch_->Perform());
+  EXPECT_EQ(0u, GetRoundTrips());
+}
+
+TEST_F(BatchTest, Throughput) {
+  const int kIterations = 200;
+  DisplayInfo info;
+  QueryBatch(batch_, &info);
+  GetRoundTrips();
+
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; i++) {
+    DisplayInfo each;
+    QueryEach(&client_, &each);
+  }
+  std::chrono::duration<double, std::micro> each_time = std::chrono::steady_clock::now() - begin;
+  EXPECT_EQ(kIterations * kQueryCount, GetRoundTrips());
+
+  begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; i++) {
+    DisplayInfo batched;
+    QueryBatch(batch_, &batched);
+  }
+  std::chrono::duration<double, std::micro> batch_time = std::chrono::steady_clock::now() - begin;
+  EXPECT_EQ(uint32_t(kIterations), GetRoundTrips());
+  EXPECT_LT(batch_time.count(), each_time.count());
+
+  double ops = double(kIterations * kQueryCount);
+  printf("%zu queries: per call %.1f us (%.0f ops/s), batched %.1f us (%.0f ops/s)\n",
+         kQueryCount, each_time.count() / kIterations, ops * 1e6 / each_time.count(),
+         batch_time.count() / kIterations, ops * 1e6 / batch_time.count());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -27,6 +27,14 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+/*
+* Changes from Qualcomm Innovation Center are provided under the following license:
+*
+* Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+* SPDX-License-Identifier: BSD-3-Clause-Clear
+*/
+
+#include <string.h>
 #include <string>
 #include <vector>
 
@@ -35,7 +43,12 @@
 namespace DisplayConfig {
 
 int ClientImpl::Init(std::string client_name, ConfigCallback *callback) {
-  display_config_ = IDisplayConfig::getService();
+  return Init(client_name, callback, IDisplayConfig::getService());
+}
+
+int ClientImpl::Init(std::string client_name, ConfigCallback *callback,
+                     android::sp<IDisplayConfig> display_config) {
+  display_config_ = display_config;
   // Unable to find Display Config 2.0 service. Fail Init.
   if (!display_config_) {
     return -1;
@@ -946,6 +959,69 @@ int ClientImpl::DummyDisplayConfigAPI() {
   return error;
 }
 
+int ClientImpl::PerformBatch(const BatchWriter &request, ByteStream *response) {
+  if (!display_config_ || !response) {
+    return -EINVAL;
+  }
+
+  BatchReader reader(request.GetData(), request.GetSize());
+  if (!reader.IsValid()) {
+    return -EINVAL;
+  }
+
+  std::call_once(batch_probe_, [this] { batch_supported_ = IsBatchSupported(); });
+  if (batch_supported_) {
+    int error = 0;
+    ByteStream input_params;
+    input_params.setToExternal(const_cast<uint8_t*>(request.GetData()), request.GetSize());
+    auto hidl_cb = [&error, response] (int32_t err, const ByteStream &params,
+                                       const HandleStream &handles) {
+      error = err;
+      *response = params;
+    };
+
+    display_config_->perform(client_handle_, kBatch, input_params, {}, hidl_cb);
+    return error;
+  }
+
+  BatchWriter results;
+  BatchOp op = {};
+  while (reader.Next(&op)) {
+    if (!IsBatchable(op.op_code)) {
+      results.Add(op.op_code, nullptr, 0, -EINVAL);
+      continue;
+    }
+
+    ByteStream op_input;
+    op_input.setToExternal(const_cast<uint8_t*>(op.data), op.size);
+    auto hidl_cb = [&results, &op] (int32_t err, const ByteStream &params,
+                                    const HandleStream &handles) {
+      results.Add(op.op_code, params.data(), params.size(), err);
+    };
+    display_config_->perform(client_handle_, op.op_code, op_input, {}, hidl_cb);
+  }
+
+  response->resize(results.GetSize());
+  memcpy(response->data(), results.GetData(), results.GetSize());
+
+  return 0;
+}
+
+bool ClientImpl::IsBatchSupported() {
+  // Every service that knows kBatch runs an empty batch, older ones reject the op code.
+  BatchWriter probe;
+  ByteStream input_params;
+  input_params.setToExternal(const_cast<uint8_t*>(probe.GetData()), probe.GetSize());
+  int error = -EINVAL;
+  auto hidl_cb = [&error] (int32_t err, const ByteStream &params, const HandleStream &handles) {
+    error = err;
+  };
+
+  display_config_->perform(client_handle_, kBatch, input_params, {}, hidl_cb);
+
+  return !error;
+}
+
 int ClientImpl::IsSupportedConfigSwitch(uint32_t disp_id, uint32_t config, bool *supported) {
   struct SupportedModesParams input = {disp_id, config};
   ByteStream input_params;
@@ -27,6 +27,13 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+/*
+* Changes from Qualcomm Innovation Center are provided under the following license:
+*
+* Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+* SPDX-License-Identifier: BSD-3-Clause-Clear
+*/
+
 #ifndef __CLIENT_IMPL_H__
 #define __CLIENT_IMPL_H__
 
@@ -36,9 +43,11 @@
 #include <hidl/HidlSupport.h>
 #include <log/log.h>
 #include <config/client_interface.h>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "batch_stream.h"
 #include "opcode_types.h"
 
 namespace DisplayConfig {
@@ -71,6 +80,9 @@ class ClientCallback: public IDisplayConfigCallback {
 class ClientImpl : public ClientInterface {
  public:
   int Init(std::string client_name, ConfigCallback *callback);
+  // Registers with display_config instead of the service from the service manager.
+  int Init(std::string client_name, ConfigCallback *callback,
+           android::sp<IDisplayConfig> display_config);
   void DeInit();
 
   virtual int IsDisplayConnected(DisplayType dpy, bool *connected);
@@ -129,9 +141,18 @@ class ClientImpl : public ClientInterface {
   virtual int AllowIdleFallback();
   virtual int DummyDisplayConfigAPI();
 
+  // Runs the operations of request in one transaction. response receives a batch with the status
+  // and output of each operation in request order, to be read with BatchReader. Services without
+  // kBatch, as found by a probe on the first call, are sent one transaction per operation.
+  int PerformBatch(const BatchWriter &request, ByteStream *response);
+
  private:
+  bool IsBatchSupported();
+
   android::sp<IDisplayConfig> display_config_ = nullptr;
   uint64_t client_handle_ = 0;
+  std::once_flag batch_probe_;
+  bool batch_supported_ = false;
 };
 
 }  // namespace DisplayConfig
@@ -30,7 +30,7 @@
 /*
 * Changes from Qualcomm Innovation Center are provided under the following license:
 *
-* Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+* Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
 *
 * Redistribution and use in source and binary forms, with or without
 * modification, are permitted (subject to the limitations in the
@@ -66,6 +66,7 @@
 #include <string>
 #include <vector>
 
+#include "batch_stream.h"
 #include "device_impl.h"
 
 namespace DisplayConfig {
@@ -76,7 +77,7 @@ std::mutex DeviceImpl::device_lock_;
 int DeviceImpl::CreateInstance(ClientContext *intf) {
   std::lock_guard<std::mutex> lock(device_lock_);
   if (!device_obj_) {
-    device_obj_ = new DeviceImpl();
+    device_obj_ = new DeviceImpl(intf);
     if (!device_obj_) {
       return -1;
     }
@@ -87,7 +88,6 @@ int DeviceImpl::CreateInstance(ClientContext *intf) {
       device_obj_ = nullptr;
       return -1;
     }
-    device_obj_->intf_ = intf;
   }
 
   return 0;
@@ -923,6 +923,14 @@ Return<void> DeviceImpl::perform(uint64_t client_handle, uint32_t op_code,
     _hidl_cb(error, {}, {});
      return Void();
   }
+
+  PerformOp(client, client_handle, op_code, input_params, input_handles, _hidl_cb);
+  return Void();
+}
+
+void DeviceImpl::PerformOp(std::shared_ptr<DeviceClientContext> client, uint64_t client_handle,
+                           uint32_t op_code, const ByteStream &input_params,
+                           const HandleStream &input_handles, perform_cb _hidl_cb) {
   switch (op_code) {
     case kIsDisplayConnected:
       client->ParseIsDisplayConnected(input_params, _hidl_cb);
@@ -1077,6 +1085,9 @@ Return<void> DeviceImpl::perform(uint64_t client_handle, uint32_t op_code,
     case kAllowIdleFallback:
       client->ParseAllowIdleFallback(_hidl_cb);
       break;
+    case kBatch:
+      ParseBatch(client, client_handle, input_params, _hidl_cb);
+      break;
     case kDummyOpcode:
       _hidl_cb(-EINVAL, {}, {});
       break;
@@ -1084,7 +1095,47 @@ Return<void> DeviceImpl::perform(uint64_t client_handle, uint32_t op_code,
       _hidl_cb(-EINVAL, {}, {});
       break;
   }
-  return Void();
+}
+
+void DeviceImpl::ParseBatch(std::shared_ptr<DeviceClientContext> client, uint64_t client_handle,
+                            const ByteStream &input_params, perform_cb _hidl_cb) {
+  BatchReader reader(input_params.data(), input_params.size());
+  if (!reader.IsValid()) {
+    _hidl_cb(-EINVAL, {}, {});
+    return;
+  }
+
+  BatchWriter writer;
+  BatchOp op = {};
+  while (reader.Next(&op)) {
+    uint32_t count = writer.GetCount();
+    if (!IsBatchable(op.op_code)) {
+      writer.Add(op.op_code, nullptr, 0, -EINVAL);
+      continue;
+    }
+
+    // The input of each operation is used in place.
+    ByteStream op_input;
+    op_input.setToExternal(const_cast<uint8_t *>(op.data), op.size);
+    auto op_cb = [&writer, &op] (int32_t error, const ByteStream &output_params,
+                                 const HandleStream &output_handles) {
+      writer.Add(op.op_code, output_params.data(), output_params.size(), error);
+    };
+    PerformOp(client, client_handle, op.op_code, op_input, {}, op_cb);
+
+    if (writer.GetCount() == count) {
+      writer.Add(op.op_code, nullptr, 0, -ENODATA);
+    }
+  }
+
+  if (!reader.AtEnd()) {
+    _hidl_cb(-EINVAL, {}, {});
+    return;
+  }
+
+  ByteStream output_params;
+  output_params.setToExternal(const_cast<uint8_t *>(writer.GetData()), writer.GetSize());
+  _hidl_cb(0, output_params, {});
 }
 
 }  // namespace DisplayConfig
@@ -30,7 +30,7 @@
 /*
 * Changes from Qualcomm Innovation Center are provided under the following license:
 *
-* Copyright (c) 2022 Qualcomm Innovation Center, Inc. All rights reserved.
+* Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
 *
 * Redistribution and use in source and binary forms, with or without
 * modification, are permitted (subject to the limitations in the
@@ -95,6 +95,7 @@ typedef hidl_vec<hidl_handle> HandleStream;
 class DeviceImpl : public IDisplayConfig, public android::hardware::hidl_death_recipient {
  public:
   static int CreateInstance(ClientContext *intf);
+  explicit DeviceImpl(ClientContext *intf) : intf_(intf) { }
 
  private:
   class DeviceClientContext : public ConfigCallback {
@@ -176,6 +177,13 @@ class DeviceImpl : public IDisplayConfig, public android::hardware::hidl_death_r
   void serviceDied(uint64_t client_handle,
                    const android::wp<::android::hidl::base::V1_0::IBase>& callback);
   void ParseDestroy(uint64_t client_handle, perform_cb _hidl_cb);
+  void PerformOp(std::shared_ptr<DeviceClientContext> client, uint64_t client_handle,
+                 uint32_t op_code, const ByteStream &input_params,
+                 const HandleStream &input_handles, perform_cb _hidl_cb);
+  // Runs the operations of a kBatch transaction in order and replies with the output and status
+  // of each, see batch_stream.h.
+  void ParseBatch(std::shared_ptr<DeviceClientContext> client, uint64_t client_handle,
+                  const ByteStream &input_params, perform_cb _hidl_cb);
 
   ClientContext *intf_ = nullptr;
   std::map<uint64_t, std::shared_ptr<DeviceClientContext>> display_config_map_;
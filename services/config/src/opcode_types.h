@@ -27,6 +27,13 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+/*
+* Changes from Qualcomm Innovation Center are provided under the following license:
+*
+* Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+* SPDX-License-Identifier: BSD-3-Clause-Clear
+*/
+
 #ifndef __OPCODE_TYPES_H__
 #define __OPCODE_TYPES_H__
 
@@ -84,6 +91,7 @@ enum OpCode {
   kGetDisplayType = 48,
   kAllowIdleFallback = 49,
   kDummyOpcode = 50,
+  kBatch = 51,  // Several operations in one transaction, see batch_stream.h
 
   kDestroy = 0xFFFF, // Destroy sequence execution
 };